@@ -0,0 +1,323 @@
+#include "./LinkClusterCodec.h"
+
+// This class holds the kernels used to pass WavePass class distributions
+// between nodes. Every kernel works on a block of floats at a time using
+// AVX2 (8 floats) or SSE2 (4 floats), a float at a time is used if
+// neither is available. The per node update works on a tile of BLOCK_SIZE
+// nodes laid out class by class, that is one block for each class with a
+// node in each lane. This way the update runs across the nodes in the
+// tile whatever the number of classes, rather than across the handful of
+// classes in a single node. Distributions are still stored a node at a
+// time since passing them along the links reads every class of a src.
+class CClassVector {
+
+public:
+
+	// This defines the number of floats held in a block
+#if defined(USE_AVX2)
+	static const int BLOCK_SIZE = 8;
+#else
+	static const int BLOCK_SIZE = 4;
+#endif
+
+private:
+
+#if defined(USE_AVX2)
+	typedef __m256 SBlock;
+
+	static inline SBlock Load(const float *ptr) {return _mm256_loadu_ps(ptr);}
+	static inline void Store(float *ptr, SBlock a) {_mm256_storeu_ps(ptr, a);}
+	static inline SBlock Set(float val) {return _mm256_set1_ps(val);}
+	static inline SBlock Add(SBlock a, SBlock b) {return _mm256_add_ps(a, b);}
+	static inline SBlock Sub(SBlock a, SBlock b) {return _mm256_sub_ps(a, b);}
+	static inline SBlock Mul(SBlock a, SBlock b) {return _mm256_mul_ps(a, b);}
+	static inline SBlock Div(SBlock a, SBlock b) {return _mm256_div_ps(a, b);}
+	// This returns a where the mask is set otherwise b
+	static inline SBlock Select(SBlock mask, SBlock a, SBlock b) {
+		return _mm256_blendv_ps(b, a, mask);
+	}
+	// This returns a mask of the lanes equal to zero
+	static inline SBlock IsZero(SBlock a) {
+		return _mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_EQ_OQ);
+	}
+#elif defined(USE_SSE2)
+	typedef __m128 SBlock;
+
+	static inline SBlock Load(const float *ptr) {return _mm_loadu_ps(ptr);}
+	static inline void Store(float *ptr, SBlock a) {_mm_storeu_ps(ptr, a);}
+	static inline SBlock Set(float val) {return _mm_set1_ps(val);}
+	static inline SBlock Add(SBlock a, SBlock b) {return _mm_add_ps(a, b);}
+	static inline SBlock Sub(SBlock a, SBlock b) {return _mm_sub_ps(a, b);}
+	static inline SBlock Mul(SBlock a, SBlock b) {return _mm_mul_ps(a, b);}
+	static inline SBlock Div(SBlock a, SBlock b) {return _mm_div_ps(a, b);}
+	// This returns a where the mask is set otherwise b
+	static inline SBlock Select(SBlock mask, SBlock a, SBlock b) {
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+	// This returns a mask of the lanes equal to zero
+	static inline SBlock IsZero(SBlock a) {
+		return _mm_cmpeq_ps(a, _mm_setzero_ps());
+	}
+#else
+	// This stands in for a register when no vector unit is available,
+	// a lane of the mask is non zero where it's set
+	struct SBlock {
+		float lane[BLOCK_SIZE];
+	};
+
+	static inline SBlock Load(const float *ptr) {
+		SBlock a;
+		for(int i=0; i<BLOCK_SIZE; i++) a.lane[i] = ptr[i];
+		return a;
+	}
+	static inline void Store(float *ptr, SBlock a) {
+		for(int i=0; i<BLOCK_SIZE; i++) ptr[i] = a.lane[i];
+	}
+	static inline SBlock Set(float val) {
+		SBlock a;
+		for(int i=0; i<BLOCK_SIZE; i++) a.lane[i] = val;
+		return a;
+	}
+	static inline SBlock Add(SBlock a, SBlock b) {
+		for(int i=0; i<BLOCK_SIZE; i++) a.lane[i] += b.lane[i];
+		return a;
+	}
+	static inline SBlock Sub(SBlock a, SBlock b) {
+		for(int i=0; i<BLOCK_SIZE; i++) a.lane[i] -= b.lane[i];
+		return a;
+	}
+	static inline SBlock Mul(SBlock a, SBlock b) {
+		for(int i=0; i<BLOCK_SIZE; i++) a.lane[i] *= b.lane[i];
+		return a;
+	}
+	static inline SBlock Div(SBlock a, SBlock b) {
+		for(int i=0; i<BLOCK_SIZE; i++) a.lane[i] /= b.lane[i];
+		return a;
+	}
+	// This returns a where the mask is set otherwise b
+	static inline SBlock Select(SBlock mask, SBlock a, SBlock b) {
+		for(int i=0; i<BLOCK_SIZE; i++) {
+			if(mask.lane[i] != 0) b.lane[i] = a.lane[i];
+		}
+		return b;
+	}
+	// This returns a mask of the lanes equal to zero
+	static inline SBlock IsZero(SBlock a) {
+		for(int i=0; i<BLOCK_SIZE; i++) a.lane[i] = (a.lane[i] == 0) ? 1.0f : 0;
+		return a;
+	}
+#endif
+
+	// This returns the sum of the lanes in a block
+	static inline float LaneSum(SBlock a) {
+
+		float lane[BLOCK_SIZE];
+		Store(lane, a);
+
+		float sum = 0;
+		for(int i=0; i<BLOCK_SIZE; i++) {
+			sum += lane[i];
+		}
+
+		return sum;
+	}
+
+	// This loads a tile of nodes class by class, lanes passed the
+	// last node are set to zero
+	// @param dist - the distribution of each node stored a node at a time
+	// @param node_num - the number of nodes in the tile
+	// @param class_num - the number of classes
+	// @param tile - stores a block for each class
+	static inline void LoadTile(const float dist[], int node_num,
+		int class_num, float tile[]) {
+
+		for(int j=0; j<class_num; j++) {
+			float *block = tile + (j * BLOCK_SIZE);
+			for(int i=0; i<node_num; i++) {
+				block[i] = dist[(i * class_num) + j];
+			}
+
+			for(int i=node_num; i<BLOCK_SIZE; i++) {
+				block[i] = 0;
+			}
+		}
+	}
+
+	// This stores a tile of nodes back a node at a time
+	// @param tile - stores a block for each class
+	// @param node_num - the number of nodes in the tile
+	// @param class_num - the number of classes
+	// @param dist - the distribution of each node stored a node at a time
+	static inline void StoreTile(const float tile[], int node_num,
+		int class_num, float dist[]) {
+
+		for(int i=0; i<node_num; i++) {
+			for(int j=0; j<class_num; j++) {
+				dist[(i * class_num) + j] = tile[(j * BLOCK_SIZE) + i];
+			}
+		}
+	}
+
+public:
+
+	// This returns the sum of a vector
+	// @param vector - the vector being summed
+	// @param size - the number of floats in the vector
+	static float Sum(const float vector[], int size) {
+
+		int i = 0;
+		float sum = 0;
+		if(size >= BLOCK_SIZE) {
+			SBlock acc = Load(vector);
+			for(i=BLOCK_SIZE; i + BLOCK_SIZE <= size; i += BLOCK_SIZE) {
+				acc = Add(acc, Load(vector + i));
+			}
+
+			sum = LaneSum(acc);
+		}
+
+		for(; i<size; i++) {
+			sum += vector[i];
+		}
+
+		return sum;
+	}
+
+	// This divides every float in a vector by the vector sum
+	// @param vector - the vector being normalized
+	// @param size - the number of floats in the vector
+	// @return the sum of the vector before it was normalized
+	static float Normalize(float vector[], int size) {
+
+		float sum = Sum(vector, size);
+		SBlock div = Set(sum);
+
+		int i = 0;
+		for(; i + BLOCK_SIZE <= size; i += BLOCK_SIZE) {
+			Store(vector + i, Div(Load(vector + i), div));
+		}
+
+		for(; i<size; i++) {
+			vector[i] /= sum;
+		}
+
+		return sum;
+	}
+
+	// This adds a scaled vector to another vector
+	// @param dst - stores the sum
+	// @param src - the vector being scaled
+	// @param weight - this is multiplied by each float in src
+	// @param size - the number of floats in each vector
+	static inline void ScaleAdd(float dst[], const float src[], float weight, int size) {
+
+		int i = 0;
+		SBlock scale = Set(weight);
+		for(; i + BLOCK_SIZE <= size; i += BLOCK_SIZE) {
+			Store(dst + i, Add(Load(dst + i), Mul(Load(src + i), scale)));
+		}
+
+		for(; i<size; i++) {
+			dst[i] += src[i] * weight;
+		}
+	}
+
+	// This turns the class weight summed over all nodes into the class
+	// weight used to keep wave pass balanced. Classes that hold more of
+	// the distribution are given less weight.
+	// @param class_weight - the summed class weight, stores the balanced weight
+	// @param class_num - the number of classes
+	static void BalanceClassWeight(float class_weight[], int class_num) {
+
+		Normalize(class_weight, class_num);
+
+		int i = 0;
+		SBlock one = Set(1.0f);
+		for(; i + BLOCK_SIZE <= class_num; i += BLOCK_SIZE) {
+			SBlock weight = Add(one, Load(class_weight + i));
+			Store(class_weight + i, Mul(Mul(weight, weight), weight));
+		}
+
+		for(; i<class_num; i++) {
+			class_weight[i] = (1 + class_weight[i]) *
+				(1 + class_weight[i]) * (1 + class_weight[i]);
+		}
+
+		Normalize(class_weight, class_num);
+
+		for(i=0; i + BLOCK_SIZE <= class_num; i += BLOCK_SIZE) {
+			Store(class_weight + i, Sub(one, Load(class_weight + i)));
+		}
+
+		for(; i<class_num; i++) {
+			class_weight[i] = 1 - class_weight[i];
+		}
+
+		Normalize(class_weight, class_num);
+	}
+
+	// This updates the distribution of a set of nodes based upon the
+	// distribution passed to each node by its neighbours. The passed
+	// distribution is normalized, weighted by the current distribution
+	// and class weight, normalized again and added to the current
+	// distribution which is then normalized. Nodes that were passed
+	// nothing are left unchanged.
+	// @param dist - the distribution of each node, stored a node at a time
+	// @param acc_dist - the distribution passed to each node
+	// @param class_weight - the class weight used to keep wave pass balanced
+	// @param node_num - the number of nodes
+	// @param class_num - the number of classes
+	// @param class_sum - the updated distribution summed over every node
+	//                  - is added to this
+	static void UpdateDistribution(float dist[], const float acc_dist[],
+		const float class_weight[], int node_num, int class_num, double class_sum[]) {
+
+		CMemoryChunk<float> tile(class_num * BLOCK_SIZE * 3);
+		float *curr = tile.Buffer();
+		float *acc = curr + (class_num * BLOCK_SIZE);
+		float *updated = acc + (class_num * BLOCK_SIZE);
+
+		for(int i=0; i<node_num; i += BLOCK_SIZE) {
+			int tile_num = min(BLOCK_SIZE, node_num - i);
+			float *node_dist = dist + (i * class_num);
+			LoadTile(node_dist, tile_num, class_num, curr);
+			LoadTile(acc_dist + (i * class_num), tile_num, class_num, acc);
+
+			SBlock acc_sum = Set(0);
+			for(int j=0; j<class_num; j++) {
+				acc_sum = Add(acc_sum, Load(acc + (j * BLOCK_SIZE)));
+			}
+
+			SBlock new_sum = Set(0);
+			for(int j=0; j<class_num; j++) {
+				float *block = acc + (j * BLOCK_SIZE);
+				SBlock new_dist = Mul(Div(Load(block), acc_sum),
+					Mul(Load(curr + (j * BLOCK_SIZE)), Set(class_weight[j])));
+				Store(block, new_dist);
+				new_sum = Add(new_sum, new_dist);
+			}
+
+			SBlock sum = Set(0);
+			for(int j=0; j<class_num; j++) {
+				float *block = updated + (j * BLOCK_SIZE);
+				Store(block, Add(Load(curr + (j * BLOCK_SIZE)),
+					Div(Load(acc + (j * BLOCK_SIZE)), new_sum)));
+				sum = Add(sum, Load(block));
+			}
+
+			// nodes that were passed nothing keep their distribution, 
+			// this also covers the empty lanes at the end
+			SBlock is_unlinked = IsZero(acc_sum);
+			for(int j=0; j<class_num; j++) {
+				float *block = updated + (j * BLOCK_SIZE);
+				SBlock node = Select(is_unlinked, Load(curr + (j * BLOCK_SIZE)),
+					Div(Load(block), sum));
+				Store(block, node);
+				class_sum[j] += LaneSum(node);
+			}
+
+			StoreTile(updated, tile_num, class_num, node_dist);
+		}
+	}
+};
+const int CClassVector::BLOCK_SIZE;
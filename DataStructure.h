@@ -10,6 +10,10 @@ typedef HANDLE pthread_t;
 #define THREAD_RETURN1 unsigned 
 #define THREAD_RETURN2 _stdcall
 
+#include <xmmintrin.h>
+#define PREFETCH_READ(ptr) _mm_prefetch((const char *)(ptr), _MM_HINT_T0)
+#define THREAD_LOCAL __declspec(thread)
+
 void WaitForProcess(HANDLE handle, uLong elap_time) {
 	WaitForSingleObject(handle, elap_time);
 }
@@ -26,6 +30,7 @@ void WaitForThread(HANDLE handle, uLong elap_time) {
 #include <arpa/inet.h>
 #include <fcntl.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <netdb.h>
 #include <unistd.h>
 #include <dirent.h>
@@ -35,6 +40,11 @@ void WaitForThread(HANDLE handle, uLong elap_time) {
 #include <iostream>
 #include <errno.h>    
 #include <sys/un.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
 
 #undef MPI_ANY_TAG
 #define MPI_ANY_TAG 123
@@ -46,6 +56,8 @@ void WaitForThread(HANDLE handle, uLong elap_time) {
 #define INFINITE 0xFFFFFFFF
 #define THREAD_RETURN1 void
 #define THREAD_RETURN2 *
+#define PREFETCH_READ(ptr) __builtin_prefetch(ptr)
+#define THREAD_LOCAL __thread
 
 typedef int SOCKET;
 typedef void* thread_return;
@@ -612,37 +624,56 @@ public:
 	}
 }; 
 
+#ifndef OS_WINDOWS
+
 // This is a general purpose class used for timing.
 class CStopWatch {
 
+	// This stores the start and stop time
+	struct timeval m_start;
+	struct timeval m_stop;
+	//	This stores the net elapsed time
+	double m_net_elapased;
+
 public:
 
 	CStopWatch() {
+		memset(&m_start, 0, sizeof(m_start));
+		memset(&m_stop, 0, sizeof(m_stop));
+		m_net_elapased = 0;
 	}
 
 	// This starts the stopwatch
 	void StartTimer() {
+		gettimeofday(&m_start, NULL);
 	}
 
 	// This stops the stopwatch
 	void StopTimer() {
+		gettimeofday(&m_stop, NULL);
+		m_net_elapased += GetElapsedTime();
 	}
 
 	// This returns the net elapsed time
 	double NetElapsedTime() {
-		return 0;
+		double time = m_net_elapased;
+		m_net_elapased = 0;
+		return time;
 	}
 
-	// This returns the time elapsed in microseconds
+	// This returns the time elapsed in seconds
 	double GetElapsedTime() {
-		return 0;
+		return (m_stop.tv_sec - m_start.tv_sec) + 
+			((m_stop.tv_usec - m_start.tv_usec) / 1000000.0);
 	}
 };
 
+#endif
+
 // Converts character strings into numerical strings and vice versa
 class CANConvert {
-	// used to store the results
-	static char str[64]; 
+	// used to store the results, each thread has its own
+	static THREAD_LOCAL char str[64]; 
 
 public:
 
@@ -721,7 +752,229 @@ public:
 		return str; 
 	}
 }; 
-char CANConvert::str[64];
+THREAD_LOCAL char CANConvert::str[64];
+
+// This class is used to scan a text buffer a block of bytes at a time 
+// rather than a byte at a time. A block is compared against a byte or
+// a range of bytes with a single instruction using AVX2 (32 bytes) or
+// SSE2 (16 bytes), a byte at a time is used if neither is available.
+// Each comparison returns a mask with a bit set for every byte in the
+// block that matched, bit 0 being the first byte in the block.
+class CByteScan {
+
+public:
+
+	// This defines the number of bytes compared at a time
+#if defined(USE_AVX2)
+	static const int BLOCK_SIZE = 32;
+#elif defined(USE_SSE2)
+	static const int BLOCK_SIZE = 16;
+#else
+	static const int BLOCK_SIZE = 8;
+#endif
+
+	// This returns the mask of the bytes in a block equal to a given byte
+	// @param block - a ptr to the first byte in the block
+	// @param ch - the byte being matched
+	static inline uLong ByteMask(const char block[], char ch) {
+
+#if defined(USE_AVX2)
+		__m256i data = _mm256_loadu_si256((const __m256i *)block);
+		return (uLong)_mm256_movemask_epi8(_mm256_cmpeq_epi8(data, _mm256_set1_epi8(ch)));
+#elif defined(USE_SSE2)
+		__m128i data = _mm_loadu_si128((const __m128i *)block);
+		return (uLong)_mm_movemask_epi8(_mm_cmpeq_epi8(data, _mm_set1_epi8(ch)));
+#else
+		uLong mask = 0;
+		for(int i=0; i<BLOCK_SIZE; i++) {
+			if(block[i] == ch) {
+				mask |= 1 << i;
+			}
+		}
+		return mask;
+#endif
+	}
+
+	// This returns the mask of the bytes in a block that lie between two
+	// ASCII characters inclusive, bytes above 127 never match
+	// @param block - a ptr to the first byte in the block
+	// @param low - the lowest byte matched
+	// @param high - the highest byte matched
+	static inline uLong RangeMask(const char block[], char low, char high) {
+
+#if defined(USE_AVX2)
+		__m256i data = _mm256_loadu_si256((const __m256i *)block);
+		__m256i above = _mm256_cmpgt_epi8(data, _mm256_set1_epi8(low - 1));
+		__m256i below = _mm256_cmpgt_epi8(_mm256_set1_epi8(high + 1), data);
+		return (uLong)_mm256_movemask_epi8(_mm256_and_si256(above, below));
+#elif defined(USE_SSE2)
+		__m128i data = _mm_loadu_si128((const __m128i *)block);
+		__m128i above = _mm_cmpgt_epi8(data, _mm_set1_epi8(low - 1));
+		__m128i below = _mm_cmplt_epi8(data, _mm_set1_epi8(high + 1));
+		return (uLong)_mm_movemask_epi8(_mm_and_si128(above, below));
+#else
+		uLong mask = 0;
+		for(int i=0; i<BLOCK_SIZE; i++) {
+			if(block[i] >= low && block[i] <= high) {
+				mask |= 1 << i;
+			}
+		}
+		return mask;
+#endif
+	}
+
+	// This returns the mask of the english letters in a block. Setting
+	// bit 5 maps capitals onto lower case so a single range is checked.
+	// @param block - a ptr to the first byte in the block
+	static inline uLong LetterMask(const char block[]) {
+
+#if defined(USE_AVX2)
+		__m256i data = _mm256_or_si256(_mm256_loadu_si256
+			((const __m256i *)block), _mm256_set1_epi8(0x20));
+		__m256i above = _mm256_cmpgt_epi8(data, _mm256_set1_epi8('a' - 1));
+		__m256i below = _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), data);
+		return (uLong)_mm256_movemask_epi8(_mm256_and_si256(above, below));
+#elif defined(USE_SSE2)
+		__m128i data = _mm_or_si128(_mm_loadu_si128
+			((const __m128i *)block), _mm_set1_epi8(0x20));
+		__m128i above = _mm_cmpgt_epi8(data, _mm_set1_epi8('a' - 1));
+		__m128i below = _mm_cmplt_epi8(data, _mm_set1_epi8('z' + 1));
+		return (uLong)_mm_movemask_epi8(_mm_and_si128(above, below));
+#else
+		return RangeMask(block, 'a', 'z') | RangeMask(block, 'A', 'Z');
+#endif
+	}
+
+	// This returns the position of the first set bit in a non zero mask
+	static inline int FirstBit(uLong mask) {
+
+#if defined(__GNUC__)
+		return __builtin_ctz(mask);
+#else
+		int bit = 0;
+		while((mask & 0x01) == 0) {
+			mask >>= 1;
+			bit++;
+		}
+		return bit;
+#endif
+	}
+
+	// This returns the number of set bits in a mask
+	static inline int BitCount(uLong mask) {
+
+#if defined(__GNUC__)
+		return __builtin_popcount(mask);
+#else
+		mask = mask - ((mask >> 1) & 0x55555555);
+		mask = (mask & 0x33333333) + ((mask >> 2) & 0x33333333);
+		return (((mask + (mask >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+#endif
+	}
+
+	// This finds the first occurrence of either of two bytes in a buffer,
+	// for instance the next html tag boundary '<' or '>'
+	// @param buff - the buffer being searched
+	// @param start - the first byte searched
+	// @param end - one past the last byte searched
+	// @return the position of the byte, end if neither byte was found
+	static int FindAnyOf(const char buff[], int start, int end, char ch1, char ch2) {
+
+		int i = start;
+		for(; i + BLOCK_SIZE <= end; i += BLOCK_SIZE) {
+			uLong mask = ByteMask(buff + i, ch1) | ByteMask(buff + i, ch2);
+			if(mask != 0) {
+				return i + FirstBit(mask);
+			}
+		}
+
+		for(; i<end; i++) {
+			if(buff[i] == ch1 || buff[i] == ch2) {
+				return i;
+			}
+		}
+
+		return end;
+	}
+
+	// This finds the first white space character (space, tab, new line 
+	// or carriage return) in a buffer
+	// @param buff - the buffer being searched
+	// @param start - the first byte searched
+	// @param end - one past the last byte searched
+	// @return the position of the white space, end if none was found
+	static int FindWhiteSpace(const char buff[], int start, int end) {
+
+		int i = start;
+		for(; i + BLOCK_SIZE <= end; i += BLOCK_SIZE) {
+			uLong mask = ByteMask(buff + i, ' ') | RangeMask(buff + i, '\t', '\r');
+			if(mask != 0) {
+				return i + FirstBit(mask);
+			}
+		}
+
+		for(; i<end; i++) {
+			if(buff[i] == ' ' || (buff[i] >= '\t' && buff[i] <= '\r')) {
+				return i;
+			}
+		}
+
+		return end;
+	}
+
+	// This returns the number of english letters in a buffer
+	// @param buff - the buffer being counted
+	// @param size - the number of bytes in the buffer
+	static int CountLetters(const char buff[], int size) {
+
+		int i = 0;
+		int count = 0;
+		for(; i + BLOCK_SIZE <= size; i += BLOCK_SIZE) {
+			count += BitCount(LetterMask(buff + i));
+		}
+
+		for(; i<size; i++) {
+			if((buff[i] >= 'a' && buff[i] <= 'z') || (buff[i] >= 'A' && buff[i] <= 'Z')) {
+				count++;
+			}
+		}
+
+		return count;
+	}
+
+	// This converts the capitals in a buffer to lower case
+	// @param buff - the buffer being converted
+	// @param size - the number of bytes in the buffer
+	static void LowerCase(char buff[], int size) {
+
+		int i = 0;
+#if defined(USE_AVX2)
+		for(; i + 32 <= size; i += 32) {
+			__m256i data = _mm256_loadu_si256((const __m256i *)(buff + i));
+			__m256i above = _mm256_cmpgt_epi8(data, _mm256_set1_epi8('A' - 1));
+			__m256i below = _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), data);
+			__m256i shift = _mm256_and_si256(_mm256_and_si256(above, below), _mm256_set1_epi8(0x20));
+			_mm256_storeu_si256((__m256i *)(buff + i), _mm256_add_epi8(data, shift));
+		}
+#endif
+#if defined(USE_SSE2)
+		for(; i + 16 <= size; i += 16) {
+			__m128i data = _mm_loadu_si128((const __m128i *)(buff + i));
+			__m128i above = _mm_cmpgt_epi8(data, _mm_set1_epi8('A' - 1));
+			__m128i below = _mm_cmplt_epi8(data, _mm_set1_epi8('Z' + 1));
+			__m128i shift = _mm_and_si128(_mm_and_si128(above, below), _mm_set1_epi8(0x20));
+			_mm_storeu_si128((__m128i *)(buff + i), _mm_add_epi8(data, shift));
+		}
+#endif
+
+		for(; i<size; i++) {
+			if(buff[i] >= 'A' && buff[i] <= 'Z') {
+				buff[i] += 'a' - 'A';
+			}
+		}
+	}
+};
+const int CByteScan::BLOCK_SIZE;
 
 // This is a very useful general purpose utility class
 // that deals mostly with text strings such as alphabets
@@ -735,12 +988,13 @@ class CUtility {
 
 protected:
 
+	// a general buffer used to store results, the temp buffers 
+	// are kept per thread so tasks can run in the same process
+	static THREAD_LOCAL char m_temp_buff1[4096]; 
 	// a general buffer used to store results
-	static char m_temp_buff1[4096]; 
+	static THREAD_LOCAL char m_temp_buff2[4096]; 
 	// a general buffer used to store results
-	static char m_temp_buff2[4096]; 
-	// a general buffer used to store results
-	static char m_temp_buff3[4096]; 
+	static THREAD_LOCAL char m_temp_buff3[4096]; 
 
 public:
 
@@ -845,24 +1099,12 @@ public:
 
 	// Counts the number of english characters in the buffer
 	inline static int CountEnglishCharacters(char buffer[], int size) {
-		int count = 0; 
-		for(int i=0; i<size; i++) {
-			if(AskEnglishCharacter(buffer[i]))
-				count++; 
-		}
-
-		return count; 
+		return CByteScan::CountLetters(buffer, size); 
 	}
 
 	// Converts a buffer to lower case if a character contains a capital
 	inline static void ConvertBufferToLowerCase(char buffer[], int size) {
-		for(int i=0; i<size; i++) {
-			if(buffer[i] < 'A' || buffer[i] > 'Z') {
-				continue;
-			}
-
-			ConvertToLowerCaseCharacter(buffer[i]); 
-		}
+		CByteScan::LowerCase(buffer, size);
 	}
 
 	// Returns true if the buffer contains a non stop character
@@ -1438,9 +1680,9 @@ public:
 	}
 }; 
 bool CUtility::m_ok_character[256];
-char CUtility::m_temp_buff1[4096];
-char CUtility::m_temp_buff2[4096]; 
-char CUtility::m_temp_buff3[4096]; 
+THREAD_LOCAL char CUtility::m_temp_buff1[4096];
+THREAD_LOCAL char CUtility::m_temp_buff2[4096]; 
+THREAD_LOCAL char CUtility::m_temp_buff3[4096]; 
 
 // allocates a block of memory - used in vector
 template <class X> class CMemory {
@@ -1740,6 +1982,17 @@ public:
 		for(int i=0; i<OverflowSize(); i++)
 			m_memory[i] = 0; 
 	}
+
+	// swaps the block of memory with another memory chunk
+	// without copying any of the elements
+	inline void Swap(CBaseMemoryChunk<X> &chunk) {
+		X *memory = m_memory;
+		int size = m_size;
+		m_memory = chunk.m_memory;
+		m_size = chunk.m_size;
+		chunk.m_memory = memory;
+		chunk.m_size = size;
+	}
 	
 	~CBaseMemoryChunk() {
 		if(m_memory) {
@@ -1973,6 +2226,15 @@ public:
 		m_size = 0; 
 	}
 
+	// swaps the contents of the array with another 
+	// array without copying any of the elements
+	inline void Swap(CBaseArray<X> &array) {
+		m_memory.Swap(array.m_memory);
+		int size = m_size;
+		m_size = array.m_size;
+		array.m_size = size;
+	}
+
 	// deletes an element from the array
 	// @param index - the index of the element to delete
 	void DeleteElement(int index) {
@@ -2157,151 +2419,740 @@ public:
 	}
 }; 
 
-// This is used for the write comp block thread
-struct SCompBlockThread {
-	// This stores a ptr to the comp buffer
-	CBaseMemoryChunk<char> comp_buffer;
-	// This stores the compression size
-	int compress_size;
-	// This stores the normal uncompressed size
-	int norm_size;
-};
+// This is the codec layer that sits beneath every compression block 
+// written by CHDFSFile and CCompression. The codec used to compress a
+// block is packed into the upper bits of the uncompressed block size 
+// stored alongside it. Zlib is codec zero so that files written before
+// the codec id existed can still be decoded. LZ4 and Zstd are only 
+// available when compiled in with USE_LZ4 and USE_ZSTD, otherwise 
+// blocks fall back to zlib when written.
+class CBlockCodec {
 
-// This defines the root DFS directory
-const char *DFS_ROOT = "/work1/s4141073/DyableCollection/";
+	// This defines the bit offset of the codec id in the block size
+	static const int CODEC_SHIFT = 28;
+	// This defines the mask used to extract the uncompressed block size
+	static const int BLOCK_SIZE_MASK = (1 << CODEC_SHIFT) - 1;
 
-// This is a very useful file class that handles
-// all access to an external file. Besides the
-// standard write and read functions there is also
-// the equivalent compression functions that compress
-// an object or several groups of objects.
-class CHDFSFile {
+public:
 
-	// This defines the number of hash divisions for the LocalData directory
-	static const int HASH_DIV_NUM = 8192;
+	// This defines the zlib codec
+	static const int ZLIB_CODEC = 0;
+	// This defines the lz4 codec
+	static const int LZ4_CODEC = 1;
+	// This defines the zstd codec
+	static const int ZSTD_CODEC = 2;
+	// This defines the number of codecs
+	static const int CODEC_NUM = 3;
+
+	// This returns true if the codec has been compiled in
+	// @param codec - the codec id being checked
+	static bool IsCodecAvailable(int codec) {
+
+		switch(codec) {
+			case ZLIB_CODEC:
+				return true;
+			#ifdef USE_LZ4
+			case LZ4_CODEC:
+				return true;
+			#endif
+			#ifdef USE_ZSTD
+			case ZSTD_CODEC:
+				return true;
+			#endif
+		}
 
-	// This stores the number of bytes stored
-	_int64 m_bytes_stored;
+		return false;
+	}
 
-	// This writes the compressed block to external storage 
-	void WriteCompressedBlock() {
+	// This returns the name of a codec
+	// @param codec - the codec id 
+	static const char *CodecName(int codec) {
 
-		WriteObject(m_write_thread.compress_size); 
-		WriteObject(m_write_thread.norm_size); 
-		WriteObject(m_write_thread.comp_buffer.Buffer(), m_write_thread.compress_size);
+		switch(codec) {
+			case ZLIB_CODEC:
+				return "zlib";
+			case LZ4_CODEC:
+				return "lz4";
+			case ZSTD_CODEC:
+				return "zstd";
+		}
+
+		return "unknown";
 	}
 
-	// This returns the hash directory for a given file
-	const char *HashDirectory(const char *dir) {
+	// This returns the codec used to write a given file. Intermediate 
+	// LocalData files favour speed while GlobalData files favour ratio.
+	// @param dir - the directory of the file being written
+	static int DefaultCodec(const char *dir) {
 
-		char *temp_buff = m_directory.Buffer() + strlen(m_directory.Buffer()) + 5;
-		strcpy(temp_buff, DFS_ROOT);
+		if(CUtility::FindFragment(dir, "LocalData/")) {
+			if(IsCodecAvailable(LZ4_CODEC)) {
+				return LZ4_CODEC;
+			}
+		}
 
-		if(CUtility::FindFragment(dir, "LocalData/") == false) {
-			strcat(temp_buff, dir);
-			return temp_buff;
+		if(CUtility::FindFragment(dir, "GlobalData/")) {
+			if(IsCodecAvailable(ZSTD_CODEC)) {
+				return ZSTD_CODEC;
+			}
 		}
 
-		int div = CHashFunction::UniversalHash(HASH_DIV_NUM, dir, strlen(dir));
-		strcat(temp_buff, "LocalData/Div");
-		strcat(temp_buff, CANConvert::NumericToAlpha(div));
-		strcat(temp_buff, "/");
-		strcat(temp_buff, dir + strlen("LocalData/"));
+		return ZLIB_CODEC;
+	}
 
-		return temp_buff;
+	// This packs the codec id into the uncompressed block size
+	// @param block_size - the uncompressed size of the block
+	// @param codec - the codec used to compress the block
+	static inline int EncodeBlockSize(int block_size, int codec) {
+		if(block_size > BLOCK_SIZE_MASK) {
+			throw EOverflowException("Block Size Too Large");
+		}
+
+		return block_size | (codec << CODEC_SHIFT);
 	}
 
-protected:
+	// This returns the uncompressed size from an encoded block size
+	static inline int BlockSize(int enc_size) {
+		return enc_size & BLOCK_SIZE_MASK;
+	}
 
-	// This stores a ptr to the open file stream
-	FILE *m_file_ptr;
+	// This returns the codec from an encoded block size
+	static inline int BlockCodec(int enc_size) {
+		return (uLong)enc_size >> CODEC_SHIFT;
+	}
 
-	// stores the directory of the file
-	CBaseMemoryChunk<char> m_directory;
-	// used to store a single compression block
-	CBaseArray<char> m_comp_buffer; 
-	// This is used to store the results to a file system
-	SCompBlockThread m_write_thread;
-	// stores the current compression offset within the file
-	int m_comp_offset;
-	// This stores the total number of bytes read
-	_int64 m_bytes_read;
+	// This compresses a buffer with a given codec. If the codec is not 
+	// available zlib is used instead and the codec is updated to match.
+	// @param codec - the codec used to compress the buffer
+	// @param input - an input buffer to compress
+	// @param output - the compressed character buffer
+	// @param input_size - the size of the input buffer in bytes
+	// @return the size of the compressed buffer in bytes
+	static int Compress(int &codec, const char input[], 
+		CBaseMemoryChunk<char> &output, int input_size) {
 
-	// Writes the compression buffer to file
-	// @param last_block - false if the last block is being written
-	int FlushCompressionBuffer(bool last_block = false) {
+		if(IsCodecAvailable(codec) == false) {
+			codec = ZLIB_CODEC;
+		}
 
-		if(m_comp_buffer.OverflowSize() == 0) {
-			InitializeCompression();
-			return 0;
+		#ifdef USE_LZ4
+		if(codec == LZ4_CODEC) {
+			output.AllocateMemory(LZ4_compressBound(input_size));
+			int length = LZ4_compress_default(input, output.Buffer(),
+				input_size, output.OverflowSize());
+
+			if(length <= 0) {
+				throw ECompressionException("Could Not Compress Buffer"); 
+			}
+
+			return length;
 		}
+		#endif
 
-		int compress_size = CompressBuffer(m_comp_buffer.Buffer(), 
-			m_write_thread.comp_buffer, m_comp_buffer.Size()); 
+		#ifdef USE_ZSTD
+		if(codec == ZSTD_CODEC) {
+			output.AllocateMemory((int)ZSTD_compressBound(input_size));
+			size_t length = ZSTD_compress(output.Buffer(), output.OverflowSize(),
+				input, input_size, 3);
 
-		m_write_thread.compress_size = compress_size;
-		m_write_thread.norm_size = m_comp_buffer.Size();
+			if(ZSTD_isError(length)) {
+				throw ECompressionException("Could Not Compress Buffer"); 
+			}
 
-		m_comp_buffer.Resize(0); 
-		if(compress_size <= 0) {
-			return -1; 
+			return (int)length;
 		}
+		#endif
 
-		WriteCompressedBlock();
+		uLongf length = (uLongf)((input_size * 1.1f) + 13); 
+		output.AllocateMemory(length); 
 
-		return compress_size + (sizeof(int) << 1); 
+		if(compress2(reinterpret_cast<Bytef *> (output.Buffer()), &length, 
+			reinterpret_cast < const Bytef *> (input), input_size, 
+			Z_DEFAULT_COMPRESSION) != Z_OK) {
+				throw ECompressionException("Could Not Compress Buffer"); 
+			}
+
+		return (int)length; 
 	}
 
-	// reads the next compression block from file
-	bool GetNextCompressionBlock() {
+	// This decompresses a buffer that was compressed with a given codec
+	// @param codec - the codec used to compress the buffer
+	// @param input - the compressed input buffer
+	// @param output - the uncompressed output buffer
+	// @param input_size - the size of the input buffer in bytes
+	// @param output_size - the size of the output buffer in bytes
+	static void Decompress(int codec, const char input[], char output[], 
+		int input_size, int output_size) {
 
-		if(m_bytes_read < 0) {
-			return false;
+		if(codec == ZLIB_CODEC) {
+			uLongf length = output_size; 
+			if(uncompress(reinterpret_cast<Bytef *> (output), &length, 
+				reinterpret_cast<const Bytef *> (input), input_size) != Z_OK) {
+					throw ECompressionException("Could Not Decompress Buffer"); 
+			}
+			return;
 		}
 
-		int norm_size; 
-		int compress_size; 
-		if(ReadObject(compress_size) == false) {
-			compress_size = -1;
+		#ifdef USE_LZ4
+		if(codec == LZ4_CODEC) {
+			if(LZ4_decompress_safe(input, output, input_size, output_size) < 0) {
+				throw ECompressionException("Could Not Decompress Buffer"); 
+			}
+			return;
 		}
+		#endif
 
-		if(compress_size < 0) {
-			m_bytes_read = -1;
-			return false;
+		#ifdef USE_ZSTD
+		if(codec == ZSTD_CODEC) {
+			if(ZSTD_isError(ZSTD_decompress(output, output_size, input, input_size))) {
+				throw ECompressionException("Could Not Decompress Buffer"); 
+			}
+			return;
 		}
+		#endif
 
-		if(m_comp_buffer.OverflowSize() == 0) {
-			InitializeCompression();
+		throw ECompressionException("Codec Not Available"); 
+	}
+};
+
+// This is used for the write comp block thread
+struct SCompBlockThread {
+	// This stores a ptr to the comp buffer
+	CBaseMemoryChunk<char> comp_buffer;
+	// This stores the compression size
+	int compress_size;
+	// This stores the normal uncompressed size
+	int norm_size;
+	// This stores the uncompressed block waiting to be compressed
+	CBaseArray<char> norm_buffer;
+	// This stores the codec used to compress the block
+	int codec;
+	// This is signalled once the block has been compressed
+	CSemaphore compressed;
+	// This stores a ptr to the next block in the work queue
+	SCompBlockThread *next_ptr;
+};
+
+// This is a pool of compressor threads shared by every file in the 
+// process. Filled comp blocks are queued by the writing file and 
+// compressed in the order they were added. Each file is responsible 
+// for writing its own compressed blocks back out in order.
+class CCompBlockPool {
+
+	// This stores the number of compressor threads
+	static int m_thread_num;
+	// This stores the head of the work queue
+	static SCompBlockThread *m_head_ptr;
+	// This stores the tail of the work queue
+	static SCompBlockThread *m_tail_ptr;
+	// This protects the work queue
+	static CMutex *m_mutex;
+	// This is signalled for every block added to the work queue
+	static CSemaphore *m_work;
+	// This protects the creation of the compressor threads when
+	// files are written by more than one thread
+	static CMutex m_init_mutex;
+
+	// This compresses blocks from the work queue
+	static THREAD_RETURN1 THREAD_RETURN2 CompressorThread(void *ptr) {
+
+		while(true) {
+			m_work->Wait();
+
+			m_mutex->Acquire();
+			SCompBlockThread *block = m_head_ptr;
+			m_head_ptr = block->next_ptr;
+			if(m_head_ptr == NULL) {
+				m_tail_ptr = NULL;
+			}
+			m_mutex->Release();
+
+			try {
+				block->compress_size = CBlockCodec::Compress(block->codec, 
+					block->norm_buffer.Buffer(), block->comp_buffer, 
+					block->norm_buffer.Size());
+				block->norm_size = CBlockCodec::EncodeBlockSize
+					(block->norm_buffer.Size(), block->codec);
+			} catch(...) {
+				block->compress_size = -1;
+			}
+
+			block->compressed.Signal();
 		}
-		
-		m_comp_offset = 0; 
-		ReadObject(norm_size); 
 
-		if(norm_size > m_comp_buffer.OverflowSize()) {
-			m_comp_buffer.Initialize(norm_size);
+		return 0;
+	}
+
+	// This starts the compressor threads
+	static void Initialize() {
+
+		m_init_mutex.Acquire();
+		if(m_work != NULL) {
+			m_init_mutex.Release();
+			return;
 		}
 
-		CBaseMemoryChunk<char> decompress(compress_size); 
-		ReadObject(decompress.Buffer(), compress_size); 
+		if(m_thread_num <= 0) {
+			m_thread_num = ProcessorNum();
+		}
 
-		try {
-			DecompressBuffer(decompress.Buffer(), 
-				m_comp_buffer.Buffer(), compress_size, norm_size); 
-		} catch(...) {
-			cout<<"Could Not Decompress "<<m_directory.Buffer()<<endl;
-			throw EException("");
+		m_mutex = new CMutex;
+		m_head_ptr = NULL;
+		m_tail_ptr = NULL;
+
+		m_work = new CSemaphore;
+
+		unsigned int threadID;
+		for(int i=0; i<m_thread_num; i++) {
+			_beginthreadex(NULL, 0, CompressorThread, NULL, NULL, &threadID);
 		}
 
-		m_bytes_read += compress_size;
-		m_comp_buffer.Resize(norm_size); 
-		return true;
+		m_init_mutex.Release();
 	}
 
 public:
 
-	CHDFSFile() {
-		m_bytes_stored = -1;
-		m_file_ptr = NULL;
+	// This returns the number of processors available
+	static int ProcessorNum() {
+		#ifdef OS_WINDOWS
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return max((int)info.dwNumberOfProcessors, 1);
+		#else
+		return max((int)sysconf(_SC_NPROCESSORS_ONLN), 1);
+		#endif
+	}
+
+	// This sets the number of compressor threads, this must 
+	// be called before the first block is added to the pool
+	// @param thread_num - the number of compressor threads
+	static void SetThreadNum(int thread_num) {
+		if(m_work == NULL) {
+			m_thread_num = thread_num;
+		}
+	}
+
+	// This adds a block to the back of the work queue
+	// @param block - the block that needs to be compressed
+	static void AddBlock(SCompBlockThread *block) {
+
+		if(m_work == NULL) {
+			Initialize();
+		}
+
+		block->next_ptr = NULL;
+		m_mutex->Acquire();
+		if(m_tail_ptr == NULL) {
+			m_head_ptr = block;
+		} else {
+			m_tail_ptr->next_ptr = block;
+		}
+		m_tail_ptr = block;
+		m_mutex->Release();
+
+		m_work->Signal();
+	}
+};
+int CCompBlockPool::m_thread_num;
+SCompBlockThread *CCompBlockPool::m_head_ptr;
+SCompBlockThread *CCompBlockPool::m_tail_ptr;
+CMutex *CCompBlockPool::m_mutex;
+CSemaphore *CCompBlockPool::m_work;
+CMutex CCompBlockPool::m_init_mutex;
+
+// This stores a single block that has been read and decompressed
+// ahead of the consumer by the read ahead thread
+struct SReadAheadBlock {
+	// This stores the uncompressed block
+	CBaseArray<char> block;
+	// This stores the compressed size of the block, -1 at the end
+	// of the file and -2 if the block could not be decompressed
+	int compress_size;
+	// This is signalled when the block is free to be loaded
+	CSemaphore empty;
+	// This is signalled when the block has been loaded
+	CSemaphore full;
+
+	SReadAheadBlock() : empty(1), full(0) {
+	}
+};
+
+// This stores the state of the read ahead thread. Two blocks are
+// loaded in turn so that block N+1 is read and decompressed while 
+// the caller consumes block N.
+struct SReadAhead {
+	// This stores the double buffered blocks
+	SReadAheadBlock block[2];
+	// This stores the compressed block read from file
+	CBaseMemoryChunk<char> comp_buffer;
+	// This stores the block currently being consumed by the caller
+	int curr_block;
+	// This stores the file offset of the next block to be consumed
+	_int64 file_offset;
+	// This is set when the read ahead thread needs to stop
+	bool is_stop;
+	// This protects the stop flag
+	CMutex mutex;
+	// This stores the handle of the read ahead thread
+	pthread_t handle;
+};
+
+// This defines the root DFS directory
+const char *DFS_ROOT = "/work1/s4141073/DyableCollection/";
+
+// This is a very useful file class that handles
+// all access to an external file. Besides the
+// standard write and read functions there is also
+// the equivalent compression functions that compress
+// an object or several groups of objects.
+class CHDFSFile {
+
+	// This defines the number of hash divisions for the LocalData directory
+	static const int HASH_DIV_NUM = 8192;
+	// This defines the maximum number of bytes in an escaped integer
+	static const int MAX_ESCAPED_BYTES = 10;
+
+	// This stores the number of bytes stored
+	_int64 m_bytes_stored;
+	// This stores the codec used to compress blocks written to the file
+	int m_codec;
+	// This is set if blocks are loaded by the read ahead thread
+	bool m_is_read_ahead;
+	// This stores the read ahead state, NULL if the thread isn't running
+	SReadAhead *m_read_ahead;
+	// This stores the compressed block read from file
+	CBaseMemoryChunk<char> m_read_buffer;
+
+	// These store a decoded escaped integer in each item type
+	inline static void SetEscapedItem(uLong &item, _int64 value) {
+		item = (uLong)value;
+	}
+
+	inline static void SetEscapedItem(_int64 &item, _int64 value) {
+		item = value;
+	}
+
+	inline static void SetEscapedItem(S5Byte &item, _int64 value) {
+		item.SetValue(value);
+	}
+
+	// This reads and decompresses the next compression block
+	// @param block - this stores the uncompressed block
+	// @param comp_buffer - this stores the compressed block
+	// @return the compressed size, -1 if at the end of the file
+	int ReadCompressionBlock(CBaseArray<char> &block, 
+		CBaseMemoryChunk<char> &comp_buffer) {
+
+		int norm_size; 
+		int compress_size; 
+		if(ReadObject(compress_size) == false) {
+			return -1;
+		}
+
+		if(compress_size < 0) {
+			return -1;
+		}
+
+		ReadObject(norm_size); 
+		int codec = CBlockCodec::BlockCodec(norm_size);
+		norm_size = CBlockCodec::BlockSize(norm_size);
+
+		if(norm_size > block.OverflowSize()) {
+			block.Initialize(norm_size);
+		}
+
+		if(compress_size > comp_buffer.OverflowSize()) {
+			comp_buffer.AllocateMemory(compress_size);
+		}
+
+		ReadObject(comp_buffer.Buffer(), compress_size); 
+		CBlockCodec::Decompress(codec, comp_buffer.Buffer(), 
+			block.Buffer(), compress_size, norm_size); 
+
+		block.Resize(norm_size); 
+		return compress_size;
+	}
+
+	// This loads blocks in the background until the end of the 
+	// file is reached or the read ahead is stopped
+	static THREAD_RETURN1 THREAD_RETURN2 ReadAheadThread(void *ptr) {
+
+		CHDFSFile *this_ptr = (CHDFSFile *)ptr;
+		SReadAhead *read_ahead = this_ptr->m_read_ahead;
+
+		int curr_block = 0;
+		while(true) {
+			SReadAheadBlock &block = read_ahead->block[curr_block];
+			block.empty.Wait();
+			read_ahead->mutex.Acquire();
+			bool is_stop = read_ahead->is_stop;
+			read_ahead->mutex.Release();
+
+			if(is_stop == true) {
+				break;
+			}
+
+			try {
+				block.compress_size = this_ptr->ReadCompressionBlock
+					(block.block, read_ahead->comp_buffer);
+			} catch(...) {
+				block.compress_size = -2;
+			}
+
+			block.full.Signal();
+			if(block.compress_size < 0) {
+				break;
+			}
+
+			curr_block ^= 1;
+		}
+
+		return 0;
+	}
+
+	// This starts the read ahead thread from the current file position
+	void StartReadAhead() {
+
+		m_read_ahead = new SReadAhead;
+		m_read_ahead->curr_block = 0;
+		m_read_ahead->is_stop = false;
+		m_read_ahead->file_offset = ftello(m_file_ptr);
+
+		unsigned int threadID;
+		m_read_ahead->handle = (pthread_t)_beginthreadex(NULL, 0, 
+			ReadAheadThread, this, NULL, &threadID);
+	}
+
+	// This stops the read ahead thread and moves the file 
+	// back to the start of the next unconsumed block
+	void StopReadAhead() {
+
+		if(m_read_ahead == NULL) {
+			return;
+		}
+
+		m_read_ahead->mutex.Acquire();
+		m_read_ahead->is_stop = true;
+		m_read_ahead->mutex.Release();
+
+		m_read_ahead->block[0].empty.Signal();
+		m_read_ahead->block[1].empty.Signal();
+		WaitForThread(m_read_ahead->handle, INFINITE);
+
+		fseeko(m_file_ptr, m_read_ahead->file_offset, SEEK_SET);
+		delete m_read_ahead;
+		m_read_ahead = NULL;
+	}
+
+	// This swaps in the next block loaded by the read ahead thread
+	// @return false if no more blocks are available
+	bool GetNextReadAheadBlock() {
+
+		if(m_read_ahead == NULL) {
+			StartReadAhead();
+		}
+
+		SReadAheadBlock &block = m_read_ahead->block[m_read_ahead->curr_block];
+		block.full.Wait();
+
+		if(block.compress_size < 0) {
+			if(block.compress_size < -1) {
+				cout<<"Could Not Decompress "<<m_directory.Buffer()<<endl;
+				throw EException("");
+			}
+
+			m_bytes_read = -1;
+			return false;
+		}
+
+		// the previous block is handed back to be reused
+		m_comp_buffer.Swap(block.block);
+		m_comp_offset = 0; 
+		m_bytes_read += block.compress_size;
+		m_read_ahead->file_offset += block.compress_size + (sizeof(int) << 1);
+		m_read_ahead->curr_block ^= 1;
+
+		block.empty.Signal();
+		return true;
+	}
+
+	// This writes the compressed block to external storage 
+	// @param block - the compressed block being written
+	void WriteCompressedBlock(SCompBlockThread &block) {
+
+		WriteObject(block.compress_size); 
+		WriteObject(block.norm_size); 
+		WriteObject(block.comp_buffer.Buffer(), block.compress_size);
+	}
+
+	// This waits for the oldest block in the compression pipeline
+	// to be compressed and writes it to external storage
+	void WritePipelineBlock() {
+
+		SCompBlockThread &block = m_write_pipeline[m_pipeline_head];
+		block.compressed.Wait();
+
+		m_pipeline_head = (m_pipeline_head + 1) % m_pipeline_depth;
+		m_pipeline_size--;
+
+		if(block.compress_size <= 0) {
+			throw ECompressionException("Could Not Compress Buffer"); 
+		}
+
+		WriteCompressedBlock(block);
+	}
+
+	// This hands the comp buffer to the compression pool. The comp buffer
+	// is swapped with a free block so the caller can keep writing.
+	// @param last_block - true if all pending blocks must be written
+	void FlushPipelineBuffer(bool last_block) {
+
+		if(m_pipeline_size >= m_pipeline_depth) {
+			WritePipelineBlock();
+		}
+
+		int buffer_size = m_comp_buffer.OverflowSize();
+		SCompBlockThread &block = m_write_pipeline
+			[(m_pipeline_head + m_pipeline_size) % m_pipeline_depth];
+
+		block.norm_buffer.Swap(m_comp_buffer);
+		if(m_comp_buffer.OverflowSize() != buffer_size) {
+			m_comp_buffer.Initialize(buffer_size);
+		}
+
+		m_comp_buffer.Resize(0); 
+		block.codec = m_codec;
+		m_pipeline_size++;
+		CCompBlockPool::AddBlock(&block);
+
+		while(last_block == true && m_pipeline_size > 0) {
+			WritePipelineBlock();
+		}
+	}
+
+	// This returns the hash directory for a given file
+	const char *HashDirectory(const char *dir) {
+
+		char *temp_buff = m_directory.Buffer() + strlen(m_directory.Buffer()) + 5;
+		strcpy(temp_buff, DFS_ROOT);
+
+		if(CUtility::FindFragment(dir, "LocalData/") == false) {
+			strcat(temp_buff, dir);
+			return temp_buff;
+		}
+
+		int div = CHashFunction::UniversalHash(HASH_DIV_NUM, dir, strlen(dir));
+		strcat(temp_buff, "LocalData/Div");
+		strcat(temp_buff, CANConvert::NumericToAlpha(div));
+		strcat(temp_buff, "/");
+		strcat(temp_buff, dir + strlen("LocalData/"));
+
+		return temp_buff;
+	}
+
+protected:
+
+	// This stores a ptr to the open file stream
+	FILE *m_file_ptr;
+
+	// stores the directory of the file
+	CBaseMemoryChunk<char> m_directory;
+	// used to store a single compression block
+	CBaseArray<char> m_comp_buffer; 
+	// This is used to store the results to a file system
+	SCompBlockThread m_write_thread;
+	// This stores the blocks waiting in the compression pool
+	SCompBlockThread *m_write_pipeline;
+	// This stores the maximum number of blocks in the pipeline
+	int m_pipeline_depth;
+	// This stores the oldest block in the pipeline
+	int m_pipeline_head;
+	// This stores the number of blocks in the pipeline
+	int m_pipeline_size;
+	// stores the current compression offset within the file
+	int m_comp_offset;
+	// This stores the total number of bytes read
+	_int64 m_bytes_read;
+
+	// Writes the compression buffer to file
+	// @param last_block - true if the last block is being written
+	// @return the number of bytes written, zero if the block 
+	//         was handed to the compression pool
+	int FlushCompressionBuffer(bool last_block = false) {
+
+		if(m_comp_buffer.OverflowSize() == 0) {
+			InitializeCompression();
+			return 0;
+		}
+
+		if(m_pipeline_depth > 0) {
+			FlushPipelineBuffer(last_block);
+			return 0;
+		}
+
+		int codec = m_codec;
+		int compress_size = CBlockCodec::Compress(codec, m_comp_buffer.Buffer(), 
+			m_write_thread.comp_buffer, m_comp_buffer.Size()); 
+
+		m_write_thread.compress_size = compress_size;
+		m_write_thread.norm_size = CBlockCodec::EncodeBlockSize
+			(m_comp_buffer.Size(), codec);
+
+		m_comp_buffer.Resize(0); 
+		if(compress_size <= 0) {
+			return -1; 
+		}
+
+		WriteCompressedBlock(m_write_thread);
+
+		return compress_size + (sizeof(int) << 1); 
+	}
+
+	// reads the next compression block from file
+	bool GetNextCompressionBlock() {
+
+		if(m_bytes_read < 0) {
+			return false;
+		}
+
+		if(m_is_read_ahead == true) {
+			return GetNextReadAheadBlock();
+		}
+
+		if(m_comp_buffer.OverflowSize() == 0) {
+			InitializeCompression();
+		}
+
+		int compress_size;
+		try {
+			compress_size = ReadCompressionBlock(m_comp_buffer, m_read_buffer);
+		} catch(...) {
+			cout<<"Could Not Decompress "<<m_directory.Buffer()<<endl;
+			throw EException("");
+		}
+
+		if(compress_size < 0) {
+			m_bytes_read = -1;
+			return false;
+		}
+
+		m_comp_offset = 0; 
+		m_bytes_read += compress_size;
+		return true;
+	}
+
+public:
+
+	CHDFSFile() {
+		m_bytes_stored = -1;
+		m_file_ptr = NULL;
+		m_codec = CBlockCodec::ZLIB_CODEC;
+		m_is_read_ahead = false;
+		m_read_ahead = NULL;
+		m_write_pipeline = NULL;
+		m_pipeline_depth = 0;
+		m_pipeline_head = 0;
+		m_pipeline_size = 0;
 	}
 
 	// This just sets the directory name of the file
@@ -2310,6 +3161,49 @@ public:
 		SetFileName(dir);
 		m_bytes_stored = -1;
 		m_file_ptr = NULL;
+		m_is_read_ahead = false;
+		m_read_ahead = NULL;
+		m_write_pipeline = NULL;
+		m_pipeline_depth = 0;
+		m_pipeline_head = 0;
+		m_pipeline_size = 0;
+	}
+
+	// This hands filled comp blocks to the shared compression pool 
+	// instead of compressing them on the caller's thread. Blocks 
+	// are still written in order so the file format is unchanged.
+	// @param block_num - the maximum number of blocks waiting to be
+	//                  - compressed, zero compresses on the caller
+	void SetCompressionPipeline(int block_num) {
+
+		while(m_pipeline_size > 0 && m_pipeline_depth > 0) {
+			WritePipelineBlock();
+		}
+
+		if(m_write_pipeline != NULL) {
+			delete []m_write_pipeline;
+			m_write_pipeline = NULL;
+		}
+
+		m_pipeline_head = 0;
+		m_pipeline_size = 0;
+		m_pipeline_depth = max(block_num, 0);
+		if(m_pipeline_depth > 0) {
+			m_write_pipeline = new SCompBlockThread[m_pipeline_depth];
+		}
+	}
+
+	// This sets the read ahead mode for sequential scans of a read file. 
+	// When set a background thread reads and decompresses the next 
+	// comp block while the current one is being consumed. Raw reads
+	// with ReadObject must not be mixed with comp reads in this mode.
+	// @param is_read_ahead - true to enable read ahead, false otherwise
+	void SetReadAhead(bool is_read_ahead) {
+		if(is_read_ahead == false) {
+			StopReadAhead();
+		}
+
+		m_is_read_ahead = is_read_ahead;
 	}
 
 	// This opens a read file, it closes any previous files that 
@@ -2383,6 +3277,7 @@ public:
 
 	// This resests the readfile at the beginning
 	inline void ResetReadFile() {
+		StopReadAhead();
 		m_comp_buffer.Initialize(m_comp_buffer.OverflowSize()); 
 		fseeko(m_file_ptr, 0L, SEEK_SET);
 		m_comp_offset = 0; 
@@ -2400,8 +3295,8 @@ public:
 
 	// This replaces a file
 	static int Rename(const char *dir1, const char *dir2) {
-		static char temp_buff1[100];
-		static char temp_buff2[100];
+		char temp_buff1[100];
+		char temp_buff2[100];
 		strcpy(temp_buff1, DFS_ROOT);
 		strcat(temp_buff1, dir1);
 
@@ -2413,7 +3308,7 @@ public:
 
 	// This removes a file
 	static int Remove(const char *dir) {
-		static char temp_buff[100];
+		char temp_buff[100];
 		strcpy(temp_buff, DFS_ROOT);
 		strcat(temp_buff, dir);
 		return remove(temp_buff);
@@ -2469,6 +3364,19 @@ public:
 	inline void SetFileName(const char str[]) {
 		m_directory.AllocateMemory(2048);
 		strcpy(m_directory.Buffer(), str);
+		m_codec = CBlockCodec::DefaultCodec(str);
+	}
+
+	// This overrides the codec used to compress blocks written to the 
+	// file. This must be called after the file name has been set.
+	// @param codec - one of the codecs defined in CBlockCodec
+	inline void SetCodec(int codec) {
+		m_codec = codec;
+	}
+
+	// Returns the codec used to compress blocks written to the file
+	inline int Codec() {
+		return m_codec;
 	}
 
 	// This copies the contents of this file to another file
@@ -2608,13 +3516,59 @@ public:
 		return fread((char *)object, sizeof(X), size, m_file_ptr) > 0; 	
 	}
 
+	// This reads a block of raw bytes from file
+	// @param buffer - stores the bytes read
+	// @param max_size - the maximum number of bytes to read
+	// @return the number of bytes read, zero at the end of the file
+	inline int ReadObjectBlock(char buffer[], int max_size) {
+		return (int)fread(buffer, sizeof(char), max_size, m_file_ptr);
+	}
+
+	// This reads raw bytes up to and including a delimiter. The stream 
+	// is locked once for the whole read rather than once for every byte.
+	// @param buffer - stores the bytes read
+	// @param max_size - the maximum number of bytes to read
+	// @param delim - the byte that ends the read
+	// @return the number of bytes read, zero at the end of the file
+	int ReadObjectUntil(char buffer[], int max_size, char delim) {
+
+		int size = 0;
+#ifdef OS_WINDOWS
+		_lock_file(m_file_ptr);
+		while(size < max_size) {
+			int ch = _getc_nolock(m_file_ptr);
+#else
+		flockfile(m_file_ptr);
+		while(size < max_size) {
+			int ch = getc_unlocked(m_file_ptr);
+#endif
+			if(ch == EOF) {
+				break;
+			}
+
+			buffer[size++] = (char)ch;
+			if((char)ch == delim) {
+				break;
+			}
+		}
+
+#ifdef OS_WINDOWS
+		_unlock_file(m_file_ptr);
+#else
+		funlockfile(m_file_ptr);
+#endif
+		return size;
+	}
+
 	// seeks a number of bytes from the current position in the file
 	inline void SeekReadFileCurrentPosition(_int64 offset) {
+		StopReadAhead();
 		fseeko(m_file_ptr, offset, SEEK_CUR); 
 	}
 	
 	// seeks a number of bytes from the beginning of the file
 	inline void SeekReadFileFromBeginning(_int64 offset) {
+		StopReadAhead();
 		fseeko(m_file_ptr, offset, SEEK_SET); 
 	}
 
@@ -2640,7 +3594,7 @@ public:
 		item = 0; 
 		int offset = 0; 
 		int byte_count = 1; 
-		static char hit; 
+		char hit; 
 
 		while(true) {
 			if(!ReadCompObject(hit)) {
@@ -2666,7 +3620,7 @@ public:
 		int offset = 0; 
 		uLong item = 0; 
 		int byte_count = 1; 
-		static char hit; 
+		char hit; 
 
 		while(offset < 28) {
 			if(!ReadCompObject(hit))return -1;
@@ -2723,6 +3677,187 @@ public:
 		return bytes; 
 	}
 
+	// This returns the unread bytes in the current comp block so they 
+	// can be decoded in place rather than copied out an object at a time.
+	// The span is only valid until the next comp block is loaded, which
+	// happens on any read that runs past the end of the span.
+	// @param span_size - stores the number of bytes in the span
+	// @return a ptr to the first unread byte, NULL at the end of the file
+	const char *CompSpan(int &span_size) {
+
+		while(m_comp_offset >= m_comp_buffer.Size()) {
+			if(!GetNextCompressionBlock()) {
+				span_size = 0;
+				return NULL;
+			}
+		}
+
+		span_size = m_comp_buffer.Size() - m_comp_offset;
+		return m_comp_buffer.Buffer() + m_comp_offset;
+	}
+
+	// This moves the read position past bytes consumed from the span
+	// @param byte_num - the number of bytes consumed
+	inline void SkipCompSpan(int byte_num) {
+		m_comp_offset += byte_num;
+	}
+
+	// This decodes an escaped integer in place, the whole item must lie
+	// in the buffer which holds for any span of MAX_ESCAPED_BYTES or more
+	// @param ptr - a ptr to the escaped item, moved past the item
+	// @return the decoded integer
+	inline static _int64 DecodeEscapedItem(const char *&ptr) {
+
+		_int64 item = 0;
+		int offset = 0;
+		while(((uChar)*ptr & 0x80) != 0) {
+			item |= (_int64)(*ptr++ & 0x7F) << offset;
+			offset += 7;
+		}
+
+		item |= (_int64)(*ptr++ & 0x7F) << offset;
+		return item;
+	}
+
+	// This reads a set of escaped integers. Items are decoded straight
+	// from the comp block, only the few items at the end of a block that
+	// may be split across two blocks are read a byte at a time.
+	// @param item - this stores the decoded items (uLong, _int64 or S5Byte)
+	// @param max_num - the maximum number of items to read
+	// @return the number of items read, less than max_num at the end of the file
+	template <class X> int ReadEscapedItems(X item[], int max_num) {
+
+		int item_num = 0;
+		while(item_num < max_num) {
+			int span_size;
+			const char *ptr = CompSpan(span_size);
+			if(ptr == NULL) {
+				break;
+			}
+
+			const char *start = ptr;
+			const char *end = ptr + span_size;
+			while(end - ptr >= MAX_ESCAPED_BYTES && item_num < max_num) {
+				SetEscapedItem(item[item_num++], DecodeEscapedItem(ptr));
+			}
+
+			SkipCompSpan((int)(ptr - start));
+			if(end - ptr >= MAX_ESCAPED_BYTES || item_num >= max_num) {
+				continue;
+			}
+
+			if(GetEscapedItem(item[item_num]) < 0) {
+				break;
+			}
+
+			item_num++;
+		}
+
+		return item_num;
+	}
+
+	// This reads a set of 5-byte integers 
+	// @param item - this stores each of the 8-byte items
+	// @param max_num - the maximum number of items to read
+	// @return the number of items read, less than max_num at the end of the file
+	int Read5ByteItems(_int64 item[], int max_num) {
+
+		int item_num = 0;
+		while(item_num < max_num) {
+			int span_size;
+			const char *ptr = CompSpan(span_size);
+			if(ptr == NULL) {
+				break;
+			}
+
+			// eight bytes are loaded for each item so three are left spare
+			int num = min((span_size - 3) / 5, max_num - item_num);
+			for(int i=0; i<num; i++) {
+				item[item_num++] = *(_int64 *)ptr & 0xFFFFFFFFFFLL;
+				ptr += 5;
+			}
+
+			SkipCompSpan(num * 5);
+			if(num > 0 || item_num >= max_num) {
+				continue;
+			}
+
+			if(!Get5ByteCompItem(item[item_num])) {
+				break;
+			}
+
+			item_num++;
+		}
+
+		return item_num;
+	}
+
+	// This reads a set of fixed size records, whole records are copied
+	// a comp block at a time. Unlike ReadCompObject a partial set of 
+	// records is returned at the end of the file.
+	// @param record - this stores the records
+	// @param max_num - the maximum number of records to read
+	// @return the number of records read
+	template <class X> int ReadCompRecords(X record[], int max_num) {
+
+		int record_num = 0;
+		while(record_num < max_num) {
+			int span_size;
+			const char *ptr = CompSpan(span_size);
+			if(ptr == NULL) {
+				break;
+			}
+
+			int num = min(span_size / (int)sizeof(X), max_num - record_num);
+			memcpy((char *)(record + record_num), ptr, num * sizeof(X));
+			SkipCompSpan(num * sizeof(X));
+			record_num += num;
+
+			if(num == 0 && !ReadCompObject(record[record_num++])) {
+				return record_num - 1;
+			}
+		}
+
+		return record_num;
+	}
+
+	// This reads an escaped byte count followed by that many bytes, which
+	// is how variable length keys are stored. The bytes are not copied 
+	// when they lie in the current comp block.
+	// @param bytes - stores the number of bytes in the record
+	// @param buff - this stores a record split across two comp blocks
+	// @return a ptr to the record which is only valid until the next read,
+	//         NULL at the end of the file
+	const char *ReadEscapedRecord(uLong &bytes, char buff[]) {
+
+		int span_size;
+		const char *ptr = CompSpan(span_size);
+		if(ptr == NULL) {
+			return NULL;
+		}
+
+		if(span_size >= MAX_ESCAPED_BYTES) {
+			const char *start = ptr;
+			bytes = (uLong)DecodeEscapedItem(ptr);
+			int header_size = (int)(ptr - start);
+
+			if(header_size + (_int64)bytes <= span_size) {
+				SkipCompSpan(header_size + bytes);
+				return ptr;
+			}
+
+			SkipCompSpan(header_size);
+		} else if(GetEscapedItem(bytes) < 0) {
+			return NULL;
+		}
+
+		if(!ReadCompObject(buff, bytes)) {
+			return NULL;
+		}
+
+		return buff;
+	}
+
 	// adds a X byte escaped integer
 	// @return the number of bytes added
 	template <class X> int AddEscapedItem(X item) {
@@ -2745,20 +3880,13 @@ public:
 	// @param output - the compressed character buffer
 	// @param input_size - the size of the input buffer - counts
 	// - the number of items not bytes
+	// @param codec - the codec used to compress the buffer
 	template <class X> static int CompressBuffer(X input[], 
-		CBaseMemoryChunk<char> &output, int input_size) {
-
-		input_size *= sizeof(X); 
-		uLongf length = (uLongf)((input_size * 1.1f) + 13); 
-		output.AllocateMemory(length); 
-
-		if(compress2(reinterpret_cast<Bytef *> (output.Buffer()), &length, 
-			reinterpret_cast < const Bytef *> (input), input_size, 
-			Z_DEFAULT_COMPRESSION) != Z_OK) {
-				throw ECompressionException("Could Not Compress Buffer"); 
-			}
+		CBaseMemoryChunk<char> &output, int input_size, 
+		int codec = CBlockCodec::ZLIB_CODEC) {
 
-		return (int)length; 
+		return CBlockCodec::Compress(codec, (const char *)input,
+			output, input_size * sizeof(X));
 	}
 
 	// decompresses a buffer taken from input and puts the results in output
@@ -2766,14 +3894,12 @@ public:
 	// @param output - the uncompressed output buffer
 	// @param input_size - the size of the input buffer in bytes
 	// @param output_size - the size of the output buffer in bytes
+	// @param codec - the codec used to compress the buffer
 	template <class X> static void DecompressBuffer(char input[], X output[], 
-		int input_size, int output_size) {
-		uLongf length = output_size * sizeof(X); 
+		int input_size, int output_size, int codec = CBlockCodec::ZLIB_CODEC) {
 
-		if(uncompress(reinterpret_cast<Bytef *> (output), &length, 
-			reinterpret_cast<const Bytef *> (input), input_size) != Z_OK) {
-				throw ECompressionException("Could Not Decompress Buffer"); 
-		}
+		CBlockCodec::Decompress(codec, input, (char *)output,
+			input_size, output_size * sizeof(X));
 	}
 
 	// used for testing compression 
@@ -2821,6 +3947,7 @@ public:
 	// forces the closing of the file
 	void CloseFile() {
 
+		StopReadAhead();
 		m_comp_offset = -1; 
 		if(m_bytes_stored < 0 && m_comp_buffer.OverflowSize() > 0) {
 			if(m_file_ptr != NULL) {
@@ -2836,14 +3963,172 @@ public:
 
 		m_bytes_stored = -1;
 		m_comp_buffer.FreeMemory();
+		m_read_buffer.FreeMemory();
 		m_comp_offset = 0;
 	}
 
 	virtual ~CHDFSFile() {
 		CloseFile(); 
+
+		// blocks can only be left behind if the file was never opened
+		while(m_pipeline_size > 0) {
+			m_write_pipeline[m_pipeline_head].compressed.Wait();
+			m_pipeline_head = (m_pipeline_head + 1) % m_pipeline_depth;
+			m_pipeline_size--;
+		}
+
+		if(m_write_pipeline != NULL) {
+			delete []m_write_pipeline;
+		}
 	}
 }; 
 
+// This maps an entire file into memory read only. Pages are brought
+// in by the OS on demand and are shared through the page cache between
+// every process that maps the same file. This allows multiple servers
+// on the same machine to hold a single copy of an index and removes 
+// the need to preload the index on start up.
+class CMappedFile {
+
+	// This stores the start of the mapped region
+	char *m_map_ptr;
+	// This stores the number of bytes mapped
+	_int64 m_bytes_stored;
+
+	#ifdef OS_WINDOWS
+	// This stores the handle of the open file
+	HANDLE m_file_handle;
+	// This stores the handle of the file mapping
+	HANDLE m_map_handle;
+	#endif
+
+public:
+
+	CMappedFile() {
+		m_map_ptr = NULL;
+		m_bytes_stored = 0;
+	}
+
+	// This returns true if a given file exists
+	// @param str - a buffer containing the name of the file
+	static bool AskFileExists(const char str[]) {
+
+		CHDFSFile file;
+		file.SetFileName(str);
+		FILE *file_ptr = fopen64(file.GetFullFileName(), "r");
+		if(file_ptr == NULL) {
+			return false;
+		}
+
+		fclose(file_ptr);
+		return true;
+	}
+
+	// This maps a file into memory, any previously mapped file is closed
+	// @param str - a buffer containing the name of the file
+	void OpenMappedFile(const char str[]) {
+
+		CloseFile();
+
+		CHDFSFile file;
+		file.SetFileName(str);
+
+		#ifdef OS_WINDOWS
+		m_file_handle = CreateFile(file.GetFullFileName(), GENERIC_READ, 
+			FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if(m_file_handle == INVALID_HANDLE_VALUE) {
+			cout<<"Could Not Map "<<file.GetFullFileName()<<endl;
+			throw EFileException("Could Not Open File"); 
+		}
+
+		LARGE_INTEGER size;
+		GetFileSizeEx(m_file_handle, &size);
+		m_bytes_stored = size.QuadPart;
+
+		m_map_handle = CreateFileMapping(m_file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if(m_map_handle != NULL) {
+			m_map_ptr = (char *)MapViewOfFile(m_map_handle, FILE_MAP_READ, 0, 0, 0);
+		}
+		#else
+		int fd = open(file.GetFullFileName(), O_RDONLY);
+		if(fd < 0) {
+			cout<<"Could Not Map "<<file.GetFullFileName()<<endl;
+			throw EFileException("Could Not Open File"); 
+		}
+
+		struct stat file_stat;
+		fstat(fd, &file_stat);
+		m_bytes_stored = file_stat.st_size;
+
+		if(m_bytes_stored > 0) {
+			m_map_ptr = (char *)mmap(NULL, m_bytes_stored, PROT_READ, MAP_SHARED, fd, 0);
+			if(m_map_ptr == MAP_FAILED) {
+				m_map_ptr = NULL;
+			}
+		}
+
+		// the mapping remains valid after the descriptor is closed
+		close(fd);
+		#endif
+
+		if(m_map_ptr == NULL && m_bytes_stored > 0) {
+			CloseFile();
+			throw EFileException("Could Not Map File");
+		}
+	}
+
+	// This returns true if a file is currently mapped
+	inline bool IsOpen() {
+		return m_map_ptr != NULL;
+	}
+
+	// This returns a pointer to the start of the mapped file
+	inline const char *Buffer() {
+		return m_map_ptr;
+	}
+
+	// Returns the number of bytes in the mapped file
+	inline _int64 FileSize() {
+		return m_bytes_stored;
+	}
+
+	// This copies a set of bytes from the mapped file
+	// @param byte_offset - the byte offset in the file to start copying from
+	// @param buff - this is where the bytes are stored
+	// @param byte_num - the number of bytes to copy
+	inline void ReadBytes(_int64 byte_offset, char buff[], int byte_num) {
+
+		if(byte_offset < 0 || byte_offset + byte_num > m_bytes_stored) {
+			throw EIllegalArgumentException("Mapped Read Out Of Bounds");
+		}
+
+		memcpy(buff, m_map_ptr + byte_offset, byte_num);
+	}
+
+	// This unmaps the file
+	void CloseFile() {
+
+		#ifdef OS_WINDOWS
+		if(m_map_ptr != NULL) {
+			UnmapViewOfFile(m_map_ptr);
+			CloseHandle(m_map_handle);
+			CloseHandle(m_file_handle);
+		}
+		#else
+		if(m_map_ptr != NULL) {
+			munmap(m_map_ptr, m_bytes_stored);
+		}
+		#endif
+
+		m_map_ptr = NULL;
+		m_bytes_stored = 0;
+	}
+
+	~CMappedFile() {
+		CloseFile();
+	}
+};
+
 
 
 // This stores the size of comp blocks as they are created 
@@ -2903,6 +4188,11 @@ public:
 			(GetFileName(), ".comp_size"));
 	}
 
+	// The compression pipeline is not supported since the compressed 
+	// size of each comp block is recorded as soon as it's stored
+	inline void SetCompressionPipeline(int block_num) {
+	}
+
 	// This skips forward to a particualr comp block
 	// @param comp_block_num - this is the number of comp blocks
 	//                       - to skip forward from
@@ -544,7 +544,7 @@ public:
 		for(int i=0; i<m_doc_cache.OverflowSize(); i++) {
 			strcpy(CUtility::SecondTempBuffer(), CUtility::ExtendString
 				(m_directory.Buffer(), i));
-			m_doc_cache[i].Initialize(CUtility::SecondTempBuffer());
+			m_doc_cache[i].Initialize(CUtility::SecondTempBuffer(), true);
 		}
 	}
 
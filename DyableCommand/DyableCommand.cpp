@@ -24,6 +24,9 @@ class CCommandServer : public CNodeStat {
 	static const int HASH_DIV_NUM = 256;
 	// This defins a predicate indicating whether testing is used
 	static const int IS_PERFORM_TESTS = false;
+	// This specifies whether uncompressed copies of the search tree and
+	// keyword indexes are written so query servers skip decompression
+	static const int IS_FLAT_INDEX = true;
 
 	// This defines the number of webgraph instances
 	static const int WEB_INST_NUM = 1;
@@ -432,6 +435,20 @@ class CCommandServer : public CNodeStat {
 		m_process_set.ResetProcessSet();
 	}
 
+	// This writes out uncompressed copies of the search tree and keyword
+	// indexes that are mapped by the query servers
+	void CreateFlatIndexes() {
+
+		CString arg("Index FlattenIndexes ");
+		arg += HASH_DIV_NUM;
+
+		m_process_set.CreateRemoteProcess("../DyableRequest/SearchHitItems/"
+			"Debug/SearchHitItems.exe", arg.Buffer(), 0);
+
+		m_process_set.WaitForPendingProcesses();
+		m_process_set.ResetProcessSet();
+	}
+
 	// This takes the list of hit items and sorts them, this is 
 	// done seperately for cluster hits and lexon hits.
 	void SortHitItems() {
@@ -721,6 +738,11 @@ public:
 
 		cout<<"Compiling Global Lexon"<<endl;
 		CompileGlobalLexonWordSet();
+
+		if(IS_FLAT_INDEX == true) {
+			cout<<"Creating Flat Indexes"<<endl;
+			CreateFlatIndexes();
+		}
 	}
 
 	void TestDocumentIndex() {
@@ -745,6 +767,12 @@ public:
 
 		CTestCompileLookupIndex compile;
 		compile.TestCompileLookupIndex();
+
+		CTestCompressionCodec codec;
+		codec.TestCompressionCodec(LOCAL_CLIENT_PROCESS);
+
+		CTestRadixSort radix_sort;
+		radix_sort.TestRadixSort(LOCAL_CLIENT_PROCESS);
 	}
 
 };
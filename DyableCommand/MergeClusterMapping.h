@@ -1,4 +1,4 @@
-#include "./TestIndexing.h"
+#include "./TestRadixSort.h"
 
 // This stores the directory where the mapping between 
 // base nodes and their cluster mapping is stored
@@ -0,0 +1,103 @@
+#include "./TestIndexing.h"
+
+// This is used to measure the throughput of each block codec on the
+// hit list blocks produced by CompileHitList. Every uncompressed comp
+// block is compressed and decompressed with each available codec and
+// the round trip is verified before the throughput is reported.
+class CTestCompressionCodec {
+
+	// This defines the number of comp blocks loaded at any one time
+	static const int COMP_BLOCK_NUM = 4;
+
+	// This stores the time spent compressing for each codec
+	CMemoryChunk<double> m_comp_time;
+	// This stores the time spent decompressing for each codec
+	CMemoryChunk<double> m_decomp_time;
+	// This stores the number of compressed bytes for each codec
+	CMemoryChunk<_int64> m_comp_bytes;
+	// This stores the total number of uncompressed bytes processed
+	_int64 m_norm_bytes;
+
+	// This runs each codec on a single uncompressed block
+	// @param block - the uncompressed hit list block
+	// @param block_size - the number of bytes in the block
+	void BenchmarkBlock(CMemoryChunk<char> &block, int block_size) {
+
+		CStopWatch timer;
+		CMemoryChunk<char> comp_buff;
+		CMemoryChunk<char> decomp_buff(block_size);
+		m_norm_bytes += block_size;
+
+		for(int i=0; i<CBlockCodec::CODEC_NUM; i++) {
+			if(CBlockCodec::IsCodecAvailable(i) == false) {
+				continue;
+			}
+
+			int codec = i;
+			timer.StartTimer();
+			int comp_size = CBlockCodec::Compress(codec,
+				block.Buffer(), comp_buff, block_size);
+			timer.StopTimer();
+			m_comp_time[i] += timer.NetElapsedTime();
+			m_comp_bytes[i] += comp_size;
+
+			timer.StartTimer();
+			CBlockCodec::Decompress(codec, comp_buff.Buffer(),
+				decomp_buff.Buffer(), comp_size, block_size);
+			timer.StopTimer();
+			m_decomp_time[i] += timer.NetElapsedTime();
+
+			if(memcmp(block.Buffer(), decomp_buff.Buffer(), block_size) != 0) {
+				cout<<"Codec Mismatch "<<CBlockCodec::CodecName(i);getchar();
+			}
+		}
+	}
+
+public:
+
+	CTestCompressionCodec() {
+		m_comp_time.AllocateMemory(CBlockCodec::CODEC_NUM, 0);
+		m_decomp_time.AllocateMemory(CBlockCodec::CODEC_NUM, 0);
+		m_comp_bytes.AllocateMemory(CBlockCodec::CODEC_NUM, 0);
+		m_norm_bytes = 0;
+	}
+
+	// This loads every base hit list block for each client and
+	// reports the compression and decompression throughput in MB/s
+	// for each codec along with the compression ratio.
+	// @param client_num - the number of clients used to create the hit list
+	void TestCompressionCodec(int client_num) {
+
+		CFileComp hit_file;
+		CMemoryChunk<char> block;
+
+		for(int i=0; i<CNodeStat::GetHashDivNum(); i++) {
+			for(int j=0; j<client_num; j++) {
+				hit_file.OpenReadFile(CUtility::ExtendString
+					("GlobalData/HitList/base_fin_hit", i, ".client", j));
+
+				CCompression &comp = hit_file.CompBuffer();
+				for(int k=0; k<comp.CompBlockNum(); k+=COMP_BLOCK_NUM) {
+					int comp_block_num = COMP_BLOCK_NUM;
+					int block_size = comp.GetUncompressedBlock(block, comp_block_num, k);
+					if(block_size > 0) {
+						BenchmarkBlock(block, block_size);
+					}
+				}
+			}
+		}
+
+		double mb = (double)m_norm_bytes / (1 << 20);
+		cout<<"Hit List Bytes "<<m_norm_bytes<<endl;
+		for(int i=0; i<CBlockCodec::CODEC_NUM; i++) {
+			if(CBlockCodec::IsCodecAvailable(i) == false) {
+				cout<<CBlockCodec::CodecName(i)<<" Not Available"<<endl;
+				continue;
+			}
+
+			cout<<CBlockCodec::CodecName(i)<<" Compress "<<(mb / m_comp_time[i])
+				<<" MB/s Decompress "<<(mb / m_decomp_time[i])<<" MB/s Ratio "
+				<<((double)m_norm_bytes / m_comp_bytes[i])<<endl;
+		}
+	}
+};
@@ -0,0 +1,109 @@
+#include "./TestCompressionCodec.h"
+
+// This is used to measure the throughput of the in memory radix sort
+// used by CExternalRadixSort to create sorted runs. A sample of the
+// anchor hits is loaded into memory and sorted on the doc id one run
+// at a time. Each run is checked to be in order and the throughput
+// is reported in GB/s.
+class CTestRadixSort {
+
+	// This defines the number of bytes in an anchor hit
+	static const int HIT_BYTE_SIZE = 11;
+	// This defines the number of low order bytes in the doc id key
+	static const int KEY_BYTE_SIZE = 5;
+	// This defines the maximum number of bytes in the sample
+	static const _int64 MAX_SAMPLE_SIZE = (_int64)1 << 30;
+	// This defines the number of bytes in each run
+	static const int RUN_BYTE_SIZE = 1 << 26;
+
+	// This stores the time spent sorting
+	double m_sort_time;
+	// This stores the number of bytes sorted
+	_int64 m_sort_bytes;
+
+	// This loads the next run of anchor hits into memory
+	// @param hit_file - the anchor hit file currently being read
+	// @param run - this stores the anchor hits in the run
+	// @return the number of anchor hits in the run
+	int LoadRun(CFileComp &hit_file, CMemoryChunk<char> &run) {
+
+		int hit_num = 0;
+		char *buff = run.Buffer();
+		int max_hit_num = run.OverflowSize() / HIT_BYTE_SIZE;
+
+		while(hit_num < max_hit_num) {
+			if(!hit_file.ReadCompObject(buff, HIT_BYTE_SIZE)) {
+				break;
+			}
+
+			buff += HIT_BYTE_SIZE;
+			hit_num++;
+		}
+
+		return hit_num;
+	}
+
+	// This sorts a single run and checks that it's in doc id order
+	// @param run - this stores the anchor hits in the run
+	// @param hit_num - the number of anchor hits in the run
+	void SortRun(CMemoryChunk<char> &run, int hit_num) {
+
+		CStopWatch timer;
+		timer.StartTimer();
+		CExternalRadixSort::RadixSortBuffer(run, hit_num,
+			HIT_BYTE_SIZE, KEY_BYTE_SIZE);
+		timer.StopTimer();
+
+		m_sort_time += timer.NetElapsedTime();
+		m_sort_bytes += (_int64)hit_num * HIT_BYTE_SIZE;
+
+		char *buff = run.Buffer();
+		for(int i=1; i<hit_num; i++) {
+			if(SFixedKeyCompare<KEY_BYTE_SIZE>::Compare
+				(buff + HIT_BYTE_SIZE, buff) > 0) {
+				cout<<"Radix Sort Error";getchar();
+			}
+
+			buff += HIT_BYTE_SIZE;
+		}
+	}
+
+public:
+
+	CTestRadixSort() {
+		m_sort_time = 0;
+		m_sort_bytes = 0;
+	}
+
+	// This sorts up to 1GB of anchor hits taken from each hash division
+	// and reports the throughput of the radix sort kernel.
+	// @param client_num - the number of clients used to create the hit list
+	void TestRadixSort(int client_num) {
+
+		CFileComp hit_file;
+		CMemoryChunk<char> run(RUN_BYTE_SIZE - (RUN_BYTE_SIZE % HIT_BYTE_SIZE));
+
+		for(int i=0; i<CNodeStat::GetHashDivNum(); i++) {
+			for(int j=0; j<client_num; j++) {
+				hit_file.OpenReadFile(CUtility::ExtendString
+					("GlobalData/HitList/anchor_fin_hit", i, ".client", j));
+
+				while(m_sort_bytes < MAX_SAMPLE_SIZE) {
+					int hit_num = LoadRun(hit_file, run);
+					if(hit_num == 0) {
+						break;
+					}
+
+					SortRun(run, hit_num);
+				}
+			}
+		}
+
+		if(m_sort_time <= 0) {
+			return;
+		}
+
+		cout<<"Radix Sorted "<<m_sort_bytes<<" Bytes At "<<((double)m_sort_bytes /
+			(1 << 30) / m_sort_time)<<" GB/s"<<endl;
+	}
+};
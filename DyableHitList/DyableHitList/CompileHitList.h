@@ -244,10 +244,12 @@ public:
 			m_base_hit_set[i].OpenWriteFile(CUtility::ExtendString
 				("GlobalData/HitList/base_fin_hit",
 				i, ".client", GetClientID()));
+			m_base_hit_set[i].SetCompressionPipeline(1);
 
 			m_anchor_hit_set[i].OpenWriteFile(CUtility::ExtendString
 				("GlobalData/HitList/anchor_fin_hit",
 				i, ".client", GetClientID()));
+			m_anchor_hit_set[i].CompBuffer().SetCompressionPipeline(1);
 		}
 	}
 
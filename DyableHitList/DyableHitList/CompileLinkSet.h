@@ -18,6 +18,8 @@ class CCompileLinkSet {
 	CHDFSFile m_fin_link_set;
 	// stores the link cluster for a given document
 	CArrayList<_int64> m_link_cluster;
+	// stores the log division of each global link in a cluster
+	CArrayList<u_short> m_link_div;
 	// This is used to compile the hit list
 	CCompileHitList m_compile_hit_list;
 
@@ -28,13 +30,20 @@ class CCompileLinkSet {
 	void RetrieveLocalURLCluster() {
 
 		static uLong cluster_size;
-		static _int64 link_url_index;
 		m_curr_link_set.GetEscapedItem(cluster_size);
 
+		int offset = m_link_cluster.Size();
+		m_link_cluster.ExtendSize(cluster_size);
+		_int64 *link_url_index = m_link_cluster.Buffer() + offset;
+
+		// the whole cluster is read at once, missing links are left as zero
+		int link_num = m_curr_link_set.Read5ByteItems(link_url_index, cluster_size);
+		for(uLong i=link_num; i<cluster_size; i++) {
+			link_url_index[i] = 0;
+		}
+
 		for(uLong i=0; i<cluster_size; i++) {
-			m_curr_link_set.Get5ByteCompItem(link_url_index);
-			link_url_index <<= 1;
-			m_link_cluster.PushBack(link_url_index);
+			link_url_index[i] <<= 1;
 		}
 	}
 
@@ -43,7 +52,6 @@ class CCompileLinkSet {
 	// of the global set linking all webpages.
 	uChar RetrieveGlobalURLCluster() {
 
-		static u_short div;
 		static uLong cluster_size;
 		static _int64 link_url_index;
 		static uChar domain_weight;
@@ -51,9 +59,13 @@ class CCompileLinkSet {
 		m_curr_link_set.ReadCompObject(domain_weight);
 		m_curr_link_set.GetEscapedItem(cluster_size);
 
+		// the log division of every link is read at once
+		m_link_div.Resize(cluster_size);
+		m_curr_link_set.ReadCompRecords(m_link_div.Buffer(), cluster_size);
+
 		for(uLong i=0; i<cluster_size; i++) {
 			// gets the link index
-			m_curr_link_set.ReadCompObject(div);
+			u_short div = m_link_div[i];
 			u_short fin_div = div & 0x7FFF;
 
 			m_compile_hit_list.RetrieveNextLinkURLIndex((int)fin_div, link_url_index);
@@ -95,6 +107,7 @@ public:
 			("GlobalData/LinkSet/fin_link_set", CNodeStat::GetClientID()));
 
 		m_link_cluster.Initialize(10000);
+		m_link_div.Initialize(10000);
 		m_compile_hit_list.LoadHitList(hit_list_breadth);
 
 		CompileFinalLinkSet();
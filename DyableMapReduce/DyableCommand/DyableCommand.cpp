@@ -289,20 +289,26 @@ class CMapReduceCommand {
 		m_mapred_prim_ptr->SetHashDivNum(hash_div_num);
 		m_mapred_prim_ptr->ProcessSet().SetMaximumClientNum(max_process_num);
 
+		// the client is told if the request failed so it isn't taken as done
+		char success = 'f';
 		int length = strlen(map_reduce_type.Buffer());
 		int index = m_meta_tag.FindWord(map_reduce_type.Buffer(), length);
 		//if the appropriate index is found
 		if(m_meta_tag.AskFoundWord()) {	
-			//call the appropriate handler through the function pointer
-			(this->*meta_handler[index])(data_handler_func.Buffer(), map_file_buff.Buffer(), 
-				key_file_buff.Buffer(), output_file_buff.Buffer(), work_dir_buff.Buffer(),
-				max_key_bytes, max_map_bytes);	
+			try {
+				//call the appropriate handler through the function pointer
+				(this->*meta_handler[index])(data_handler_func.Buffer(), map_file_buff.Buffer(), 
+					key_file_buff.Buffer(), output_file_buff.Buffer(), work_dir_buff.Buffer(),
+					max_key_bytes, max_map_bytes);	
+			} catch(EException &e) {
+				e.PrintException("Request Failed:");
+				success = 'e';
+			}
 		} else {
 			cout<<"Command Not Found"<<endl;
 		}
 		
 		delete m_mapred_prim_ptr;
-		char success = 'f';
 		conn.Send(&success, 1);
 	}
 
@@ -323,9 +329,13 @@ public:
 		}
 	}
 
-	// This swans servers to fullfill a query requested by the user
+	// This swans servers to fullfill a query requested by the user. Since
+	// this process stays resident the slave primatives are run as tasks
+	// on a pool of worker threads rather than as spawned processes.
 	void ListenForConnections() {
 
+		CMapReducePrimatives::StartTaskPool(CCompBlockPool::ProcessorNum());
+
 		if(!m_connect.OpenServerConnection(5555, LOCAL_NETWORK)) {
 			throw ENetworkException("Could Not Open Server Connection");
 		}
@@ -1039,6 +1049,11 @@ int main(int argc, char *argv[]) {
 	int inst_id = atoi(argv[11]);
 	int max_process_num = atoi(argv[12]);
 
+	// the slave primatives are run in this process if a worker number is given
+	if(argc > 13 && atoi(argv[13]) > 0) {
+		CMapReducePrimatives::StartTaskPool(atoi(argv[13]));
+	}
+
 	CBeacon::InitializeBeacon(inst_id, 5555 + inst_id);
 	command->MapReduceTask(data_handle_func, map_reduce_type, map_file, 
 		key_file, output_file, work_dir, data_type, max_key_bytes, 
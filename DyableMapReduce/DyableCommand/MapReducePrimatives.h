@@ -1,11 +1,57 @@
-#include "../../ProcessSet.h"
+#include "../DyableSlave/ProcessCommand.h"
 
 // This composes the server side MapReduce primatives that are used to
-// perform various MapReduce tasks by multiple clients.
+// perform various MapReduce tasks by multiple clients. Each primative is
+// normally run by spawning a slave process for every client set. When a
+// resident task pool has been started the primatives are instead handled
+// as tasks on the pool's worker threads inside this process, which avoids
+// the cost of starting a process for every hash division.
 class CMapReducePrimatives {
 
+	// This defines the number of times a failed task is run again
+	static const int MAX_TASK_RETRY = 2;
+
+	// This stores a request to one of the slave MapReduce primatives
+	// that is handled by a worker in the task pool
+	struct SSlaveTask {
+		// This stores the client set being processed
+		int client_id;
+		// This stores the number of key client sets
+		int key_client_num;
+		// This stores the number of map client sets
+		int map_client_num;
+		// This stores the byte offset in the client file
+		_int64 file_byte_offset;
+		// This stores the number of bytes to process
+		_int64 tuple_bytes;
+		// This stores the lower bound on the client division set
+		int div_start;
+		// This stores the upper bound on the client division set
+		int div_end;
+		// This stores the maximum number of bytes that make up the key
+		int max_key_bytes;
+		// This stores the maximum number of bytes that make up the map
+		int max_map_bytes;
+		// This stores the type of map reduce primative
+		CString request;
+		// This stores the data processing handle name
+		CString data_handle_func;
+		// This stores the working directory
+		CString work_dir;
+		// This stores the directory of the data set
+		CString data_dir;
+		// This stores the data type for the MapReduce
+		CString data_type;
+		// This is set once the request has been handled without failing
+		bool is_done;
+	};
+
 	// This is used to spawn the the set of processes
 	static CProcessSet m_process_set;
+	// This is used to run the primatives inside this process
+	static CTaskPool m_task_pool;
+	// This stores the tasks that have been added to the task pool
+	CArrayList<SSlaveTask *> m_slave_task;
 	// This stores the maximum number of bytes that make up the key
 	int m_max_key_bytes;
 	// This stores the maximum number of bytes that make up the map
@@ -15,6 +61,114 @@ class CMapReducePrimatives {
 	// This stores the data type for the MapReduce
 	const char *m_data_type;
 
+	// This handles a slave request on one of the task pool's workers
+	// @param task - the request being handled
+	template <class X>
+	static void HandleSlaveTask(SSlaveTask &task) {
+
+		CMemoryElement<CProcessCommand<X> > process;
+		process->Initialize(task.client_id, task.key_client_num, task.map_client_num);
+		process->SetDataHandleFunc(task.data_handle_func.Buffer());
+		process->HandleRequest(task.request.Buffer(), task.max_key_bytes, 
+			task.max_map_bytes, task.file_byte_offset, task.tuple_bytes, 
+			task.work_dir.Buffer(), task.data_dir.Buffer(),
+			task.div_start, task.div_end);
+		process.DeleteMemoryElement();
+	}
+
+	// This is the entry function for a slave request run in the task pool
+	static void SlaveTask(void *ptr) {
+
+		SSlaveTask *task = (SSlaveTask *)ptr;
+		task->is_done = false;
+		if(strcmp(task->data_type.Buffer(), "float") == 0) {
+			HandleSlaveTask<float>(*task);
+		} else if(strcmp(task->data_type.Buffer(), "int") == 0) {
+			HandleSlaveTask<int>(*task);
+		} else if(strcmp(task->data_type.Buffer(), "_int64") == 0) {
+			HandleSlaveTask<_int64>(*task);
+		}
+
+		task->is_done = true;
+	}
+
+	// This adds a request to one of the slave MapReduce primatives to the
+	// task pool, each hash division is added as a separate task
+	// @param client_id - this is the current client set being processed
+	// @param key_client_num - the number of key client sets
+	// @param map_client_num - the number of map client sets
+	// @param file_byte_offset - the byte offset in the client file
+	// @param tuple_bytes - the number of bytes to process
+	// @param div_start - the lower bound on the client division set
+	// @param div_end - the upper bound on the client division set
+	// @param request - the type of map reduce primative
+	// @param data_handle_func - the data processing handle name
+	// @param data_dir - this stores the directory of the data set
+	void AddSlaveTask(int client_id, int key_client_num, int map_client_num, 
+		_int64 file_byte_offset, _int64 tuple_bytes, int div_start,
+		int div_end, const char *request, const char *data_handle_func,
+		const char *data_dir) {
+
+		SSlaveTask *task = new SSlaveTask;
+		task->client_id = client_id;
+		task->key_client_num = key_client_num;
+		task->map_client_num = map_client_num;
+		task->file_byte_offset = file_byte_offset;
+		task->tuple_bytes = tuple_bytes;
+		task->div_start = div_start;
+		task->div_end = div_end;
+		task->max_key_bytes = m_max_key_bytes;
+		task->max_map_bytes = m_max_map_bytes;
+		task->request = request;
+		task->work_dir = m_work_dir;
+		task->data_dir = data_dir;
+		task->data_type = m_data_type;
+		task->is_done = false;
+
+		if(data_handle_func == NULL || strlen(data_handle_func) == 0) {
+			task->data_handle_func = "NULL";
+		} else {
+			task->data_handle_func = data_handle_func;
+		}
+
+		m_slave_task.PushBack(task);
+		m_task_pool.AddTask(SlaveTask, task);
+	}
+
+	// This waits for every task added to the task pool to finish. A
+	// failed task is run again in the same way that a failed slave
+	// process is restarted. An exception is thrown if a task still
+	// fails once it has been retried.
+	void WaitForSlaveTasks() {
+
+		if(m_slave_task.Size() == 0) {
+			return;
+		}
+
+		int fail_num = m_task_pool.WaitForTasks();
+		for(int j=0; j<MAX_TASK_RETRY && fail_num > 0; j++) {
+			cout<<"Retrying "<<fail_num<<" MapReduce Tasks"<<endl;
+			for(int i=0; i<m_slave_task.Size(); i++) {
+				if(m_slave_task[i]->is_done == false) {
+					m_task_pool.AddTask(SlaveTask, m_slave_task[i]);
+				}
+			}
+
+			fail_num = m_task_pool.WaitForTasks();
+		}
+
+		for(int i=0; i<m_slave_task.Size(); i++) {
+			delete m_slave_task[i];
+		}
+
+		m_slave_task.Resize(0);
+
+		if(fail_num > 0) {
+			cout<<fail_num<<" MapReduce Tasks Failed"<<endl;
+			throw EException("MapReduce Task Failed");
+		}
+	}
+
 	// This function formats the request to one of the slave MapReduce primatives.
 	// @param client_id - this is the current client set being processed
 	// @param key_client_num - the number of key client sets
@@ -31,6 +185,12 @@ class CMapReducePrimatives {
 		int div_end, const char *request, const char *data_handle_func,
 		const char *data_dir) {
 
+		if(m_task_pool.WorkerNum() > 0) {
+			AddSlaveTask(client_id, key_client_num, map_client_num, file_byte_offset,
+				tuple_bytes, div_start, div_end, request, data_handle_func, data_dir);
+			return;
+		}
+
 		CString comand("Index ");
 
 		comand += client_id;
@@ -78,6 +238,26 @@ public:
 	CMapReducePrimatives() {
 		m_data_type = "int";
 		m_process_set.SetPort(3000);
+		m_slave_task.Initialize();
+	}
+
+	~CMapReducePrimatives() {
+		// tasks are only left here if the stack is being unwound
+		// by an earlier failure so this one is only reported
+		try {
+			WaitForSlaveTasks();
+		} catch(EException &e) {
+			e.PrintException();
+		}
+	}
+
+	// This starts the resident task pool, once started every primative
+	// is handled inside this process rather than by a spawned slave
+	// @param worker_num - the number of worker threads in the pool
+	static void StartTaskPool(int worker_num) {
+		if(m_task_pool.WorkerNum() == 0) {
+			m_task_pool.Initialize(worker_num);
+		}
 	}
 
 	// This sets the working directory and data directory as well as the 
@@ -364,7 +544,8 @@ public:
 	}
 
 	// This waits for pending processes to complete
-	inline void WaitForPendingProcesses() {
+	void WaitForPendingProcesses() {
+		WaitForSlaveTasks();
 		m_process_set.WaitForPendingProcesses();
 	}
 
@@ -373,4 +554,6 @@ public:
 		m_process_set.ResetProcessSet();
 	}
 };
+const int CMapReducePrimatives::MAX_TASK_RETRY;
 CProcessSet CMapReducePrimatives::m_process_set;
+CTaskPool CMapReducePrimatives::m_task_pool;
@@ -96,17 +96,17 @@ class CApplyMapsToKeys : public CSetNum {
 
 		uLong bytes;
 		int key_bytes;
+		const char *key;
 		CMemoryChunk<char> key_buff(m_max_key_bytes);
-		while(key_file.GetEscapedItem(bytes) >= 0) {
+		while((key = key_file.ReadEscapedRecord(bytes, key_buff.Buffer())) != NULL) {
 
 			key_bytes = bytes;
-			key_file.ReadCompObject(key_buff.Buffer(), key_bytes);
-			int id = m_key_map.FindWord(key_buff.Buffer(), key_bytes);
+			int id = m_key_map.FindWord(key, key_bytes);
 
 			if(m_key_map.AskFoundWord() == false) {
 				new_key_file.AddEscapedItem(key_bytes);
 				new_key_file.AddEscapedItem((int)0);
-				new_key_file.WriteCompObject(key_buff.Buffer(), key_bytes);
+				new_key_file.WriteCompObject(key, key_bytes);
 				continue;
 			}
 
@@ -123,7 +123,7 @@ class CApplyMapsToKeys : public CSetNum {
 
 			new_key_file.AddEscapedItem(key_bytes);
 			new_key_file.AddEscapedItem(map_bytes);
-			new_key_file.WriteCompObject(key_buff.Buffer(), key_bytes);
+			new_key_file.WriteCompObject(key, key_bytes);
 			new_key_file.WriteCompObject(map_value, map_bytes);
 		}
 	}
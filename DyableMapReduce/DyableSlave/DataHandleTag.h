@@ -94,7 +94,7 @@ public:
 	static void ReadTextStringMap1(CHDFSFile &map_file, char map[], 
 		char key[], int &map_bytes, int &key_bytes) {
 
-		static uChar word_length;
+		uChar word_length;
 		key_bytes = sizeof(uLong);
 		map_file.ReadCompObject(key, key_bytes);
 		map_file.ReadCompObject(word_length);
@@ -117,7 +117,7 @@ public:
 		// reads in the word id
 		file.ReadCompObject(key_buff, 5);
 
-		static uChar keyword_num;
+		uChar keyword_num;
 		// read in the keyword number and checksum
 		char *prev_ptr = map_buff;
 		file.ReadCompObject(map_buff, 5);
@@ -141,7 +141,7 @@ public:
 		file.ReadCompObject(key_buff, 5);
 
 		// read in the text string corresponding to the keyword
-		static uChar word_length;
+		uChar word_length;
 		// read the term weight
 		file.ReadCompObject(map_buff, sizeof(float));
 		file.ReadCompObject(word_length);
@@ -175,7 +175,7 @@ public:
 	static void WriteWordIDClusMap1(CHDFSFile &file, char map_buff[], 
 		int &map_bytes, char key_buff[], int &key_bytes) {
 
-		static S5Byte node;
+		S5Byte node;
 
 		if(map_bytes == 0) {
 			node.SetMaxValue();
@@ -199,7 +199,7 @@ public:
 		file.ReadCompObject(key_buff, 5);
 
 		// read in the text string corresponding to the keyword
-		static uChar word_length;
+		uChar word_length;
 		// read the term weight
 		file.ReadCompObject(map_buff, sizeof(float));
 		file.ReadCompObject(map_buff + sizeof(float), 1);
@@ -227,7 +227,7 @@ public:
 		file.ReadCompObject(key_buff, 5);
 
 		// read in the text string corresponding to the keyword
-		static int word_length;
+		int word_length;
 		file.ReadCompObject(map_buff, sizeof(int));
 		word_length = *(int *)map_buff;
 		file.ReadCompObject(map_buff + sizeof(int), word_length);
@@ -247,7 +247,7 @@ public:
 		file.ReadCompObject(key_buff, 5);
 
 		// read in the text string corresponding to the keyword
-		static uChar doc_num;
+		uChar doc_num;
 		file.ReadCompObject(map_buff, sizeof(uChar));
 		doc_num = *(uChar *)map_buff;
 		file.ReadCompObject(map_buff + sizeof(uChar), doc_num * sizeof(S5Byte));
@@ -264,8 +264,8 @@ public:
 	static void ReadSimilarTermMap(CHDFSFile &file, char map_buff[], 
 		char key_buff[], int &map_bytes, int &key_bytes) {
 
-		static uChar length;
-		static uChar set_num;
+		uChar length;
+		uChar set_num;
 		file.ReadCompObject(key_buff, sizeof(S5Byte));
 		file.ReadCompObject(map_buff, sizeof(uChar));
 		key_bytes = sizeof(S5Byte);
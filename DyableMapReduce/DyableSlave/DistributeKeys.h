@@ -26,6 +26,8 @@ class CDistributeKeys : public CSetNum {
 			this->m_bucket_set[i].OpenWriteFile(CUtility::ExtendString
 				(dir, ".key_set", i, ".client", CSetNum::GetClientID()));
 			this->m_bucket_set[i].InitializeCompression(comp_buff_size);
+			// one block in flight per bucket keeps every compressor busy
+			this->m_bucket_set[i].SetCompressionPipeline(1);
 		}
 
 		m_key_file.OpenReadFile(key_set_dir);
@@ -33,6 +35,7 @@ class CDistributeKeys : public CSetNum {
 
 		m_hash_node_file.OpenWriteFile(CUtility::ExtendString
 			(dir, ".hash_node_set", CSetNum::GetClientID()));
+		m_hash_node_file.SetCompressionPipeline(2);
 	}
 
 
@@ -28,14 +28,14 @@ template <class X> class CFindKeyOccurrence : public CSetNum {
 	void LoadKeySet(CHDFSFile &key_file, char buff[]) {
 
 		uLong bytes;
-		while(key_file.GetEscapedItem(bytes) >= 0) {
-			key_file.ReadCompObject(buff, bytes);
+		const char *key;
+		while((key = key_file.ReadEscapedRecord(bytes, buff)) != NULL) {
 
 			if(bytes > m_max_key_bytes) {
 				cout<<"key size mis";getchar();
 			}
 
-			int id = m_key_map.AddWord(buff, bytes);
+			int id = m_key_map.AddWord(key, bytes);
 			if(!m_key_map.AskFoundWord()) {
 				m_occurr.PushBack(1);
 			} else {
@@ -102,13 +102,13 @@ template <class X> class CFindKeyOccurrence : public CSetNum {
 				(m_directory, ".mapped_set", CSetNum::GetClientID(), ".client", j));
 
 			uLong bytes;
-			while(curr_key_file.GetEscapedItem(bytes) >= 0) {
-				curr_key_file.ReadCompObject(buff.Buffer(), bytes);
+			const char *key;
+			while((key = curr_key_file.ReadEscapedRecord(bytes, buff.Buffer())) != NULL) {
 
-				int id = m_key_map.FindWord(buff.Buffer(), bytes);
+				int id = m_key_map.FindWord(key, bytes);
 
 				curr_map_file.AddEscapedItem(bytes);
-				curr_map_file.WriteCompObject(buff.Buffer(), bytes);
+				curr_map_file.WriteCompObject(key, bytes);
 				curr_map_file.WriteCompObject(m_occurr[id]);
 			}
 		}
@@ -24,16 +24,17 @@ class CFindKeyWeight : public CSetNum {
 
 		uLong bytes;
 		X weight;
+		const char *key;
 
-		while(key_file.GetEscapedItem(bytes) >= 0) {
-			key_file.ReadCompObject(buff, bytes);
-			key_file.ReadCompObject(weight);
+		while((key = key_file.ReadEscapedRecord(bytes, buff)) != NULL) {
 
 			if(bytes > m_max_key_bytes) {
 				cout<<"key mis";getchar();
 			}
 
-			int id = this->m_key_map.AddWord(buff, bytes);
+			// the key is read in place so must be used before the weight is read
+			int id = this->m_key_map.AddWord(key, bytes);
+			key_file.ReadCompObject(weight);
 			if(!this->m_key_map.AskFoundWord()) {
 				this->m_occurr.PushBack(weight);
 			} else {
@@ -101,14 +102,14 @@ class CFindKeyWeight : public CSetNum {
 
 			uLong bytes;
 			X weight;
-			while(curr_key_file.GetEscapedItem(bytes) >= 0) {
-				curr_key_file.ReadCompObject(buff.Buffer(), bytes);
-				curr_key_file.ReadCompObject(weight);
+			const char *key;
+			while((key = curr_key_file.ReadEscapedRecord(bytes, buff.Buffer())) != NULL) {
 
-				int id = m_key_map.FindWord(buff.Buffer(), bytes);
+				int id = m_key_map.FindWord(key, bytes);
 				curr_map_file.AddEscapedItem(bytes);
-				curr_map_file.WriteCompObject(buff.Buffer(), bytes);
+				curr_map_file.WriteCompObject(key, bytes);
 				curr_map_file.WriteCompObject(m_occurr[id]);
+				curr_key_file.ReadCompObject(weight);
 			}
 		}
 	}
@@ -1,14 +1,18 @@
-#include "../../MapReduce.h"
+#include "../../ProcessSet.h"
 
 static const int MAX_MAPRED_BYTES = 1000000;
 
-// This class is used to store the total number of key and map client sets
+// This class is used to store the total number of key and map client sets.
+// These are kept per thread so that primatives for different client sets 
+// can run as tasks in the same process.
 class CSetNum {
 
 	// This stores the total number of key client sets
-	static int m_key_client_set_num;
+	static THREAD_LOCAL int m_key_client_set_num;
 	// This stores the total number of map client sets
-	static int m_map_client_set_num;
+	static THREAD_LOCAL int m_map_client_set_num;
+	// This stores the client set being processed
+	static THREAD_LOCAL int m_client_id;
 
 public:
 
@@ -25,6 +29,11 @@ public:
 		m_map_client_set_num = map_set_num;
 	}
 
+	// Sets the client set being processed
+	inline static void SetClientID(int client_id) {
+		m_client_id = client_id;
+	}
+
 	// Returns the total number of key client sets
 	inline static int GetKeyClientNum() {
 		return m_key_client_set_num;
@@ -37,11 +46,12 @@ public:
 
 	// This returns the client id
 	inline static int GetClientID() {
-		return CNodeStat::GetClientID();
+		return m_client_id;
 	}
 };
-int CSetNum::m_key_client_set_num;
-int CSetNum::m_map_client_set_num;
+THREAD_LOCAL int CSetNum::m_key_client_set_num;
+THREAD_LOCAL int CSetNum::m_map_client_set_num;
+THREAD_LOCAL int CSetNum::m_client_id;
 
 // This class takes an arbitrary set of key value pairs and groups 
 // values by their key value, in the same physical location in the
@@ -1,136 +1,63 @@
 #include "./FindKeyWeight.h"
 
 // This is used to merge sorted blocks together to complete the external
-// sorting pass. Sort items are merged together using a priority queue.
+// sorting pass. Sort items are merged together using a loser tree.
 // The sorted items are written back out to file. Multiple sorting passes
 // may be required. This process is performed in parallel with a number
-// of other sorting streams. 
+// of other sorting streams. No static state is used so multiple merges
+// can be performed in the same process.
 class CMergeSortedBlocks {	
 
-	// used for the priority queue sorting
-	struct SSortedHit {
-		SExternalSort hit; 
-		int bucket; 
-	}; 
-
-	// This stores the size in bytes of a given sort item
-	static int m_hit_byte_size;
 	// This stores the size in bytes of a given sort item
-	static int m_sort_byte_size;
-	// This stores the initial bit offset -> used in the compare function
-	static int m_init_offset;
-	// this is the compare function used to sort hits
-	static int (*m_compare)(const SExternalSort & arg1, 
-		const SExternalSort & arg2); 
-
+	int m_hit_byte_size;
 	// This stores the set of sorted blocks
 	CMemoryChunk<CHDFSFile> m_sorted_block_set;
-	// This stores the set of sorted items
-	CPriorityQueue<SSortedHit> m_queue; 
-	// This stores the queue buffer items
+	// This stores the current sort item for each sorted block
 	CMemoryChunk<char> m_queue_buff;
 
-	// This defines how a sort item is compare. Since a non comparison
-	// model is used for sorting, this means that this simply orders
-	// sort items in lexographic order. Note that an gauranteed
-	// extra four bytes that have been nulled need to be placed at
-	// the start of the buffer storing sort items, this is because
-	// it's possible that the offset could become negativde in the 
-	// comparison function (done for efficiency).
-	static int CompareLexographicItem(const SSortedHit &arg1, 
-		const SSortedHit &arg2) {
-
-		static uLong value1;
-		static uLong value2;
-		static int offset;
-
-		offset = m_init_offset;
-		char *buff1 = arg1.hit.hit_item + m_sort_byte_size;
-		char *buff2 = arg2.hit.hit_item + m_sort_byte_size;
-
-		while(true) {
-			value1 = *(uLong *)buff1;
-			value2 = *(uLong *)buff2;
-
-			if(offset < 0) {
-				value1 >>= -offset;
-				value2 >>= -offset;
-			}
-
-			if(value1 < value2) {
-				return 1;
-			}
-
-			if(value1 > value2) {
-				return -1;
-			}
-
-			if(offset <= 0) {
-				return 0;
-			}
-
-			offset -= 32;
-			buff1 -= 4;
-			buff2 -= 4;
-		}
-
-		return 0;
-	}
-
-	// This is the comparison function used in quick sort
-	static int CompareQuickSortItem(const SSortedHit &arg1, 
-		const SSortedHit &arg2) {
-
-		return m_compare(arg1.hit, arg2.hit);
-	}
-
-	// This initializes the set of bucket hit items
+	// This loads the first sort item from each sorted block into the tree,
+	// each sorted block has a fixed slot in the queue buffer
 	// @param work_dir - this is the working directory to store the hashed
 	//                 - keys produced as output
 	// @param div_start - this is the beginning of the set of sorted files
 	//					- being merged for this client
-	void Initialize(const char work_dir[], int div_start) {
+	// @param tree - this is used to merge the sorted blocks
+	template <class C>
+	void Initialize(const char work_dir[], int div_start, CLoserTree<C> &tree) {
 
-		int offset = 4;
-		SSortedHit item; 
 		for(int i=0; i<m_sorted_block_set.OverflowSize(); i++) {
-
-			item.bucket = i; 
-			item.hit.hit_item = m_queue_buff.Buffer() + offset; 
+			char *slot = m_queue_buff.Buffer() + (i * m_hit_byte_size);
 			m_sorted_block_set[i].OpenReadFile(CUtility::ExtendString(work_dir, i + div_start));
 
-			if(!m_sorted_block_set[i].ReadCompObject(item.hit.hit_item, m_hit_byte_size)) {
-				continue;
+			if(m_sorted_block_set[i].ReadCompObject(slot, m_hit_byte_size)) {
+				tree.SetLeaf(i, slot);
 			}
-
-			m_queue.AddItem(item); 
-			offset += m_hit_byte_size; 
 		}
+
+		tree.Build();
 	}
 
-	// This is the first pass of the sorting process note bucket number is
-	// the max number of buckets that can fit into memory and bucket 
-	// set is an index giving the current lot of buckets (bucket num)
+	// This merges all of the sorted blocks into a single sorted file
 	// @param sort_merge_file - this stores tthe final sorted file
-	template <class X>
-	void SortPass(X &sort_merge_file, bool is_display) {
+	// @param tree - this is used to merge the sorted blocks
+	// @param is_display - true if progress should be displayed
+	template <class X, class C>
+	void SortPass(X &sort_merge_file, CLoserTree<C> &tree, bool is_display) {
 
-		SSortedHit item; 
-		CArrayList<char *> released_slot(10); 
 		int pass = 0;
+		char *item;
 
-		while(m_queue.PopItem(item)) {
-
-			sort_merge_file.WriteCompObject(item.hit.hit_item, m_hit_byte_size);
-			released_slot.PushBack(item.hit.hit_item); 
+		while((item = tree.WinnerItem()) != NULL) {
+			int winner = tree.Winner();
+			sort_merge_file.WriteCompObject(item, m_hit_byte_size);
 
-			// retrieves a hit from a different bucket if none 
-			// left in current bucket
-			if(!m_sorted_block_set[item.bucket].ReadCompObject
-				(released_slot.LastElement(), m_hit_byte_size)) {
-					continue;
+			// the sorted block's slot is refilled in place
+			if(!m_sorted_block_set[winner].ReadCompObject(item, m_hit_byte_size)) {
+				tree.SetLeaf(winner, NULL);
 			}
 
+			tree.Replay(winner);
+
 			if(is_display == true && ++pass >= 4000000) {
 				float perc = 0;
 				for(int i=0; i<m_sorted_block_set.OverflowSize(); i++) {
@@ -141,11 +68,37 @@ class CMergeSortedBlocks {
 				cout<<(perc * 100)<<"% Done"<<endl;
 				pass = 0;
 			}
+		}
+	}
+
+	// This merges a set of sorted blocks and writes them to the output file
+	// @param work_dir - this is the working directory storing the sorted blocks
+	// @param output_dir - this is the directory of the merged file
+	// @param div_start - the first sorted block being merged
+	// @param div_end - one past the last sorted block being merged
+	// @param compare - this is used to compare sort items
+	template <class C>
+	void MergeBlocks(const char work_dir[], const char output_dir[],
+		int div_start, int div_end, const C &compare) {
 
-			// adds another hit back to the priority queue from
-			// the same bucket division if bucket division not empty
-			item.hit.hit_item = released_slot.PopBack(); 
-			m_queue.AddItem(item); 
+		int bucket_num = div_end - div_start;
+		m_sorted_block_set.AllocateMemory(bucket_num);
+		m_queue_buff.AllocateMemory(m_hit_byte_size * bucket_num); 
+
+		CLoserTree<C> tree;
+		tree.Initialize(bucket_num, compare);
+		Initialize(work_dir, div_start, tree);
+
+		if(CSetNum::GetClientID() > 0) {
+			CHDFSFile sort_merge_file;
+			sort_merge_file.OpenWriteFile(output_dir);
+			sort_merge_file.InitializeCompression(1 << 16);
+			SortPass(sort_merge_file, tree, false);
+		} else {
+			CSegFile sort_merge_file;
+			sort_merge_file.OpenWriteFile(output_dir);
+			sort_merge_file.InitializeCompression(1 << 16);
+			SortPass(sort_merge_file, tree, true);
 		}
 	}
 
@@ -170,36 +123,11 @@ public:
 			compare_byte_size = sort_byte_size;
 		}
 
-		m_sort_byte_size = compare_byte_size - 4;
-		m_init_offset = m_sort_byte_size;
+		SKeyCompare compare;
+		compare.key_byte_size = compare_byte_size;
 		m_hit_byte_size = sort_byte_size;
 
-		// this is used in the lexographic compare function
-		if(m_init_offset < 0) {
-			m_init_offset = -((-m_init_offset) << 3);
-		} else {
-			m_init_offset <<= 3;
-		}
-
-		int bucket_num = div_end - div_start;
-		m_sorted_block_set.AllocateMemory(bucket_num);
-		m_queue.Initialize(bucket_num, CompareLexographicItem);
-		m_queue_buff.AllocateMemory((m_hit_byte_size * bucket_num) + 4); 
-		memset(m_queue_buff.Buffer(), 0, 4);
-
-		Initialize(work_dir, div_start);
-
-		if(CSetNum::GetClientID() > 0) {
-			CHDFSFile sort_merge_file;
-			sort_merge_file.OpenWriteFile(output_dir);
-			sort_merge_file.InitializeCompression(1 << 16);
-			SortPass(sort_merge_file, false);
-		} else {
-			CSegFile sort_merge_file;
-			sort_merge_file.OpenWriteFile(output_dir);
-			sort_merge_file.InitializeCompression(1 << 16);
-			SortPass(sort_merge_file, true);
-		}
+		MergeBlocks(work_dir, output_dir, div_start, div_end, compare);
 	}
 
 	// This is the entry function for a quick sort
@@ -215,31 +143,10 @@ public:
 		int sort_byte_size, int div_start, int div_end, 
 		int (*compare_func)(const SExternalSort &arg1, const SExternalSort &arg2)) {
 
+		SFuncCompare compare;
+		compare.compare = compare_func;
 		m_hit_byte_size = sort_byte_size;
-		m_compare = compare_func;
-
-		int bucket_num = div_end - div_start;
-		m_sorted_block_set.AllocateMemory(bucket_num);
-		m_queue.Initialize(bucket_num, CompareQuickSortItem);
-		m_queue_buff.AllocateMemory((m_hit_byte_size * bucket_num) + 4); 
-		memset(m_queue_buff.Buffer(), 0, 4);
 
-		Initialize(work_dir, div_start);
-
-		if(CSetNum::GetClientID() > 0) {
-			CHDFSFile sort_merge_file;
-			sort_merge_file.OpenWriteFile(output_dir);
-			sort_merge_file.InitializeCompression(1 << 16);
-			SortPass(sort_merge_file, false);
-		} else {
-			CSegFile sort_merge_file;
-			sort_merge_file.OpenWriteFile(output_dir);
-			sort_merge_file.InitializeCompression(1 << 16);
-			SortPass(sort_merge_file, true);
-		}
+		MergeBlocks(work_dir, output_dir, div_start, div_end, compare);
 	}
 };
-int CMergeSortedBlocks::m_hit_byte_size;
-int CMergeSortedBlocks::m_sort_byte_size;
-int CMergeSortedBlocks::m_init_offset;
-int (*CMergeSortedBlocks::m_compare)(const SExternalSort & arg1, const SExternalSort & arg2); 
\ No newline at end of file
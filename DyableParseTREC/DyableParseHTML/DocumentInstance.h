@@ -99,6 +99,11 @@ class CDocumentInstance : public CWebpage {
 	CArray<char> m_mod_url_buff;
 	// This returns the set of stop characters
 	bool m_is_stop_character[256];
+	// This stores each of the stop characters in the set
+	// so a block can be matched against them
+	char m_stop_char[256];
+	// This stores the number of stop characters
+	int m_stop_char_num;
 
 	// Stores text stats
 	STextStat m_text;
@@ -121,6 +126,18 @@ class CDocumentInstance : public CWebpage {
 	// This stores the start of the current html tag being processed
 	char *m_html_text_tag;
 
+	// This returns the mask of the stop characters in a block
+	// @param block - a ptr to the first byte in the block
+	inline uLong StopMask(const char block[]) {
+
+		uLong mask = 0;
+		for(int i=0; i<m_stop_char_num; i++) {
+			mask |= CByteScan::ByteMask(block, m_stop_char[i]);
+		}
+
+		return mask;
+	}
+
 	// Scans a text string embedded in the document and extracts
 	// any valid words. It also checks for stopwords and indexes
 	// appropriately, aswell as converting to lower case and checking
@@ -131,32 +148,67 @@ class CDocumentInstance : public CWebpage {
 		bool is_capital = false;
 		m_excerpt.paragraph_char_num += length - start;
 		int char_num = 0;
-		for(int i=start; i<length; i++) {
+		int i = start;
+
+		// whole blocks are counted with masks unless they hold the end of a sentence
+		for(; i + CByteScan::BLOCK_SIZE <= length; i += CByteScan::BLOCK_SIZE) {
+			char *block = str + i;
+			uLong sentence = (CByteScan::ByteMask(block, '.') | CByteScan::ByteMask(block, ';') |
+				CByteScan::ByteMask(block, '?')) & CByteScan::ByteMask(block + 1, ' ');
 
-			if((str[i] == '.' || str[i] == ';' || str[i] == '?') && str[i+1] == ' ') {
-				if(char_num > 20 && is_capital == true) { 
-					m_excerpt.sentence_num++;
-					is_capital = false;
+			if(sentence != 0) {
+				for(int j=i; j<i + CByteScan::BLOCK_SIZE; j++) {
+					ScanCharacter(str, j, char_num, is_capital);
 				}
+				continue;
+			}
+
+			uLong letter = CByteScan::LetterMask(block);
+			uLong stop = StopMask(block);
 
-				char_num = 0;
+			char_num += CByteScan::BLOCK_SIZE;
+			m_excerpt.char_num += CByteScan::BitCount(letter);
+			m_excerpt.illegal_char_num += CByteScan::BLOCK_SIZE - CByteScan::BitCount(letter | stop);
+			if(CByteScan::RangeMask(block, 'A', 'Z') != 0) {
+				is_capital = true;
 			}
+		}
 
-			char_num++;
-			if(CUtility::AskEnglishCharacter(str[i])) {
-				m_excerpt.char_num++;
-				if(CUtility::AskCapital(str[i])) {
-					is_capital = true;
-				}
-				continue;
+		for(; i<length; i++) {
+			ScanCharacter(str, i, char_num, is_capital);
+		}
+	}
+
+	// This counts a single character in a text segment
+	// @param str - the text segment
+	// @param i - the position of the character
+	// @param char_num - the number of characters since the last sentence
+	// @param is_capital - true if a capital was found in the sentence
+	inline void ScanCharacter(char str[], int i, int &char_num, bool &is_capital) {
+
+		if((str[i] == '.' || str[i] == ';' || str[i] == '?') && str[i+1] == ' ') {
+			if(char_num > 20 && is_capital == true) { 
+				m_excerpt.sentence_num++;
+				is_capital = false;
 			}
 
-			if(m_is_stop_character[(uChar)(str[i])]) {
-				continue;
+			char_num = 0;
+		}
+
+		char_num++;
+		if(CUtility::AskEnglishCharacter(str[i])) {
+			m_excerpt.char_num++;
+			if(CUtility::AskCapital(str[i])) {
+				is_capital = true;
 			}
+			return;
+		}
 
-			m_excerpt.illegal_char_num++;
+		if(m_is_stop_character[(uChar)(str[i])]) {
+			return;
 		}
+
+		m_excerpt.illegal_char_num++;
 	}
 
 	// This adds a link stored in the temp buffer to the log
@@ -270,7 +322,9 @@ public:
 	// belonging to document instance 
 	// @param set_id - this is the set id for the current
 	//               - file storage for this client
-	void InitializeDocumentInstance(int set_id) {
+	// @param is_logged - true if compiled documents are added to a 
+	//                  - document log instead of the file storage
+	void InitializeDocumentInstance(int set_id, bool is_logged = false) {
 		m_excerpt_bound.Initialize(6000);
 		m_paragraph_bound.Initialize(6000);
 		m_image_bound.Initialize(1000);
@@ -288,7 +342,14 @@ public:
 		m_is_stop_character[(uChar)('.')] = true;
 		m_is_stop_character[(uChar)('\'')] = true;
 
-		InitializeWebpage(set_id);
+		m_stop_char_num = 0;
+		for(int i=0; i<256; i++) {
+			if(m_is_stop_character[i] == true) {
+				m_stop_char[m_stop_char_num++] = (char)i;
+			}
+		}
+
+		InitializeWebpage(set_id, is_logged);
 	}
 
 	// Starts a new document alerting the log file and webgraph
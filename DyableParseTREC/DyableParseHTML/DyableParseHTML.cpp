@@ -5,6 +5,8 @@
 // length of each document and extract the url.
 class CProcessTRECDataSet {
 
+	// This defines the maximum number of bytes read from a header at a time
+	static const int LINE_SIZE = 4096;
 
 	// This stores the TREC data set
 	CHDFSFile m_trec_file;
@@ -15,27 +17,31 @@ class CProcessTRECDataSet {
 	// This stores the current byte offset
 	int m_curr_byte_offset;
 
-	// This extracts the html header
+	// This extracts the html header a line at a time. A blank line 
+	// ends the header, new lines are stored as null characters.
 	bool ExtractHTMLHeader() {
 
-		char ch;
+		char line_buff[LINE_SIZE];
 		m_header_buff.Resize(0);
-		while(m_trec_file.ReadObject(ch)) {
-			m_header_buff.PushBack(ch);
-
-			if(m_header_buff.Size() < 2) {
-				continue;
+		while(true) {
+			int start = m_header_buff.Size();
+			int size = m_trec_file.ReadObjectUntil(line_buff, LINE_SIZE, '\n');
+			if(size == 0) {
+				return false;
 			}
 
-			if(ch == '\0') {
-				m_header_buff.LastElement() = '\n';
-			}
+			m_header_buff.CopyBufferToArrayList(line_buff, size, start);
 
-			if(ch == '\n') {
-				m_header_buff.LastElement() = '\0';
+			char *line = m_header_buff.Buffer();
+			for(int i=max(start, 1); i<m_header_buff.Size(); i++) {
+				if(line[i] == '\0') {
+					line[i] = '\n';
+				} else if(line[i] == '\n') {
+					line[i] = '\0';
+				}
 			}
 
-			if(CUtility::FindFragment(m_header_buff.Buffer() + 
+			if(m_header_buff.Size() >= 2 && CUtility::FindFragment(m_header_buff.Buffer() + 
 				m_header_buff.Size() - 2, "\0\0", 2, 0)) {
 				return true;
 			}
@@ -115,13 +121,51 @@ public:
 		return m_trec_file.ReadObject(doc_buff.Buffer(), content_len);
 	}
 };
+const int CProcessTRECDataSet::LINE_SIZE;
 
 
 // This class is responsible for retrieve documents
 // from the document server so that they can be indexed.
 // This includes seperating the normal text from the HTML text.
+// Documents can also be parsed by a number of threads at once. 
+// A single reader thread splits the TREC file into documents and
+// places each in the next slot of a ring. Each parse thread has its
+// own html parser and takes the next unparsed slot, writing the 
+// compiled documents to the slot's document log. The calling thread
+// adds the logs to file storage in the order the documents were read
+// so document ids are the same as when parsing with a single thread.
 class CDocumentServer {
 
+	// This defines the number of documents in the ring per parse thread
+	static const int SLOTS_PER_THREAD = 4;
+
+	// This stores a document as it passes from the reader thread
+	// through a parse thread and into file storage
+	struct SDocumentSlot {
+		// This stores the document
+		CArray<char> document;
+		// This stores the url of the document
+		CArray<char> url;
+		// This stores the compiled documents
+		CArrayList<char> doc_log;
+		// This is true if the document was parsed successfully
+		bool is_parsed;
+		// This is true if the slot marks the end of the document set
+		bool is_end;
+		// This is signalled once the document has been parsed
+		CSemaphore parsed_sem;
+	};
+
+	// This stores a parse thread
+	struct SParseThread {
+		// This stores a ptr to the document server
+		CDocumentServer *this_ptr;
+		// This is used to extract HTML attributes from the page
+		CHTMLAttribute html_attr;
+		// This stores the handle of the thread
+		pthread_t handle;
+	};
+
 	// Stores the retrieved document
 	CArray<char> m_document;
 	// This stores the url buffer
@@ -131,27 +175,46 @@ class CDocumentServer {
 	// This stores the document index
 	CProcessTRECDataSet m_doc_set;
 
+	// This stores the ring of documents being parsed
+	CMemoryChunk<SDocumentSlot> m_slot;
+	// This stores the number of documents read
+	_int64 m_read_num;
+	// This stores the number of documents taken by parse threads
+	_int64 m_parse_num;
+	// This is signalled when a slot is free to be read into
+	CSemaphore m_free_sem;
+	// This is signalled when a slot is ready to be parsed
+	CSemaphore m_read_sem;
+	// This protects the next document to parse
+	CMutex m_parse_mutex;
+
 	// This breaks the text document up into individual html tag 
 	// segments and text string segments. It then feeds each 
 	// segment into HTMLAttribute for further processing.
+	// @param html_attr - the html parser for the document
+	// @param document - the document being parsed
 	// @param offset - the offset in the document buffer
-	void CompileWebDocument(int offset) {
+	static void CompileWebDocument(CHTMLAttribute &html_attr, CArray<char> &document, int offset) {
 		bool html_tag = false; 
 		int start = offset;
 
-		for(int i=offset; i<m_document.Size(); i++) {
-			if(m_document[i] == '<') {
+		int size = document.Size();
+		// jumps straight to the next tag boundary rather than testing every byte
+		for(int i = CByteScan::FindAnyOf(document.Buffer(), offset, size, '<', '>'); i < size; 
+			i = CByteScan::FindAnyOf(document.Buffer(), i + 1, size, '<', '>')) {
+
+			if(document[i] == '<') {
 				if(html_tag == false) {
-					m_html_attr.AddData(m_document.Buffer(), i, start);	
+					html_attr.AddData(document.Buffer(), i, start);	
 				}
 
 				start = i + 1; 
 				html_tag = true;
 				continue;
 			} 
-			if(m_document[i] == '>') {
+			if(document[i] == '>') {
 				if(html_tag == true) {
-					m_html_attr.AddAttribute(m_document.Buffer(), i, start);
+					html_attr.AddAttribute(document.Buffer(), i, start);
 				}
 				html_tag = false;
 				start = i + 1; 
@@ -160,8 +223,30 @@ class CDocumentServer {
 		}
 
 		if(html_tag == false) {
-			m_html_attr.AddData(m_document.Buffer(), m_document.Size(), start);	
+			html_attr.AddData(document.Buffer(), document.Size(), start);	
+		}
+	}
+
+	// This parses a single document and compiles its attributes
+	// @param html_attr - the html parser for the document
+	// @param document - the document being parsed
+	// @param url - the url of the document
+	// @return true if the document was parsed, false otherwise
+	static bool ParseDocument(CHTMLAttribute &html_attr, CArray<char> &document, CArray<char> &url) {
+
+		try { 
+			html_attr.DocInstance().SetBaseURL(url.Buffer(), url.Size());
+			int pos = CUtility::FindSubFragment(document.Buffer(), "\n\n", document.Size());
+
+			html_attr.Reset();
+			html_attr.DocInstance().CreateNewDocument();
+			CompileWebDocument(html_attr, document, pos + 2);
+			html_attr.DocInstance().FinishDocument();
+			return true;
+		} catch(...) {
 		}
+
+		return false;
 	}
 
 	// This runs through all of the documents that belong to this client
@@ -182,19 +267,127 @@ class CDocumentServer {
 				float perc = m_doc_set.DocsParsed() * 100;
 				//cout<<"Client "<<set_id<<": "<<perc<<"%"<<endl;
 			}
-			
 
-			try { 
-				m_html_attr.DocInstance().SetBaseURL(m_url.Buffer(), m_url.Size());
-				int pos = CUtility::FindSubFragment(m_document.Buffer(), "\n\n", m_document.Size());
-
-				m_html_attr.Reset();
-				m_html_attr.DocInstance().CreateNewDocument();
-				CompileWebDocument(pos + 2);
-				m_html_attr.DocInstance().FinishDocument();
+			if(ParseDocument(m_html_attr, m_document, m_url) == true) {
 				docs_parsed++;	
+			}
+		}
+
+		return docs_parsed;
+	}
+
+	// This is the entry function for the reader thread. Each document 
+	// is read into the next slot in the ring once the slot is free. 
+	static THREAD_RETURN1 THREAD_RETURN2 ReadDocumentThread(void *ptr) {
+
+		CDocumentServer *this_ptr = (CDocumentServer *)ptr;
+		CMemoryChunk<SDocumentSlot> &slot_set = this_ptr->m_slot;
+
+		while(true) {
+			this_ptr->m_free_sem.Wait();
+			SDocumentSlot &slot = slot_set[(int)(this_ptr->m_read_num % slot_set.OverflowSize())];
+			slot.doc_log.Resize(0);
+			slot.is_parsed = false;
+			slot.is_end = true;
+
+			try {
+				slot.is_end = !this_ptr->m_doc_set.RetrieveNextDocument(slot.document, slot.url);
 			} catch(...) {
 			}
+
+			this_ptr->m_read_num++;
+			this_ptr->m_read_sem.Signal();
+			if(slot.is_end == true) {
+				slot.parsed_sem.Signal();
+				break;
+			}
+		}
+
+		return 0;
+	}
+
+	// This is the entry function for a parse thread. The parse threads
+	// take slots in the order they were read until the end is reached,
+	// the end slot is never taken so every parse thread finds it.
+	static THREAD_RETURN1 THREAD_RETURN2 ParseDocumentThread(void *ptr) {
+
+		SParseThread *thread = (SParseThread *)ptr;
+		CDocumentServer *this_ptr = thread->this_ptr;
+		CMemoryChunk<SDocumentSlot> &slot_set = this_ptr->m_slot;
+
+		while(true) {
+			this_ptr->m_read_sem.Wait();
+
+			this_ptr->m_parse_mutex.Acquire();
+			SDocumentSlot &slot = slot_set[(int)(this_ptr->m_parse_num % slot_set.OverflowSize())];
+			if(slot.is_end == false) {
+				this_ptr->m_parse_num++;
+			}
+			this_ptr->m_parse_mutex.Release();
+
+			if(slot.is_end == true) {
+				// passes the end on to the next parse thread
+				this_ptr->m_read_sem.Signal();
+				break;
+			}
+
+			thread->html_attr.DocInstance().SetDocumentLog(slot.doc_log);
+			slot.is_parsed = ParseDocument(thread->html_attr, slot.document, slot.url);
+			slot.parsed_sem.Signal();
+		}
+
+		return 0;
+	}
+
+	// This parses the documents using a number of parse threads
+	// @param set_id - this is the id of the compiled attributes 
+	//               - being produced
+	// @param thread_num - the number of parse threads
+	// @return the number of documents parsed
+	int ParallelCycleThroughDocuments(int set_id, int thread_num) {
+
+		unsigned int threadID;
+		m_slot.AllocateMemory(thread_num * SLOTS_PER_THREAD);
+		for(int i=0; i<m_slot.OverflowSize(); i++) {
+			m_slot[i].document.Initialize(2000000);
+			m_slot[i].url.Initialize(2048);
+			m_slot[i].doc_log.Initialize(0xFFFF);
+			m_free_sem.Signal();
+		}
+
+		m_read_num = 0;
+		m_parse_num = 0;
+
+		CMemoryChunk<SParseThread> thread(thread_num);
+		for(int i=0; i<thread_num; i++) {
+			thread[i].this_ptr = this;
+			thread[i].html_attr.DocInstance().InitializeDocumentInstance(set_id, true);
+			thread[i].handle = _beginthreadex(NULL, 0, 
+				ParseDocumentThread, &thread[i], NULL, &threadID);
+		}
+
+		pthread_t reader = _beginthreadex(NULL, 0, 
+			ReadDocumentThread, this, NULL, &threadID);
+
+		int docs_parsed = 0;
+		for(_int64 i=0; ; i++) {
+			SDocumentSlot &slot = m_slot[(int)(i % m_slot.OverflowSize())];
+			slot.parsed_sem.Wait();
+			if(slot.is_end == true) {
+				break;
+			}
+
+			m_html_attr.DocInstance().CommitDocumentLog(slot.doc_log);
+			if(slot.is_parsed == true) {
+				docs_parsed++;
+			}
+
+			m_free_sem.Signal();
+		}
+
+		WaitForThread(reader, INFINITE);
+		for(int i=0; i<thread_num; i++) {
+			WaitForThread(thread[i].handle, INFINITE);
 		}
 
 		return docs_parsed;
@@ -214,7 +407,10 @@ public:
 	// @param set_id - this is the id of the compiled attributes 
 	//               - being produced
 	// @param html_dir - this stores the directory of the html document
-	void IndexDocuments(int client_id, int client_num, int set_id, const char *html_dir) {
+	// @param thread_num - the number of parse threads, documents are
+	//                   - parsed on the calling thread if one
+	void IndexDocuments(int client_id, int client_num, int set_id, 
+		const char *html_dir, int thread_num = 1) {
 
 		CWebpage::SetClientID(client_id);
 		CNodeStat::SetClientID(client_id);
@@ -226,24 +422,121 @@ public:
 		m_document.Initialize(2000000);
 		m_html_attr.DocInstance().InitializeDocumentInstance(set_id);
 	
-		int doc_num = CycleThroughDocuments(client_id, set_id);
+		int doc_num;
+		if(thread_num > 1) {
+			doc_num = ParallelCycleThroughDocuments(set_id, thread_num);
+		} else {
+			doc_num = CycleThroughDocuments(client_id, set_id);
+		}
 
 		CHDFSFile size_file;
 		size_file.OpenWriteFile(CUtility::ExtendString
 			("GlobalData/CompiledAttributes/doc_set_size", set_id));
 		size_file.WriteObject(doc_num);
 	}
+
+	// This measures the parsing throughput of a single core. The documents
+	// are first loaded into memory so that only the parse is timed. Both the
+	// tag boundary scan on its own and the full parse of each document are
+	// reported in MB/s of html. The hit lists are still written to set_id.
+	// @param set_id - the id of the compiled attributes being produced
+	// @param html_dir - this stores the directory of the html document
+	// @param max_bytes - the maximum number of document bytes to load
+	void BenchmarkDocuments(int set_id, const char *html_dir, int max_bytes) {
+
+		CWebpage::SetClientID(0);
+		CNodeStat::SetClientID(0);
+		CNodeStat::SetClientNum(1);
+
+		m_url.Initialize(2048);
+		m_doc_set.Initialize(html_dir);
+		m_document.Initialize(2000000);
+		m_html_attr.DocInstance().InitializeDocumentInstance(set_id);
+
+		CArrayList<char> doc_buff(max_bytes);
+		CArrayList<int> doc_offset(1024);
+		doc_offset.PushBack(0);
+		while(doc_buff.Size() < max_bytes) {
+			try {
+				if(m_doc_set.RetrieveNextDocument(m_document, m_url) == false) {
+					break;
+				}
+			} catch(...) {
+				break;
+			}
+
+			doc_buff.CopyBufferToArrayList(m_document.Buffer(), m_document.Size(), doc_buff.Size());
+			doc_offset.PushBack(doc_buff.Size());
+		}
+
+		int doc_num = doc_offset.Size() - 1;
+		double mbytes = (double)doc_buff.Size() / (1 << 20);
+		cout<<"Loaded "<<doc_num<<" Documents "<<mbytes<<" MB"<<endl;
+		if(doc_num == 0) {
+			return;
+		}
+
+		CStopWatch scan_time;
+		_int64 tag_num = 0;
+		scan_time.StartTimer();
+		for(int i=0; i<doc_num; i++) {
+			int end = doc_offset[i+1];
+			for(int j = CByteScan::FindAnyOf(doc_buff.Buffer(), doc_offset[i], end, '<', '>');
+				j < end; j = CByteScan::FindAnyOf(doc_buff.Buffer(), j + 1, end, '<', '>')) {
+				tag_num++;
+			}
+		}
+		scan_time.StopTimer();
+
+		CStopWatch parse_time;
+		for(int i=0; i<doc_num; i++) {
+			int size = doc_offset[i+1] - doc_offset[i];
+			m_document.Resize(size);
+			memcpy(m_document.Buffer(), doc_buff.Buffer() + doc_offset[i], size);
+
+			try { 
+				m_html_attr.DocInstance().SetBaseURL(m_url.Buffer(), m_url.Size());
+				int pos = CUtility::FindSubFragment(m_document.Buffer(), "\n\n", m_document.Size());
+
+				m_html_attr.Reset();
+				m_html_attr.DocInstance().CreateNewDocument();
+				parse_time.StartTimer();
+				CompileWebDocument(m_html_attr, m_document, pos + 2);
+				parse_time.StopTimer();
+				m_html_attr.DocInstance().FinishDocument();
+			} catch(...) {
+			}
+		}
+
+		double scan_sec = scan_time.NetElapsedTime();
+		double parse_sec = parse_time.NetElapsedTime();
+		cout<<"Tag Boundaries "<<tag_num<<" Block Size "<<CByteScan::BLOCK_SIZE<<endl;
+		cout<<"Tag Scan "<<(mbytes / max(scan_sec, 1e-9))<<" MB/s"<<endl;
+		cout<<"Parse "<<(mbytes / max(parse_sec, 1e-9))<<" MB/s per core"<<endl;
+	}
 };
+const int CDocumentServer::SLOTS_PER_THREAD;
 
 
 int main(int argc, char *argv[]) {
 
 	if(argc < 2)return 0;
 
+	// DyableParseHTML Benchmark <set_id> <warc file> [max MB]
+	if(argc > 3 && strcmp(argv[1], "Benchmark") == 0) {
+		int max_bytes = (argc > 4) ? atoi(argv[4]) << 20 : 256 << 20;
+		CMemoryElement<CDocumentServer> bench;
+		bench->BenchmarkDocuments(atoi(argv[2]), argv[3], max_bytes);
+		bench.DeleteMemoryElement();
+		return 0;
+	}
+
 	int client_id;
 	int client_num;
 	int set_id;
 	const char *doc_set_dir;
+	// the number of parse threads is optional and follows the other arguments
+	int thread_num = 1;
 
 	if(argc > 3) {
 
@@ -252,6 +545,9 @@ int main(int argc, char *argv[]) {
 		set_id = atoi(argv[3]);
 		doc_set_dir = argv[4];
 		int len = strlen(doc_set_dir);
+		if(argc > 5) {
+			thread_num = atoi(argv[5]);
+		}
 
 		CHDFSFile size_file;
 		size_file.OpenWriteFile(CUtility::ExtendString
@@ -265,6 +561,9 @@ int main(int argc, char *argv[]) {
 		
 		set_id = atoi(argv[1]);
 		int len;
+		if(argc > 2) {
+			thread_num = atoi(argv[2]);
+		}
 
 		CHDFSFile size_file;
 		size_file.OpenReadFile(CUtility::ExtendString
@@ -288,7 +587,7 @@ int main(int argc, char *argv[]) {
 	
 	CBeacon::InitializeBeacon(client_id, 2222);
 	CMemoryElement<CDocumentServer> index;
-	index->IndexDocuments(client_id, client_num, set_id, doc_set_dir);
+	index->IndexDocuments(client_id, client_num, set_id, doc_set_dir, thread_num);
 	index.DeleteMemoryElement();
 	CBeacon::SendTerminationSignal();
 
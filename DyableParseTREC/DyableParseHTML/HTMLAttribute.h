@@ -1,5 +1,121 @@
 #include "./DocumentInstance.h"
 
+// This class stores the set of html tags that have a handler. The tag
+// set is fixed so a perfect hash is built when the table is created, 
+// a multiplier is searched for that maps every tag to its own slot. A
+// lookup then takes a single hash and a single comparison to confirm
+// the tag, there are no collision chains to follow.
+class CHTMLTagTable {
+
+	// This defines the number of slots in the table
+	static const int SLOT_NUM = 256;
+	// This defines the maximum number of bytes in a tag
+	static const int MAX_TAG_LENGTH = 11;
+
+	// This stores the tag index held in each slot, -1 if empty
+	short m_slot[SLOT_NUM];
+	// This stores each of the tags
+	char m_tag[SLOT_NUM][MAX_TAG_LENGTH + 1];
+	// This stores the length of each tag
+	char m_tag_length[SLOT_NUM];
+	// This stores the number of tags
+	int m_tag_num;
+	// This stores the multiplier used to spread the tags
+	uLong m_seed;
+
+	// This returns the slot for a given tag 
+	// @param str - the buffer containing the tag
+	// @param length - the number of bytes in the tag
+	inline int Slot(const char str[], int length) {
+
+		uLong hash = length;
+		for(int i=0; i<length; i++) {
+			hash = (hash * 31) + (uChar)str[i];
+		}
+
+		return (int)(((hash * m_seed) >> 24) & (SLOT_NUM - 1));
+	}
+
+	// This checks if every tag is mapped to a different slot
+	bool AskPerfectSeed() {
+
+		for(int i=0; i<SLOT_NUM; i++) {
+			m_slot[i] = -1;
+		}
+
+		for(int i=0; i<m_tag_num; i++) {
+			int slot = Slot(m_tag[i], m_tag_length[i]);
+			if(m_slot[slot] >= 0) {
+				return false;
+			}
+
+			m_slot[slot] = i;
+		}
+
+		return true;
+	}
+
+public:
+
+	CHTMLTagTable() {
+		m_tag_num = 0;
+	}
+
+	// This adds a tag to the table, the tag index is the
+	// order in which the tag was added
+	// @param str - the html tag
+	void AddTag(const char str[]) {
+
+		int length = (int)strlen(str);
+		if(length > MAX_TAG_LENGTH || m_tag_num >= SLOT_NUM) {
+			throw EIllegalArgumentException("html tag");
+		}
+
+		memcpy(m_tag[m_tag_num], str, length + 1);
+		m_tag_length[m_tag_num++] = (char)length;
+	}
+
+	// This builds the perfect hash once all the tags have been added,
+	// the search is deterministic so the same seed is always chosen
+	void BuildTable() {
+
+		for(int i=0; i<(1 << 20); i++) {
+			m_seed = 0x9E3779B1 + (i << 1);
+			if(AskPerfectSeed() == true) {
+				return;
+			}
+		}
+
+		throw EException("Could not build html tag table");
+	}
+
+	// This returns the index of a tag
+	// @param str - the buffer containing the tag
+	// @param length - one past the last byte in the tag
+	// @param start - the first byte in the tag
+	// @return the tag index, -1 if the tag isn't in the table
+	inline int FindTag(const char str[], int length, int start) {
+
+		length -= start;
+		if(length <= 0 || length > MAX_TAG_LENGTH) {
+			return -1;
+		}
+
+		int index = m_slot[Slot(str + start, length)];
+		if(index < 0 || m_tag_length[index] != length) {
+			return -1;
+		}
+
+		if(memcmp(m_tag[index], str + start, length) != 0) {
+			return -1;
+		}
+
+		return index;
+	}
+};
+const int CHTMLTagTable::SLOT_NUM;
+const int CHTMLTagTable::MAX_TAG_LENGTH;
+
 // This class is responsible for examining the HTML attribute tags on
 // each of the webpages and extracting the characteristics of the 
 // page such as links, images, text formating, keywords, line breaks
@@ -12,7 +128,7 @@ class CHTMLAttribute {
 	bool m_no_spider;
 
 	// stores the html tags used in looking up the handler functions
-	CHashDictionary<short> m_html_tag;
+	CHTMLTagTable m_html_tag;
 	// stores the current image index found
 	int m_curr_image_index;
 	// This stores the current instance of a document
@@ -31,7 +147,6 @@ public:
 		m_no_spider = false;
 		m_curr_image_index = 0;
 
-		m_html_tag.Initialize(200, 8);
 		char html[][20]={"a", "img", "meta", "p", "/p", "/a", 
 			"title", "/title", "li", "font", "pre", "/pre", "center",  
 			"/center", "tt", "/tt", "h", "/h", "hr", "table", "/table", "br", "script", "/script", 
@@ -40,10 +155,11 @@ public:
 
 		int index=0;
 		while(!CUtility::FindFragment(html[index], "//")) {
-			int length = (int)strlen(html[index]);
-			m_html_tag.AddWord(html[index++], length);
+			m_html_tag.AddTag(html[index++]);
 		}
 
+		m_html_tag.BuildTable();
+
 	}
 
 	// This returns a reference to the current document instance
@@ -102,9 +218,9 @@ public:
 			return;
 		}
 
-		int index = m_html_tag.FindWord(str, html_length, start);
+		int index = m_html_tag.FindTag(str, html_length, start);
 		//if the appropriate index is found
-		if(m_html_tag.AskFoundWord()) {	
+		if(index >= 0) {	
 			//call the appropriate handler through the function pointer
 			(this->*html_handler[index])(str, length, start);	
 		}
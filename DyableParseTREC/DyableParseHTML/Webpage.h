@@ -124,6 +124,9 @@ class CWebpage {
 
 	// This stores the compiled document
 	CFileStorage m_comp_doc;
+	// This stores the compiled documents for a single webpage when
+	// parsing with multiple threads, NULL if added straight to storage
+	CArrayList<char> *m_doc_log;
 	// This stores the compiled document
 	CLinkedBuffer<char> m_doc_text;
 	// This stores the document title , stored with each excerpt
@@ -289,13 +292,36 @@ getchar();*/
 
 			m_doc_text.CopyBufferToLinkedBuffer(bound.start_ptr, size);
 
+			StoreDocument();
+		}
+	}
+
+	// This stores the compiled document held in the text buffer. Each 
+	// entry in the document log holds the url length, url, document 
+	// length and document so it can be added to storage later.
+	void StoreDocument() {
+
+		if(m_doc_log == NULL) {
 			m_comp_doc.AddDocument(m_doc_text, BaseURL().Buffer(), BaseURL().Size());
+			return;
 		}
+
+		int url_length = BaseURL().Size();
+		int doc_length = m_doc_text.Size();
+		m_doc_log->CopyBufferToArrayList((char *)&url_length, sizeof(int), m_doc_log->Size());
+		m_doc_log->CopyBufferToArrayList(BaseURL().Buffer(), url_length, m_doc_log->Size());
+		m_doc_log->CopyBufferToArrayList((char *)&doc_length, sizeof(int), m_doc_log->Size());
+
+		int offset = m_doc_log->Size();
+		m_doc_log->ExtendSize(doc_length);
+		m_doc_text.ResetPath();
+		m_doc_text.CopyLinkedBufferToBuffer(m_doc_log->Buffer() + offset, doc_length);
 	}
 
 public:
 
 	CWebpage() {
+		m_doc_log = NULL;
 	}
 
 	
@@ -303,13 +329,17 @@ public:
 	// in the set of illegal web page type extensions.
 	// @param set_id - this is the set id for the current
 	//               - file storage for this client
-	void InitializeWebpage(int set_id) {
+	// @param is_logged - true if compiled documents are added to a 
+	//                  - document log instead of the file storage
+	void InitializeWebpage(int set_id, bool is_logged = false) {
 		m_base_url.Initialize(2048); 
 		m_webpage_type.Initialize(4); 
 		m_doc_text.Initialize(2048);
 
-		m_comp_doc.Initialize(CUtility::ExtendString
-			("GlobalData/CompiledAttributes/comp_doc", set_id));
+		if(is_logged == false) {
+			m_comp_doc.Initialize(CUtility::ExtendString
+				("GlobalData/CompiledAttributes/comp_doc", set_id));
+		}
 
 		m_illegal_url_char.AllocateMemory(256);
 		char char_set[] = "#@&;\"$,\n\t![]()*|{}\0";
@@ -328,6 +358,13 @@ public:
 		} 
 	}
 
+	// This sets the log that stores the compiled documents for the next
+	// webpage, the webpage must have been initialized as logged
+	// @param doc_log - the document log
+	inline void SetDocumentLog(CArrayList<char> &doc_log) {
+		m_doc_log = &doc_log;
+	}
+
 	// This sets the title for the document
 	// @paraam text_starta_ptr - this is a ptr to the first character in the title
 	// @param text_end_ptr - this is a ptr to the last character in the title
@@ -424,7 +461,7 @@ public:
 		AddAttribute(image_bound, "<i>");
 
 		// first add the document stub
-		m_comp_doc.AddDocument(m_doc_text, BaseURL().Buffer(), BaseURL().Size());
+		StoreDocument();
 
 		if(excerpt_bound.Size() > 0) {
 			AddExcerpts(excerpt_bound);
@@ -433,6 +470,25 @@ public:
 		return true;
 	}
 
+	// This adds the compiled documents held in a document log to the file
+	// storage in the order they were logged
+	// @param doc_log - the document log created by another webpage
+	void CommitDocumentLog(CArrayList<char> &doc_log) {
+
+		int offset = 0;
+		while(offset < doc_log.Size()) {
+			int url_length = *(int *)(doc_log.Buffer() + offset);
+			char *url = doc_log.Buffer() + offset + sizeof(int);
+			offset += sizeof(int) + url_length;
+
+			int doc_length = *(int *)(doc_log.Buffer() + offset);
+			offset += sizeof(int);
+
+			m_comp_doc.AddDocument(doc_log.Buffer() + offset, doc_length, url, url_length);
+			offset += doc_length;
+		}
+	}
+
 	// Checks the link characters are valid. This is done by scanning
 	// through the url string and looking for invalid characters.
 	bool CheckLinkCharacters(char str[], int length, int start = 0) {
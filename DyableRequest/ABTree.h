@@ -224,7 +224,7 @@ public:
 	}
 
 	// This returns a ptr to an ab_node 
-	inline SABTreeNode *ABNode(COpenConnection &conn) {
+	inline SABTreeNode *ABNode(CFrameConnection &conn) {
 		return m_ab_node_cache.AddABNode(conn);
 	}
 
@@ -33,6 +33,9 @@ class CHitItemBlockSet {
 	CMemoryChunk<CHitItemBlock> m_doc_id_block;
 	// This stores the number of hit list divisions
 	int m_hit_list_div_num;
+	// This is a predicate indicating whether the indexes are mapped
+	// read only into memory rather than read through the file system
+	bool m_is_mapped;
 
 	// This loads in each of the different hit block indexes
 	void LoadHitBlockIndexes() {
@@ -43,28 +46,28 @@ class CHitItemBlockSet {
 		
 		for(int i=0; i<m_ab_tree_block.OverflowSize(); i++) {
 			m_ab_tree_block[i].Initialize(CUtility::
-				ExtendString(AB_TREE_DIR, i), 100);
+				ExtendString(AB_TREE_DIR, i), 100, m_is_mapped);
 
 			m_keyword_block[i].Initialize(CUtility::
-				ExtendString(KEYWORDS_DIR, i), 100);
+				ExtendString(KEYWORDS_DIR, i), 100, m_is_mapped);
 
 			m_s_link_block[i].Initialize(CUtility::
-				ExtendString(S_LINK_DIR, i), 100);
+				ExtendString(S_LINK_DIR, i), 100, m_is_mapped);
 
 			m_doc_id_block[i].Initialize(CUtility::
-				ExtendString(DOC_ID_LOOKUP_DIR, i), 100);
+				ExtendString(DOC_ID_LOOKUP_DIR, i), 100, m_is_mapped);
 		}
 
 		for(int j=0; j<2; j++) {
 			for(int i=0; i<m_hit_list_block.OverflowSize(); i++) {
 				m_hit_list_block[i].hit_type[j].Initialize(CUtility::
-					ExtendString(dir[j], i), 100);
+					ExtendString(dir[j], i), 100, m_is_mapped);
 			}
 		}
 
 		for(int i=0; i<m_lookup_block.OverflowSize(); i++) {
 			m_lookup_block[i].Initialize(CUtility::ExtendString
-				("GlobalData/Retrieve/lookup", i), 100);
+				("GlobalData/Retrieve/lookup", i), 100, m_is_mapped);
 		}
 	}
 
@@ -79,10 +82,12 @@ public:
 	}
 
 	// This is called to start the comp block cache
-	void Initialize(int hit_list_div_num, int ab_tree_num) {
+	// @param is_mapped - true if the indexes should be mapped read only
+	void Initialize(int hit_list_div_num, int ab_tree_num, bool is_mapped) {
 
-		CHitItemBlock::InitializeLRUQueue(50000);
+		CHitItemBlock::InitializeLRUQueue();
 
+		m_is_mapped = is_mapped;
 		m_hit_list_div_num = hit_list_div_num;
 		m_ab_tree_block.AllocateMemory(ab_tree_num);
 		m_keyword_block.AllocateMemory(ab_tree_num);
@@ -94,6 +99,23 @@ public:
 		LoadHitBlockIndexes();
 	}
 
+	// This writes out uncompressed copies of the search tree and keyword
+	// indexes, which are touched on every query. When these flat files are
+	// present a mapped index reads them directly without decompression.
+	// This only needs to be run once after the indexes have been built.
+	// @param ab_tree_num - this is the total number of ab_trees
+	static void CreateFlatIndexes(int ab_tree_num) {
+
+		CCompression comp;
+		for(int i=0; i<ab_tree_num; i++) {
+			comp.LoadIndex(CUtility::ExtendString(AB_TREE_DIR, i));
+			comp.CreateFlatFile();
+
+			comp.LoadIndex(CUtility::ExtendString(KEYWORDS_DIR, i));
+			comp.CreateFlatFile();
+		}
+	}
+
 	// This is the entry function used to retrieve a set of bytes from
 	// storage at some offset. The comp block will need to be loaded 
 	// into memory if it not already availabe. 
@@ -194,8 +216,18 @@ public:
 
 	// This is called to start the comp block cache
 	// @param ab_tree_num - this is the total number of ab_trees
-	inline static void Initialize(int hit_list_div_num, int ab_tree_num) {
-		m_byte.Initialize(hit_list_div_num, ab_tree_num);
+	// @param is_mapped - true if the indexes should be mapped read only
+	//                  - so they are shared between query servers
+	inline static void Initialize(int hit_list_div_num, 
+		int ab_tree_num, bool is_mapped = true) {
+
+		m_byte.Initialize(hit_list_div_num, ab_tree_num, is_mapped);
+	}
+
+	// This writes out uncompressed copies of the hottest indexes
+	// @param ab_tree_num - this is the total number of ab_trees
+	inline static void CreateFlatIndexes(int ab_tree_num) {
+		CHitItemBlockSet::CreateFlatIndexes(ab_tree_num);
 	}
 
 	// This sets the number of hit list divisions
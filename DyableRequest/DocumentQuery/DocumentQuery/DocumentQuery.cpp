@@ -13,9 +13,10 @@ class CDocumentQuery {
 
 
 	// This issues a request to the document server
-	bool IssueRequest(COpenConnection &conn, _int64 &doc_id) {
+	bool IssueRequest(CFrameConnection &conn, _int64 &doc_id) {
 
 		char success;
+		CQueryTrace::SendQueryID(conn);
 		conn.Send((char *)&doc_id, 5);
 		conn.Receive(&success, 1);
 
@@ -26,17 +27,9 @@ class CDocumentQuery {
 		}
 
 		int doc_length;
-		int offset = 0;
-		int bytes_received;
-
 		conn.Receive((char *)&doc_length, 4);
 		m_doc_buff.AllocateMemory(doc_length);
-		while(offset < doc_length) {
-			conn.Receive(bytes_received, 
-				m_doc_buff.Buffer() + offset, doc_length - offset);
-
-			offset += bytes_received;
-		}
+		conn.Receive(m_doc_buff.Buffer(), doc_length);
 
 		conn.CloseConnection();
 		return true;
@@ -58,12 +51,20 @@ class CDocumentQuery {
 			return false;
 		}
 
-		COpenConnection conn;
+		// the id of the query the document was returned for
+		int query_id_len;
+		const char *query_id = CUtility::ExtractText(buff, "qid=", query_id_len);
+		if(query_id != NULL) {
+			CQueryTrace::SetQueryID(strtoll(query_id, NULL, 10));
+		}
+
+		CFrameConnection conn;
 		CNameServer::DocumentServerInst(conn);
 		if(IssueRequest(conn, doc_id) == false) {
 			return false;
 		}
 
+		CTraceSpan span(CQueryTrace::SUMMARY);
 		m_doc_inst.AddQueryTerms(query_text, len);
 
 		const char *id_set = CUtility::ExtractText(buff, "keywords=", len);
@@ -102,6 +103,7 @@ public:
 
 	CDocumentQuery() {
 		CNameServer::Initialize();
+		CQueryTrace::Initialize("Document Query");
 	}
 
 	// This is the entry function
@@ -111,6 +113,7 @@ public:
 		strcpy(buff.Buffer(), text);
 
 		ProcessDisplayDocument(buff.Buffer());
+		CQueryTrace::Flush();
 	}
 };
 
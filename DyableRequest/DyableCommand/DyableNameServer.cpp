@@ -1,4 +1,4 @@
-#include "./ProcessRequest.h"
+#include "./LoadGenerator.h"
 
 // This server is responsible for keeping track of each of the different servers
 // used to perform various tasks needed to process a query. It associates a 
@@ -8,9 +8,36 @@ class CNameServer : public CProcessRequest {
 
 	// This defines the keep alive time for a server before it is restarted
 	static const int KEEP_ALIVE_TIME = 10000000;
+	// This defines the number of workers used to handle requests
+	static const int WORKER_NUM = 8;
 
 	// This is used to process requests
 	COpenConnection m_conn;
+	// This dispatches requests to the workers
+	CReactor m_reactor;
+
+	// This is called by a worker once a client has sent requests. Every 
+	// request in the frame is handled, the connection is then kept open 
+	// for the client's next requests until the client closes it.
+	static bool HandleConnection(SOCKET &socket, void *ptr) {
+
+		CNameServer *this_ptr = (CNameServer *)ptr;
+		CFrameConnection conn(socket);
+
+		try {
+			do {
+				this_ptr->ProcessRequest(conn);
+			} while(conn.IsReceivePending() == true);
+
+			socket = conn.Detach();
+			return true;
+		} catch(...) {
+		}
+
+		conn.CloseConnection();
+		socket = INVALID_SOCKET;
+		return false;
+	}
 
 public:
 
@@ -32,31 +59,29 @@ public:
 		ns_port_file.WriteObject(KEEP_ALIVE_TIME);
 		ns_port_file.CloseFile();
 
-		SOCKET socket;
 		m_conn.ListenOnServerConnection(INFINITE);
 		cout<<"Name Server Listening For Connections"<<endl;
 
 		Initialize();
 
-		while(true) {
-			socket = m_conn.ServerAcceptConnection();
-cout<<"in&&&"<<endl;
-			try {
-				ProcessRequest(socket);
-			} catch(...) {
-			}
-
-			COpenConnection::CloseConnection(socket);
-cout<<"out&&&"<<endl;
-		}
+		m_reactor.Initialize(m_conn.Socket(), WORKER_NUM, HandleConnection, this);
+		m_reactor.Run();
 	}
 };
 const int CNameServer::KEEP_ALIVE_TIME;
+const int CNameServer::WORKER_NUM;
 
 
 
 int main(int argc, char *argv[]) {
 
+	if(argc >= 5 && strcmp(argv[1], "LoadTest") == 0) {
+		CLoadGenerator load;
+		load.Run(atoi(argv[2]), atoi(argv[3]), atoi(argv[4]),
+			argc >= 6 && strcmp(argv[5], "Ping") == 0);
+		return 0;
+	}
+
 	if(argc < 2) {
 		CNameServerStat::SetServerID(0);
 	} else {
@@ -0,0 +1,247 @@
+#include "./ProcessRequest.h"
+
+// This is used to measure the latency of the name server under a fixed
+// request rate. Requests are issued open loop, that is request i is due
+// i / qps seconds after the start regardless of how long earlier requests
+// took. The latency of a request is measured from the time it was due
+// rather than the time it was sent, so a server that falls behind is
+// charged for the time requests spent waiting. Each request opens a new
+// connection and looks up a server, cycling through the server types, so
+// every request goes through the locked server table. A server that is
+// handed out is freed again on the same connection. Optionally only a 
+// Ping is sent to measure the server core alone. The p50 and p99 
+// latencies are reported once every request has finished.
+class CLoadGenerator {
+
+	// This defines the number of server types
+	static const int SERVER_TYPE_NUM = 5;
+	// This stores the name of each server type in the order the
+	// name server registers them, the index is the server type id
+	static const char *m_server_name[SERVER_TYPE_NUM];
+
+	// This stores the state of a single client thread
+	struct SClient {
+		// This stores a ptr to the load generator
+		CLoadGenerator *this_ptr;
+		// This stores the id of the client
+		int id;
+		// This stores the handle of the client thread
+		pthread_t handle;
+	};
+
+	// This stores the name server port
+	u_short m_ns_port;
+	// This stores the number of requests issued per second
+	int m_qps;
+	// This stores the total number of requests
+	int m_request_num;
+	// This is true if only a Ping is sent
+	bool m_is_ping;
+	// This stores the latency of each request in seconds,
+	// a failed request has a negative latency
+	CMemoryChunk<float> m_latency;
+	// This stores the set of client threads
+	CMemoryChunk<SClient> m_client;
+	// This is started when the first request is due
+	CStopWatch m_clock;
+
+	// This is used to sort the latencies from smallest to largest
+	static int CompareLatency(const float &arg1, const float &arg2) {
+
+		if(arg1 < arg2) {
+			return 1;
+		}
+
+		if(arg1 > arg2) {
+			return -1;
+		}
+
+		return 0;
+	}
+
+	// This returns the number of seconds since the first request was due
+	double ElapsedTime() {
+
+		CStopWatch clock = m_clock;
+		clock.StopTimer();
+		return clock.GetElapsedTime();
+	}
+
+	// This sends the name of a request to the name server
+	// @param conn - the connection to the name server
+	// @param request_id - the id of the request
+	// @param request - the name of the request
+	void SendRequestName(CFrameConnection &conn, int request_id, const char request[]) {
+
+		char buff[20];
+		memset(buff, 0, sizeof(buff));
+		strncpy(buff, request, sizeof(buff) - 1);
+		conn.Send((char *)&request_id, sizeof(int));
+		conn.Send(buff, sizeof(buff));
+	}
+
+	// This looks up a server of a given type. If a server is handed
+	// out it's freed straight away so the server table isn't drained.
+	// @param conn - the connection to the name server
+	// @param server_type_id - the type of server being looked up
+	void LookupServer(CFrameConnection &conn, int server_type_id) {
+
+		int request_id;
+		char is_avail;
+		u_short port;
+		SendRequestName(conn, server_type_id, m_server_name[server_type_id]);
+		conn.Receive((char *)&request_id, sizeof(int));
+		conn.Receive(&is_avail, sizeof(char));
+		conn.Receive((char *)&port, sizeof(u_short));
+
+		if(request_id != server_type_id) {
+			throw ENetworkException("Invalid Reply ID");
+		}
+
+		if(is_avail == false) {
+			return;
+		}
+
+		SendRequestName(conn, server_type_id, "FreeServer");
+		conn.Send((char *)&server_type_id, sizeof(int));
+		conn.Send((char *)&port, sizeof(u_short));
+	}
+
+	// This sends a single request to the name server
+	// @param id - the index of the request
+	// @return true if the name server replied, false otherwise
+	bool SendRequest(int id) {
+
+		CFrameConnection conn;
+		if(conn.OpenClientConnection(m_ns_port, LOCAL_NETWORK) == false) {
+			return false;
+		}
+
+		bool is_alive = false;
+		try {
+			if(m_is_ping == true) {
+				int request_id = 0;
+				char buff;
+				SendRequestName(conn, request_id, "Ping");
+				conn.Receive((char *)&request_id, sizeof(int));
+				conn.Receive(&buff, sizeof(char));
+			} else {
+				LookupServer(conn, id % SERVER_TYPE_NUM);
+			}
+
+			conn.Flush();
+			is_alive = true;
+		} catch(...) {
+		}
+
+		conn.CloseConnection();
+		return is_alive;
+	}
+
+	// This is the entry function for each client thread. Client i
+	// issues every request whose index is i modulo the client number.
+	static THREAD_RETURN1 THREAD_RETURN2 ClientThread(void *ptr) {
+
+		SClient *client = (SClient *)ptr;
+		CLoadGenerator *this_ptr = client->this_ptr;
+		int client_num = this_ptr->m_client.OverflowSize();
+
+		for(int i=client->id; i<this_ptr->m_request_num; i+=client_num) {
+			double due_time = (double)i / this_ptr->m_qps;
+			double wait_time = due_time - this_ptr->ElapsedTime();
+			if(wait_time > 0) {
+				usleep((int)(wait_time * 1000000));
+			}
+
+			if(this_ptr->SendRequest(i) == false) {
+				this_ptr->m_latency[i] = -1;
+				continue;
+			}
+
+			this_ptr->m_latency[i] = (float)(this_ptr->ElapsedTime() - due_time);
+		}
+
+		return 0;
+	}
+
+	// This returns the latency at a given percentile
+	// @param latency - the sorted latency of every successful request
+	// @param success_num - the number of successful requests
+	// @param percentile - the percentile between 0 and 100
+	float Percentile(CMemoryChunk<float> &latency, int success_num, int percentile) {
+
+		int index = (int)(((_int64)success_num * percentile) / 100);
+		return latency[min(index, success_num - 1)];
+	}
+
+public:
+
+	CLoadGenerator() {
+	}
+
+	// This issues requests at a fixed rate to the name server
+	// and reports the latency distribution.
+	// @param qps - the number of requests issued per second
+	// @param second_num - the number of seconds to issue requests for
+	// @param client_num - the number of concurrent client threads
+	// @param is_ping - true if only a Ping is sent, false to look up servers
+	void Run(int qps, int second_num, int client_num, bool is_ping = false) {
+
+		if(qps <= 0 || second_num <= 0 || client_num <= 0) {
+			throw EIllegalArgumentException("Invalid Load Parameters");
+		}
+
+		int keep_alive_time;
+		CHDFSFile ns_port_file;
+		ns_port_file.OpenReadFile("GlobalData/PortInfo/ns");
+		ns_port_file.ReadObject(m_ns_port);
+		ns_port_file.ReadObject(keep_alive_time);
+		ns_port_file.CloseFile();
+
+		m_qps = qps;
+		m_is_ping = is_ping;
+		m_request_num = qps * second_num;
+		m_latency.AllocateMemory(m_request_num, -1);
+		m_client.AllocateMemory(client_num);
+
+		unsigned int threadID;
+		m_clock.StartTimer();
+		for(int i=0; i<client_num; i++) {
+			m_client[i].this_ptr = this;
+			m_client[i].id = i;
+			m_client[i].handle = _beginthreadex(NULL, 0,
+				ClientThread, &m_client[i], NULL, &threadID);
+		}
+
+		for(int i=0; i<client_num; i++) {
+			WaitForThread(m_client[i].handle, INFINITE);
+		}
+
+		double total_time = ElapsedTime();
+
+		int success_num = 0;
+		CMemoryChunk<float> latency(m_request_num);
+		for(int i=0; i<m_request_num; i++) {
+			if(m_latency[i] >= 0) {
+				latency[success_num++] = m_latency[i];
+			}
+		}
+
+		cout<<"Requests "<<m_request_num<<" Failed "<<(m_request_num - success_num)
+			<<" Achieved QPS "<<(success_num / total_time)<<endl;
+
+		if(success_num == 0) {
+			return;
+		}
+
+		CSort<float> sort(success_num, CompareLatency);
+		sort.HybridSort(latency.Buffer());
+
+		cout<<"Target QPS "<<qps<<" p50 "<<(Percentile(latency, success_num, 50) * 1000)
+			<<" ms p99 "<<(Percentile(latency, success_num, 99) * 1000)<<" ms Max "
+			<<(latency[success_num - 1] * 1000)<<" ms"<<endl;
+	}
+};
+const int CLoadGenerator::SERVER_TYPE_NUM;
+const char *CLoadGenerator::m_server_name[] = {"TextStringServer", 
+	"DocumentServer", "ExpRewServer", "RetrieveServer", "KeywordServer"};
@@ -113,42 +113,87 @@ public:
 		m_server_type[offset++] = &m_keyword_server;
 	}
 
-	// This process a request issued by a query
-	void ProcessRequest(SOCKET &socket) {
-
-		int server_type_id;
+	// This process a request issued by a query. Requests are handled by 
+	// several workers at once so the server table is locked once the 
+	// request name has been read. Each request starts with an id that 
+	// is sent back ahead of the reply so a client can have several 
+	// requests outstanding on the same connection.
+	void ProcessRequest(CFrameConnection &conn) {
+
+		int request_id;
 		CMemoryChunk<char> buff(20);
-		COpenConnection::Receive(socket, buff.Buffer(), 20);
+		conn.Receive((char *)&request_id, sizeof(int));
+		conn.Receive(buff.Buffer(), 20);
+
+		if(CUtility::FindFragment(buff.Buffer(), "Ping")) {
+			char is_alive = true;
+			conn.Send((char *)&request_id, sizeof(int));
+			conn.Send(&is_alive, sizeof(char));
+			return;
+		}
+
+		m_mutex.Acquire();
+		try {
+			ProcessServerRequest(conn, request_id, buff.Buffer());
+		} catch(...) {
+			m_mutex.Release();
+			throw;
+		}
+		m_mutex.Release();
+	}
+
+	// This returns the server type that a request is looking for
+	// @param request - the name of the request
+	// @return the server type, NULL if the request is not a lookup
+	CServerType *LookupServerType(const char request[]) {
 
-		cout<<buff.Buffer()<<endl;
-		if(CUtility::FindFragment(buff.Buffer(), "RetrieveServer")) {
-			m_retrieve_server.ProcessRequest(socket);
+		if(CUtility::FindFragment(request, "RetrieveServer")) {
+			return &m_retrieve_server;
 		}
 
-		if(CUtility::FindFragment(buff.Buffer(), "TextStringServer")) {
-			m_text_string_server.ProcessRequest(socket);
+		if(CUtility::FindFragment(request, "TextStringServer")) {
+			return &m_text_string_server;
 		}
 
-		if(CUtility::FindFragment(buff.Buffer(), "DocumentServer")) {
-			m_doc_server.ProcessRequest(socket);
+		if(CUtility::FindFragment(request, "DocumentServer")) {
+			return &m_doc_server;
 		}
 
-		if(CUtility::FindFragment(buff.Buffer(), "ExpRewServer")) {
-			m_exp_rew_server.ProcessRequest(socket);
+		if(CUtility::FindFragment(request, "ExpRewServer")) {
+			return &m_exp_rew_server;
 		}
 
-		if(CUtility::FindFragment(buff.Buffer(), "KeywordServer")) {
-			m_keyword_server.ProcessRequest(socket);
+		if(CUtility::FindFragment(request, "KeywordServer")) {
+			return &m_keyword_server;
+		}
+
+		return NULL;
+	}
+
+	// This process a request for one of the server types, only 
+	// a lookup has a reply, freeing a server does not
+	// @param conn - the connection to the query
+	// @param request_id - the id of the request sent with the reply
+	// @param request - the name of the request
+	void ProcessServerRequest(CFrameConnection &conn, int request_id, const char request[]) {
+
+		int server_type_id;
+		cout<<request<<endl;
+		CServerType *server_type = LookupServerType(request);
+		if(server_type != NULL) {
+			conn.Send((char *)&request_id, sizeof(int));
+			server_type->ProcessRequest(conn);
+			return;
 		}
 
-		if(CUtility::FindFragment(buff.Buffer(), "FreeServer")) {
-			COpenConnection::Receive(socket, (char *)&server_type_id, sizeof(int));
-			m_server_type[server_type_id]->FreeServer(socket);
+		if(CUtility::FindFragment(request, "FreeServer")) {
+			conn.Receive((char *)&server_type_id, sizeof(int));
+			m_server_type[server_type_id]->FreeServer(conn);
 		}
 
-		if(CUtility::FindFragment(buff.Buffer(), "DestroyServer")) {
-			COpenConnection::Receive(socket, (char *)&server_type_id, sizeof(int));
-			m_server_type[server_type_id]->DestroyServer(socket);
+		if(CUtility::FindFragment(request, "DestroyServer")) {
+			conn.Receive((char *)&server_type_id, sizeof(int));
+			m_server_type[server_type_id]->DestroyServer(conn);
 		}
 	}
 
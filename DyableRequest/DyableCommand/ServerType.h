@@ -68,9 +68,11 @@ public:
 		}
 	}
 
-	// This processes an incoming request for a server
-	void ProcessRequest(SOCKET &socket) {
+	// This processes an incoming request for a server. The reply is 
+	// whether a server is available followed by its port.
+	void ProcessRequest(CFrameConnection &conn) {
 
+		u_short port = 0;
 		char is_avail = false;
 		cout<<m_server_dir.Buffer()<<" ";
 		for(int i=0; i<m_avail_set.OverflowSize(); i++) {
@@ -83,13 +85,14 @@ public:
 			if(m_avail_set[i].is_avail == true) {
 				is_avail = true;
 				m_avail_set[i].is_avail = false;
-				COpenConnection::Send(socket, &is_avail, sizeof(char));
-				COpenConnection::Send(socket, (char *)&m_avail_set[i].port, sizeof(u_short));
+				conn.Send(&is_avail, sizeof(char));
+				conn.Send((char *)&m_avail_set[i].port, sizeof(u_short));
 				return;
 			}
 		}
 
-		COpenConnection::Send(socket, &is_avail, sizeof(char));
+		conn.Send(&is_avail, sizeof(char));
+		conn.Send((char *)&port, sizeof(u_short));
 	}
 
 	// This sends a notification to all of the client servers
@@ -110,10 +113,10 @@ public:
 	}
 	
 	// This destroys a given server and removes it's contact information from the table
-	void DestroyServer(SOCKET &sock) {
+	void DestroyServer(CFrameConnection &conn) {
 
 		u_short port;
-		COpenConnection::Receive(sock, (char *)&port, sizeof(u_short));
+		conn.Receive((char *)&port, sizeof(u_short));
 
 		for(int i=0; i<m_avail_set.OverflowSize(); i++) {
 
@@ -130,10 +133,10 @@ public:
 	// This handles the freeing of the server from use. This could 
 	// occur when the server is no longer being used or a new server
 	// has just been created.
-	void FreeServer(SOCKET &sock) {
+	void FreeServer(CFrameConnection &conn) {
 
 		u_short port;
-		COpenConnection::Receive(sock, (char *)&port, sizeof(u_short));
+		conn.Receive((char *)&port, sizeof(u_short));
 cout<<"here1"<<endl;
 		for(int i=0; i<m_avail_set.OverflowSize(); i++) {
 
@@ -144,11 +147,11 @@ cout<<"here1"<<endl;
 			}
 		}
 cout<<"here2"<<endl;
-		COpenConnection conn;
+		COpenConnection server_conn;
 		for(int i=0; i<m_avail_set.OverflowSize(); i++) {
 
-			if(conn.OpenClientConnection(m_avail_set[i].port, LOCAL_NETWORK) == true) {
-				conn.CloseConnection();
+			if(server_conn.OpenClientConnection(m_avail_set[i].port, LOCAL_NETWORK) == true) {
+				server_conn.CloseConnection();
 				continue;
 			}
 
@@ -7,10 +7,19 @@ const char *ASSOC_MAP_FILE = "GlobalData/Lexon/assoc_map";
 // document id that is supplied as part of the query process.
 class CParseQuery : public CNameServerStat {
 
+	// This defines the number of requests handled before the server is restarted
+	static const int KEEP_ALIVE_TIME = 10000;
+
 	// This stores all of the document instances when performing a lookup
 	CRetrieveDocument m_doc_set;
 	// This stores the tcp connection
 	COpenConnection m_conn;
+	// This dispatches requests to the worker
+	CReactor m_reactor;
+	// This stores the port the server is listening on
+	u_short m_listen_port;
+	// This stores the number of requests handled
+	int m_request_num;
 
 	// This predicate indicates whether the server is in use or not
 	bool m_in_use;
@@ -19,14 +28,14 @@ class CParseQuery : public CNameServerStat {
 
 	// writes the a success code back to the client
 	// @param connect - send data to connection
-	static inline void WriteSuccessResponse(COpenConnection &connect) {
+	static inline void WriteSuccessResponse(CFrameConnection &connect) {
 		char success = 's';
 		connect.Send(&success, 1);
 	}
 
 	// writes the a failure code back to the client
 	// @param connect - send data to connection
-	static inline void WriteFailureResponse(COpenConnection &connect) {
+	static inline void WriteFailureResponse(CFrameConnection &connect) {
 		char failure = 'f';
 		connect.Send(&failure, 1);
 	}
@@ -34,12 +43,15 @@ class CParseQuery : public CNameServerStat {
 	// Retrieves a particular document from the document
 	// set with a given document id
 	// @param connect - send data to connection
-	void HandleQueryCase(COpenConnection &connect) {
+	void HandleQueryCase(CFrameConnection &connect) {
 
 		_int64 doc_id = 0;
 		CMemoryChunk<char> doc_buff;
+		CQueryTrace::ReceiveQueryID(connect);
 		connect.Receive((char *)&doc_id, 5);
 
+		CTraceSpan span(CQueryTrace::DOCUMENT_FETCH);
+
 		if(!m_doc_set.RetrieveDocument(doc_id, doc_buff)) {
 			WriteFailureResponse(connect);
 			return;
@@ -57,6 +69,31 @@ class CParseQuery : public CNameServerStat {
 		connect.Send(doc_buff.Buffer(), length);
 	}
 
+	// This is called by the worker once a client has connected, requests
+	// are handled until the client closes the connection
+	static bool HandleConnection(SOCKET &socket, void *ptr) {
+
+		CParseQuery *this_ptr = (CParseQuery *)ptr;
+
+		try {
+			CFrameConnection conn(socket);
+			CNameServer::SetServerActive(conn);
+
+			while(true) {
+				this_ptr->HandleQueryCase(conn);
+				CQueryTrace::EndRequest();
+				if(++this_ptr->m_request_num >= KEEP_ALIVE_TIME) {
+					this_ptr->m_reactor.Stop();
+					break;
+				}
+			}
+		} catch(...) {
+		}
+
+		CNameServer::FreeServer(this_ptr->m_listen_port);
+		return false;
+	}
+
 public:
 
 	// This creates a document server
@@ -70,30 +107,27 @@ public:
 		CNameServerStat::InitializeBeacon();
 
 		CUtility::RandomizeSeed();
-		u_short listen_port = (rand() % 40000) + 10000;
-		while(m_conn.OpenServerConnection(listen_port, LOCAL_NETWORK) == false) {
-			listen_port = (rand() % 40000) + 10000;
+		m_listen_port = (rand() % 40000) + 10000;
+		while(m_conn.OpenServerConnection(m_listen_port, LOCAL_NETWORK) == false) {
+			m_listen_port = (rand() % 40000) + 10000;
 		}
 
 		CNameServer::Initialize();
-		CNameServer::FreeServer(listen_port);
+		CQueryTrace::Initialize("Document Server");
+		CNameServer::FreeServer(m_listen_port);
 		m_conn.ListenOnServerConnection(INFINITE);
-		
-		for(int i=0; i<10000; i++) {
-			try {
-				COpenConnection conn(m_conn.ServerAcceptConnection());
-				CNameServer::SetServerActive(conn);
-				HandleQueryCase(conn);
-			} catch(...) {
-			}
 
-			CNameServer::FreeServer(listen_port);
-		}
+		m_request_num = 0;
+		// the reset port is sent as soon as a query connects
+		m_reactor.Initialize(m_conn.Socket(), 1, HandleConnection, this, true);
+		m_reactor.Run();
 
-		CNameServer::DestroyServer(listen_port);
+		CNameServer::DestroyServer(m_listen_port);
 	}
 };
 
+const int CParseQuery::KEEP_ALIVE_TIME;
+
 int main(int argc, char *argv[]) {
 
 
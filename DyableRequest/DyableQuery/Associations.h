@@ -61,7 +61,7 @@ public:
 	}
 
 	// This adds the set of associations to the set
-	void AddAssociations(COpenConnection &conn) {
+	void AddAssociations(CFrameConnection &conn) {
 
 		static u_short num;
 		static SAssoc assoc;
@@ -244,21 +244,28 @@ class CCompileRankedList {
 	// This resolves the doc ids for the top ranking documents
 	void ResolveDocIDs() {
 
-		SOCKET sock;
+		CFrameConnection conn;
 		int num = m_fin_set_ptr->Size();
-		CNameServer::ExpectedRewardServerInst(sock);
+		CNameServer::ExpectedRewardServerInst(conn);
 
 		static char request[20] = "DocIDLookup";
-		COpenConnection::Send(sock, request, 20);
-		COpenConnection::Send(sock, (char *)&num, sizeof(int));
+		conn.Send(request, 20);
+		CQueryTrace::SendQueryID(conn);
+		conn.Send((char *)&num, sizeof(int));
 
+		// every node id is sent before any doc id is received 
+		// so the lookup takes a single round trip
 		for(int i=0; i<m_fin_set_ptr->Size(); i++) {
 			SQueryRes &res = *m_fin_set_ptr->operator[](i).ptr;
-			COpenConnection::Send(sock, (char *)&res.node_id, sizeof(S5Byte));
-			COpenConnection::Receive(sock, (char *)&res.doc_id, sizeof(S5Byte));
+			conn.Send((char *)&res.node_id, sizeof(S5Byte));
 		}
 
-		COpenConnection::CloseConnection(sock);
+		for(int i=0; i<m_fin_set_ptr->Size(); i++) {
+			SQueryRes &res = *m_fin_set_ptr->operator[](i).ptr;
+			conn.Receive((char *)&res.doc_id, sizeof(S5Byte));
+		}
+
+		CNameServer::ReleaseExpectedRewardServer(conn);
 	}
 
 public:
@@ -268,6 +275,12 @@ public:
 		m_keyword_set.AllocateMemory(100, -100);
 	}
 
+	// This removes the documents and keywords left from the previous query
+	void Reset() {
+		m_excerpt_doc_buff.Restart();
+		m_keyword_server.Reset();
+	}
+
 	// This adds a document to the set
 	inline void AddDocument(SQueryRes &res) {
 
@@ -278,6 +291,11 @@ public:
 		m_excerpt_doc_buff.PushBack(res);
 	}
 
+	// This returns the set of documents added since the last reset
+	inline CLinkedBuffer<SQueryRes> &DocumentSet() {
+		return m_excerpt_doc_buff;
+	}
+
 	// This returns a reference to the last document
 	inline SQueryRes &LastDoc() {
 		return m_excerpt_doc_buff.LastElement();
@@ -1,4 +1,4 @@
-#include "./TextStringServer.h"
+#include "./QueryLog.h"
 
 // This is the main entry class for a query.
 // It's responsible for parsing a text string
@@ -9,8 +9,9 @@ class CParseQuery {
 	CRender m_render_res;
 	// This is used to retrieve the set of word ids for each query term
 	CTextStringServer m_retrieve_word_set;
-	// This is used to contact the retrieve servers
-	CRetrieveServer m_retrieve_server;
+	// This is used to contact the retrieve servers, it outlives the
+	// query since a server abandoned at the deadline may still use it
+	static CRetrieveServer m_retrieve_server;
 	// This is used to measure the different component times
 	CStopWatch m_timer;
 
@@ -20,6 +21,8 @@ class CParseQuery {
 
 		m_retrieve_server.ProcessQuery(m_retrieve_word_set.QueryTermNum());
 
+		CTraceSpan render_span(CQueryTrace::RENDER);
+
 		/*cout<<"<h4>Word ID Set: ";
 		for(int i=0; i<CRetrieveServer::WordIDSet().Size(); i++) {
 			cout<<CRetrieveServer::WordIDSet()[i].word_id.Value()<<" "<<
@@ -32,29 +35,59 @@ class CParseQuery {
 		m_render_res.RenderResults();
 	}
 
+	// This reports the network cost of the query as a html comment, that
+	// is the number of round trips made to the query servers and the 
+	// number of bytes sent before and after compression. The number of
+	// retrieve servers that missed the deadline is also reported, the
+	// results are partial if any did.
+	void RenderNetworkStat() {
+
+		cout<<"\n<!-- Round Trips "<<CFrameConnection::RoundTripNum()
+			<<" Frames Sent "<<CFrameConnection::SendFrameNum()
+			<<" Wire Bytes "<<CFrameConnection::WireByteNum()
+			<<" Raw Bytes "<<CFrameConnection::RawByteNum()<<" -->"<<endl;
+
+		cout<<"<!-- Retrieve Servers "<<m_retrieve_server.ServerNum()
+			<<" Timed Out "<<m_retrieve_server.ExpiredServerNum()<<" -->"<<endl;
+
+		cout<<"<!-- Cache Hit "<<m_retrieve_server.IsCacheHit()
+			<<" Lookups "<<CQueryCache::LookupNum()
+			<<" Hits "<<CQueryCache::HitNum()
+			<<" Evicted "<<CQueryCache::EvictNum()
+			<<" Entries "<<CQueryCache::EntryNum()
+			<<" Bytes Used "<<CQueryCache::MemoryUsed()
+			<<" Bytes Reserved "<<CQueryCache::MemoryReserved()<<" -->"<<endl;
+	}
+
 public:
 
 	CParseQuery() {
 		cout<<"Content-type: text/html\n\n";
+	}
+
+	// This initializes the state shared by every query, for the resident
+	// front end this is only done once before any query is served
+	static void Initialize() {
 		CUtility::Initialize();
 		CNameServer::Initialize();
+		CQueryLog::Initialize("query_log.txt");
+		CQueryTrace::Initialize("Query Front End");
 	}
 
 	// This is responsible for finding the search type
 	// either search, image, excerpt
 	void SearchQuery(char string[]) {
 
-		time_t t;
-		time(&t);
-		FILE *fp = fopen("query_log.txt", "a+");
-		if(fp != NULL) {
-			fprintf(fp, "%s %s\n", string, asctime(localtime(&t)));
-			fclose(fp);
-		}
+		CQueryLog::LogQuery(string);
+		CQueryTrace::BeginQuery();
+		CTraceSpan query_span(CQueryTrace::QUERY);
 
 		int src_doc_id = CUtility::ExtractParameter(string, "Source=");
+		CFrameConnection::ResetStat();
 
+		CTraceSpan lookup_span(CQueryTrace::WORD_LOOKUP);
 		m_retrieve_word_set.ParseQuery(string);
+		lookup_span.Finish();
 
 		if(CRetrieveServer::WordIDSet().Size() == 0) {
 			m_render_res.RenderSearchHeader();
@@ -63,14 +96,197 @@ public:
 		}
 
 		RenderResults();
+		RenderNetworkStat();
 	}
 
 };
+CRetrieveServer CParseQuery::m_retrieve_server;
+
+// This is the resident query front end. It initializes once and then
+// serves queries over a local socket, so a query no longer pays for 
+// process start up and initialization. Since much of the query state
+// is held statically a process can only run one query at a time, so 
+// a number of worker processes are forked that each accept from the
+// same listening socket. Each worker keeps its name server connection
+// and pool of server connections open between queries. A worker that
+// exits, for instance after a time out, is restarted.
+class CQueryFrontEnd {
+
+	// This defines the default number of worker processes
+	static const int WORKER_NUM = 8;
+	// This defines the maximum number of bytes in a query string
+	static const int MAX_QUERY_SIZE = 8192;
+
+	// This is the listening connection
+	COpenConnection m_conn;
+
+	// This serves queries on a connection until the client closes it. 
+	// A query is sent as its length followed by the query string, the
+	// reply is the length of the page followed by the rendered page.
+	// @param socket - the connection to the client
+	void ServeConnection(SOCKET socket) {
+
+		CFrameConnection conn(socket);
+		CMemoryChunk<char> query(MAX_QUERY_SIZE + 1);
+		streambuf *stdout_buff = cout.rdbuf();
+
+		try {
+			while(true) {
+				int query_len;
+				conn.Receive((char *)&query_len, sizeof(int));
+				if(query_len < 0 || query_len > MAX_QUERY_SIZE) {
+					break;
+				}
+
+				conn.Receive(query.Buffer(), query_len);
+				query[query_len] = '\0';
+
+				ostringstream page;
+				cout.rdbuf(page.rdbuf());
+				{
+					CParseQuery parse;
+					parse.SearchQuery(query.Buffer());
+				}
+				cout.flush();
+				cout.rdbuf(stdout_buff);
+
+				string page_str = page.str();
+				int page_size = page_str.size();
+				conn.Send((char *)&page_size, sizeof(int));
+				conn.Send(page_str.c_str(), page_size);
+				conn.Flush();
+				CQueryTrace::EndRequest();
+			}
+		} catch(...) {
+		}
+
+		cout.rdbuf(stdout_buff);
+		conn.CloseConnection();
+	}
+
+	// This is the main loop for a worker process
+	void ServeQueries() {
+
+		CQueryLog::StartWriter();
+		while(true) {
+			ServeConnection(m_conn.ServerAcceptConnection());
+		}
+	}
+
+public:
+
+	CQueryFrontEnd() {
+	}
+
+	// This starts the front end and publishes its port 
+	// @param worker_num - the number of worker processes
+	void Run(int worker_num = WORKER_NUM) {
+
+		if(worker_num <= 0) {
+			throw EIllegalArgumentException("Invalid Worker Number");
+		}
+
+		CUtility::RandomizeSeed();
+		u_short listen_port = (rand() % 40000) + 10000;
+		while(m_conn.OpenServerConnection(listen_port, LOCAL_NETWORK) == false) {
+			listen_port = (rand() % 40000) + 10000;
+		}
+
+		m_conn.ListenOnServerConnection(INFINITE);
+		CParseQuery::Initialize();
+		// the cache must exist before the fork to be shared by the workers
+		CQueryCache::Initialize();
+
+		for(int i=0; i<worker_num; i++) {
+			if(fork() != 0) {
+				continue;
+			}
+
+			int pid;
+			while(true) {
+				if((pid = fork()) != 0) {
+					waitpid(pid, NULL, 0);
+				} else {
+					ServeQueries();
+				}
+			}
+		}
+
+		CHDFSFile port_file;
+		port_file.OpenWriteFile("GlobalData/PortInfo/query");
+		port_file.WriteObject(listen_port);
+		port_file.CloseFile();
+
+		cout<<"Query Front End Listening For Connections"<<endl;
+		while(true) {
+			waitpid(-1, NULL, 0);
+		}
+	}
+
+	// This hands a query from the CGI process to the front end and writes
+	// out the rendered page. 
+	// @param query - the query string
+	// @return true if the page was rendered, false if the front end 
+	//         - isn't running or failed before the page was received
+	static bool ForwardQuery(const char query[]) {
+
+		if(CMappedFile::AskFileExists("GlobalData/PortInfo/query") == false) {
+			return false;
+		}
+
+		u_short port;
+		CHDFSFile port_file;
+		port_file.OpenReadFile("GlobalData/PortInfo/query");
+		port_file.ReadObject(port);
+		port_file.CloseFile();
+
+		CFrameConnection conn;
+		if(conn.OpenClientConnection(port, LOCAL_NETWORK) == false) {
+			return false;
+		}
+
+		int query_len = strlen(query);
+		if(query_len > MAX_QUERY_SIZE) {
+			query_len = MAX_QUERY_SIZE;
+		}
+
+		CMemoryChunk<char> page;
+		try {
+			int page_size;
+			conn.Send((char *)&query_len, sizeof(int));
+			conn.Send(query, query_len);
+			conn.Receive((char *)&page_size, sizeof(int));
+			page.AllocateMemory(page_size + 1);
+			conn.Receive(page.Buffer(), page_size);
+			page[page_size] = '\0';
+		} catch(...) {
+			conn.CloseConnection();
+			return false;
+		}
+
+		conn.CloseConnection();
+		cout.write(page.Buffer(), page.OverflowSize() - 1);
+		cout.flush();
+		return true;
+	}
+};
+const int CQueryFrontEnd::WORKER_NUM;
+const int CQueryFrontEnd::MAX_QUERY_SIZE;
 
 int main(int argc, char *argv[])
 {
 	char *data = NULL;
 
+	if(argc >= 2 && strcmp(argv[1], "FrontEnd") == 0) {
+		CQueryFrontEnd front_end;
+		if(argc >= 3) {
+			front_end.Run(atoi(argv[2]));
+		} else {
+			front_end.Run();
+		}
+		return 0;
+	}
+
 	if(argc > 1) {
 		data = argv[1];
 		CBeacon::InitializeBeacon(atoi(argv[2]), 2222);
@@ -86,6 +302,12 @@ int main(int argc, char *argv[])
 
 	if(data == NULL)return 0;
 
+	// the query is only run in this process if the front end isn't running
+	if(argc == 1 && CQueryFrontEnd::ForwardQuery(data) == true) {
+		return 0;
+	}
+
+	CParseQuery::Initialize();
 	CParseQuery parse;
 
 	//try {
@@ -93,6 +315,9 @@ int main(int argc, char *argv[])
 	//} catch(...) {
 	//}
 
+	CQueryLog::Flush();
+	CQueryTrace::Flush();
+
 	if(argc > 1) {
 		CBeacon::SendTerminationSignal();
 	}
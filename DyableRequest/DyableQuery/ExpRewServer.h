@@ -23,8 +23,8 @@ class CExpRewServer {
 		CExpRewServer *this_ptr;
 		// This stores the local id of the term
 		int id;
-		// This stores the client socket
-		SOCKET sock;
+		// This stores the client connection
+		CFrameConnection conn;
 		// This stores the handle for the thread
 		HANDLE handle;
 	};
@@ -167,9 +167,9 @@ class CExpRewServer {
 	}
 
 	// This initializes a client ready to process
-	void InitializeClient(SOCKET &sock, int id) {
+	void InitializeClient(CFrameConnection &conn, int id) {
 
-		CNameServer::ExpectedRewardServerInst(sock);
+		CNameServer::ExpectedRewardServerInst(conn);
 
 		m_mutex.Acquire();
 		int node_num = m_subset_buff.Size();
@@ -178,20 +178,21 @@ class CExpRewServer {
 		m_mutex.Release();
 
 		static char request[20] = "Query";
-		COpenConnection::Send(sock, request, 20);
-		COpenConnection::Send(sock, (char *)&node_num, sizeof(int));
-		COpenConnection::Send(sock, (char *)&server_num, sizeof(int));
-		COpenConnection::Send(sock, (char *)&id, sizeof(int));
+		conn.Send(request, 20);
+		CQueryTrace::SendQueryID(conn);
+		conn.Send((char *)&node_num, sizeof(int));
+		conn.Send((char *)&server_num, sizeof(int));
+		conn.Send((char *)&id, sizeof(int));
 
 
-		COpenConnection::Send(sock, (char *)&assoc_num, sizeof(int));
+		conn.Send((char *)&assoc_num, sizeof(int));
 		for(int i=0; i<m_assoc_buff.Size(); i++) {
 			m_mutex.Acquire();
 			SAssoc *ptr = m_assoc_buff[i].ptr;
 			m_mutex.Release();
 
-			COpenConnection::Send(sock, (char *)&ptr->id, sizeof(S5Byte));
-			COpenConnection::Send(sock, (char *)&ptr->weight, sizeof(float));
+			conn.Send((char *)&ptr->id, sizeof(S5Byte));
+			conn.Send((char *)&ptr->weight, sizeof(float));
 		}
 
 		for(int i=0; i<m_subset_buff.Size(); i++) {
@@ -200,37 +201,37 @@ class CExpRewServer {
 			SQueryRes *ptr = m_subset_buff[i].ptr;
 			m_mutex.Release();
 
-			COpenConnection::Send(sock, (char *)&ptr->node_id, sizeof(S5Byte));
-			COpenConnection::Send(sock, (char *)&ptr->rank, sizeof(float));
-			COpenConnection::Send(sock, (char *)&ptr->title_div_num, sizeof(uChar));
-			COpenConnection::Send(sock, (char *)&ptr->hit_score, sizeof(uChar));
+			conn.Send((char *)&ptr->node_id, sizeof(S5Byte));
+			conn.Send((char *)&ptr->rank, sizeof(float));
+			conn.Send((char *)&ptr->title_div_num, sizeof(uChar));
+			conn.Send((char *)&ptr->hit_score, sizeof(uChar));
 		}
 	}
 
 	// This issues a request to the ExpRew Server.
-	void IssueRequest(SOCKET &sock, int id) {
+	void IssueRequest(CFrameConnection &conn, int id) {
 
 		int doc_size;
-		InitializeClient(sock, id);
-		COpenConnection::Receive(sock, (char *)&doc_size, sizeof(int));
+		InitializeClient(conn, id);
+		conn.Receive((char *)&doc_size, sizeof(int));
 
 		for(int i=0; i<doc_size; i++) {
 			m_mutex.Acquire();
-			CKeywordSet::AssignAnchorNodeKeywords(sock);
+			CKeywordSet::AssignAnchorNodeKeywords(conn);
 			m_mutex.Release();
 		}
 
 		m_mutex.Acquire();
-		CKeywordSet::AssignSpatialKeywords(sock);
+		CKeywordSet::AssignSpatialKeywords(conn);
 		m_mutex.Release();
 
-		COpenConnection::CloseConnection(sock);
+		CNameServer::ReleaseExpectedRewardServer(conn);
 	}
 
 	// This spawns a connnection to a text string server
 	static THREAD_RETURN1 THREAD_RETURN2 ExpRewServerThread(void *ptr) {
 		SInstConn *call = (SInstConn *)ptr;
-		call->this_ptr->IssueRequest(call->sock, call->id);
+		call->this_ptr->IssueRequest(call->conn, call->id);
 		return 0;
 	}
 
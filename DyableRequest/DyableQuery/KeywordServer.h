@@ -13,8 +13,8 @@ class CKeywordServer {
 		CKeywordServer *this_ptr;
 		// This stores the local id of the term
 		int id;
-		// This stores the client socket
-		SOCKET sock;
+		// This stores the client connection
+		CFrameConnection conn;
 		// This stores the handle for the thread
 		HANDLE handle;
 	};
@@ -49,9 +49,9 @@ class CKeywordServer {
 	}
 
 	// This issues a request to the Keyword Server.
-	void IssueRequest(SOCKET &sock, int id) {
+	void IssueRequest(CFrameConnection &conn, int id) {
 
-		CNameServer::KeywordServerInst(sock);
+		CNameServer::KeywordServerInst(conn);
 
 		m_mutex.Acquire();
 
@@ -59,18 +59,18 @@ class CKeywordServer {
 		CHashFunction::BoundaryPartion(id, SERVER_NUM, bound.end, bound.start);
 
 		int width = bound.Width();
-		COpenConnection::Send(sock, (char *)&width, sizeof(int));
+		conn.Send((char *)&width, sizeof(int));
 
 		for(int i=bound.start; i<bound.end; i++) {
-			COpenConnection::Send(sock, (char *)&m_res_buff[i].ptr->node_id, sizeof(S5Byte));
+			conn.Send((char *)&m_res_buff[i].ptr->node_id, sizeof(S5Byte));
 		}
 
 		int num = m_keyword_buff.Size();
-		COpenConnection::Send(sock, (char *)&num, sizeof(int));
+		conn.Send((char *)&num, sizeof(int));
 		for(int i=0; i<m_keyword_buff.Size(); i++) {
 			uChar occur = m_keyword_buff[i].occur;
-			COpenConnection::Send(sock, (char *)&m_keyword_buff[i].keyword_id, sizeof(S5Byte));
-			COpenConnection::Send(sock, (char *)&occur, sizeof(uChar));
+			conn.Send((char *)&m_keyword_buff[i].keyword_id, sizeof(S5Byte));
+			conn.Send((char *)&occur, sizeof(uChar));
 		}
 
 		m_mutex.Release();
@@ -78,20 +78,22 @@ class CKeywordServer {
 		for(int i=bound.start; i<bound.end; i++) {
 
 			SQueryRes &res = *m_res_buff[i].ptr;
-			COpenConnection::Receive(sock, (char *)&res.node_id, sizeof(S5Byte));
+			conn.Receive((char *)&res.node_id, sizeof(S5Byte));
 
 			m_mutex.Acquire();
-			res.keyword_check_sum = CKeywordSet::AssignKeywordSet(sock, res.node_id);
+			res.keyword_check_sum = CKeywordSet::AssignKeywordSet(conn, res.node_id);
 			res.local_doc_id = m_doc_id++;
 			res.is_red = false;
 			m_mutex.Release();
 		}
+
+		CNameServer::ReleaseKeywordServer(conn);
 	}
 
 	// This spawns a connnection to a text string server
 	static THREAD_RETURN1 THREAD_RETURN2 KeywordServerThread(void *ptr) {
 		SInstConn *call = (SInstConn *)ptr;
-		call->this_ptr->IssueRequest(call->sock, call->id);
+		call->this_ptr->IssueRequest(call->conn, call->id);
 		return 0;
 	}
 
@@ -102,6 +104,12 @@ public:
 		m_doc_id = 0;
 	}
 
+	// This removes the keywords left from the previous query
+	inline void Reset() {
+		m_keyword_buff.Resize(0);
+		m_doc_id = 0;
+	}
+
 	// This adds a high ranking keyword to the set
 	inline void AddKeyword(SKeyword &keyword) {
 		m_keyword_buff.PushBack(keyword);
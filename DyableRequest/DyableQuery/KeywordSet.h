@@ -40,7 +40,7 @@ class CKeywordSet {
 	// This stores the number of keywords in each excerpt
 	static CArrayList<int> m_keyword_offset;
 	// This is used to resolve excerpt keywords
-	static COpenConnection m_conn;
+	static CFrameConnection m_conn;
 	// This stores the global set of keywords
 	static CArrayList<SKeyword> m_global_keywords;
 	// This stores the keyword map
@@ -131,7 +131,7 @@ class CKeywordSet {
 	}
 
 	// This compiles the global list of keywords
-	static void CompileGlobalKeywordList(COpenConnection &conn, int list_size) {
+	static void CompileGlobalKeywordList(CFrameConnection &conn, int list_size) {
 
 		uChar word_length;
 		cout<<"<table border=0>";
@@ -164,7 +164,7 @@ class CKeywordSet {
 		}
 
 		cout<<"</table>";
-		conn.CloseConnection();
+		CNameServer::ReleaseTextStringServer(conn);
 	}
 
 public:
@@ -181,6 +181,7 @@ public:
 		m_keyword_map.Initialize();
 		m_keyword_offset.PushBack(0);
 		m_max_word_occur = 0;
+		m_cluster_term_str.Reset();
 	}
 
 	// This returns the number of keywords
@@ -233,7 +234,7 @@ public:
 	}
 
 	// This adds the keywords set for each document from the keyword server
-	static uLong AssignKeywordSet(SOCKET &sock, S5Byte &node) {
+	static uLong AssignKeywordSet(CFrameConnection &conn, S5Byte &node) {
 
 		static uChar occur;
 		static uChar keyword_num;
@@ -243,10 +244,10 @@ public:
 		keyword.is_valid = false;
 		uLong check_sum = 0;
 
-		COpenConnection::Receive(sock, (char *)&keyword_num, sizeof(uChar));
+		conn.Receive((char *)&keyword_num, sizeof(uChar));
 
 		for(int i=0; i<keyword_num; i++) {
-			COpenConnection::Receive(sock, (char *)&key_id.keyword_id, sizeof(S5Byte));
+			conn.Receive((char *)&key_id.keyword_id, sizeof(S5Byte));
 
 			check_sum += key_id.keyword_id.Value();
 
@@ -266,7 +267,7 @@ public:
 	}
 
 	// This adds the keyword set that appears spatially
-	static void AssignSpatialKeywords(SOCKET &sock) {
+	static void AssignSpatialKeywords(CFrameConnection &conn) {
 		
 		static uChar occur;
 		static uChar keyword_num;
@@ -274,11 +275,11 @@ public:
 		keyword.occur = 0;
 		keyword.is_valid = false;
 
-		COpenConnection::Receive(sock, (char *)&keyword_num, sizeof(uChar));
+		conn.Receive((char *)&keyword_num, sizeof(uChar));
 
 		for(uChar i=0; i<keyword_num; i++) {
-			COpenConnection::Receive(sock, (char *)&keyword.keyword_id, sizeof(S5Byte));
-			COpenConnection::Receive(sock, (char *)&occur, sizeof(uChar));
+			conn.Receive((char *)&keyword.keyword_id, sizeof(S5Byte));
+			conn.Receive((char *)&occur, sizeof(uChar));
 
 			int id = m_keyword_map.AddWord((char *)&keyword.keyword_id, sizeof(S5Byte));
 
@@ -297,7 +298,7 @@ public:
 	}
 
 	// This adds the keyword set for anchor nodes to the global set of keywords
-	static void AssignAnchorNodeKeywords(SOCKET &sock) {
+	static void AssignAnchorNodeKeywords(CFrameConnection &conn) {
 		
 		static uChar keyword_num;
 		static SKeyword keyword;
@@ -305,10 +306,10 @@ public:
 		keyword.occur = 0;
 		keyword.is_valid = false;
 
-		COpenConnection::Receive(sock, (char *)&keyword_num, sizeof(uChar));
+		conn.Receive((char *)&keyword_num, sizeof(uChar));
 
 		for(uChar i=0; i<keyword_num; i++) {
-			COpenConnection::Receive(sock, (char *)&key_id.keyword_id, sizeof(S5Byte));
+			conn.Receive((char *)&key_id.keyword_id, sizeof(S5Byte));
 
 			key_id.local_id = m_keyword_map.AddWord((char *)&key_id.keyword_id, sizeof(S5Byte));
 			m_keyword_set.PushBack(key_id);
@@ -342,6 +343,7 @@ public:
 		static char request[20] = "WordIDRequest";
 
 		m_conn.Send(request, 20);
+		CQueryTrace::SendQueryID(m_conn);
 		m_conn.Send((char *)&match_num, sizeof(int));
 	}
 
@@ -613,7 +615,7 @@ public:
 	// This renders the keyword set with the histogram
 	static void RenderKeywordHistogram() {
 
-		COpenConnection conn;
+		CFrameConnection conn;
 		CNameServer::TextStringServerInst(conn);
 	
 		int match_num = min(65, m_sorted_keyword_set.Size());
@@ -624,6 +626,7 @@ public:
 		static char request[20] = "WordIDRequest";
 
 		conn.Send(request, 20);
+		CQueryTrace::SendQueryID(conn);
 		conn.Send((char *)&match_num, sizeof(int));
 
 		CompileGlobalKeywordList(conn, match_num);
@@ -636,5 +639,5 @@ CLimitedPQ<SKeyword> CKeywordSet::m_keyword_queue;
 CArrayList<CKeywordSet::SKeywordID> CKeywordSet::m_keyword_set;
 CArrayList<int> CKeywordSet::m_keyword_offset;
 CArrayList<SKeyword> CKeywordSet::m_global_keywords;
-COpenConnection CKeywordSet::m_conn;
+CFrameConnection CKeywordSet::m_conn;
 CString CKeywordSet::m_cluster_term_str;
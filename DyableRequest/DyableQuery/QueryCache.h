@@ -0,0 +1,553 @@
+#include "./CompileRankedList.h"
+
+#ifndef OS_WINDOWS
+
+// This class is responsible for caching the set of documents returned by
+// the retrieve servers for a query so a repeated query doesn't have to be
+// searched again. An entry is keyed on the query's word ids, local ids and
+// factors sorted by word id, so queries that parse to the same word id set
+// share an entry regardless of how they were typed. Entries are evicted
+// using a LRU scheme once the cache is full and expire after a fixed time
+// so changes to the index are picked up. The cache is placed in shared
+// memory before the front end forks its workers so every worker process
+// shares the same entries, access is protected by a process shared mutex.
+class CQueryCache {
+
+	// This defines the maximum number of entries in the cache
+	static const int MAX_ENTRY_NUM = 4096;
+	// This defines the breadth of the hash map
+	static const int HASH_BREADTH = 8191;
+	// This defines the number of documents in a document block
+	static const int DOC_BLOCK_SIZE = 64;
+	// This defines the number of document blocks in the cache
+	static const int MAX_BLOCK_NUM = 8192;
+	// This defines the maximum number of blocks a single entry can use
+	static const int MAX_ENTRY_BLOCK_NUM = MAX_BLOCK_NUM >> 3;
+	// This defines the maximum number of query terms in a cached query
+	static const int MAX_KEY_TERM_NUM = 16;
+	// This defines the number of bytes in the key for each query term
+	static const int KEY_TERM_SIZE = sizeof(S5Byte) + sizeof(uChar) + sizeof(float);
+	// This defines the number of seconds before an entry expires
+	static const int CACHE_TTL = 600;
+
+	// This stores a block of documents belonging to an entry
+	struct SDocBlock {
+		// This stores the next block in the entry
+		int next_block;
+		// This stores the documents
+		SQueryRes doc[DOC_BLOCK_SIZE];
+	};
+
+	// This stores one of the entries in the cache
+	struct SCacheEntry {
+		// This stores the next entry in the hash chain or free list
+		int next_hash;
+		// This stores the previous entry in the LRU list
+		int prev_cache;
+		// This stores the next entry in the LRU list
+		int next_cache;
+		// This stores the first document block
+		int block_ptr;
+		// This stores the hash division of the entry
+		int hash_id;
+		// This stores the number of bytes in the key
+		int key_size;
+		// This stores the key
+		char key[MAX_KEY_TERM_NUM * KEY_TERM_SIZE];
+		// This stores the maximum number of terms found in a document
+		int max_word_div_num;
+		// This stores the number of documents
+		int doc_num;
+		// This stores the number of document blocks
+		int block_num;
+		// This stores the time the entry was added
+		time_t create_time;
+	};
+
+	// This stores the cache, it's placed in shared memory
+	struct SCache {
+		// This protects the cache
+		pthread_mutex_t mutex;
+		// This stores the first entry in each hash division
+		int hash_map[HASH_BREADTH];
+		// This stores the most recently used entry
+		int head_cache;
+		// This stores the least recently used entry
+		int tail_cache;
+		// This stores the list of free entries
+		int free_entry;
+		// This stores the list of free document blocks
+		int free_block;
+		// This stores the number of entries that have been used at some point
+		int entry_used;
+		// This stores the number of blocks that have been used at some point
+		int block_used;
+		// This stores the number of entries in the cache
+		int entry_num;
+		// This stores the number of document blocks in use
+		int block_num;
+		// This stores the number of lookups
+		_int64 lookup_num;
+		// This stores the number of lookups that found an entry
+		_int64 hit_num;
+		// This stores the number of entries that expired
+		_int64 expire_num;
+		// This stores the number of entries evicted to make room
+		_int64 evict_num;
+		// This stores the entries
+		SCacheEntry entry[MAX_ENTRY_NUM];
+		// This stores the document blocks
+		SDocBlock block[MAX_BLOCK_NUM];
+	};
+
+	// This stores the cache, NULL if the cache isn't used
+	static SCache *m_cache;
+
+	// This is used to sort the query terms by word id
+	static int CompareKeyTerm(const SWordItem &arg1, const SWordItem &arg2) {
+
+		_int64 word_id1 = S5Byte::Value(arg1.word_id);
+		_int64 word_id2 = S5Byte::Value(arg2.word_id);
+
+		if(word_id1 < word_id2) {
+			return 1;
+		}
+
+		if(word_id1 > word_id2) {
+			return -1;
+		}
+
+		if(arg1.local_id < arg2.local_id) {
+			return 1;
+		}
+
+		if(arg1.local_id > arg2.local_id) {
+			return -1;
+		}
+
+		if(arg1.factor < arg2.factor) {
+			return 1;
+		}
+
+		if(arg1.factor > arg2.factor) {
+			return -1;
+		}
+
+		return 0;
+	}
+
+	// This creates the key for a query
+	// @param word_set - the set of query terms
+	// @param key - this stores the key
+	// @param key_size - this stores the number of bytes in the key
+	// @return false if the query has too many terms to be cached
+	static bool CreateKey(CArrayList<SWordItem> &word_set, char key[], int &key_size) {
+
+		if(word_set.Size() == 0 || word_set.Size() > MAX_KEY_TERM_NUM) {
+			return false;
+		}
+
+		CMemoryChunk<SWordItem> term(word_set.Size());
+		memcpy(term.Buffer(), word_set.Buffer(), word_set.Size() * sizeof(SWordItem));
+
+		CSort<SWordItem> sort(term.OverflowSize(), CompareKeyTerm);
+		sort.HybridSort(term.Buffer());
+
+		key_size = 0;
+		for(int i=0; i<term.OverflowSize(); i++) {
+			memcpy(key + key_size, (char *)&term[i].word_id, sizeof(S5Byte));
+			key_size += sizeof(S5Byte);
+			memcpy(key + key_size, (char *)&term[i].local_id, sizeof(uChar));
+			key_size += sizeof(uChar);
+			memcpy(key + key_size, (char *)&term[i].factor, sizeof(float));
+			key_size += sizeof(float);
+		}
+
+		return true;
+	}
+
+	// This locks the cache. If a worker died while holding the lock the
+	// cache may have been left half updated so it's emptied.
+	static void Lock() {
+
+		int ret = pthread_mutex_lock(&m_cache->mutex);
+		if(ret == EOWNERDEAD) {
+			pthread_mutex_consistent(&m_cache->mutex);
+			Clear();
+		}
+	}
+
+	// This unlocks the cache
+	static inline void Unlock() {
+		pthread_mutex_unlock(&m_cache->mutex);
+	}
+
+	// This empties the cache, the counters are kept
+	static void Clear() {
+
+		for(int i=0; i<HASH_BREADTH; i++) {
+			m_cache->hash_map[i] = -1;
+		}
+
+		m_cache->head_cache = -1;
+		m_cache->tail_cache = -1;
+		m_cache->free_entry = -1;
+		m_cache->free_block = -1;
+		m_cache->entry_used = 0;
+		m_cache->block_used = 0;
+		m_cache->entry_num = 0;
+		m_cache->block_num = 0;
+	}
+
+	// This returns a free entry or -1 if there are none
+	static int FreeEntry() {
+
+		int id = m_cache->free_entry;
+		if(id >= 0) {
+			m_cache->free_entry = m_cache->entry[id].next_hash;
+			return id;
+		}
+
+		if(m_cache->entry_used < MAX_ENTRY_NUM) {
+			return m_cache->entry_used++;
+		}
+
+		return -1;
+	}
+
+	// This returns a free document block or -1 if there are none
+	static int FreeBlock() {
+
+		int id = m_cache->free_block;
+		if(id >= 0) {
+			m_cache->free_block = m_cache->block[id].next_block;
+			return id;
+		}
+
+		if(m_cache->block_used < MAX_BLOCK_NUM) {
+			return m_cache->block_used++;
+		}
+
+		return -1;
+	}
+
+	// This returns the number of blocks that can still be taken
+	static inline int AvailableBlockNum() {
+		return MAX_BLOCK_NUM - m_cache->block_num;
+	}
+
+	// This takes an entry out of the LRU list
+	static void UnlinkCacheEntry(int id) {
+
+		SCacheEntry &entry = m_cache->entry[id];
+		if(entry.prev_cache >= 0) {
+			m_cache->entry[entry.prev_cache].next_cache = entry.next_cache;
+		} else {
+			m_cache->head_cache = entry.next_cache;
+		}
+
+		if(entry.next_cache >= 0) {
+			m_cache->entry[entry.next_cache].prev_cache = entry.prev_cache;
+		} else {
+			m_cache->tail_cache = entry.prev_cache;
+		}
+	}
+
+	// This places an entry at the head of the LRU list
+	static void LinkCacheEntry(int id) {
+
+		SCacheEntry &entry = m_cache->entry[id];
+		entry.prev_cache = -1;
+		entry.next_cache = m_cache->head_cache;
+
+		if(m_cache->head_cache >= 0) {
+			m_cache->entry[m_cache->head_cache].prev_cache = id;
+		} else {
+			m_cache->tail_cache = id;
+		}
+
+		m_cache->head_cache = id;
+	}
+
+	// This removes an entry from the cache and frees its document blocks
+	static void RemoveEntry(int id) {
+
+		SCacheEntry &entry = m_cache->entry[id];
+
+		int *curr_ptr = &m_cache->hash_map[entry.hash_id];
+		while(*curr_ptr != id) {
+			curr_ptr = &m_cache->entry[*curr_ptr].next_hash;
+		}
+		*curr_ptr = entry.next_hash;
+
+		UnlinkCacheEntry(id);
+
+		int block_id = entry.block_ptr;
+		while(block_id >= 0) {
+			int next_block = m_cache->block[block_id].next_block;
+			m_cache->block[block_id].next_block = m_cache->free_block;
+			m_cache->free_block = block_id;
+			block_id = next_block;
+		}
+
+		m_cache->block_num -= entry.block_num;
+		m_cache->entry_num--;
+		entry.next_hash = m_cache->free_entry;
+		m_cache->free_entry = id;
+	}
+
+	// This searches for the entry with a given key
+	// @return the entry or -1 if it's not in the cache
+	static int FindEntry(int hash_id, const char key[], int key_size) {
+
+		int id = m_cache->hash_map[hash_id];
+		while(id >= 0) {
+			SCacheEntry &entry = m_cache->entry[id];
+			if(entry.key_size == key_size && memcmp(entry.key, key, key_size) == 0) {
+				return id;
+			}
+
+			id = entry.next_hash;
+		}
+
+		return -1;
+	}
+
+public:
+
+	CQueryCache() {
+	}
+
+	// This creates the cache in shared memory, this must be called before
+	// the worker processes are forked. The cache isn't used unless this
+	// has been called.
+	static void Initialize() {
+
+		void *ptr = mmap(NULL, sizeof(SCache), PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+		if(ptr == MAP_FAILED) {
+			throw EException("Could Not Map Query Cache");
+		}
+
+		m_cache = (SCache *)ptr;
+
+		pthread_mutexattr_t attr;
+		pthread_mutexattr_init(&attr);
+		pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+		pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+		pthread_mutex_init(&m_cache->mutex, &attr);
+		pthread_mutexattr_destroy(&attr);
+
+		Clear();
+		m_cache->lookup_num = 0;
+		m_cache->hit_num = 0;
+		m_cache->expire_num = 0;
+		m_cache->evict_num = 0;
+	}
+
+	// This searches for the documents retrieved for a query. On a hit
+	// the documents are added to the ranked list.
+	// @param word_set - the set of query terms
+	// @param ranked_list - the ranked list the documents are added to
+	// @param max_word_div_num - this stores the maximum number of
+	//                         - query terms found in a document
+	// @return true if the query was found, false otherwise
+	static bool FindQuery(CArrayList<SWordItem> &word_set,
+		CCompileRankedList &ranked_list, int &max_word_div_num) {
+
+		int key_size;
+		char key[MAX_KEY_TERM_NUM * KEY_TERM_SIZE];
+		if(m_cache == NULL || CreateKey(word_set, key, key_size) == false) {
+			return false;
+		}
+
+		int hash_id = CHashFunction::UniversalHash(HASH_BREADTH, key, key_size);
+
+		Lock();
+		m_cache->lookup_num++;
+		int id = FindEntry(hash_id, key, key_size);
+		if(id < 0) {
+			Unlock();
+			return false;
+		}
+
+		SCacheEntry &entry = m_cache->entry[id];
+		if(time(NULL) - entry.create_time > CACHE_TTL) {
+			m_cache->expire_num++;
+			RemoveEntry(id);
+			Unlock();
+			return false;
+		}
+
+		m_cache->hit_num++;
+		UnlinkCacheEntry(id);
+		LinkCacheEntry(id);
+
+		max_word_div_num = entry.max_word_div_num;
+		int block_id = entry.block_ptr;
+		for(int i=0; i<entry.doc_num; i++) {
+			if(i > 0 && (i % DOC_BLOCK_SIZE) == 0) {
+				block_id = m_cache->block[block_id].next_block;
+			}
+
+			ranked_list.AddDocument(m_cache->block[block_id].doc[i % DOC_BLOCK_SIZE]);
+		}
+
+		Unlock();
+		return true;
+	}
+
+	// This adds the documents retrieved for a query to the cache, least
+	// recently used entries are evicted to make room. Queries that return
+	// too many documents aren't cached.
+	// @param word_set - the set of query terms
+	// @param doc_set - the set of retrieved documents
+	// @param max_word_div_num - the maximum number of query
+	//                         - terms found in a document
+	static void AddQuery(CArrayList<SWordItem> &word_set,
+		CLinkedBuffer<SQueryRes> &doc_set, int max_word_div_num) {
+
+		int key_size;
+		char key[MAX_KEY_TERM_NUM * KEY_TERM_SIZE];
+		if(m_cache == NULL || CreateKey(word_set, key, key_size) == false) {
+			return;
+		}
+
+		int block_num = (doc_set.Size() + DOC_BLOCK_SIZE - 1) / DOC_BLOCK_SIZE;
+		if(block_num > MAX_ENTRY_BLOCK_NUM) {
+			return;
+		}
+
+		int hash_id = CHashFunction::UniversalHash(HASH_BREADTH, key, key_size);
+
+		Lock();
+		int id = FindEntry(hash_id, key, key_size);
+		if(id >= 0) {
+			// another worker has just added the same query
+			RemoveEntry(id);
+		}
+
+		while(m_cache->tail_cache >= 0 && (AvailableBlockNum() < block_num ||
+			(m_cache->free_entry < 0 && m_cache->entry_used >= MAX_ENTRY_NUM))) {
+			m_cache->evict_num++;
+			RemoveEntry(m_cache->tail_cache);
+		}
+
+		id = FreeEntry();
+		SCacheEntry &entry = m_cache->entry[id];
+		entry.hash_id = hash_id;
+		entry.key_size = key_size;
+		memcpy(entry.key, key, key_size);
+		entry.max_word_div_num = max_word_div_num;
+		entry.doc_num = doc_set.Size();
+		entry.block_num = block_num;
+		entry.create_time = time(NULL);
+		entry.block_ptr = -1;
+
+		int *block_ptr = &entry.block_ptr;
+		SDocBlock *block = NULL;
+		doc_set.ResetPath();
+		for(int i=0; i<doc_set.Size(); i++) {
+			if((i % DOC_BLOCK_SIZE) == 0) {
+				*block_ptr = FreeBlock();
+				block = &m_cache->block[*block_ptr];
+				block_ptr = &block->next_block;
+				*block_ptr = -1;
+			}
+
+			block->doc[i % DOC_BLOCK_SIZE] = *doc_set.NextNode();
+		}
+
+		entry.next_hash = m_cache->hash_map[hash_id];
+		m_cache->hash_map[hash_id] = id;
+		LinkCacheEntry(id);
+
+		m_cache->entry_num++;
+		m_cache->block_num += block_num;
+		Unlock();
+	}
+
+	// This returns the number of lookups
+	static _int64 LookupNum() {
+
+		if(m_cache == NULL) {
+			return 0;
+		}
+
+		Lock();
+		_int64 lookup_num = m_cache->lookup_num;
+		Unlock();
+		return lookup_num;
+	}
+
+	// This returns the number of lookups that found an entry
+	static _int64 HitNum() {
+
+		if(m_cache == NULL) {
+			return 0;
+		}
+
+		Lock();
+		_int64 hit_num = m_cache->hit_num;
+		Unlock();
+		return hit_num;
+	}
+
+	// This returns the number of entries that were evicted or expired
+	static _int64 EvictNum() {
+
+		if(m_cache == NULL) {
+			return 0;
+		}
+
+		Lock();
+		_int64 evict_num = m_cache->evict_num + m_cache->expire_num;
+		Unlock();
+		return evict_num;
+	}
+
+	// This returns the number of entries in the cache
+	static int EntryNum() {
+
+		if(m_cache == NULL) {
+			return 0;
+		}
+
+		Lock();
+		int entry_num = m_cache->entry_num;
+		Unlock();
+		return entry_num;
+	}
+
+	// This returns the number of bytes used by the entries in the cache
+	static _int64 MemoryUsed() {
+
+		if(m_cache == NULL) {
+			return 0;
+		}
+
+		Lock();
+		_int64 byte_num = (_int64)m_cache->entry_num * sizeof(SCacheEntry) +
+			(_int64)m_cache->block_num * sizeof(SDocBlock);
+		Unlock();
+		return byte_num;
+	}
+
+	// This returns the number of bytes reserved for the cache
+	static inline _int64 MemoryReserved() {
+		return m_cache == NULL ? 0 : sizeof(SCache);
+	}
+};
+const int CQueryCache::MAX_ENTRY_NUM;
+const int CQueryCache::HASH_BREADTH;
+const int CQueryCache::DOC_BLOCK_SIZE;
+const int CQueryCache::MAX_BLOCK_NUM;
+const int CQueryCache::MAX_ENTRY_BLOCK_NUM;
+const int CQueryCache::MAX_KEY_TERM_NUM;
+const int CQueryCache::KEY_TERM_SIZE;
+const int CQueryCache::CACHE_TTL;
+
+CQueryCache::SCache *CQueryCache::m_cache = NULL;
+
+#endif
@@ -0,0 +1,131 @@
+#include "./TextStringServer.h"
+
+// This class is responsible for recording every query in the query log
+// without holding up the query. A query only appends its log line to an
+// in memory buffer. A writer thread swaps the full buffer for the empty
+// one and appends it to the log file with a single write, so the lines
+// from different front end processes are never interleaved. If the writer
+// falls behind and the buffer fills up later lines are dropped rather
+// than making queries wait on the disk.
+class CQueryLog {
+
+	// This defines the number of bytes buffered before lines are dropped
+	static const int LOG_BUFFER_SIZE = 1 << 16;
+	// This defines the number of milliseconds between writes
+	static const int FLUSH_INTERVAL = 200;
+
+	// This stores the buffer lines are added to and the buffer being written
+	static CArrayList<char> m_log_buff[2];
+	// This stores the index of the buffer lines are added to
+	static int m_curr_buff;
+	// This stores the number of lines dropped since the last write
+	static int m_drop_num;
+	// This stores the log file
+	static FILE *m_file_ptr;
+	// This protects the buffer lines are added to
+	static CMutex m_mutex;
+	// This is held while a buffer is being written
+	static CMutex m_write_mutex;
+
+	// This is the entry function for the writer thread
+	static THREAD_RETURN1 THREAD_RETURN2 WriterThread(void *ptr) {
+
+		while(true) {
+			Sleep(FLUSH_INTERVAL);
+			Flush();
+		}
+
+		return 0;
+	}
+
+public:
+
+	CQueryLog() {
+	}
+
+	// This opens the log file, lines are only written once
+	// either the writer thread is started or it's flushed
+	// @param file - the name of the log file
+	static void Initialize(const char file[]) {
+
+		m_log_buff[0].Initialize(LOG_BUFFER_SIZE);
+		m_log_buff[1].Initialize(LOG_BUFFER_SIZE);
+		m_curr_buff = 0;
+		m_drop_num = 0;
+
+		m_file_ptr = fopen(file, "a");
+		if(m_file_ptr != NULL) {
+			setvbuf(m_file_ptr, NULL, _IONBF, 0);
+		}
+	}
+
+	// This starts the writer thread, this must be called by the
+	// process that is logging since threads don't survive a fork
+	static void StartWriter() {
+
+		unsigned int threadID;
+		_beginthreadex(NULL, 0, WriterThread, NULL, NULL, &threadID);
+	}
+
+	// This adds a query to the log
+	// @param query - the query string
+	static void LogQuery(const char query[]) {
+
+		time_t t;
+		time(&t);
+		char time_str[32];
+		asctime_r(localtime(&t), time_str);
+
+		int query_len = strlen(query);
+		int time_len = strlen(time_str);
+
+		m_mutex.Acquire();
+		CArrayList<char> &buff = m_log_buff[m_curr_buff];
+		if(buff.Size() + query_len + time_len + 2 > LOG_BUFFER_SIZE) {
+			m_drop_num++;
+			m_mutex.Release();
+			return;
+		}
+
+		buff.CopyBufferToArrayList(query, query_len, buff.Size());
+		buff.PushBack(' ');
+		buff.CopyBufferToArrayList(time_str, time_len, buff.Size());
+		buff.PushBack('\n');
+		m_mutex.Release();
+	}
+
+	// This writes every line that has been added to the log
+	static void Flush() {
+
+		if(m_file_ptr == NULL) {
+			return;
+		}
+
+		m_write_mutex.Acquire();
+		m_mutex.Acquire();
+		CArrayList<char> &buff = m_log_buff[m_curr_buff];
+		int drop_num = m_drop_num;
+		m_curr_buff ^= 0x01;
+		m_drop_num = 0;
+		m_mutex.Release();
+
+		if(buff.Size() > 0) {
+			fwrite(buff.Buffer(), sizeof(char), buff.Size(), m_file_ptr);
+			buff.Resize(0);
+		}
+
+		if(drop_num > 0) {
+			fprintf(m_file_ptr, "Dropped %d Queries\n", drop_num);
+		}
+		m_write_mutex.Release();
+	}
+};
+const int CQueryLog::LOG_BUFFER_SIZE;
+const int CQueryLog::FLUSH_INTERVAL;
+
+CArrayList<char> CQueryLog::m_log_buff[2];
+int CQueryLog::m_curr_buff;
+int CQueryLog::m_drop_num;
+FILE *CQueryLog::m_file_ptr = NULL;
+CMutex CQueryLog::m_mutex;
+CMutex CQueryLog::m_write_mutex;
@@ -235,6 +235,12 @@ public:
 
 	CRender() {
 		m_duplicate_term.Initialize(20);
+		m_query_text.Reset();
+		m_add_query_text.Reset();
+		m_original_text.Reset();
+		m_dym_phrase.Reset();
+		m_dym_url.Reset();
+		m_user_info.Reset();
 	}
 
 	// This adds the query terms to the set of highlighted terms
@@ -413,6 +419,7 @@ public:
 
 		cout<<"<script type=\"text/javascript\">";
 		cout<<"var domain_name=\""<<DOMAIN_NAME<<"\";";
+		cout<<"var query_id=\""<<CQueryTrace::QueryID()<<"\";";
 
 		cout<<"var global_keyword_set=new Array(";
 		CKeywordSet::RenderGlobalKeywordList(1024);
@@ -1,8 +1,13 @@
-#include "./CompileRankedList.h"
+#include "./QueryCache.h"
 
 // This class is responsible for contacting a number of the retrieve servers 
 // in parllel in order to process a given request made by the user. The
 // retrieve servers can only be contacted once the word id set is known.
+// Documents are added to the ranked list as soon as they're received from
+// any server. The query is given a fixed time to retrieve documents, any
+// server that hasn't finished by then is abandoned and the query carries
+// on with the documents received so far. The thread of an abandoned 
+// server is not waited on, it's joined at the start of the next query.
 class CRetrieveServer : public CNodeStat {
 
 	// This stores the maximum number of retrieve servers allowed per query
@@ -13,6 +18,8 @@ class CRetrieveServer : public CNodeStat {
 	static const int MAX_SEARCH_PASS_NUM = 1;
 	// This defines the number of retrieve servers
 	static const int RETRIEVE_SERVER_NUM = 5;
+	// This defines the number of milliseconds allowed to retrieve documents
+	static const int RETRIEVE_DEADLINE = 1200;
 
 	// This stores one of the parallel connections to the retrieve server
 	struct SRetrieveConn {
@@ -21,10 +28,16 @@ class CRetrieveServer : public CNodeStat {
 		// This stores the retrieve id
 		int id;
 		// This stores the handle for the thread
-		HANDLE handle;
-		// This stores the socket of the child server
+		pthread_t handle;
+		// This is true once the thread has been started
+		bool is_start;
+		// This is true once the server has finished or failed
+		bool is_done;
+		// This is true once the thread has been joined
+		bool is_joined;
+		// This stores the connection to the child server
 		// if it is not the parent
-		SOCKET child_sock;
+		CFrameConnection child_conn;
 	};
 
 	// This stores the set of word ids
@@ -35,6 +48,20 @@ class CRetrieveServer : public CNodeStat {
 	static CCompileRankedList m_ranked_list;
 	// This protects access to the result queue
 	CMutex m_mutex;
+	// This is signalled every time a server finishes
+	CSemaphore m_done_sem;
+	// This is true once the deadline has passed
+	bool m_is_expired;
+	// This stores the number of servers that have finished
+	int m_done_num;
+	// This stores the number of servers abandoned at the deadline
+	int m_expired_num;
+	// This stores the number of servers that failed
+	int m_fail_num;
+	// This is true if the documents were found in the query cache
+	bool m_is_cache_hit;
+	// This is started when the servers are first contacted
+	CStopWatch m_deadline_timer;
 
 	// This stores the maximum number of terms found 
 	// belonging to a particular document
@@ -43,35 +70,35 @@ class CRetrieveServer : public CNodeStat {
 	int m_query_term_num;
 
 	// This sends the query terms to the server
-	void SendQueryTerms(SOCKET &socket) {
+	void SendQueryTerms(CFrameConnection &conn) {
 
 
 		int query_term_num = CRetrieveServer::WordIDSet().Size();
-		COpenConnection::Send(socket, (char *)&query_term_num, 4);
+		conn.Send((char *)&query_term_num, 4);
 
 		for(int j=0; j<CRetrieveServer::WordIDSet().Size(); j++) {
 			SWordItem &word = CRetrieveServer::WordIDSet()[j];
-			COpenConnection::Send(socket, (char *)&word.word_id, sizeof(S5Byte));
-			COpenConnection::Send(socket, (char *)&word.factor, sizeof(float));
-			COpenConnection::Send(socket, (char *)&word.local_id, sizeof(uChar));
+			conn.Send((char *)&word.word_id, sizeof(S5Byte));
+			conn.Send((char *)&word.factor, sizeof(float));
+			conn.Send((char *)&word.local_id, sizeof(uChar));
 		}
 	}
 
 	// This is called to subdivide a retrieve server to increase the level
 	// of parallelism in the search strategy.
-	void ServerInst(SOCKET &socket, int client_id) {
+	void ServerInst(CFrameConnection &conn, int client_id) {
 
 		char is_divide;
 		int max_word_div_num;
 		int search_pass_num = 0;
 		int active_serv_num = 0;
 
-		COpenConnection::Send(socket, (char *)&MAX_SEARCH_IT, sizeof(int));
+		conn.Send((char *)&MAX_SEARCH_IT, sizeof(int));
 		
 		while(true) {
-			COpenConnection::Receive(socket, (char *)&max_word_div_num, sizeof(int));
+			conn.Receive((char *)&max_word_div_num, sizeof(int));
 			if(max_word_div_num < 0) {
-				COpenConnection::Receive(socket, (char *)&max_word_div_num, sizeof(int));
+				conn.Receive((char *)&max_word_div_num, sizeof(int));
 				m_mutex.Acquire();
 				m_max_word_div_num = max(m_max_word_div_num, max_word_div_num);
 				m_mutex.Release();
@@ -84,26 +111,70 @@ class CRetrieveServer : public CNodeStat {
 			
 			if(++search_pass_num >= MAX_SEARCH_PASS_NUM) {
 				max_word_div_num = -1;
-				COpenConnection::Send(socket, (char *)&max_word_div_num, sizeof(int));
+				conn.Send((char *)&max_word_div_num, sizeof(int));
 				break;
 			}
 
 			m_mutex.Acquire();
-			COpenConnection::Send(socket, (char *)&m_max_word_div_num, sizeof(int));
+			conn.Send((char *)&m_max_word_div_num, sizeof(int));
 			m_mutex.Release();
 
 			is_divide = (active_serv_num < MAX_SERVER_NUM) ? 'd' : 'f';
-			COpenConnection::Send(socket, &is_divide, sizeof(char));
+			conn.Send(&is_divide, sizeof(char));
 
 			if(is_divide == 'd') {
 				active_serv_num++;
-				CreateChildServerInst(socket, client_id);
+				CreateChildServerInst(conn, client_id);
 			} 
 		}
 
-		RetrieveDocuments(socket, client_id);
+		RetrieveDocuments(conn, client_id);
+	}
+
+	// This returns the number of milliseconds left before the deadline
+	int RemainTime() {
+
+		CStopWatch timer = m_deadline_timer;
+		timer.StopTimer();
+		return RETRIEVE_DEADLINE - (int)(timer.GetElapsedTime() * 1000);
+	}
+
+	// This abandons a server that is still being set up once the
+	// deadline has passed, since its connection was never aborted
+	void CheckDeadline() {
+
+		m_mutex.Acquire();
+		bool is_expired = m_is_expired;
+		m_mutex.Release();
+
+		if(is_expired == true) {
+			throw ENetworkException("Retrieve Deadline Passed");
+		}
+	}
+
+	// This is called once a server has finished or failed. The connection
+	// is only kept for later requests if the server finished before the
+	// deadline, otherwise it may have been aborted part way through.
+	// @param ptr - the server that finished
+	// @param is_success - true if every document was received
+	void FinishServer(SRetrieveConn *ptr, bool is_success) {
 
-		COpenConnection::CloseConnection(socket);
+		m_mutex.Acquire();
+		ptr->is_done = true;
+		m_done_num++;
+		if(is_success == false) {
+			m_fail_num++;
+		}
+		bool is_expired = m_is_expired;
+		m_mutex.Release();
+
+		if(is_success == true && is_expired == false) {
+			CNameServer::ReleaseRetrieveServer(ptr->child_conn);
+		} else {
+			CNameServer::CloseServer(ptr->child_conn);
+		}
+
+		m_done_sem.Signal();
 	}
 
 	// This is used to spawn one of the document instances
@@ -111,13 +182,19 @@ class CRetrieveServer : public CNodeStat {
 	static THREAD_RETURN1 THREAD_RETURN2 SubdividServersThread(void *ptr) {
 		SRetrieveConn *call = (SRetrieveConn *)ptr;
 
-		call->this_ptr->ServerInst(call->child_sock, call->id);
+		bool is_success = true;
+		try {
+			call->this_ptr->ServerInst(call->child_conn, call->id);
+		} catch(...) {
+			is_success = false;
+		}
 
+		call->this_ptr->FinishServer(call, is_success);
 		return 0;
 	}
 
 	// This transfers data from the parent search server to the child search server
-	void TransferData(SOCKET &parent_sock, SOCKET &child_sock) {
+	void TransferData(CFrameConnection &parent_conn, CFrameConnection &child_conn) {
 
 		uChar hit_seg_num;
 		SHitSegment hit_seg;
@@ -129,80 +206,103 @@ class CRetrieveServer : public CNodeStat {
 		S64BitBound node_bound;
 
 		int node_num;
-		COpenConnection::Receive(parent_sock, (char *)&node_num, sizeof(int));
-		COpenConnection::Send(child_sock, (char *)&node_num, sizeof(int));
+		parent_conn.Receive((char *)&node_num, sizeof(int));
+		child_conn.Send((char *)&node_num, sizeof(int));
 
 		for(int i=0; i<node_num; i++) {
 	
-			COpenConnection::Receive(parent_sock, (char *)&tree_id, sizeof(u_short));
-			COpenConnection::Receive(parent_sock, (char *)&tree_level, sizeof(uChar));
-			COpenConnection::Receive(parent_sock, (char *)&byte_offset, sizeof(_int64));
-			COpenConnection::Receive(parent_sock, (char *)&header, sizeof(SABNode));
-			COpenConnection::Receive(parent_sock, (char *)&node_bound, sizeof(S64BitBound));
+			parent_conn.Receive((char *)&tree_id, sizeof(u_short));
+			parent_conn.Receive((char *)&tree_level, sizeof(uChar));
+			parent_conn.Receive((char *)&byte_offset, sizeof(_int64));
+			parent_conn.Receive((char *)&header, sizeof(SABNode));
+			parent_conn.Receive((char *)&node_bound, sizeof(S64BitBound));
 	
-			COpenConnection::Send(child_sock, (char *)&tree_id, sizeof(u_short));
-			COpenConnection::Send(child_sock, (char *)&byte_offset, sizeof(_int64));
-			COpenConnection::Send(child_sock, (char *)&header, sizeof(SABNode));
-			COpenConnection::Send(child_sock, (char *)&node_bound, sizeof(S64BitBound));
-			COpenConnection::Send(child_sock, (char *)&tree_level, sizeof(uChar));
-
-			COpenConnection::Receive(parent_sock, (char *)&hit_seg_num, sizeof(uChar));
-			COpenConnection::Send(child_sock, (char *)&hit_seg_num, sizeof(uChar));
+			child_conn.Send((char *)&tree_id, sizeof(u_short));
+			child_conn.Send((char *)&byte_offset, sizeof(_int64));
+			child_conn.Send((char *)&header, sizeof(SABNode));
+			child_conn.Send((char *)&node_bound, sizeof(S64BitBound));
+			child_conn.Send((char *)&tree_level, sizeof(uChar));
+
+			parent_conn.Receive((char *)&hit_seg_num, sizeof(uChar));
+			child_conn.Send((char *)&hit_seg_num, sizeof(uChar));
 				
 			for(uChar k=0; k<hit_seg_num; k++) {
-				COpenConnection::Receive(parent_sock, (char *)&hit_seg, sizeof(SHitSegment));
-				COpenConnection::Send(child_sock, (char *)&hit_seg, sizeof(SHitSegment));
+				parent_conn.Receive((char *)&hit_seg, sizeof(SHitSegment));
+				child_conn.Send((char *)&hit_seg, sizeof(SHitSegment));
 			}
 		}
 	}
 
 	// This is used to create a new server instance
-	void CreateChildServerInst(SOCKET &socket, int client_id) {
+	void CreateChildServerInst(CFrameConnection &conn, int client_id) {
+
+		CheckDeadline();
 
 		m_mutex.Acquire();
 		SRetrieveConn *ptr = m_pend_server_set.ExtendSize(1);
 		ptr->this_ptr = this;
 		ptr->id = client_id;
+		ptr->is_start = false;
+		ptr->is_done = false;
+		ptr->is_joined = false;
 		m_mutex.Release();
 
-		CNameServer::RetrieveServerInst(ptr->child_sock);
+		try {
+			if(CNameServer::RetrieveServerInst(ptr->child_conn, RemainTime()) == false) {
+				throw ENetworkException("No Retrieve Server Found");
+			}
+			CheckDeadline();
 
-		unsigned int uiThread1ID;
-		const char command[20] = "Seed";
-		COpenConnection::Send(ptr->child_sock, command, 20);
+			const char command[20] = "Seed";
+			ptr->child_conn.Send(command, 20);
 
-		m_mutex.Acquire();
-		COpenConnection::Send(ptr->child_sock, (char *)&client_id, sizeof(int));
-		COpenConnection::Send(ptr->child_sock, (char *)&RETRIEVE_SERVER_NUM, sizeof(int));
-		SendQueryTerms(ptr->child_sock);
-		COpenConnection::Send(ptr->child_sock, (char *)&m_max_word_div_num, sizeof(int));
+			m_mutex.Acquire();
+			ptr->child_conn.Send((char *)&client_id, sizeof(int));
+			ptr->child_conn.Send((char *)&RETRIEVE_SERVER_NUM, sizeof(int));
+			SendQueryTerms(ptr->child_conn);
+			ptr->child_conn.Send((char *)&m_max_word_div_num, sizeof(int));
 
-		m_mutex.Release();
+			m_mutex.Release();
 
-		TransferData(socket, ptr->child_sock);
+			TransferData(conn, ptr->child_conn);
+		} catch(...) {
+			FinishServer(ptr, false);
+			throw;
+		}
 
-		ptr->handle = (HANDLE)_beginthreadex(NULL, 0, 
+		unsigned int uiThread1ID;
+		ptr->is_start = true;
+		ptr->handle = _beginthreadex(NULL, 0, 
 			SubdividServersThread, ptr, NULL, &uiThread1ID);
 	}
 
-	// This retrieves the set of documents and keywords from a retrieve server
-	void RetrieveDocuments(SOCKET &socket, int client_id) {
+	// This retrieves the set of documents and keywords from a retrieve 
+	// server. Documents are no longer added once the deadline has passed
+	// since the final document set may already be being ranked.
+	void RetrieveDocuments(CFrameConnection &conn, int client_id) {
 
 		SQueryRes res;	
 		int set_num = 0;
-		COpenConnection::Receive(socket, (char *)&set_num, sizeof(int));
+		conn.Receive((char *)&set_num, sizeof(int));
 		res.is_red = false;
 
 		for(int j=0; j<set_num; j++) {
-			COpenConnection::Receive(socket, (char *)&res.unique_term_num, sizeof(uChar));
-			COpenConnection::Receive(socket, (char *)&res.title_div_num, sizeof(uChar));
-			COpenConnection::Receive(socket, (char *)&res.node_id, sizeof(S5Byte));
-			COpenConnection::Receive(socket, (char *)&res.hit_score, sizeof(uChar));
-			COpenConnection::Receive(socket, (char *)&res.check_sum, sizeof(uLong));
+			conn.Receive((char *)&res.unique_term_num, sizeof(uChar));
+			conn.Receive((char *)&res.title_div_num, sizeof(uChar));
+			conn.Receive((char *)&res.node_id, sizeof(S5Byte));
+			conn.Receive((char *)&res.hit_score, sizeof(uChar));
+			conn.Receive((char *)&res.check_sum, sizeof(uLong));
 
 			m_mutex.Acquire();
-			m_ranked_list.AddDocument(res);
+			bool is_expired = m_is_expired;
+			if(is_expired == false) {
+				m_ranked_list.AddDocument(res);
+			}
 			m_mutex.Release();
+
+			if(is_expired == true) {
+				throw ENetworkException("Retrieve Deadline Passed");
+			}
 		}
 	}
 
@@ -212,30 +312,128 @@ class CRetrieveServer : public CNodeStat {
 	// @param word_id_set - this stores the set of query terms
 	void SendQuery(SRetrieveConn *ptr) {
 
-		CNameServer::RetrieveServerInst(ptr->child_sock);
+		if(CNameServer::RetrieveServerInst(ptr->child_conn, RemainTime()) == false) {
+			throw ENetworkException("No Retrieve Server Found");
+		}
+		CheckDeadline();
 		
 		const char command[20] = "Query";
-		COpenConnection::Send(ptr->child_sock, command, 20);
-		COpenConnection::Send(ptr->child_sock, (char *)&ptr->id, sizeof(int));
-		COpenConnection::Send(ptr->child_sock, (char *)&RETRIEVE_SERVER_NUM, sizeof(int));
+		ptr->child_conn.Send(command, 20);
+		CQueryTrace::SendQueryID(ptr->child_conn);
+		ptr->child_conn.Send((char *)&ptr->id, sizeof(int));
+		ptr->child_conn.Send((char *)&RETRIEVE_SERVER_NUM, sizeof(int));
 
-		SendQueryTerms(ptr->child_sock);
-		ServerInst(ptr->child_sock, ptr->id);
+		SendQueryTerms(ptr->child_conn);
+		ServerInst(ptr->child_conn, ptr->id);
 	}
 
 	// This is used to spawn one of the document instances
 	// to retreive a document
 	static THREAD_RETURN1 THREAD_RETURN2 RetrieveResThread(void *ptr) {
 		SRetrieveConn *call = (SRetrieveConn *)ptr;
-		call->this_ptr->SendQuery(call);
 
+		bool is_success = true;
+		try {
+			call->this_ptr->SendQuery(call);
+		} catch(...) {
+			is_success = false;
+		}
+
+		call->this_ptr->FinishServer(call, is_success);
 		return 0;
 	}
 
+	// This waits until every server has finished or the deadline has 
+	// passed. Servers still running at the deadline have their connection
+	// aborted so their threads finish straight away.
+	void WaitForServers() {
+
+		while(true) {
+			m_mutex.Acquire();
+			bool is_finished = (m_done_num == m_pend_server_set.Size());
+			m_mutex.Release();
+
+			if(is_finished == true) {
+				return;
+			}
+
+			int remain_time = RemainTime();
+			if(remain_time <= 0 || m_done_sem.Wait(remain_time) == false) {
+				break;
+			}
+		}
+
+		SRetrieveConn *ptr;
+		m_mutex.Acquire();
+		m_is_expired = true;
+		m_pend_server_set.ResetPath();
+		while((ptr = m_pend_server_set.NextNode()) != NULL) {
+			if(ptr->is_done == false) {
+				ptr->child_conn.Abort();
+				m_expired_num++;
+			}
+		}
+		m_mutex.Release();
+	}
+
+	// This joins the threads of the servers that have finished. The thread
+	// of a server abandoned at the deadline may still be running, it's
+	// left to be joined at the start of the next query.
+	// @param is_wait - true to wait for every thread to finish
+	void JoinServers(bool is_wait) {
+
+		if(m_pend_server_set.BufferSize() < 0) {
+			return;
+		}
+
+		SRetrieveConn *ptr;
+		m_pend_server_set.ResetPath();
+		while((ptr = m_pend_server_set.NextNode()) != NULL) {
+			if(ptr->is_start == false || ptr->is_joined == true) {
+				continue;
+			}
+
+			m_mutex.Acquire();
+			bool is_done = ptr->is_done;
+			m_mutex.Release();
+
+			if(is_done == true || is_wait == true) {
+				WaitForThread(ptr->handle, INFINITE);
+				ptr->is_joined = true;
+			}
+		}
+	}
+
+	// This resets the state of the last query
+	void Reset() {
+		m_max_word_div_num = 0;
+		m_is_expired = false;
+		m_done_num = 0;
+		m_expired_num = 0;
+		m_fail_num = 0;
+		m_is_cache_hit = false;
+	}
+
 public:
 
 	CRetrieveServer() {
-		m_max_word_div_num = 0;
+		Reset();
+	}
+
+	// This returns the number of retrieve servers used by the query
+	inline int ServerNum() {
+		return m_pend_server_set.Size();
+	}
+
+	// This returns the number of retrieve servers that hadn't finished
+	// by the deadline, the results are partial if this is non zero
+	inline int ExpiredServerNum() {
+		return m_expired_num;
+	}
+
+	// This returns true if the documents were found in the query cache
+	inline bool IsCacheHit() {
+		return m_is_cache_hit;
 	}
 
 	// This returns the set of query terms
@@ -261,26 +459,61 @@ public:
 	void ProcessQuery(int query_term_num) {
 
 		unsigned int uiThread1ID;
+		// servers abandoned by the last query still use the shared state
+		JoinServers(true);
+		Reset();
+
 		m_query_term_num = query_term_num;
 		m_pend_server_set.Initialize(30);
+		m_ranked_list.Reset();
 		CKeywordSet::Initialize();
 
+#ifndef OS_WINDOWS
+		if(CQueryCache::FindQuery(m_word_id_set, m_ranked_list, m_max_word_div_num)) {
+			m_is_cache_hit = true;
+			CTraceSpan rank_span(CQueryTrace::RANK);
+			m_ranked_list.RankFinalDocumentSet(m_max_word_div_num);
+			return;
+		}
+#endif
+
+		CTraceSpan retrieve_span(CQueryTrace::RETRIEVE);
+		m_deadline_timer.StartTimer();
+
+		m_mutex.Acquire();
 		for(int i=0; i<RETRIEVE_SERVER_NUM; i++) {
 			SRetrieveConn *ptr = m_pend_server_set.ExtendSize(1);
 			ptr->id = i;
 			ptr->this_ptr = this;
+			ptr->is_start = true;
+			ptr->is_done = false;
+			ptr->is_joined = false;
 
-			ptr->handle = (HANDLE)_beginthreadex(NULL, 0, 
+			ptr->handle = _beginthreadex(NULL, 0, 
 				RetrieveResThread, ptr, NULL, &uiThread1ID);
 		}
+		m_mutex.Release();
 
-		SRetrieveConn *ptr;
-		m_pend_server_set.ResetPath();
-		while((ptr = m_pend_server_set.NextNode()) != NULL) {
-			WaitForThread(ptr->handle, INFINITE);
+		WaitForServers();
+		JoinServers(false);
+
+		// a server abandoned at the deadline may still be running
+		m_mutex.Acquire();
+		int max_word_div_num = m_max_word_div_num;
+		m_mutex.Release();
+
+#ifndef OS_WINDOWS
+		// partial results are not cached
+		if(m_expired_num == 0 && m_fail_num == 0) {
+			CQueryCache::AddQuery(m_word_id_set, 
+				m_ranked_list.DocumentSet(), max_word_div_num);
 		}
+#endif
+
+		retrieve_span.Finish();
+		CTraceSpan rank_span(CQueryTrace::RANK);
 
-		m_ranked_list.RankFinalDocumentSet(m_max_word_div_num);
+		m_ranked_list.RankFinalDocumentSet(max_word_div_num);
 	}
 
 };
@@ -288,6 +521,7 @@ const int CRetrieveServer::MAX_SERVER_NUM;
 const int CRetrieveServer::MAX_SEARCH_IT;
 const int CRetrieveServer::MAX_SEARCH_PASS_NUM;
 const int CRetrieveServer::RETRIEVE_SERVER_NUM;
+const int CRetrieveServer::RETRIEVE_DEADLINE;
 
 CArrayList<SWordItem> CRetrieveServer::m_word_id_set;
 CLinkedBuffer<CRetrieveServer::SRetrieveConn> CRetrieveServer::m_pend_server_set;
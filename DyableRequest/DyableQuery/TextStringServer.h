@@ -59,7 +59,7 @@ class CTextStringServer {
 	// @param local_id - this stores the current local id of the word
 	// @param match_score - this is the match score of the term
 	// @param is_synom - true if the word is a synonym for the one supplied
-	void TokenizeClosetMatchString(COpenConnection &conn, S5Byte &word_id,
+	void TokenizeClosetMatchString(CFrameConnection &conn, S5Byte &word_id,
 		uLong word_occur, int local_id, uChar match_score, bool is_synom) {
 
 		int word_end;
@@ -95,7 +95,7 @@ class CTextStringServer {
 	// @param conn - this is the connection to the text string server
 	// @param match_num - this is the number of term matches
 	// @param local_id - this stores the current local id of the word
-	void ProcessSimilarTerm(COpenConnection &conn, int match_num, int local_id) {
+	void ProcessSimilarTerm(CFrameConnection &conn, int match_num, int local_id) {
 
 		S5Byte word_id;
 		uChar term_match;
@@ -120,20 +120,21 @@ class CTextStringServer {
 	// combined terms in the association.
 	void IssueRequest(SInstConn &inst) {
 	
-		COpenConnection conn;
+		CFrameConnection conn;
 		CNameServer::TextStringServerInst(conn);
 	
 		int match_num;
 		static char request[20] = "SimilarWord";
 
 		conn.Send(request, 20);
+		CQueryTrace::SendQueryID(conn);
 		conn.Send((char *)&m_is_spell_check, 1);
 		conn.Send((char *)&inst.text_length, 2);
 		conn.Send(inst.text_ptr, inst.text_length);
 		conn.Receive((char *)&match_num, sizeof(int));
 
 		ProcessSimilarTerm(conn, match_num, inst.id);
-		conn.CloseConnection();
+		CNameServer::ReleaseTextStringServer(conn);
 	}
 
 	// This spawns a connnection to a text string server
@@ -213,6 +213,8 @@ function loadXMLDoc(doc_id, query, node_id, is_keywords, term_weight) {
     text += node_id;
     text += "&excerpt=";
     text += excerpt_id;
+    text += "&qid=";
+    text += query_id;
 
     if (is_keywords == true) {
         text += "&keywords=";
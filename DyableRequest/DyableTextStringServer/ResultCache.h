@@ -329,7 +329,7 @@ public:
 
 	// This searches for an entry in the result cache and
 	// returns the stored result back to the client.
-	bool FindEntry(COpenConnection &conn, const char str[], int length) {
+	bool FindEntry(CFrameConnection &conn, const char str[], int length) {
 
 		SHashEntry *ptr = FindEntry(str, length);
 
@@ -416,7 +416,7 @@ public:
 
 			string_set[i].AddTextSegment(CUtility::SecondTempBuffer(), length);
 
-			COpenConnection conn;
+			CFrameConnection conn;
 			for(int j=max(0, i-MAX_CACHE_ENTRIES + 1); j<i; j++) {
 				if(FindEntry(conn, string_set[j].Buffer(), string_set[j].Size()) == false) {
 					cout<<"not found";getchar();
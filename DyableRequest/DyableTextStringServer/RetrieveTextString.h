@@ -65,7 +65,7 @@ public:
 
 	// This processes a request for the lookup of a set of word id to find the 
 	// corresponding text string for each word id
-	void ProcessRequest(COpenConnection &conn) {
+	void ProcessRequest(CFrameConnection &conn) {
 
 		int word_num = 0;
 		_int64 word_id = 0;
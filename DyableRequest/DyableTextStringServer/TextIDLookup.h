@@ -288,7 +288,7 @@ class CRetrieveSimilarWordID : public CNodeStat {
 	// This sends the set of associated terms for a given query term
 	// @param item - this is the particular word item
 	// @param byte_offset - this is the association byte offset
-	void SendAssociatedTerms(COpenConnection &conn, SWord &item, S5Byte &assoc_byte_offset) {
+	void SendAssociatedTerms(CFrameConnection &conn, SWord &item, S5Byte &assoc_byte_offset) {
 
 		CHitItemBlock &cache = m_assoc_word[item.word_id.Value() % CNodeStat::GetHashDivNum()];
 		_int64 byte_offset = assoc_byte_offset.Value();
@@ -315,7 +315,7 @@ class CRetrieveSimilarWordID : public CNodeStat {
 	// @param is_match - true if an exact match is found, false otherwise
 	// @param is_synm - true if the word is a synonym for the one supplied
 	void SendPossibleMatch(SWord &item, bool is_match, bool is_synm,
-		const char *search_str, COpenConnection &conn) {
+		const char *search_str, CFrameConnection &conn) {
 
 		static S5Byte assoc_byte_offset;
 
@@ -367,7 +367,7 @@ class CRetrieveSimilarWordID : public CNodeStat {
 	// @param conn - the open connection to the client
 	// @param phrase_length - this is the length of the total phrase sent
 	// @param - this is the length of the first word in the phrase
-	void FindWordID1(COpenConnection &conn, char str[], 
+	void FindWordID1(CFrameConnection &conn, char str[], 
 		int phrase_length, int word_length) {
 		
 		bool is_match = SearchForTextString(str, word_length);
@@ -403,7 +403,7 @@ class CRetrieveSimilarWordID : public CNodeStat {
 	// @param conn - the open connection to the client
 	// @param phrase_length - this is the length of the total phrase sent
 	// @param - this is the length of the first word in the phrase
-	void FindWordID(COpenConnection &conn, char str[], 
+	void FindWordID(CFrameConnection &conn, char str[], 
 		int phrase_length, int word_length) {
 		
 		bool is_match = SearchForTextString(str, word_length);
@@ -449,7 +449,7 @@ public:
 
 	CRetrieveSimilarWordID() {
 
-		CHitItemBlock::InitializeLRUQueue(100000);
+		CHitItemBlock::InitializeLRUQueue();
 	}
 
 	// This initializes the set of hit blocks
@@ -468,11 +468,11 @@ public:
 		m_sort_word.AllocateMemory(CNodeStat::GetHashDivNum());
 		for(int i=0; i<CNodeStat::GetHashDivNum(); i++) {
 			m_lookup_index[i].Initialize(CUtility::ExtendString
-				("GlobalData/Lexicon/word_lookup", i), 100);
+				("GlobalData/Lexicon/word_lookup", i), 100, true);
 			m_sort_word[i].Initialize(CUtility::ExtendString
-				("GlobalData/Lexicon/sorted_words", i), 100);
+				("GlobalData/Lexicon/sorted_words", i), 100, true);
 			m_assoc_word[i].Initialize(CUtility::ExtendString
-				("GlobalData/Lexicon/assoc_term", i), 100);
+				("GlobalData/Lexicon/assoc_term", i), 100, true);
 		}
 	}
 
@@ -485,7 +485,7 @@ public:
 
 	// Returns the word id belonging to some word text string
 	// @param conn - the open connection to the client
-	void WordIDRequest(COpenConnection &conn) {
+	void WordIDRequest(CFrameConnection &conn) {
 	
 		int phrase_length = 0;
 		int word_length = -1;
@@ -530,7 +530,7 @@ public:
 
 		Initialize();
 		Reset();
-		COpenConnection conn;
+		CFrameConnection conn;
 		int phrase_length = strlen(word);
 		int word_length = -1;
 		m_is_spell_check = false;
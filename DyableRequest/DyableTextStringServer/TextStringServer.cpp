@@ -11,21 +11,48 @@ class CParseQuery : public CNameServerStat {
 	CRetrieveTextString m_text_string;
 	// This stores the tcp connection
 	COpenConnection m_conn;
+	// This dispatches requests to the worker
+	CReactor m_reactor;
+	// This stores the port the server is listening on
+	u_short m_listen_port;
 
 	// This process the request for the connecting client
-	void HandleQueryCase(COpenConnection &accept) {
+	void HandleQueryCase(CFrameConnection &accept) {
 
 		accept.Receive(CUtility::SecondTempBuffer(), 20);
 		cout<<"Request "<<CUtility::SecondTempBuffer()<<endl;
 		if(CUtility::FindFragment(CUtility::SecondTempBuffer(), "SimilarWord")) {
+			CQueryTrace::ReceiveQueryID(accept);
+			CTraceSpan span(CQueryTrace::WORD_LOOKUP);
 			m_sim_word.WordIDRequest(accept);
 		}
 
 		if(CUtility::FindFragment(CUtility::SecondTempBuffer(), "WordIDRequest")) {
+			CQueryTrace::ReceiveQueryID(accept);
+			CTraceSpan span(CQueryTrace::WORD_LOOKUP);
 			m_text_string.ProcessRequest(accept);
 		}
+	}
+
+	// This is called by the worker once a client has connected, requests
+	// are handled until the client closes the connection
+	static bool HandleConnection(SOCKET &socket, void *ptr) {
+
+		CParseQuery *this_ptr = (CParseQuery *)ptr;
+
+		try {
+			CFrameConnection conn(socket);
+			CNameServer::SetServerActive(conn);
+
+			while(true) {
+				this_ptr->HandleQueryCase(conn);
+				CQueryTrace::EndRequest();
+			}
+		} catch(...) {
+		}
 
-		accept.CloseConnection();
+		CNameServer::FreeServer(this_ptr->m_listen_port);
+		return false;
 	}
 
 public:
@@ -40,30 +67,23 @@ public:
 		CNameServerStat::InitializeBeacon();
 
 		CUtility::RandomizeSeed();
-		u_short listen_port = (rand() % 40000) + 10000;
-		while(m_conn.OpenServerConnection(listen_port, LOCAL_NETWORK) == false) {
-			listen_port = (rand() % 40000) + 10000;
+		m_listen_port = (rand() % 40000) + 10000;
+		while(m_conn.OpenServerConnection(m_listen_port, LOCAL_NETWORK) == false) {
+			m_listen_port = (rand() % 40000) + 10000;
 		}
 
 		CNameServer::Initialize();
 		CNameServer::InitializeServerThread();
+		CQueryTrace::Initialize("Text String Server");
 
-		cout<<"Text String Server Listening "<<listen_port<<endl;
+		cout<<"Text String Server Listening "<<m_listen_port<<endl;
 		m_conn.ListenOnServerConnection(INFINITE);
 
-		CNameServer::FreeServer(listen_port);
-		
-		while(true) {
+		CNameServer::FreeServer(m_listen_port);
 
-			try {
-				COpenConnection conn(m_conn.ServerAcceptConnection());
-				CNameServer::SetServerActive(conn);
-				HandleQueryCase(conn);
-			} catch(...) {
-			}
-
-			CNameServer::FreeServer(listen_port);
-		}
+		// the reset port is sent as soon as a query connects
+		m_reactor.Initialize(m_conn.Socket(), 1, HandleConnection, this, true);
+		m_reactor.Run();
 	}
 };
 
@@ -123,7 +123,7 @@ public:
 
 	// This is called to seed all of the high scoring documents in the graph.
 	// This is a precursor to calculating expected reward
-	void Initialize(COpenConnection &conn) {
+	void Initialize(CFrameConnection &conn) {
 		
 		int node_num;
 		int client_id = 0;
@@ -190,11 +190,12 @@ public:
 
 		CompileSeedNodes();
 
+		CTraceSpan span(CQueryTrace::BRANCH_AND_BOUND);
 		m_branch_bound.RankDocuments(conn);
 	}
 
 	// This retrieves the set of doc ids for a given set of node ids
-	void RetrieveDocIDs(COpenConnection &conn) {
+	void RetrieveDocIDs(CFrameConnection &conn) {
 
 		int num;
 		conn.Receive((char *)&num, sizeof(int));
@@ -207,8 +208,6 @@ public:
 			m_branch_bound.Keywords().RetrieveDocID(doc_id, keyword_byte_offset, doc_id);
 			conn.Send((char *)&doc_id, sizeof(S5Byte));
 		}
-
-		conn.CloseConnection();
 	}
 
 };
\ No newline at end of file
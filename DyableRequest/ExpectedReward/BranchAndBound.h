@@ -210,7 +210,7 @@ public:
 	}
 
 	// This ranks the set of documents by their expected reward and keyword score
-	void RankDocuments(COpenConnection &conn) {
+	void RankDocuments(CFrameConnection &conn) {
 
 		cout<<"Shuffle Time "<<shuffle_time<<endl;
 		cout<<"keyword_time "<<keyword_time<<endl;
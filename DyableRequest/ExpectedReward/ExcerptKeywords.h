@@ -213,7 +213,7 @@ public:
 	}
 
 	// This sends the top N spatial keywords
-	void SendSpatialKeywords(COpenConnection &conn) {
+	void SendSpatialKeywords(CFrameConnection &conn) {
 
 		m_keyword_queue.Initialize(200, CompareSpatialKeywords);
 
@@ -319,7 +319,7 @@ class CExcerptKeywords : public CRankExcerpt {
 	// This adds the excerpt keywords that belong to a particular document
 	// @param byte_offset - this is the byte offset of the keyword set being processed
 	// @param tree_id - this is the id of the keyword set being processed
-	void SendKeywordSet(_int64 byte_offset, int tree_id, COpenConnection &conn) {
+	void SendKeywordSet(_int64 byte_offset, int tree_id, CFrameConnection &conn) {
 
 		static int enc_bytes;
 		static CMemoryChunk<char> ab_buff(11);
@@ -465,7 +465,7 @@ public:
 
 	// This adds the set of associated terms for a given query which are used
 	// as seed terms to guide the search.
-	void AddSeedTerms(COpenConnection &conn) {
+	void AddSeedTerms(CFrameConnection &conn) {
 
 		S5Byte keyword_id;
 		float weight;
@@ -536,7 +536,7 @@ public:
 	}
 
 	// This calculates the keyword score for a given document 
-	void SendExcerptKeywords(S5Byte &node_id, COpenConnection &conn) {
+	void SendExcerptKeywords(S5Byte &node_id, CFrameConnection &conn) {
 
 		static S5Byte doc_id;
 		static int enc_bytes;
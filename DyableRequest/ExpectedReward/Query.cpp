@@ -7,40 +7,76 @@ class CParseQuery : public CNodeStat {
 
 	// This stores the tcp connection
 	COpenConnection m_conn;
+	// This dispatches requests to the worker, a server handles
+	// one query at a time so only a single worker is used
+	CReactor m_reactor;
+	// This stores the port the server is listening on
+	u_short m_listen_port;
+	// This stores the number of requests handled
+	int m_request_num;
 	// This is used to to assign a document score to 
 	// each of the documents that need resolving
 	CAssignDocumentScore m_doc_score;
 
 	// This begins the query 
-	void FullQuery(COpenConnection &conn) {
+	void FullQuery(CFrameConnection &conn) {
 
 		CStopWatch stop;
 		stop.StartTimer();
 
+		CTraceSpan span(CQueryTrace::EXPECTED_REWARD);
 		m_doc_score.Initialize(conn);
 
 		stop.StopTimer();
 		cout<<"-------------------  Exp Reward "<<stop.GetElapsedTime()<<endl;
-		conn.CloseConnection();
 	}
 
 	// This handles the query case that is conn requested
-	void HandleQueryCase(COpenConnection &conn) {
+	void HandleQueryCase(CFrameConnection &conn) {
 
 		conn.Receive(CUtility::SecondTempBuffer(), 20);
 
 		if(CUtility::FindFragment(CUtility::SecondTempBuffer(), "Query")) {
+			CQueryTrace::ReceiveQueryID(conn);
 			Reset();
 			FullQuery(conn);
 			return;
 		}
 
 		if(CUtility::FindFragment(CUtility::SecondTempBuffer(), "DocIDLookup")) {
+			CQueryTrace::ReceiveQueryID(conn);
+			CTraceSpan span(CQueryTrace::DOC_ID_LOOKUP);
 			m_doc_score.RetrieveDocIDs(conn);
 			return;
 		}
 	}
 
+	// This is called by the worker once a client has connected, requests
+	// are handled until the client closes the connection
+	static bool HandleConnection(SOCKET &socket, void *ptr) {
+
+		CParseQuery *this_ptr = (CParseQuery *)ptr;
+
+		try {
+			CFrameConnection conn(socket);
+			cout<<"Expected Reward Accepted A Connection "<<this_ptr->m_listen_port<<endl;
+			CNameServer::SetServerActive(conn);
+
+			while(true) {
+				this_ptr->HandleQueryCase(conn);
+				CQueryTrace::EndRequest();
+				if(++this_ptr->m_request_num >= CNameServer::KeepAliveTime()) {
+					this_ptr->m_reactor.Stop();
+					break;
+				}
+			}
+		} catch(...) {
+		}
+
+		CNameServer::FreeServer(this_ptr->m_listen_port);
+		return false;
+	}
+
 public:
 
 	CParseQuery() {
@@ -50,7 +86,7 @@ public:
 		CNodeStat::SetClientID(0);
 		CNodeStat::SetClientNum(6);
 
-		COpenConnection conn;
+		CFrameConnection conn;
 		m_doc_score.Initialize(conn);*/
 	}
 
@@ -63,32 +99,26 @@ public:
 		CByte::Initialize(256, CNodeStat::GetHashDivNum());
 
 		CUtility::RandomizeSeed();
-		u_short listen_port = (rand() % 40000) + 10000;
-		while(m_conn.OpenServerConnection(listen_port, LOCAL_NETWORK) == false) {
-			listen_port = (rand() % 40000) + 10000;
+		m_listen_port = (rand() % 40000) + 10000;
+		while(m_conn.OpenServerConnection(m_listen_port, LOCAL_NETWORK) == false) {
+			m_listen_port = (rand() % 40000) + 10000;
 		}
 		
 		CNameServer::Initialize();
 		CNameServer::InitializeServerThread();
+		CQueryTrace::Initialize("Expected Reward Server");
 
-		cout<<"Expected Reward Listening "<<listen_port<<endl;
+		cout<<"Expected Reward Listening "<<m_listen_port<<endl;
 		m_conn.ListenOnServerConnection(INFINITE);
 
-		CNameServer::FreeServer(listen_port);
-		
-		for(int i=0; i<CNameServer::KeepAliveTime(); i++) {
-			try {
-				COpenConnection conn(m_conn.ServerAcceptConnection());
-				cout<<"Expected Reward Accepted A Connection "<<listen_port<<endl;
-				CNameServer::SetServerActive(conn);
-				HandleQueryCase(conn);
-			} catch(...) {
-			}
+		CNameServer::FreeServer(m_listen_port);
 
-			CNameServer::FreeServer(listen_port);
-		}
+		m_request_num = 0;
+		// the reset port is sent as soon as a query connects
+		m_reactor.Initialize(m_conn.Socket(), 1, HandleConnection, this, true);
+		m_reactor.Run();
 
-		CNameServer::DestroyServer(listen_port);
+		CNameServer::DestroyServer(m_listen_port);
 	}
 
 	// This resets the entire system ready for the next query
@@ -4,7 +4,7 @@
 class CKeywordQuery {
 
 	// This stores the connection to the document server
-	COpenConnection m_conn;
+	CFrameConnection m_conn;
 
 public:
 
@@ -31,6 +31,7 @@ public:
 		static char request[20] = "WordIDRequest";
 
 		m_conn.Send(request, 20);
+		CQueryTrace::SendQueryID(m_conn);
 		m_conn.Send((char *)&match_num, sizeof(int));
 
 		m_conn.Send((char *)&keyword_id, sizeof(S5Byte));
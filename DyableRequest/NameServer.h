@@ -1,4 +1,4 @@
-#include "../DocumentDatabase.h"
+#include "./QueryTrace.h"
 
 // This class is responsible for finding the contact information for each of the 
 // different servers in order to service a given request made by a user.
@@ -6,6 +6,22 @@ class CNameServer {
 
 	// This defines the number of name servers
 	static const int NAME_SERVER_NUM = 1;
+	// This defines the maximum number of name server requests awaiting a reply
+	static const int MAX_PENDING_NUM = 64;
+	// This defines the number of times a name server request is sent
+	// before giving up if the connection to the name server is lost
+	static const int MAX_RETRY_NUM = 3;
+	// This defines the maximum number of idle connections kept to each
+	// type of server
+	static const int MAX_TYPE_POOL_NUM = 2;
+	// This defines the number of milliseconds an idle connection is kept
+	// before it's closed, which frees the server back to the name server.
+	// This must be less than the time a server waits without a beacon.
+	static const int POOL_IDLE_TIME = 1000;
+	// This defines the number of milliseconds between each beacon
+	static const int BEACON_TIME = 100;
+	// This defines the number of milliseconds allowed to find a free server
+	static const int SERVER_TIME_OUT = 2000;
 
 	// This stores one of the connection to an available server
 	struct SAvailConn {
@@ -23,8 +39,58 @@ class CNameServer {
 		SOCKET name_socket;
 	};
 
+	// This stores a name server request awaiting a reply
+	struct SPendingRequest {
+		// This indicates whether the request is in use
+		bool is_used;
+		// This indicates whether the reply has arrived
+		bool is_done;
+		// This stores the number of bytes in the reply
+		int reply_size;
+		// This stores the reply
+		char reply[4];
+	};
+
+	// This stores an idle connection to a server kept for later requests
+	struct SPoolConn {
+		// This stores the socket
+		SOCKET socket;
+		// This stores the port the server listens for the beacon on
+		int reset_port;
+		// This stores the number of milliseconds the connection has been idle
+		int idle_time;
+		// This stores the type of server
+		char server_name[20];
+	};
+
+	// This stores a server that is sent a keep alive beacon
+	struct SBeacon {
+		// This stores the connection to the server
+		SOCKET socket;
+		// This stores the port the server listens for the beacon on
+		int reset_port;
+	};
+
 	// This stores the beacon connection
 	static COpenConnection m_beacon_conn;
+	// This stores the connection to the name server shared by every thread
+	static CFrameConnection m_ns_conn;
+	// This is incremented every time the name server connection is reopened
+	static int m_ns_epoch;
+	// This protects sending on the name server connection and the pending set
+	static CMutex m_ns_mutex;
+	// This is held by the thread reading replies from the name server
+	static CMutex m_ns_read_mutex;
+	// This stores the name server requests awaiting a reply
+	static CMemoryChunk<SPendingRequest> m_pending;
+	// This stores the set of idle server connections
+	static CArrayList<SPoolConn> m_pool;
+	// This stores the set of servers currently held by this process
+	static CArrayList<SBeacon> m_beacon_set;
+	// This is true once the beacon thread has been started
+	static bool m_is_beacon_start;
+	// This protects the set of idle server connections and the beacon set
+	static CMutex m_pool_mutex;
 	// This stores the name server port
 	static u_short m_ns_port;
 	// This stores the general purpose mutex
@@ -49,54 +115,371 @@ class CNameServer {
 		cout<<"</div></center>";
 	}
 
-	// This retrieves a given instance of a server
+	// This closes the connection to the name server after it has failed.
+	// Every request sent on it is abandoned and is sent again by its 
+	// thread. The idle server connections are closed since they were
+	// handed out by a name server that may no longer be running. This 
+	// must be called while holding the read lock.
+	// @param epoch - the epoch of the connection that failed
+	static void ResetNameServerConnection(int epoch) {
+
+		m_ns_mutex.Acquire();
+		if(epoch == m_ns_epoch) {
+			m_ns_conn.CloseConnection();
+			m_ns_epoch++;
+		}
+		m_ns_mutex.Release();
+
+		m_pool_mutex.Acquire();
+		while(m_pool.Size() > 0) {
+			SOCKET socket = m_pool.PopBack().socket;
+			COpenConnection::CloseConnection(socket);
+		}
+		m_pool_mutex.Release();
+	}
+
+	// This adds a server to the set that is sent the keep alive beacon. 
+	// A socket that was closed without being removed is replaced once 
+	// its descriptor is reused. The beacon thread is started the first
+	// time a server is added.
+	// @param socket - the connection to the server
+	// @param reset_port - the port the server listens for the beacon on
+	static void AddBeacon(SOCKET socket, int reset_port) {
+
+		m_pool_mutex.Acquire();
+		int i;
+		for(i=0; i<m_beacon_set.Size(); i++) {
+			if(m_beacon_set[i].socket == socket) {
+				break;
+			}
+		}
+
+		if(i == m_beacon_set.Size()) {
+			m_beacon_set.ExtendSize(1);
+		}
+
+		m_beacon_set[i].socket = socket;
+		m_beacon_set[i].reset_port = reset_port;
+
+		if(m_is_beacon_start == false) {
+			unsigned int uiThread1ID;
+			m_is_beacon_start = true;
+			_beginthreadex(NULL, 0, BeaconThread2, NULL, NULL, &uiThread1ID);
+		}
+		m_pool_mutex.Release();
+	}
+
+	// This stops sending the keep alive beacon to a server whose connection
+	// is being closed or kept idle, this must be called while holding the
+	// pool lock
+	// @param socket - the connection to the server
+	// @return the port the server listens for the beacon on, -1 if none
+	static int RemoveBeacon(SOCKET socket) {
+
+		for(int i=0; i<m_beacon_set.Size(); i++) {
+			if(m_beacon_set[i].socket == socket) {
+				int reset_port = m_beacon_set[i].reset_port;
+				m_beacon_set[i] = m_beacon_set.LastElement();
+				m_beacon_set.PopBack();
+				return reset_port;
+			}
+		}
+
+		return -1;
+	}
+
+	// This closes every idle connection that has been kept longer than
+	// allowed. The server frees itself back to the name server once its 
+	// connection is closed. This must be called while holding the pool lock.
+	// @param elapsed_time - the number of milliseconds since the last call
+	static void ExpireIdleServers(int elapsed_time) {
+
+		for(int i=m_pool.Size()-1; i>=0; i--) {
+			m_pool[i].idle_time += elapsed_time;
+			if(m_pool[i].idle_time < POOL_IDLE_TIME) {
+				continue;
+			}
+
+			COpenConnection::CloseConnection(m_pool[i].socket);
+			m_pool[i] = m_pool.LastElement();
+			m_pool.PopBack();
+		}
+	}
+
+	// This sends a request on the name server connection, the connection
+	// is opened if this is the first request or the last one failed
+	// @param request - the name of the request
+	// @param arg - the request arguments
+	// @param arg_size - the number of bytes in the arguments
+	// @param reply_size - the number of bytes in the reply, zero if none
+	// @param epoch - stores the epoch of the connection the request was sent on
+	// @return the id of the request
+	static int SendNameServerRequest(const char request[], const char arg[], 
+		int arg_size, int reply_size, int &epoch) {
+
+		int id;
+		while(true) {
+			m_ns_mutex.Acquire();
+
+			id = 0;
+			while(id < MAX_PENDING_NUM && m_pending[id].is_used == true) {
+				id++;
+			}
+
+			if(id < MAX_PENDING_NUM) {
+				break;
+			}
+
+			m_ns_mutex.Release();
+			Sleep(1);
+		}
+
+		if(m_ns_conn.Socket() == INVALID_SOCKET) {
+			if(m_ns_conn.OpenClientConnection(m_ns_port, LOCAL_NETWORK) == false) {
+				m_ns_mutex.Release();
+				exit(0);
+			}
+
+			m_ns_conn.SetAutoFlush(false);
+		}
+
+		char name[20];
+		memset(name, 0, sizeof(name));
+		strncpy(name, request, sizeof(name) - 1);
+
+		epoch = m_ns_epoch;
+		m_pending[id].is_used = reply_size > 0;
+		m_pending[id].is_done = false;
+		m_pending[id].reply_size = reply_size;
+
+		try {
+			m_ns_conn.Send((char *)&id, sizeof(int));
+			m_ns_conn.Send(name, sizeof(name));
+			m_ns_conn.Send(arg, arg_size);
+			m_ns_conn.Flush();
+		} catch(...) {
+			m_pending[id].is_used = false;
+			m_ns_mutex.Release();
+			throw;
+		}
+
+		m_ns_mutex.Release();
+		return id;
+	}
+
+	// This waits for the reply to a name server request. The thread 
+	// holding the read lock reads replies and hands each one to the request
+	// with the matching id until its own reply has arrived.
+	// @param id - the id of the request
+	// @param epoch - the epoch of the connection the request was sent on
+	// @param reply - stores the reply
+	// @return true if the reply arrived, false if the connection was lost
+	static bool WaitForReply(int id, int epoch, char reply[]) {
+
+		bool is_done = false;
+		m_ns_read_mutex.Acquire();
+
+		try {
+			while(m_pending[id].is_done == false) {
+				m_ns_mutex.Acquire();
+				bool is_lost = epoch != m_ns_epoch;
+				m_ns_mutex.Release();
+
+				if(is_lost == true) {
+					break;
+				}
+
+				int reply_id;
+				m_ns_conn.Receive((char *)&reply_id, sizeof(int));
+				if(reply_id < 0 || reply_id >= MAX_PENDING_NUM || 
+					m_pending[reply_id].is_used == false) {
+					throw ENetworkException("Invalid Reply ID");
+				}
+
+				SPendingRequest &pending = m_pending[reply_id];
+				m_ns_conn.Receive(pending.reply, pending.reply_size);
+				pending.is_done = true;
+			}
+
+			is_done = m_pending[id].is_done;
+			if(is_done == true) {
+				memcpy(reply, m_pending[id].reply, m_pending[id].reply_size);
+			}
+		} catch(...) {
+			ResetNameServerConnection(epoch);
+		}
+
+		m_ns_read_mutex.Release();
+
+		m_ns_mutex.Acquire();
+		m_pending[id].is_used = false;
+		m_ns_mutex.Release();
+
+		return is_done;
+	}
+
+	// This sends a request to the name server over the connection shared 
+	// by every thread in the process. Each request carries an id that the
+	// name server sends back with the reply, so requests from different 
+	// threads can be outstanding at the same time. The process exits if 
+	// the name server can't be reached, as it would for a failed connect.
+	// @param request - the name of the request
+	// @param arg - the request arguments
+	// @param arg_size - the number of bytes in the arguments
+	// @param reply - stores the reply
+	// @param reply_size - the number of bytes in the reply, zero if none
+	static void NameServerRequest(const char request[], const char arg[],
+		int arg_size, char reply[], int reply_size) {
+
+		for(int i=0; i<MAX_RETRY_NUM; i++) {
+			int id;
+			int epoch = -1;
+			try {
+				id = SendNameServerRequest(request, arg, arg_size, reply_size, epoch);
+			} catch(...) {
+				m_ns_read_mutex.Acquire();
+				ResetNameServerConnection(epoch);
+				m_ns_read_mutex.Release();
+				continue;
+			}
+
+			if(reply_size == 0 || WaitForReply(id, epoch, reply) == true) {
+				return;
+			}
+		}
+
+		exit(0);
+	}
+
+	// This takes an idle connection to a given type of server. Connections 
+	// the server has closed, for instance once it has reached its keep alive
+	// time, are discarded. The server is sent the beacon again once taken.
 	// @param conn - this is used to store the connection to the server
 	// @param server_name - this is the type of server
-	// @param id - this is the id of one of the retrieve servers
-	//           - if the retreive servers are being used
-	static void ServerInst(SOCKET &socket, const char server_name[]) {
+	// @return true if an idle connection was found, false otherwise
+	static bool TakePooledServer(CFrameConnection &conn, const char server_name[]) {
+
+		m_pool_mutex.Acquire();
+		for(int i=m_pool.Size()-1; i>=0; i--) {
+			if(strcmp(m_pool[i].server_name, server_name) != 0) {
+				continue;
+			}
+
+			SPoolConn pool_conn = m_pool[i];
+			m_pool[i] = m_pool.LastElement();
+			m_pool.PopBack();
+
+			conn.Attach(pool_conn.socket);
+			if(conn.IsAlive() == true) {
+				m_pool_mutex.Release();
+				AddBeacon(conn.Socket(), pool_conn.reset_port);
+				return true;
+			}
+
+			conn.CloseConnection();
+		}
+
+		m_pool_mutex.Release();
+		return false;
+	}
+
+	// This hands a connection back once a request has finished so it can
+	// be reused by a later request to the same type of server. The server
+	// is no longer sent the beacon while its connection is idle and the
+	// connection is closed once it has been idle for too long, so a server
+	// is only held by this process while it's in use or about to be reused.
+	// @param conn - the connection to the server
+	// @param server_name - this is the type of server
+	static void ReleaseServer(CFrameConnection &conn, const char server_name[]) {
+
+		bool is_alive = false;
+		try {
+			conn.Flush();
+			is_alive = conn.IsAlive();
+		} catch(...) {
+		}
+
+		m_pool_mutex.Acquire();
+		int reset_port = RemoveBeacon(conn.Socket());
+
+		int pool_num = 0;
+		for(int i=0; i<m_pool.Size(); i++) {
+			if(strcmp(m_pool[i].server_name, server_name) == 0) {
+				pool_num++;
+			}
+		}
+
+		if(is_alive == false || reset_port < 0 || pool_num >= MAX_TYPE_POOL_NUM) {
+			m_pool_mutex.Release();
+			conn.CloseConnection();
+			return;
+		}
+
+		SPoolConn pool_conn;
+		pool_conn.socket = conn.Detach();
+		pool_conn.reset_port = reset_port;
+		pool_conn.idle_time = 0;
+		strcpy(pool_conn.server_name, server_name);
+		m_pool.PushBack(pool_conn);
+		m_pool_mutex.Release();
+	}
+
+	// This retrieves a given instance of a server. An idle connection is
+	// used if there is one, otherwise the name server is asked for a free
+	// server until one is handed out or the time allowed has passed.
+	// @param conn - this is used to store the connection to the server
+	// @param server_name - this is the type of server
+	// @param time_out - the number of milliseconds allowed to find a server
+	// @return true if connected to a server, false otherwise
+	static bool ServerInst(CFrameConnection &conn, const char server_name[], int time_out) {
+
+		if(TakePooledServer(conn, server_name) == true) {
+			return true;
+		}
 
 		u_short port;
-		SOCKET ns_sock;
+		char reply[3];
 
 		CStopWatch timer;
 		timer.StartTimer();
-		char is_accept = false;
-		unsigned int uiThread1ID;
 
 		while(true) {
 
 			timer.StopTimer();
+			int remain_time = time_out - (int)(timer.GetElapsedTime() * 1000);
 
-			if(timer.GetElapsedTime() > 2.0f) {
-				PrintTimeOut();
-				exit(0);
-			}
-
-			if(!COpenConnection::OpenClientConnection(ns_sock, m_ns_port, LOCAL_NETWORK)) {
-				exit(0);
+			if(remain_time <= 0) {
+				return false;
 			}
 
-			strcpy(CUtility::SecondTempBuffer(), server_name);
-			COpenConnection::Send(ns_sock, CUtility::SecondTempBuffer(), 20);
-			COpenConnection::Receive(ns_sock, (char *)&is_accept, sizeof(char));
+			NameServerRequest(server_name, NULL, 0, reply, sizeof(reply));
 
-			if(is_accept == false) {
-				COpenConnection::CloseConnection(ns_sock);
-				Sleep(100);
+			if(reply[0] == false) {
+				Sleep(min(remain_time, 100));
 				continue;
 			}
 
-			COpenConnection::Receive(ns_sock, (char *)&port, sizeof(u_short));
-			COpenConnection::CloseConnection(ns_sock);
+			memcpy((char *)&port, reply + 1, sizeof(u_short));
 			
-			if(COpenConnection::OpenClientConnection(socket, port, LOCAL_NETWORK)) {
-				COpenConnection::Receive(socket, (char *)&m_reset_port, sizeof(int));
-				_beginthreadex(NULL, 0, BeaconThread2, &m_reset_port, NULL, &uiThread1ID);
-				break;
+			if(conn.OpenClientConnection(port, LOCAL_NETWORK)) {
+				int reset_port;
+				conn.Receive((char *)&reset_port, sizeof(int));
+				AddBeacon(conn.Socket(), reset_port);
+				return true;
 			}
 		
 			cout<<"Can't Connect "<<server_name<<" "<<port<<endl;
+			return false;
+		}
+	}
+
+	// This retrieves a given instance of a server, the process 
+	// exits if a server can't be found in the time allowed
+	// @param conn - this is used to store the connection to the server
+	// @param server_name - this is the type of server
+	static void ServerInstOrExit(CFrameConnection &conn, const char server_name[]) {
+
+		if(ServerInst(conn, server_name, SERVER_TIME_OUT) == false) {
 			PrintTimeOut();
 			exit(0);
 		}
@@ -119,16 +502,25 @@ class CNameServer {
 	}
 
 	// This spawns the server keep alive thread, to notify servers 
-	// that query instance is still active
+	// that query instance is still active. A single thread beacons 
+	// every server in use by the process, idle pooled servers aren't
+	// sent the beacon and are closed once they've expired.
 	static THREAD_RETURN1 THREAD_RETURN2 BeaconThread2(void *ptr) {
 
 		COpenConnection conn;
-		conn.OpenClientUDPConnection(*(int *)ptr, LOCAL_NETWORK);
+		conn.OpenClientUDPConnection(0, LOCAL_NETWORK);
 		char buff = 'b';
 
 		while(true) {
-			conn.SendUDP(&buff, 1);
-			Sleep(100);
+			m_pool_mutex.Acquire();
+			for(int i=0; i<m_beacon_set.Size(); i++) {
+				conn.FormatUDPClientConnection(m_beacon_set[i].reset_port, LOCAL_NETWORK);
+				conn.SendUDP(&buff, 1);
+			}
+
+			ExpireIdleServers(BEACON_TIME);
+			m_pool_mutex.Release();
+			Sleep(BEACON_TIME);
 		}
 
 		return 0;
@@ -173,6 +565,14 @@ public:
 		ns_port_file.ReadObject(m_keep_alive_time);
 		ns_port_file.CloseFile();
 		m_is_reset = true;
+
+		m_pool.Initialize(16);
+		m_beacon_set.Initialize(16);
+		m_is_beacon_start = false;
+		m_pending.AllocateMemory(MAX_PENDING_NUM);
+		for(int i=0; i<MAX_PENDING_NUM; i++) {
+			m_pending[i].is_used = false;
+		}
 	}
 
 	// This returns the keep alive time
@@ -198,8 +598,9 @@ public:
 	}
 
 	// This sets the server as active
-	static void SetServerActive(COpenConnection &conn) {
+	static void SetServerActive(CFrameConnection &conn) {
 		conn.Send((char *)&m_reset_port, sizeof(int));
+		conn.Flush();
 		CHitItemBlock::SetServerActive();
 
 		m_mutex.Acquire();
@@ -209,47 +610,69 @@ public:
 	}
 
 	// This retrieves an instance of a keyword server
-	static void KeywordServerInst(SOCKET &socket) {
-		ServerInst(socket, "KeywordServer");
+	static void KeywordServerInst(CFrameConnection &conn) {
+		ServerInstOrExit(conn, "KeywordServer");
 	}
 
-	// This retrieves an instance of a retrieve server
-	static void RetrieveServerInst(SOCKET &socket) {
-		ServerInst(socket, "RetrieveServer");
+	// This retrieves an instance of a retrieve server. Unlike the other 
+	// servers the query carries on without it if none is found in time.
+	// @param time_out - the number of milliseconds allowed to find a server
+	// @return true if connected to a server, false otherwise
+	static bool RetrieveServerInst(CFrameConnection &conn, int time_out) {
+		return ServerInst(conn, "RetrieveServer", time_out);
 	}
 
 	// This retrieves an instance of a document server
 	// @param id - this is the id of the retrieve server being request
 	//           - this is one of the N parallel servers
-	static void DocumentServerInst(SOCKET &socket) {
-		ServerInst(socket, "DocumentServer");
+	static void DocumentServerInst(CFrameConnection &conn) {
+		ServerInstOrExit(conn, "DocumentServer");
 	}
 
-	// This retrieves an instance of a document server
-	// @param id - this is the id of the retrieve server being request
-	//           - this is one of the N parallel servers
-	static inline void DocumentServerInst(COpenConnection &conn) {
-		DocumentServerInst(conn.Socket());
+	// This retrieves an instance of a text string server
+	static void TextStringServerInst(CFrameConnection &conn) {
+		ServerInstOrExit(conn, "TextStringServer");
 	}
 
-	// This retrieves an instance of a text string server
-	static void TextStringServerInst(SOCKET &socket) {
-		ServerInst(socket, "TextStringServer");
+	// This retrieves an instance of a expected reward server
+	static void ExpectedRewardServerInst(CFrameConnection &conn) {
+		ServerInstOrExit(conn, "ExpRewServer");
 	}
 
-	// This retrieves an instance of a text string server
-	static inline void TextStringServerInst(COpenConnection &conn) {
-		TextStringServerInst(conn.Socket());
+	// This keeps a keyword server connection for later requests
+	static void ReleaseKeywordServer(CFrameConnection &conn) {
+		ReleaseServer(conn, "KeywordServer");
 	}
 
-	// This retrieves an instance of a text string server
-	static void ExpectedRewardServerInst(SOCKET &socket) {
-		ServerInst(socket, "ExpRewServer");
+	// This keeps a retrieve server connection for later requests
+	static void ReleaseRetrieveServer(CFrameConnection &conn) {
+		ReleaseServer(conn, "RetrieveServer");
 	}
 
-	// This retrieves an instance of a expected reward server
-	static inline void ExpectedRewardServerInst(COpenConnection &conn) {
-		ExpectedRewardServerInst(conn.Socket());
+	// This keeps a document server connection for later requests
+	static void ReleaseDocumentServer(CFrameConnection &conn) {
+		ReleaseServer(conn, "DocumentServer");
+	}
+
+	// This keeps a text string server connection for later requests
+	static void ReleaseTextStringServer(CFrameConnection &conn) {
+		ReleaseServer(conn, "TextStringServer");
+	}
+
+	// This keeps a expected reward server connection for later requests
+	static void ReleaseExpectedRewardServer(CFrameConnection &conn) {
+		ReleaseServer(conn, "ExpRewServer");
+	}
+
+	// This closes a connection to a server instead of keeping it for later
+	// requests, used when a request was abandoned part way through
+	// @param conn - the connection to the server
+	static void CloseServer(CFrameConnection &conn) {
+
+		m_pool_mutex.Acquire();
+		RemoveBeacon(conn.Socket());
+		m_pool_mutex.Release();
+		conn.CloseConnection();
 	}
 
 	// This frees a given instance of a server back to the name server
@@ -260,23 +683,16 @@ public:
 	// This frees a given instance of a server back to the name server
 	static void FreeServer(u_short port, bool is_destroy = false) {
 
-		COpenConnection conn;
-		if(conn.OpenClientConnection(m_ns_port, LOCAL_NETWORK) == false) {
-			exit(0);
-		}
-
+		char arg[sizeof(int) + sizeof(u_short)];
 		int server_type_id = CNameServerStat::GetServerTypeID();
+		memcpy(arg, (char *)&server_type_id, sizeof(int));
+		memcpy(arg + sizeof(int), (char *)&port, sizeof(u_short));
 
 		if(is_destroy == false) {
-			strcpy(CUtility::SecondTempBuffer(), "FreeServer");
+			NameServerRequest("FreeServer", arg, sizeof(arg), NULL, 0);
 		} else {
-			strcpy(CUtility::SecondTempBuffer(), "DestroyServer");
+			NameServerRequest("DestroyServer", arg, sizeof(arg), NULL, 0);
 		}
-
-		conn.Send(CUtility::SecondTempBuffer(), 20);
-		conn.Send((char *)&server_type_id, sizeof(int));
-		conn.Send((char *)&port, sizeof(u_short));
-		conn.CloseConnection();
 	}
 
 };
@@ -286,4 +702,13 @@ bool CNameServer::m_is_reset;
 int CNameServer::m_reset_port;
 int CNameServer::m_time_out;
 COpenConnection CNameServer::m_beacon_conn;
+CFrameConnection CNameServer::m_ns_conn;
+int CNameServer::m_ns_epoch;
+CMutex CNameServer::m_ns_mutex;
+CMutex CNameServer::m_ns_read_mutex;
+CMemoryChunk<CNameServer::SPendingRequest> CNameServer::m_pending;
+CArrayList<CNameServer::SPoolConn> CNameServer::m_pool;
+CArrayList<CNameServer::SBeacon> CNameServer::m_beacon_set;
+bool CNameServer::m_is_beacon_start;
+CMutex CNameServer::m_pool_mutex;
 int CNameServer::m_keep_alive_time;
@@ -0,0 +1,313 @@
+#include "../DocumentDatabase.h"
+
+// This class is responsible for recording how long each stage of a query
+// takes in every server the query passes through. The front end assigns
+// each query an id which is sent to a server straight after the request
+// name, so the spans recorded by the different servers for the same query
+// can be matched up. Spans are written to a fixed size ring so recording
+// never allocates. Every so many requests the spans added since the last
+// write are appended to query_trace.json in the chrome trace array format
+// (chrome://tracing), which allows the closing bracket to be left off. 
+// Every server on a machine appends to the same file with a single write
+// so the file holds one trace for every process. Timestamps are wall clock.
+class CQueryTrace {
+
+	// This defines the number of spans held in the ring
+	static const int RING_SIZE = 1 << 14;
+	// This defines the number of requests between writing the trace
+	static const int FLUSH_INTERVAL = 256;
+
+	// This stores one of the recorded spans
+	struct SSpan {
+		// This stores the id of the query
+		_int64 query_id;
+		// This stores the start time in microseconds
+		_int64 start;
+		// This stores the duration in microseconds
+		int duration;
+		// This stores the thread that recorded the span
+		int thread_id;
+		// This stores the stage
+		int span_type;
+	};
+
+	// This stores the ring of spans
+	static CMemoryChunk<SSpan> m_span_ring;
+	// This stores the number of spans recorded
+	static _int64 m_span_num;
+	// This stores the number of spans recorded when the trace was last written
+	static _int64 m_flush_num;
+	// This stores the trace events being written
+	static CArrayList<char> m_trace_buff;
+	// This stores the id of the query being processed
+	static _int64 m_query_id;
+	// This stores the number of queries started by this process
+	static int m_query_num;
+	// This stores the number of requests since the trace was written
+	static int m_request_num;
+	// This stores the number of threads that have recorded a span
+	static int m_thread_num;
+	// This stores the id of the calling thread, 0 if not yet assigned
+	static THREAD_LOCAL int m_thread_id;
+	// This stores the name of the server
+	static char m_process_name[64];
+	// This protects the ring
+	static CMutex m_mutex;
+
+public:
+
+	// These define the different stages of a query
+	static const int QUERY = 0;
+	static const int WORD_LOOKUP = 1;
+	static const int RETRIEVE = 2;
+	static const int HIT_SEARCH = 3;
+	static const int RANK = 4;
+	static const int EXPECTED_REWARD = 5;
+	static const int BRANCH_AND_BOUND = 6;
+	static const int DOC_ID_LOOKUP = 7;
+	static const int RENDER = 8;
+	static const int DOCUMENT_FETCH = 9;
+	static const int SUMMARY = 10;
+	static const int SPAN_TYPE_NUM = 11;
+
+	CQueryTrace() {
+	}
+
+	// This allocates the ring, spans are only recorded once this
+	// has been called
+	// @param process_name - the name of the server shown in the trace
+	static void Initialize(const char process_name[]) {
+
+		strncpy(m_process_name, process_name, sizeof(m_process_name) - 1);
+		m_process_name[sizeof(m_process_name) - 1] = '\0';
+
+		m_mutex.Acquire();
+		m_span_ring.AllocateMemory(RING_SIZE);
+		m_trace_buff.Initialize(4096);
+		m_span_num = 0;
+		m_flush_num = 0;
+		m_request_num = 0;
+		m_mutex.Release();
+	}
+
+	// This returns the id of this process
+	inline static int ProcessID() {
+#ifdef OS_WINDOWS
+		return (int)GetCurrentProcessId();
+#else
+		return (int)getpid();
+#endif
+	}
+
+	// This returns the current time in microseconds
+	static _int64 Time() {
+
+#ifdef OS_WINDOWS
+		FILETIME time;
+		GetSystemTimeAsFileTime(&time);
+		_int64 ticks = ((_int64)time.dwHighDateTime << 32) | time.dwLowDateTime;
+		// convert from 100ns intervals since 1601 to the unix epoch
+		return ticks / 10 - 11644473600000000LL;
+#else
+		struct timeval time;
+		gettimeofday(&time, NULL);
+		return (_int64)time.tv_sec * 1000000 + time.tv_usec;
+#endif
+	}
+
+	// This assigns a new id to the query about to be processed. The id
+	// is made up of the time, the process id and a count so that the
+	// different front end processes never hand out the same id.
+	// @return the query id
+	static _int64 BeginQuery() {
+
+		m_query_num++;
+		m_query_id = ((_int64)(time(NULL) & 0xFFFFF) << 40) |
+			((_int64)(ProcessID() & 0xFFFF) << 24) | (m_query_num & 0xFFFFFF);
+
+		return m_query_id;
+	}
+
+	// This returns the id of the query being processed
+	inline static _int64 QueryID() {
+		return m_query_id;
+	}
+
+	// This sets the id of the query being processed
+	inline static void SetQueryID(_int64 query_id) {
+		m_query_id = query_id;
+	}
+
+	// This sends the query id to a server, this must follow the request name
+	// @param conn - the connection to the server
+	static void SendQueryID(CFrameConnection &conn) {
+		conn.Send((char *)&m_query_id, sizeof(_int64));
+	}
+
+	// This receives the query id sent by the client
+	// @param conn - the connection to the client
+	static void ReceiveQueryID(CFrameConnection &conn) {
+		conn.Receive((char *)&m_query_id, sizeof(_int64));
+	}
+
+	// This records a span for the current query
+	// @param span_type - the stage being recorded
+	// @param start - the start time in microseconds
+	// @param end - the end time in microseconds
+	static void AddSpan(int span_type, _int64 start, _int64 end) {
+
+		if(m_span_ring.OverflowSize() == 0) {
+			return;
+		}
+
+		m_mutex.Acquire();
+		if(m_thread_id == 0) {
+			m_thread_id = ++m_thread_num;
+		}
+
+		SSpan &span = m_span_ring[(int)(m_span_num % RING_SIZE)];
+		span.query_id = m_query_id;
+		span.start = start;
+		span.duration = (int)(end - start);
+		span.thread_id = m_thread_id;
+		span.span_type = span_type;
+		m_span_num++;
+		m_mutex.Release();
+	}
+
+	// This is called once a request has been handled, the trace
+	// is written out every FLUSH_INTERVAL requests
+	static void EndRequest() {
+
+		if(++m_request_num < FLUSH_INTERVAL) {
+			return;
+		}
+
+		m_request_num = 0;
+		Flush();
+	}
+
+	// This appends the spans recorded since the last write to the trace
+	// file. Spans that were overwritten in the ring before they could be
+	// written are lost, the number lost is recorded in the trace.
+	static void Flush() {
+
+		static const char *span_name[] = {"query", "word_lookup", "retrieve",
+			"hit_search", "rank", "expected_reward", "branch_and_bound",
+			"doc_id_lookup", "render", "document_fetch", "summary"};
+
+		if(m_span_ring.OverflowSize() == 0) {
+			return;
+		}
+
+		m_mutex.Acquire();
+		int span_num = (int)min(m_span_num - m_flush_num, (_int64)RING_SIZE);
+		int lost_num = (int)(m_span_num - m_flush_num - span_num);
+		int first_span = (int)((m_span_num - span_num) % RING_SIZE);
+		CMemoryChunk<SSpan> span_set(max(span_num, 1));
+		for(int i=0; i<span_num; i++) {
+			span_set[i] = m_span_ring[(first_span + i) % RING_SIZE];
+		}
+		m_flush_num = m_span_num;
+		m_mutex.Release();
+
+		if(span_num == 0) {
+			return;
+		}
+
+		FILE *file_ptr = fopen("query_trace.json", "a");
+		if(file_ptr == NULL) {
+			return;
+		}
+
+		// unbuffered so the events go out in a single write
+		setvbuf(file_ptr, NULL, _IONBF, 0);
+
+		char event[256];
+		int pid = ProcessID();
+		m_trace_buff.Resize(0);
+		fseek(file_ptr, 0, SEEK_END);
+		if(ftell(file_ptr) == 0) {
+			m_trace_buff.CopyBufferToArrayList("[\n", 2, 0);
+		}
+
+		int len = sprintf(event, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+			"\"args\":{\"name\":\"%s\",\"lost_spans\":%d}},\n", pid, m_process_name, lost_num);
+		m_trace_buff.CopyBufferToArrayList(event, len, m_trace_buff.Size());
+
+		for(int i=0; i<span_num; i++) {
+			SSpan &span = span_set[i];
+			len = sprintf(event, "{\"name\":\"%s\",\"cat\":\"query\",\"ph\":\"X\","
+				"\"ts\":%lld,\"dur\":%d,\"pid\":%d,\"tid\":%d,\"args\":{\"query\":\"%lld\"}},\n",
+				span_name[span.span_type], (long long)span.start, span.duration,
+				pid, span.thread_id, (long long)span.query_id);
+
+			m_trace_buff.CopyBufferToArrayList(event, len, m_trace_buff.Size());
+		}
+
+		fwrite(m_trace_buff.Buffer(), sizeof(char), m_trace_buff.Size(), file_ptr);
+		fclose(file_ptr);
+	}
+};
+const int CQueryTrace::RING_SIZE;
+const int CQueryTrace::FLUSH_INTERVAL;
+const int CQueryTrace::QUERY;
+const int CQueryTrace::WORD_LOOKUP;
+const int CQueryTrace::RETRIEVE;
+const int CQueryTrace::HIT_SEARCH;
+const int CQueryTrace::RANK;
+const int CQueryTrace::EXPECTED_REWARD;
+const int CQueryTrace::BRANCH_AND_BOUND;
+const int CQueryTrace::DOC_ID_LOOKUP;
+const int CQueryTrace::RENDER;
+const int CQueryTrace::DOCUMENT_FETCH;
+const int CQueryTrace::SUMMARY;
+const int CQueryTrace::SPAN_TYPE_NUM;
+
+CMemoryChunk<CQueryTrace::SSpan> CQueryTrace::m_span_ring;
+_int64 CQueryTrace::m_span_num = 0;
+_int64 CQueryTrace::m_flush_num = 0;
+CArrayList<char> CQueryTrace::m_trace_buff;
+_int64 CQueryTrace::m_query_id = 0;
+int CQueryTrace::m_query_num = 0;
+int CQueryTrace::m_request_num = 0;
+int CQueryTrace::m_thread_num = 0;
+THREAD_LOCAL int CQueryTrace::m_thread_id = 0;
+char CQueryTrace::m_process_name[64];
+CMutex CQueryTrace::m_mutex;
+
+// This records a single span, timing starts when the span is created
+// and the span is recorded when it's finished or goes out of scope
+class CTraceSpan {
+
+	// This stores the stage being timed
+	int m_span_type;
+	// This stores the start time in microseconds
+	_int64 m_start;
+	// This is true once the span has been recorded
+	bool m_is_finished;
+
+public:
+
+	// @param span_type - the stage being timed
+	CTraceSpan(int span_type) {
+		m_span_type = span_type;
+		m_start = CQueryTrace::Time();
+		m_is_finished = false;
+	}
+
+	// This records the span if it hasn't already been recorded
+	void Finish() {
+
+		if(m_is_finished == true) {
+			return;
+		}
+
+		m_is_finished = true;
+		CQueryTrace::AddSpan(m_span_type, m_start, CQueryTrace::Time());
+	}
+
+	~CTraceSpan() {
+		Finish();
+	}
+};
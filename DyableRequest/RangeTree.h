@@ -704,7 +704,7 @@ public:
 	// to evict an ab_node if there is no free memory.
 	// @param conn - this stores the connection to the query server
 	// @return the pointer to the root ab_node
-	SABTreeNode *AddABNode(COpenConnection &conn) {
+	SABTreeNode *AddABNode(CFrameConnection &conn) {
 		
 		static u_short tree_id;
 		static _int64 byte_offset;
@@ -174,7 +174,7 @@ class CCompileRankedList {
 	}
 
 	// This sends one of the document results to the query server
-	inline void SendDocumentRes(COpenConnection &conn, SDocument &doc) {
+	inline void SendDocumentRes(CFrameConnection &conn, SDocument &doc) {
 
 		CalculateCheckSum(doc);
 		FindTitleHitNum(doc);
@@ -281,7 +281,7 @@ public:
 
 	// This sends the search results to the query server
 	// @param max_unique_words - this is the maximum number of hits in a doucment
-	void SendSearchResults(COpenConnection &conn, int max_unique_words) {
+	void SendSearchResults(CFrameConnection &conn, int max_unique_words) {
 
 		SQueryRes res;
 		SDocumentPtr doc_ptr;
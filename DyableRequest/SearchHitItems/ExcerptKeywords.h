@@ -43,7 +43,7 @@ class CExcerptKeywords {
 	// This function retrieves the next sequential word id in the excerpt
 	// @param byte_offset - this is the byte offset of the keyword set being processed
 	// @param tree_id - this is the id of the keyword set being processed
-	inline void RetrieveExcerptWordID(_int64 &byte_offset, int tree_id, COpenConnection &conn) {
+	inline void RetrieveExcerptWordID(_int64 &byte_offset, int tree_id, CFrameConnection &conn) {
 
 		static CMemoryChunk<char> ab_buff(sizeof(S5Byte));
 		CByte::KeywordBytes(tree_id, ab_buff.Buffer(), sizeof(S5Byte), byte_offset);
@@ -68,7 +68,7 @@ public:
 	//                  - the hit positions in the document
 	// @return true if not a duplicate excerpt, false otherwise
 	bool AddExcerptKeywords(_int64 byte_offset, int tree_id,
-		_int64 &check_sum, COpenConnection &conn) {
+		_int64 &check_sum, CFrameConnection &conn) {
 
 		static int enc_bytes;
 		static CMemoryChunk<char> ab_buff(11);
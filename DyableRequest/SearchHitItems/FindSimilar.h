@@ -60,7 +60,7 @@ public:
 	// This retrieves the set of global keywords that have a high association
 	// to the query supplied by the user. This terms are checked for existence
 	// in each fo the excerpts being searched.
-	void RetreiveKeywordSet(COpenConnection &conn) {
+	void RetreiveKeywordSet(CFrameConnection &conn) {
 	}
 
 	// This adds the excerpt keywords that belong to a particular document
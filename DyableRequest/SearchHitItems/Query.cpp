@@ -10,6 +10,13 @@ class CParseQuery : public CNodeStat {
 	CSearchHitItems m_search_hit_item;
 	// This stores the tcp connection
 	COpenConnection m_conn;
+	// This dispatches requests to the worker, a server handles
+	// one query at a time so only a single worker is used
+	CReactor m_reactor;
+	// This stores the port the server is listening on
+	u_short m_listen_port;
+	// This stores the number of requests handled
+	int m_request_num;
 	
 	// This is used for performance profiling
 	CStopWatch m_timer;
@@ -18,7 +25,7 @@ class CParseQuery : public CNodeStat {
 	// This retrieves the word id set from the user and searches for hits that 
 	// that match the query. This is done using the heuristic search.
 	// @param inst_conn - this stores the connection tot the client
-	void SearchForQuery(COpenConnection &inst_conn) {
+	void SearchForQuery(CFrameConnection &inst_conn) {
 
 		SWordItem word;
 		int query_term_num;
@@ -42,7 +49,7 @@ class CParseQuery : public CNodeStat {
 
 	// This performs a complete query.
 	// @param inst_conn - this stores the connection tot the client
-	void FullQuery(COpenConnection &inst_conn) {
+	void FullQuery(CFrameConnection &inst_conn) {
 
 		int it_num;
 		int client_id = 0;
@@ -59,6 +66,7 @@ class CParseQuery : public CNodeStat {
 
 		inst_conn.Receive((char *)&it_num, sizeof(int));
 
+		CTraceSpan span(CQueryTrace::HIT_SEARCH);
 		m_timer.StartTimer();
 		m_search_hit_item.PerformSearch(inst_conn, it_num);
 		m_timer.StopTimer();
@@ -110,7 +118,7 @@ public:
 
 		CByte::Initialize(256, 256);
 
-		COpenConnection conn;
+		CFrameConnection conn;
 		int it_num = 100000;
 
 		m_timer.StartTimer();
@@ -119,17 +127,42 @@ public:
 	}
 
 	// This handles the query case that is being requested
-	void HandleQueryCase(COpenConnection &inst_conn) {
+	void HandleQueryCase(CFrameConnection &inst_conn) {
 
 		inst_conn.Receive(CUtility::SecondTempBuffer(), 20);
 
 		if(CUtility::FindFragment(CUtility::SecondTempBuffer(), "Query")) {
 			cout<<"Query-------------------"<<endl;
+			CQueryTrace::ReceiveQueryID(inst_conn);
 			Reset();
 			FullQuery(inst_conn);
 		}
-		
-		inst_conn.CloseConnection();
+	}
+
+	// This is called by the worker once a client has connected, requests
+	// are handled until the client closes the connection
+	static bool HandleConnection(SOCKET &socket, void *ptr) {
+
+		CParseQuery *this_ptr = (CParseQuery *)ptr;
+
+		try {
+			CFrameConnection conn(socket);
+			cout<<"Search Hit Items Accepted A Connection "<<this_ptr->m_listen_port<<endl;
+			CNameServer::SetServerActive(conn);
+
+			while(true) {
+				this_ptr->HandleQueryCase(conn);
+				CQueryTrace::EndRequest();
+				if(++this_ptr->m_request_num >= CNameServer::KeepAliveTime()) {
+					this_ptr->m_reactor.Stop();
+					break;
+				}
+			}
+		} catch(...) {
+		}
+
+		CNameServer::FreeServer(this_ptr->m_listen_port);
+		return false;
 	}
 
 	// This is the entry function that processes requests from
@@ -141,32 +174,26 @@ public:
 		CByte::Initialize(256, CNodeStat::GetHashDivNum());
 
 		CUtility::RandomizeSeed();
-		u_short listen_port = (rand() % 40000) + 10000;
-		while(m_conn.OpenServerConnection(listen_port, LOCAL_NETWORK) == false) {
-			listen_port = (rand() % 40000) + 10000;
+		m_listen_port = (rand() % 40000) + 10000;
+		while(m_conn.OpenServerConnection(m_listen_port, LOCAL_NETWORK) == false) {
+			m_listen_port = (rand() % 40000) + 10000;
 		}
 
 		CNameServer::Initialize();
 		CNameServer::InitializeServerThread();
+		CQueryTrace::Initialize("Retrieve Server");
 		
-		cout<<"Search Hit Items Listening "<<listen_port<<endl;
+		cout<<"Search Hit Items Listening "<<m_listen_port<<endl;
 		m_conn.ListenOnServerConnection(INFINITE);
 
-		CNameServer::FreeServer(listen_port);
+		CNameServer::FreeServer(m_listen_port);
 
-		for(int i=0; i<CNameServer::KeepAliveTime(); i++) {
-			try {
-				COpenConnection conn(m_conn.ServerAcceptConnection());
-				cout<<"Search Hit Items Accepted A Connection "<<listen_port<<endl;
-				CNameServer::SetServerActive(conn);
-				HandleQueryCase(conn);
-			} catch(...) {
-			}
-
-			CNameServer::FreeServer(listen_port);
-		}
+		m_request_num = 0;
+		// the reset port is sent as soon as a query connects
+		m_reactor.Initialize(m_conn.Socket(), 1, HandleConnection, this, true);
+		m_reactor.Run();
 
-		CNameServer::DestroyServer(listen_port);
+		CNameServer::DestroyServer(m_listen_port);
 
 	}
 
@@ -187,9 +214,16 @@ int main(int argc, char* argv[])
 	} 
 
 	if(argc < 2) return 0;
-	int server_type_id = atoi(argv[1]);
 	CNodeStat::SetHashDivNum(256);
 
+	// this is run once after the index build instead of serving queries
+	if(argc >= 3 && strcmp(argv[1], "FlattenIndexes") == 0) {
+		CByte::CreateFlatIndexes(atoi(argv[2]));
+		return 0;
+	}
+
+	int server_type_id = atoi(argv[1]);
+
 	CParseQuery query;
 	query.ProcessClientRequests(server_type_id);
 
@@ -318,7 +318,7 @@ class CSearchHitItems : public CGroupHitItemsSpatially {
 	// This sends information relating to a particular ab_node to the query server
 	// so the search space can be duplicated.
 	// @param region - the current priority region being processed
-	void SendABNodeInfo(COpenConnection &conn, SPriorityRegion &region) {
+	void SendABNodeInfo(CFrameConnection &conn, SPriorityRegion &region) {
 
 		conn.Send((char *)&region.tree_level, sizeof(uChar));
 		SHitSegment *hit_seg_ptr = region.hit_seg_ptr;
@@ -341,7 +341,7 @@ class CSearchHitItems : public CGroupHitItemsSpatially {
 	// search space the level of parallelization is increased by a factor of two.
 	// To subdivide the search space the top N nodes are subdivided equal amongst
 	// two parallel seach streams. 
-	void SubdivideSearchNodes(COpenConnection &conn) {
+	void SubdivideSearchNodes(CFrameConnection &conn) {
 
 		int max_search_num = min(m_hit_queue.Size() >> 1, MAX_TRAN_NODE_NUM);
 
@@ -446,7 +446,7 @@ public:
 	// @param doc_sub_size - this is the number of high priority documents
 	//                     - to compile once the searching process is finished
 	// @param max_it - this is the maximum number of iterations
-	void PerformSearch(COpenConnection &conn, int max_it) {
+	void PerformSearch(CFrameConnection &conn, int max_it) {
 
 		CreateWordIDSet();
 		m_max_word_div_num = 0;
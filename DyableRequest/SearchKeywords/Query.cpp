@@ -7,6 +7,13 @@ class CParseQuery : public CNodeStat {
 
 	// This stores the tcp connection
 	COpenConnection m_conn;
+	// This dispatches requests to the worker, a server handles
+	// one query at a time so only a single worker is used
+	CReactor m_reactor;
+	// This stores the port the server is listening on
+	u_short m_listen_port;
+	// This stores the number of requests handled
+	int m_request_num;
 	// This is used to compile the keyword set for each document
 	CSearchKeywords m_keywords;
 	// This is used for performance profiling
@@ -19,7 +26,7 @@ class CParseQuery : public CNodeStat {
 
 	// This performs a complete query.
 	// @param inst_conn - this stores the connection tot the client
-	void HandleQueryCase(COpenConnection &inst_conn) {
+	void HandleQueryCase(CFrameConnection &inst_conn) {
 
 
 		m_keywords.Initialize(inst_conn);
@@ -28,6 +35,31 @@ class CParseQuery : public CNodeStat {
 		m_keywords.CompileSearchResults(inst_conn);
 	}
 
+	// This is called by the worker once a client has connected, requests
+	// are handled until the client closes the connection
+	static bool HandleConnection(SOCKET &socket, void *ptr) {
+
+		CParseQuery *this_ptr = (CParseQuery *)ptr;
+
+		try {
+			CFrameConnection conn(socket);
+			cout<<"Search Keywords Accepted A Connection "<<this_ptr->m_listen_port<<endl;
+			CNameServer::SetServerActive(conn);
+
+			while(true) {
+				this_ptr->HandleQueryCase(conn);
+				if(++this_ptr->m_request_num >= CNameServer::KeepAliveTime()) {
+					this_ptr->m_reactor.Stop();
+					break;
+				}
+			}
+		} catch(...) {
+		}
+
+		CNameServer::FreeServer(this_ptr->m_listen_port);
+		return false;
+	}
+
 public:
 
 	CParseQuery() {
@@ -42,32 +74,25 @@ public:
 		CByte::Initialize(256, CNodeStat::GetHashDivNum());
 
 		CUtility::RandomizeSeed();
-		u_short listen_port = (rand() % 40000) + 10000;
-		while(m_conn.OpenServerConnection(listen_port, LOCAL_NETWORK) == false) {
-			listen_port = (rand() % 40000) + 10000;
+		m_listen_port = (rand() % 40000) + 10000;
+		while(m_conn.OpenServerConnection(m_listen_port, LOCAL_NETWORK) == false) {
+			m_listen_port = (rand() % 40000) + 10000;
 		}
 
 		CNameServer::Initialize();
 		CNameServer::InitializeServerThread();
 
-		cout<<"Search Keywords Listening "<<listen_port<<endl;
+		cout<<"Search Keywords Listening "<<m_listen_port<<endl;
 		m_conn.ListenOnServerConnection(INFINITE);
 
-		CNameServer::FreeServer(listen_port);
-		
-		for(int i=0; i<CNameServer::KeepAliveTime(); i++) {
-			try {
-				COpenConnection conn(m_conn.ServerAcceptConnection());
-				cout<<"Search Keywords Accepted A Connection "<<listen_port<<endl;
-				CNameServer::SetServerActive(conn);
-				HandleQueryCase(conn);
-			} catch(...) {
-			}
+		CNameServer::FreeServer(m_listen_port);
 
-			CNameServer::FreeServer(listen_port);
-		}
+		m_request_num = 0;
+		// the reset port is sent as soon as a query connects
+		m_reactor.Initialize(m_conn.Socket(), 1, HandleConnection, this, true);
+		m_reactor.Run();
 
-		CNameServer::DestroyServer(listen_port);
+		CNameServer::DestroyServer(m_listen_port);
 	}
 
 	// This resets the entire system ready for the next query
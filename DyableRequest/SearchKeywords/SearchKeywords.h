@@ -278,7 +278,7 @@ public:
 	}
 
 	// This adds the set of documents to the set
-	void Initialize(COpenConnection &conn) {
+	void Initialize(CFrameConnection &conn) {
 
 		int num;
 		conn.Receive((char *)&num, sizeof(int));
@@ -353,7 +353,7 @@ public:
 	}
 
 	// This sends the set of search results along with the keyword set to the query server
-	void CompileSearchResults(COpenConnection &conn) {
+	void CompileSearchResults(CFrameConnection &conn) {
 
 		m_doc_buff.Resize(m_doc_size);
 
@@ -44,6 +44,7 @@ class CSortHitList : public CNodeStat {
 	void MergeHitItems(CHDFSFile &hit_list_file) {
 
 		int count = 0;
+		hit_list_file.SetReadAhead(true);
 		SHitItem hit_item;
 		while(hit_item.ReadHitDocOrder(hit_list_file)) {
 
@@ -137,6 +138,8 @@ int main(int argc, char *argv [])
 	
 	cout<<"Client "<<sort_div<<endl;
 	CBeacon::InitializeBeacon(sort_div, 2222);
+	CExternalMerge::SetSortThreadNum(CCompBlockPool::ProcessorNum());
+	CExternalMerge::SetSortMemorySize(1 << 26);
 	CMemoryElement<CSortHitList> hit_list_div;
 	hit_list_div->SortHitList(sort_div, client_num);
 	hit_list_div.DeleteMemoryElement();
@@ -12,6 +12,8 @@ class CCommunication : public CNodeStat {
 	static int m_wave_pass_inst;
 	// This stores the number of wave pass classes
 	static int m_wave_pass_class;
+	// This stores the maximum number of processes run at once
+	static int m_max_process_num;
 
 public:
 
@@ -23,6 +25,17 @@ public:
 		return m_process_set;
 	}
 
+	// This sets the maximum number of processes run at once
+	static void SetMaximumProcessNum(int max_process_num) {
+		m_max_process_num = max_process_num;
+		m_process_set.SetMaximumClientNum(max_process_num);
+	}
+
+	// This returns the maximum number of processes run at once
+	static inline int MaximumProcessNum() {
+		return m_max_process_num;
+	}
+
 	// This sets the wave pass statistics
 	void SetWavePass(int wave_pass_inst, int class_num) {
 		m_wave_pass_inst = wave_pass_inst;
@@ -41,4 +54,5 @@ public:
 };
 CProcessSet CCommunication::m_process_set;
 int CCommunication::m_wave_pass_inst;
-int CCommunication::m_wave_pass_class;
\ No newline at end of file
+int CCommunication::m_wave_pass_class;
+int CCommunication::m_max_process_num = 1;
\ No newline at end of file
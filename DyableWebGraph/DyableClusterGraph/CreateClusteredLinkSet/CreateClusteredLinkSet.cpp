@@ -21,6 +21,8 @@ class CCreateClusteredLinkSet : public CNodeStat {
 	CHDFSFile m_bin_link_set_file;
 	// This stores the clustered link set 
 	CHDFSFile m_clus_link_file;
+	// This is used to encode each link cluster
+	CLinkClusterCodec m_link_cluster;
 	// This stores all the back class distribution
 	CHDFSFile m_back_set_file;
 
@@ -95,19 +97,19 @@ class CCreateClusteredLinkSet : public CNodeStat {
 				curr_ptr = curr_ptr->next_ptr;
 			}
 
-			m_clus_link_file.AddEscapedItem(m_dst_buff.Size());
-			m_clus_link_file.WriteCompObject(src);
+			m_link_cluster.Reset(src);
 			AssignBackBuffDist(src);
 
 			for(int i=0; i<m_dst_buff.Size(); i++) {
-				m_clus_link_file.WriteCompObject(m_dst_buff[i]);
 				m_link_weight_buff[i] /= m_net_link_weight;
 
 				// larger clusters have greater influence
 				m_link_weight_buff[i] *= m_dst_buff.Size();
-				m_clus_link_file.WriteCompObject(m_link_weight_buff[i]);
+				m_link_cluster.AddLink(m_dst_buff[i], m_link_weight_buff[i]);
 			}
 
+			m_link_cluster.WriteLinkCluster(m_clus_link_file);
+
 			m_dst_buff.Resize(0);
 			m_link_weight_buff.Resize(0);
 		}
@@ -78,6 +78,8 @@ class CCreateLinkSet : public CNodeStat {
 	CHDFSFile m_keyword_link_set;
 	// This stores the set of webgraph links
 	CHDFSFile m_webgraph_link_set;
+	// This is used to decode each link cluster
+	CLinkClusterCodec m_link_cluster;
 
 	// This stores the new link set
 	CHDFSFile m_curr_link_set;
@@ -199,16 +201,15 @@ class CCreateLinkSet : public CNodeStat {
 	// @param is_keyword_link - true if a keyword link is being processed
 	bool ProcessLinkCluster(CHDFSFile &link_set_file, SWLink &w_link, bool is_keyword_link) {
 
-		static uLong cluster_size;
-		if(link_set_file.GetEscapedItem(cluster_size) < 0) {
+		if(m_link_cluster.ReadLinkCluster(link_set_file) == false) {
 			return false;
 		}
 
-		link_set_file.ReadCompObject(w_link.src);
+		w_link.src = m_link_cluster.Src();
 
-		for(uLong i=0; i<cluster_size; i++) {
-			link_set_file.ReadCompObject(w_link.dst);
-			link_set_file.ReadCompObject(w_link.link_weight);
+		for(int i=0; i<m_link_cluster.LinkNum(); i++) {
+			w_link.dst = m_link_cluster.Dst(i);
+			w_link.link_weight = m_link_cluster.LinkWeight(i);
 
 			if(w_link.link_weight < 0) {
 				cout<<"Neg Link";getchar();
@@ -106,6 +106,11 @@ c = 1;
 	void CreateHiearchy(int wave_pass_cycles, int max_child_num, 
 		int top_level_node_num, bool is_test) {
 
+		if(is_test == true) {
+			CTestClassVector test0;
+			test0.TestClassVector();
+		}
+
 		_int64 link_num = CNodeStat::GetGlobalLinkNum();
 		while(CNodeStat::GetCurrNodeNum() > 1000) {
 
@@ -152,7 +157,7 @@ public:
 		CNodeStat::SetInstNum(inst_num);
 		CNodeStat::SetHashDivNum(hash_div_num);
 		ProcessSet().SetPort(5555 + inst_id);
-		ProcessSet().SetMaximumClientNum(max_process_num);
+		CCommunication::SetMaximumProcessNum(max_process_num);
 		CMapReduce::SetMaximumProcessNum(max_process_num);
 		CNodeStat::LoadNodeLinkStat();
 
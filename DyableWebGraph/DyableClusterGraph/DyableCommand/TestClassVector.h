@@ -0,0 +1,251 @@
+#include "../../Communication.h"
+
+// This is used to test the wave pass class vector kernels against the
+// scalar loops they replaced. A random hash division is built in memory
+// and the distribution of every node is passed along its links and then
+// updated, once with the scalar loops and once with CClassVector. This
+// is done for a small and a large number of classes. The results must
+// agree and the time taken by each is reported.
+class CTestClassVector {
+
+	// This defines the number of nodes in the hash division
+	static const int NODE_NUM = 1 << 18;
+	// This defines the number of links passed to each node
+	static const int LINK_NUM = 8;
+	// This defines one in every how many nodes is left unlinked
+	static const int UNLINKED_NODE = 16;
+	// This defines the number of times each kernel is run
+	static const int RUN_NUM = 4;
+
+	// This stores the offset of the first link of each dst node
+	CMemoryChunk<int> m_dst_offset;
+	// This stores the src node of each link
+	CMemoryChunk<int> m_link_src;
+	// This stores the weight of each link
+	CMemoryChunk<float> m_link_weight;
+
+	// This returns a random node, rand is only relied upon for 15 bits
+	inline int RandNode() {
+		return (((rand() & 0x7FFF) << 15) | (rand() & 0x7FFF)) % NODE_NUM;
+	}
+
+	// This creates the random hash division
+	void CreateDivision() {
+
+		m_dst_offset.AllocateMemory(NODE_NUM + 1);
+		m_link_src.AllocateMemory(NODE_NUM * LINK_NUM);
+		m_link_weight.AllocateMemory(NODE_NUM * LINK_NUM);
+
+		int link_num = 0;
+		for(int i=0; i<NODE_NUM; i++) {
+			m_dst_offset[i] = link_num;
+			if((i % UNLINKED_NODE) == 0) {
+				continue;
+			}
+
+			for(int j=0; j<LINK_NUM; j++) {
+				m_link_src[link_num] = RandNode();
+				m_link_weight[link_num] = (float)((rand() % 1000) + 1) / 1000;
+				link_num++;
+			}
+		}
+
+		m_dst_offset[NODE_NUM] = link_num;
+	}
+
+	// This creates a random distribution for each node
+	void CreateDistribution(CMemoryChunk<float> &dist, int class_num) {
+
+		dist.AllocateMemory(NODE_NUM * class_num);
+		for(int i=0; i<dist.OverflowSize(); i++) {
+			dist[i] = (float)((rand() % 1000) + 1) / 1000;
+		}
+
+		for(int i=0; i<NODE_NUM; i++) {
+			CMath::NormalizeVector(dist.Buffer() + (i * class_num), class_num);
+		}
+	}
+
+	// This passes the distribution along each link a class at a time
+	void ScalarMultiply(const float src_dist[], float dst_dist[], int class_num) {
+
+		for(int i=0; i<NODE_NUM; i++) {
+			float *dst = dst_dist + (i * class_num);
+			for(int j=m_dst_offset[i]; j<m_dst_offset[i+1]; j++) {
+				const float *src = src_dist + (m_link_src[j] * class_num);
+				for(int k=0; k<class_num; k++) {
+					dst[k] += src[k] * m_link_weight[j];
+				}
+			}
+		}
+	}
+
+	// This passes the distribution along each link using the kernel
+	void VectorMultiply(const float src_dist[], float dst_dist[], int class_num) {
+
+		for(int i=0; i<NODE_NUM; i++) {
+			float *dst = dst_dist + (i * class_num);
+			for(int j=m_dst_offset[i]; j<m_dst_offset[i+1]; j++) {
+				CClassVector::ScaleAdd(dst, src_dist + (m_link_src[j] * class_num),
+					m_link_weight[j], class_num);
+			}
+		}
+	}
+
+	// This updates the distribution of each linked node a node at a time
+	void ScalarUpdate(float dist[], float acc_dist[], const float class_weight[],
+		int class_num, double class_sum[]) {
+
+		for(int i=0; i<NODE_NUM; i++) {
+			float *curr = dist + (i * class_num);
+			if(m_dst_offset[i] == m_dst_offset[i+1]) {
+				for(int j=0; j<class_num; j++) {
+					class_sum[j] += curr[j];
+				}
+				continue;
+			}
+
+			float *new_dist = acc_dist + (i * class_num);
+			CMath::NormalizeVector(new_dist, class_num);
+			for(int j=0; j<class_num; j++) {
+				new_dist[j] *= curr[j] * class_weight[j];
+			}
+
+			CMath::NormalizeVector(new_dist, class_num);
+			for(int j=0; j<class_num; j++) {
+				curr[j] += new_dist[j];
+			}
+
+			CMath::NormalizeVector(curr, class_num);
+			for(int j=0; j<class_num; j++) {
+				class_sum[j] += curr[j];
+			}
+		}
+	}
+
+	// This finds the class weight a class at a time
+	void ScalarClassWeight(float class_weight[], int class_num) {
+
+		CMath::NormalizeVector(class_weight, class_num);
+		for(int i=0; i<class_num; i++) {
+			class_weight[i] = (1 + class_weight[i]) *
+				(1 + class_weight[i]) * (1 + class_weight[i]);
+		}
+
+		CMath::NormalizeVector(class_weight, class_num);
+		for(int i=0; i<class_num; i++) {
+			class_weight[i] = 1 - class_weight[i];
+		}
+
+		CMath::NormalizeVector(class_weight, class_num);
+	}
+
+	// This checks that two sets of results agree
+	void CheckResult(const float set1[], const float set2[], int size, const char *stage) {
+
+		for(int i=0; i<size; i++) {
+			float diff = abs(set1[i] - set2[i]);
+			if(diff > 1e-4 * max(1.0f, abs(set1[i]))) {
+				cout<<stage<<" Mismatch "<<set1[i]<<" "<<set2[i];getchar();
+				return;
+			}
+		}
+	}
+
+	// This times each kernel for a given number of classes
+	void TestClassNum(int class_num) {
+
+		CMemoryChunk<float> src_dist;
+		CreateDistribution(src_dist, class_num);
+
+		CMemoryChunk<float> scalar_acc(NODE_NUM * class_num);
+		CMemoryChunk<float> vector_acc(NODE_NUM * class_num);
+		CMemoryChunk<float> scalar_dist(NODE_NUM * class_num);
+		CMemoryChunk<float> vector_dist(NODE_NUM * class_num);
+		CMemoryChunk<float> scalar_weight(class_num);
+		CMemoryChunk<float> vector_weight(class_num);
+		CMemoryChunk<double> scalar_sum(class_num);
+		CMemoryChunk<double> vector_sum(class_num);
+		CStopWatch scalar_mult, vector_mult, scalar_update, vector_update;
+
+		for(int i=0; i<RUN_NUM; i++) {
+			scalar_acc.InitializeMemoryChunk(0);
+			vector_acc.InitializeMemoryChunk(0);
+
+			scalar_mult.StartTimer();
+			ScalarMultiply(src_dist.Buffer(), scalar_acc.Buffer(), class_num);
+			scalar_mult.StopTimer();
+
+			vector_mult.StartTimer();
+			VectorMultiply(src_dist.Buffer(), vector_acc.Buffer(), class_num);
+			vector_mult.StopTimer();
+
+			CheckResult(scalar_acc.Buffer(), vector_acc.Buffer(),
+				scalar_acc.OverflowSize(), "Multiply");
+
+			for(int j=0; j<class_num; j++) {
+				scalar_weight[j] = (float)((rand() % 1000) + 1);
+				vector_weight[j] = scalar_weight[j];
+			}
+
+			ScalarClassWeight(scalar_weight.Buffer(), class_num);
+			CClassVector::BalanceClassWeight(vector_weight.Buffer(), class_num);
+			CheckResult(scalar_weight.Buffer(), vector_weight.Buffer(),
+				class_num, "Class Weight");
+
+			scalar_dist.MakeMemoryChunkEqualTo(src_dist);
+			vector_dist.MakeMemoryChunkEqualTo(src_dist);
+			scalar_sum.InitializeMemoryChunk(0);
+			vector_sum.InitializeMemoryChunk(0);
+
+			scalar_update.StartTimer();
+			ScalarUpdate(scalar_dist.Buffer(), scalar_acc.Buffer(),
+				scalar_weight.Buffer(), class_num, scalar_sum.Buffer());
+			scalar_update.StopTimer();
+
+			vector_update.StartTimer();
+			CClassVector::UpdateDistribution(vector_dist.Buffer(), vector_acc.Buffer(),
+				vector_weight.Buffer(), NODE_NUM, class_num, vector_sum.Buffer());
+			vector_update.StopTimer();
+
+			CheckResult(scalar_dist.Buffer(), vector_dist.Buffer(),
+				scalar_dist.OverflowSize(), "Update");
+
+			for(int j=0; j<class_num; j++) {
+				if(abs(scalar_sum[j] - vector_sum[j]) > 1e-4 * max(1.0, scalar_sum[j])) {
+					cout<<"Class Sum Mismatch "<<scalar_sum[j]<<" "<<vector_sum[j];getchar();
+				}
+			}
+		}
+
+		double scalar_mult_time = scalar_mult.NetElapsedTime() / RUN_NUM;
+		double vector_mult_time = vector_mult.NetElapsedTime() / RUN_NUM;
+		double scalar_update_time = scalar_update.NetElapsedTime() / RUN_NUM;
+		double vector_update_time = vector_update.NetElapsedTime() / RUN_NUM;
+
+		cout<<"Class Num "<<class_num<<endl;
+		cout<<"  Multiply: Scalar "<<scalar_mult_time<<"s Vector "<<vector_mult_time
+			<<"s Speedup "<<scalar_mult_time / max(vector_mult_time, 1e-9)<<endl;
+		cout<<"  Update: Scalar "<<scalar_update_time<<"s Vector "<<vector_update_time
+			<<"s Speedup "<<scalar_update_time / max(vector_update_time, 1e-9)<<endl;
+	}
+
+public:
+
+	CTestClassVector() {
+		CreateDivision();
+	}
+
+	// This is the entry function
+	void TestClassVector() {
+
+		cout<<"Testing Class Vector Block Size "<<CClassVector::BLOCK_SIZE<<endl;
+		TestClassNum(3);
+		TestClassNum(8);
+		TestClassNum(32);
+	}
+};
+const int CTestClassVector::NODE_NUM;
+const int CTestClassVector::LINK_NUM;
+const int CTestClassVector::UNLINKED_NODE;
+const int CTestClassVector::RUN_NUM;
@@ -1,4 +1,4 @@
-#include "../../Communication.h"
+#include "./TestClassVector.h"
 
 // This stores all the accumulated s_links that are remapped
 // at every level of the hiearchy
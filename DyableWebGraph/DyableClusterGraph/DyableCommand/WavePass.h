@@ -5,6 +5,10 @@
 // so each individual executable must be spawned
 class CWavePass : public CCommunication {
 
+	// This defines the maximum number of megabytes of links that 
+	// each hash division can hold in memory
+	static const int MAX_GRAPH_MB = 1024;
+
 	// This distribute the wave pass distribution to neighbours
 	void DistributeWavePass() {
 
@@ -97,20 +101,77 @@ class CWavePass : public CCommunication {
 			}
 		}
 
-		CMath::NormalizeVector(final_class_weight.Buffer(), CCommunication::WavePassClasses());
-		for(int j=0; j<CCommunication::WavePassClasses(); j++) {
-			final_class_weight[j] = (1 + final_class_weight[j]) * 
-				(1 + final_class_weight[j]) * (1 + final_class_weight[j]);
+		CClassVector::BalanceClassWeight(final_class_weight.Buffer(),
+			CCommunication::WavePassClasses());
+
+		final_class_weight.WriteMemoryChunkToFile(CUtility::ExtendString
+			("LocalData/fin_class_weight", CNodeStat::GetInstID()));
+	}
+
+	// This performs a number of wave pass cycles with each hash division
+	// held in memory. Every division must be running at the same time as
+	// they exchange wave pass distributions on each cycle. Nothing is done
+	// if any of the divisions don't fit in memory.
+	// @param cycle_num - the number of wave pass cycles to perform
+	// @return true if the cycles were performed in memory
+	bool WavePassGraph(int cycle_num) {
+
+		if(cycle_num < 1 || CNodeStat::GetHashDivNum() > CCommunication::MaximumProcessNum()) {
+			return false;
 		}
 
-		CMath::NormalizeVector(final_class_weight.Buffer(), CCommunication::WavePassClasses());
-		for(int j=0; j<CCommunication::WavePassClasses(); j++) {
-			final_class_weight[j] = 1 - final_class_weight[j];
+		CHDFSFile done_file;
+		for(int i=0; i<CNodeStat::GetHashDivNum(); i++) {
+			done_file.SetFileName(CUtility::ExtendString("LocalData/wave_pass_graph_done", i));
+			done_file.RemoveFile();
 		}
 
-		CMath::NormalizeVector(final_class_weight.Buffer(), CCommunication::WavePassClasses());
-		final_class_weight.WriteMemoryChunkToFile(CUtility::ExtendString
-			("LocalData/fin_class_weight", CNodeStat::GetInstID()));
+		// a barrier for each cycle and for each class weight update
+		int sync_num = cycle_num << 1;
+		CLinkGraph::RemoveExchangeFiles("LocalData/wave_pass_graph",
+			CNodeStat::GetHashDivNum(), sync_num);
+
+		for(int i=0; i<CNodeStat::GetHashDivNum(); i++) {
+			CString arg("Index ");
+			arg += i;
+			arg += " ";
+			arg += CNodeStat::GetHashDivNum();
+			arg += " ";
+			arg += cycle_num;
+			arg += " ";
+			arg += MAX_GRAPH_MB;
+			arg += " ";
+			arg += max(1, CCompBlockPool::ProcessorNum() / CNodeStat::GetHashDivNum());
+
+			ProcessSet().CreateRemoteProcess("../WavePass/WavePassGraph/Debug/"
+				"WavePassGraph.exe", arg.Buffer(), i);
+		}
+
+		ProcessSet().WaitForPendingProcesses();
+
+		bool is_failed = CLinkGraph::AskFailed("LocalData/wave_pass_graph",
+			CNodeStat::GetHashDivNum());
+
+		CLinkGraph::RemoveExchangeFiles("LocalData/wave_pass_graph",
+			CNodeStat::GetHashDivNum(), sync_num);
+
+		if(is_failed == true) {
+			throw EException("Wave pass graph failed");
+		}
+
+		int done_num = 0;
+		for(int i=0; i<CNodeStat::GetHashDivNum(); i++) {
+			if(CMappedFile::AskFileExists(CUtility::ExtendString
+				("LocalData/wave_pass_graph_done", i))) {
+				done_num++;
+			}
+		}
+
+		if(done_num > 0 && done_num < CNodeStat::GetHashDivNum()) {
+			throw EException("Wave pass graph did not complete");
+		}
+
+		return done_num > 0;
 	}
 
 public:
@@ -127,7 +188,15 @@ public:
 		for(int j=0; j<CCommunication::WavePassInstNum(); j++) {
 			FindNetClassDist();
 			cout<<"Pass "<<j<<endl;
-			for(int i=0; i<wave_pass_cycles; i++) {
+
+			// all but the last cycle, which adds the external nodes
+			int start = 0;
+			if(WavePassGraph(wave_pass_cycles - 1) == true) {
+				start = wave_pass_cycles - 1;
+				FindNetClassDist();
+			}
+
+			for(int i=start; i<wave_pass_cycles; i++) {
 				cout<<"Distributing"<<endl;
 				DistributeWavePass();
 				cout<<"Accumulating"<<endl;
@@ -142,6 +211,8 @@ public:
 	}
 };
 
+const int CWavePass::MAX_GRAPH_MB;
+
 // This tests that the reverse w_links are merged correctly so a clustered
 // link set can be created.
 class CTestMergeBinaryLinks : public CNodeStat {
@@ -305,19 +376,7 @@ class CTestWavePass : public CNodeStat {
 			m_class_weight[j] = sum;
 		}
 
-		CMath::NormalizeVector(m_class_weight.Buffer(), m_class_num);
-
-		for(int j=0; j<m_class_num; j++) {
-			m_class_weight[j] = (1 + m_class_weight[j]) * 
-				(1 + m_class_weight[j]) * (1 + m_class_weight[j]);
-		}
-
-		CMath::NormalizeVector(m_class_weight.Buffer(), m_class_num);
-		for(int j=0; j<m_class_num; j++) {
-			m_class_weight[j] = 1 - m_class_weight[j];
-		}
-
-		CMath::NormalizeVector(m_class_weight.Buffer(), m_class_num);
+		CClassVector::BalanceClassWeight(m_class_weight.Buffer(), m_class_num);
 	}
 
 	// This assigns the majority class to each node
@@ -346,18 +405,18 @@ class CTestWavePass : public CNodeStat {
 	void CreateLocalLinkSet(CArrayList<SClusterLink> &local_link_set,
 		CHDFSFile &clus_link_file) {
 
-		uLong cluster_size;
 		SWaveDist src_wave_dist;
 		SWaveDist dst_wave_dist;
 		SWLink w_link;
+		CLinkClusterCodec link_cluster;
 
-		while(clus_link_file.GetEscapedItem(cluster_size) >= 0) {
-			clus_link_file.ReadCompObject(w_link.src);
+		while(link_cluster.ReadLinkCluster(clus_link_file)) {
+			w_link.src = link_cluster.Src();
 			m_node_set.AddWord((char *)&w_link.src, 4);
 
-			for(uLong i=0; i<cluster_size; i++) {
-				clus_link_file.ReadCompObject(w_link.dst);
-				clus_link_file.ReadCompObject(w_link.link_weight);
+			for(int i=0; i<link_cluster.LinkNum(); i++) {
+				w_link.dst = link_cluster.Dst(i);
+				w_link.link_weight = link_cluster.LinkWeight(i);
 
 				local_link_set.ExtendBuffer(1);
 				local_link_set.LastElement().base_link = w_link;
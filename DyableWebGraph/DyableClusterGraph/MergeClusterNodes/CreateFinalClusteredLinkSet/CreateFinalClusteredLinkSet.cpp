@@ -21,6 +21,8 @@ class CCreateFinalClusteredLinkSet {
 	CFileSet<CHDFSFile> m_link_set;
 	// This stores the clustered link set 
 	CHDFSFile m_clus_link_file;
+	// This is used to encode each link cluster
+	CLinkClusterCodec m_link_cluster;
 
 	// This stores the src node map
 	CObjectHashMap<S5Byte> m_src_map;
@@ -61,8 +63,6 @@ class CCreateFinalClusteredLinkSet {
 				curr_ptr = curr_ptr->next_ptr;
 			}
 
-			m_clus_link_file.AddEscapedItem(m_dst_buff.Size());
-			m_clus_link_file.WriteCompObject(src);
 			clus_map.base_node = src;
 			clus_map.cluster = src;
 			clus_map.weight = link_weight;
@@ -74,10 +74,15 @@ class CCreateFinalClusteredLinkSet {
 			int hash = clus_map.base_node.Value() % CNodeStat::GetClientNum();
 			clus_map.WriteClusterMap(m_clus_label_set.File(hash));
 
+			// the final link set is unweighted so every link is given
+			// the same weight which is stored once for the cluster
+			m_link_cluster.Reset(src);
 			for(int i=0; i<m_dst_buff.Size(); i++) {
-				m_clus_link_file.WriteCompObject(m_dst_buff[i]);
+				m_link_cluster.AddLink(m_dst_buff[i], 1.0f);
 			}
 
+			m_link_cluster.WriteLinkCluster(m_clus_link_file);
+
 			m_dst_buff.Resize(0);
 		}
 	}
@@ -60,10 +60,10 @@ class CDistributeClusterNodes {
 	void ProcessLinkSet() {
 
 		SWLink w_link;
-		uLong cluster_size;
+		CLinkClusterCodec link_cluster;
 
-		while(m_clus_link_file.GetEscapedItem(cluster_size) >= 0) {
-			m_clus_link_file.ReadCompObject(w_link.src);
+		while(link_cluster.ReadLinkCluster(m_clus_link_file)) {
+			w_link.src = link_cluster.Src();
 
 			int id = m_node_map.Get(w_link.src);
 			SWClusterMap &clus_map = m_clus_label_buff[id];
@@ -74,8 +74,8 @@ class CDistributeClusterNodes {
 				cout<<"src mismatch "<<clus_map.base_node.Value()<<" "<<w_link.src.Value();getchar();
 			}
 
-			for(uLong i=0; i<cluster_size; i++) {
-				m_clus_link_file.ReadCompObject(w_link.dst);
+			for(int i=0; i<link_cluster.LinkNum(); i++) {
+				w_link.dst = link_cluster.Dst(i);
 
 				clus_map.base_node = w_link.dst;
 				int hash = w_link.dst.Value() % m_forward_set.SetNum(); 
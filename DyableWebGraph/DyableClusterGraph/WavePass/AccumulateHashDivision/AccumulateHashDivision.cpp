@@ -65,27 +65,25 @@ class CAccumulateHashDivision : public CNodeStat {
 	// added to the existing back buffer.
 	void AccumulateDistribution() {
 
-		float dist;
 		S5Byte dst;
+		CMemoryChunk<float> dist(m_class_num);
+		CCombinedMessageReader reader;
 
 		for(int j=0; j<GetClientNum(); j++) {
 			m_forward_set.OpenReadFile(CNodeStat::GetClientID(), j);
 
 			CHDFSFile &node_file = m_forward_set.File(CNodeStat::GetClientID());
-			while(node_file.ReadCompObject(dst)) {
+			reader.Initialize(node_file, m_class_num);
+			while(reader.NextMessage(dst, dist.Buffer())) {
 				int id = m_node_map.Put(dst);
 
 				if(!m_node_map.AskFoundWord()) {
 					for(int k=0; k<m_class_num; k++) {
-						node_file.ReadCompObject(dist);
-						m_wave_pass_dist.PushBack(dist);
+						m_wave_pass_dist.PushBack(dist[k]);
 					}
 				} else {
-					int offset = id * m_class_num;
-					for(int k=0; k<m_class_num; k++) {
-						node_file.ReadCompObject(dist);
-						m_wave_pass_dist[offset++] += dist;
-					}
+					CClassVector::ScaleAdd(m_wave_pass_dist.Buffer() +
+						(id * m_class_num), dist.Buffer(), 1.0f, m_class_num);
 				}
 			}
 		}
@@ -105,14 +103,14 @@ class CAccumulateHashDivision : public CNodeStat {
 		CMemoryChunk<float> &new_dist, int id, float &sum, 
 		CMemoryChunk<float> &curr_class_weight) {
 
-		if(id < 0) {
-			// nothing linked to this base node so distribution is unchanged
+		int offset = id * m_class_num;
+		if(id < 0 || CClassVector::Sum(m_wave_pass_dist.Buffer() + offset, m_class_num) == 0) {
+			// nothing passed to this base node so distribution is unchanged
 			sum = 1.0f;
 			return;
 		}
 
-		int offset = id * m_class_num;
-		CMath::NormalizeVector(m_wave_pass_dist.Buffer() + offset, m_class_num);
+		CClassVector::Normalize(m_wave_pass_dist.Buffer() + offset, m_class_num);
 
 		for(int i=0; i<m_class_num; i++) {
 			new_dist[i] = m_wave_pass_dist[offset++] * 
@@ -120,7 +118,7 @@ class CAccumulateHashDivision : public CNodeStat {
 		}
 
 		sum = 0;
-		CMath::NormalizeVector(new_dist.Buffer(), m_class_num);
+		CClassVector::Normalize(new_dist.Buffer(), m_class_num);
 		for(int i=0; i<m_class_num; i++) {
 			curr_dist[i] += new_dist[i];
 			sum += curr_dist[i];
@@ -8,8 +8,9 @@ class CDistributeWavePass : public CNodeStat {
 	// This defines the number of classes to use for wave pass,
 	// this will most usually be set to the the number of clients
 	int m_class_num;
-	// This stores all the forward class distribution
-	CFileSet<CHDFSFile> m_forward_set;
+	// This combines the distribution passed to each dst node
+	// before it's written to the dst's hash division
+	CMessageCombiner m_combiner;
 	// This stores the hashed link set once all link clusters
 	// have been hashed to seperate bins
 	CHDFSFile m_clus_link_file;
@@ -20,33 +21,22 @@ class CDistributeWavePass : public CNodeStat {
 	// It passes the wave pass distribution to all the neighbours.
 	void ProcessLinkSet() {
 
-		SWLink w_link;
-		uLong cluster_size;
+		S5Byte node;
+		CLinkClusterCodec link_cluster;
 		CMemoryChunk<float> dist(m_class_num);
 
-		while(m_clus_link_file.GetEscapedItem(cluster_size) >= 0) {
-			m_clus_link_file.ReadCompObject(w_link.src);
-
-			m_back_file.ReadCompObject(w_link.dst);
+		while(link_cluster.ReadLinkCluster(m_clus_link_file)) {
+			m_back_file.ReadCompObject(node);
 			for(int j=0; j<m_class_num; j++) {
 				m_back_file.ReadCompObject(dist[j]);
 			}
 
-			if(w_link.src != w_link.dst) {
-				cout<<"Node Mismatch "<<w_link.src.Value()<<" "<<w_link.dst.Value();getchar();
+			if(link_cluster.Src() != node) {
+				cout<<"Node Mismatch "<<link_cluster.Src().Value()<<" "<<node.Value();getchar();
 			}
 
-			for(uLong i=0; i<cluster_size; i++) {
-				m_clus_link_file.ReadCompObject(w_link.dst);
-				m_clus_link_file.ReadCompObject(w_link.link_weight);
-
-				int hash = w_link.dst.Value() % m_forward_set.SetNum();
-				m_forward_set.File(hash).WriteCompObject(w_link.dst);
-
-				for(int j=0; j<m_class_num; j++) {
-					float weight = w_link.link_weight * dist[j];
-					m_forward_set.File(hash).WriteCompObject(weight);
-				}
+			for(int i=0; i<link_cluster.LinkNum(); i++) {
+				m_combiner.AddMessage(link_cluster.Dst(i), dist.Buffer(), link_cluster.LinkWeight(i));
 			}
 		}
 	}
@@ -65,8 +55,8 @@ public:
 		CHDFSFile::Initialize();
 		m_class_num = 3;
 
-		m_forward_set.OpenWriteFileSet("LocalData/forward_wave_pass",
-			CNodeStat::GetClientNum(), GetClientID());
+		m_combiner.Initialize("LocalData/forward_wave_pass",
+			CNodeStat::GetClientNum(), GetClientID(), m_class_num);
 
 		m_clus_link_file.OpenReadFile(CUtility::ExtendString
 			(SUBM_SET_DIR, CNodeStat::GetClientID()));
@@ -75,6 +65,7 @@ public:
 			("LocalData/back_wave_pass", CNodeStat::GetClientID()));
 	
 		ProcessLinkSet();
+		m_combiner.CloseCombiner();
 	}
 };
 
@@ -0,0 +1,227 @@
+#include "../../../../MapReduce.h"
+
+// This class performs a number of wave pass cycles for a single hash
+// division with the division's link set held in memory. This replaces
+// a cycle of DistributeWavePass and AccumulateHashDivision when every
+// division fits in memory. The link set and back buffer are loaded once,
+// after which each cycle passes the wave pass distribution of each node
+// to its neighbours in memory. Only the distributions passed to nodes in
+// other hash divisions are written out. The class weights are summed
+// across all divisions on each cycle. Once complete the back buffer and
+// class weight are written out so the final cycle, which adds in the
+// external nodes, can carry on as normal.
+class CWavePassGraph : public CNodeStat {
+
+	// This defines the number of classes to use for wave pass,
+	// this will most usually be set to the the number of clients
+	int m_class_num;
+	// This stores the hash division held in memory
+	CLinkGraph m_graph;
+	// This stores the hashed link set once all link clusters
+	// have been hashed to seperate bins
+	CHDFSFile m_clus_link_file;
+	// This stores all the back class distribution
+	CHDFSFile m_back_file;
+
+	// This stores the wave pass distribution of each local node
+	CArrayList<float> m_wave_pass_dist;
+	// This stores the distribution passed to each local node and boundary slot
+	CMemoryChunk<float> m_forward_dist;
+	// This stores the local id of each node in the back buffer in order
+	CArrayList<int> m_back_id;
+	// This stores each node in the back buffer in order
+	CArrayList<S5Byte> m_back_node;
+	// This stores the global class weight used to keep wave pass balanced
+	CMemoryChunk<float> m_class_weight;
+	// This stores the class weight summed over the local nodes
+	CMemoryChunk<double> m_local_class_weight;
+
+	// This loads the link set and back buffer for the hash division.
+	// The back buffer holds the src node of each link cluster in order.
+	void LoadLinkSet() {
+
+		S5Byte node;
+		CLinkClusterCodec link_cluster;
+		CMemoryChunk<float> dist(m_class_num);
+
+		m_clus_link_file.SetReadAhead(true);
+		m_back_file.SetReadAhead(true);
+
+		while(link_cluster.ReadLinkCluster(m_clus_link_file)) {
+			m_back_file.ReadCompObject(node);
+			m_back_file.ReadCompObject(dist.Buffer(), m_class_num);
+
+			if(link_cluster.Src() != node) {
+				cout<<"Node Mismatch "<<link_cluster.Src().Value()<<" "<<node.Value();getchar();
+			}
+
+			int id = m_graph.AddNode(node);
+			if(id * m_class_num >= m_wave_pass_dist.Size()) {
+				m_wave_pass_dist.CopyBufferToArrayList(dist.Buffer(),
+					m_class_num, m_wave_pass_dist.Size());
+			}
+
+			m_back_id.PushBack(id);
+			m_back_node.PushBack(node);
+
+			for(int i=0; i<link_cluster.LinkNum(); i++) {
+				m_graph.AddLink(id, link_cluster.Dst(i), link_cluster.LinkWeight(i));
+			}
+		}
+
+		m_clus_link_file.CloseFile();
+		m_back_file.CloseFile();
+	}
+
+	// This turns the class weight summed over all nodes into the
+	// class weight used to keep wave pass balanced
+	// @param net_class_weight - the class weight summed over all nodes
+	void UpdateClassWeight(const double net_class_weight[]) {
+
+		for(int j=0; j<m_class_num; j++) {
+			m_class_weight[j] = (float)net_class_weight[j];
+		}
+
+		CClassVector::BalanceClassWeight(m_class_weight.Buffer(), m_class_num);
+	}
+
+	// This performs a single wave pass cycle
+	// @param cycle - the current cycle
+	// @param thread_num - the number of threads to use
+	void PerformCycle(int cycle, int thread_num) {
+
+		m_graph.Multiply(m_wave_pass_dist.Buffer(),
+			m_forward_dist.Buffer(), m_class_num, thread_num);
+
+		m_graph.SendBoundary(m_forward_dist.Buffer(), m_class_num, cycle);
+		m_graph.Synchronize(cycle + 1, NULL, NULL, 0);
+		m_graph.ReceiveBoundary(m_forward_dist.Buffer(), m_class_num, cycle);
+
+		// nodes that aren't linked are passed nothing so are left unchanged
+		m_local_class_weight.InitializeMemoryChunk(0);
+		CClassVector::UpdateDistribution(m_wave_pass_dist.Buffer(), m_forward_dist.Buffer(),
+			m_class_weight.Buffer(), m_graph.NodeNum(), m_class_num,
+			m_local_class_weight.Buffer());
+	}
+
+	// This writes the back buffer in the same order it was read
+	void WriteBackBuffer() {
+
+		m_back_file.OpenWriteFile();
+		m_back_file.InitializeCompression();
+		for(int i=0; i<m_back_id.Size(); i++) {
+			m_back_file.WriteCompObject(m_back_node[i]);
+			m_back_file.WriteCompObject(m_wave_pass_dist.Buffer() +
+				(m_back_id[i] * m_class_num), m_class_num);
+		}
+
+		m_back_file.CloseFile();
+	}
+
+public:
+
+	CWavePassGraph() {
+		CHDFSFile::Initialize();
+	}
+
+	// This is the entry function that performs the wave pass cycles.
+	// Nothing is done if any of the hash divisions don't fit in memory.
+	// @param hash_div - this is the hash division being processed
+	// @param hash_div_num - this is the number of hash divisions
+	// @param cycle_num - this is the number of wave pass cycles
+	// @param max_byte_num - this is the maximum number of bytes to use for links
+	// @param thread_num - this is the number of threads to use
+	void WavePassGraph(int hash_div, int hash_div_num, int cycle_num,
+		_int64 max_byte_num, int thread_num) {
+
+		CNodeStat::SetInstID(0);
+		CNodeStat::SetClientID(hash_div);
+		CNodeStat::SetClientNum(hash_div_num);
+		m_class_num = 3;
+
+		CMemoryChunk<float> curr_class_weight(CUtility::ExtendString
+			("LocalData/fin_class_weight", GetInstID()));
+		m_class_weight.AllocateMemory(m_class_num, 0);
+		for(int j=0; j<min(m_class_num, curr_class_weight.OverflowSize()); j++) {
+			m_class_weight[j] = curr_class_weight[j];
+		}
+		m_local_class_weight.AllocateMemory(m_class_num, 0);
+
+		m_clus_link_file.OpenReadFile(CUtility::ExtendString
+			(SUBM_SET_DIR, CNodeStat::GetClientID()));
+		m_back_file.OpenReadFile(CUtility::ExtendString
+			("LocalData/back_wave_pass", CNodeStat::GetClientID()));
+
+		m_wave_pass_dist.Initialize(1024);
+		m_back_id.Initialize(1024);
+		m_back_node.Initialize(1024);
+		m_graph.Initialize("LocalData/wave_pass_graph", hash_div, hash_div_num, max_byte_num);
+
+		LoadLinkSet();
+		if(m_graph.AskOverflow() == false) {
+			m_graph.CompileGraph();
+		}
+
+		double overflow = m_graph.AskOverflow() ? 1 : 0;
+		double net_overflow;
+		m_graph.Synchronize(0, &overflow, &net_overflow, 1);
+		if(net_overflow > 0) {
+			return;
+		}
+
+		CMemoryChunk<double> net_class_weight(m_class_num);
+		m_forward_dist.AllocateMemory(max(m_graph.DstNum() * m_class_num, 1));
+
+		for(int i=0; i<cycle_num; i++) {
+			cout<<"Wave Pass Cycle "<<i<<" Out Of "<<cycle_num<<endl;
+			PerformCycle(i, thread_num);
+
+			if(i < cycle_num - 1) {
+				m_graph.Synchronize(cycle_num + i + 1, m_local_class_weight.Buffer(),
+					net_class_weight.Buffer(), m_class_num);
+				UpdateClassWeight(net_class_weight.Buffer());
+			}
+		}
+
+		WriteBackBuffer();
+
+		CMemoryChunk<float> class_weight(m_class_num);
+		for(int j=0; j<m_class_num; j++) {
+			class_weight[j] = (float)m_local_class_weight[j];
+		}
+
+		class_weight.WriteMemoryChunkToFile(CUtility::ExtendString
+			("LocalData/class_weight", CNodeStat::GetClientID()));
+
+		CHDFSFile done_file;
+		done_file.OpenWriteFile(CUtility::ExtendString
+			("LocalData/wave_pass_graph_done", hash_div));
+		done_file.WriteObject(cycle_num);
+		done_file.CloseFile();
+	}
+};
+
+int main(int argc, char *argv[]) {
+
+	if(argc < 2)return 0;
+	int hash_div = atoi(argv[1]);
+	int hash_div_num = atoi(argv[2]);
+	int cycle_num = atoi(argv[3]);
+	_int64 max_byte_num = (_int64)atoi(argv[4]) << 20;
+	int thread_num = atoi(argv[5]);
+
+	CBeacon::InitializeBeacon(hash_div, 5555);
+	CMemoryElement<CWavePassGraph> graph;
+	try {
+		graph->WavePassGraph(hash_div, hash_div_num, cycle_num, max_byte_num, thread_num);
+	} catch(...) {
+		// the other divisions would otherwise wait on the next barrier
+		CLinkGraph::SignalFailure("LocalData/wave_pass_graph", hash_div);
+		throw;
+	}
+	graph.DeleteMemoryElement();
+
+	CBeacon::SendTerminationSignal();
+
+	return 0;
+}
@@ -45,20 +45,23 @@ class CAccumulateHashDivision : public CNodeStat {
 	// @param forward_set_num - this is the number of forward sets created
 	void AccumulateDistribution(int hash_div, int forward_set_num) {
 
-		SPulseMap pulse_map;
+		S5Byte dst;
+		float pulse_score;
+		CCombinedMessageReader reader;
 		for(int i=0; i<CNodeStat::GetHashDivNum(); i++) {
 			m_forward_set.SetDirectory(WavePassFile(i));
 			for(int j=0; j<forward_set_num; j++) {
 				m_forward_set.OpenReadFile(hash_div, j);
 
 				CHDFSFile &node_file = m_forward_set.File(hash_div);
-				while(pulse_map.ReadPulseMap(node_file)) {
-					int id = m_node_map.Put(pulse_map.node);
+				reader.Initialize(node_file, 1);
+				while(reader.NextMessage(dst, &pulse_score)) {
+					int id = m_node_map.Put(dst);
 
 					if(!m_node_map.AskFoundWord()) {
-						m_pulse_dist.PushBack(pulse_map.pulse_score);
+						m_pulse_dist.PushBack(pulse_score);
 					} else {
-						m_pulse_dist[id] += pulse_map.pulse_score;
+						m_pulse_dist[id] += pulse_score;
 					}
 				}
 
@@ -54,6 +54,9 @@ class CCreateClusteredLinkSet : public CNodeStat {
 	// This stores the set of links in priority order
 	CLimitedPQ<SWLinkPtr> m_link_queue;
 
+	// This is used to encode each link cluster
+	CLinkClusterCodec m_link_cluster;
+
 	// This stores the final binary link set
 	CHDFSFile m_bin_link_set;
 	// This stores the hashed link set once all link clusters
@@ -167,10 +170,8 @@ class CCreateClusteredLinkSet : public CNodeStat {
 		int hash = (int)(src % m_hash_link_set.SetNum());
 		CHDFSFile &fin_link_set = m_hash_link_set.File(hash);
 
-		fin_link_set.AddEscapedItem(m_link_ptr.Size());
-		fin_link_set.WriteCompObject5Byte(src);
-	
 		pulse_map.node = src;
+		m_link_cluster.Reset(pulse_map.node);
 		pulse_map.WritePulseMap(m_back_set.File(hash));
 
 		if(pulse_map.node >= GetGlobalNodeNum()) {
@@ -180,10 +181,10 @@ class CCreateClusteredLinkSet : public CNodeStat {
 		for(int i=0; i<m_link_ptr.Size(); i++) {
 			SWLink &w_link = *m_link_ptr[i].ptr;
 			w_link.link_weight /= net_link_weight;
-
-			fin_link_set.WriteCompObject(w_link.dst);
-			fin_link_set.WriteCompObject(w_link.link_weight);
+			m_link_cluster.AddLink(w_link.dst, w_link.link_weight);
 		}
+
+		m_link_cluster.WriteLinkCluster(fin_link_set);
 	}
 
 	// This cycles through the link set and groups nodes
@@ -6,13 +6,16 @@
 // distributing the src pulse score to all of the dst nodes.
 class CDistributePulseScores : public CNodeStat {
 
-	// This stores all the forward pulse rank scores
-	CFileSet<CHDFSFile> m_forward_set;
+	// This combines the pulse score passed to each dst node
+	// before it's written to the dst's hash division
+	CMessageCombiner m_combiner;
 	// This stores all the back pulse rank scores
 	CFileSet<CHDFSFile> m_back_set;
 	// This stores the hashed link set once all link clusters
 	// have been hashed to seperate bins
 	CFileSet<CHDFSFile> m_hash_link_set;
+	// This is used to decode each link cluster
+	CLinkClusterCodec m_link_cluster;
 	// This stores the net updated pulse score across all nodes
 	double m_net_pulse_score;
 
@@ -34,32 +37,28 @@ class CDistributePulseScores : public CNodeStat {
 	void ProcessLinkSet(CHDFSFile &clus_link_file, CHDFSFile &back_file, 
 		_int64 min_node_num, _int64 max_node_num) {
 
-		SWLink w_link;
-		uLong cluster_size;
-		_int64 dst_index = 0;
 		SPulseMap back_pulse_map;
-		SPulseMap forward_pulse_map;
 
-		while(clus_link_file.GetEscapedItem(cluster_size) >= 0) {
-			clus_link_file.ReadCompObject(w_link.src);
+		// both link sets are scanned sequentially 
+		clus_link_file.SetReadAhead(true);
+		back_file.SetReadAhead(true);
 
+		while(m_link_cluster.ReadLinkCluster(clus_link_file)) {
 			back_pulse_map.ReadPulseMap(back_file);
 			m_net_pulse_score += back_pulse_map.pulse_score;
 
-			for(uLong i=0; i<cluster_size; i++) {
-				clus_link_file.ReadCompObject((char *)&dst_index, 5);
-				clus_link_file.ReadCompObject(w_link.link_weight);
+			for(int i=0; i<m_link_cluster.LinkNum(); i++) {
+				S5Byte &dst = m_link_cluster.Dst(i);
 
-				if(dst_index >= max_node_num) {
-					continue;
+				if(dst.Value() >= max_node_num) {
+					// dst nodes are sorted so the rest are also out of range
+					break;
 				}
 
-				int hash = (int)(dst_index % m_forward_set.SetNum());
-				forward_pulse_map.node = dst_index;
-				forward_pulse_map.pulse_score = back_pulse_map.pulse_score * w_link.link_weight;
+				float pulse_score = back_pulse_map.pulse_score * m_link_cluster.LinkWeight(i);
 
-				m_net_pulse_score += forward_pulse_map.pulse_score;
-				forward_pulse_map.WritePulseMap(m_forward_set.File(hash));
+				m_net_pulse_score += pulse_score;
+				m_combiner.AddMessage(dst, pulse_score);
 			}
 		}
 	}
@@ -96,8 +95,8 @@ public:
 		}
 
 		m_net_pulse_score = 0;
-		m_forward_set.OpenWriteFileSet(WavePassFile(hash_div),
-			hash_div_num, GetClientID());
+		m_combiner.Initialize(WavePassFile(hash_div),
+			hash_div_num, GetClientID(), 1);
 
 		for(int i=client_start; i<client_end; i++) {
 			m_back_set.OpenReadFile(hash_div, i);
@@ -107,6 +106,8 @@ public:
 				m_back_set.File(hash_div), min_node_num, max_node_num);
 		}
 
+		m_combiner.CloseCombiner();
+
 		CHDFSFile net_pulse_file;
 		net_pulse_file.OpenWriteFile(CUtility::ExtendString
 			("LocalData/net_pulse", hash_div, ".client", GetClientID()));
@@ -5,8 +5,20 @@
 // also handles incomplete processes. The procedure is to 
 class CPulseRankControl : public CNodeStat {
 
+	// This defines the maximum number of megabytes of links that 
+	// each hash division can hold in memory
+	static const int MAX_GRAPH_MB = 1024;
+	// This defines the residual relative to a node's pulse score below
+	// which the node is not passed on, given as a negative power of ten
+	static const int PUSH_RESIDUAL_EXP = 3;
+	// This defines the L1 residual across all nodes at which the pulse
+	// rank cycles stop, given as a negative power of ten
+	static const int STOP_RESIDUAL_EXP = 3;
+
 	// This stores the number of client sets per hash division
 	int m_client_set_num;
+	// This stores the maximum number of processes run at once
+	int m_max_process_num;
 	// This defines the number of pulse rank cycles
 	int m_pulse_rank_cycles;
 	// This is the maximum number of documents
@@ -144,6 +156,84 @@ class CPulseRankControl : public CNodeStat {
 		m_process_set.WaitForPendingProcesses();
 	}
 
+	// This performs every pulse rank cycle with each hash division held
+	// in memory. Every division must be running at the same time as they
+	// exchange pulse scores on each cycle. The cycles stop early once the
+	// pulse scores have converged. Nothing is done if any of the
+	// divisions don't fit in memory. The test framework checks against
+	// exact cycles so every node is passed on and no cycle is skipped.
+	// @param is_keyword_set - true if the keyword link set is being used
+	// @param is_test - true if the test framework is being used
+	// @return true if the cycles were performed in memory
+	bool PulseRankGraph(bool is_keyword_set, bool is_test) {
+
+		if(CNodeStat::GetHashDivNum() > m_max_process_num) {
+			return false;
+		}
+
+		CHDFSFile done_file;
+		for(int i=0; i<CNodeStat::GetHashDivNum(); i++) {
+			done_file.SetFileName(CUtility::ExtendString("LocalData/pulse_graph_done", i));
+			done_file.RemoveFile();
+		}
+
+		CLinkGraph::RemoveExchangeFiles("LocalData/pulse_graph",
+			CNodeStat::GetHashDivNum(), m_pulse_rank_cycles + 1);
+
+		int thread_num = max(1, CCompBlockPool::ProcessorNum() * 
+			CNodeStat::GetClientNum() / CNodeStat::GetHashDivNum());
+
+		for(int i=0; i<CNodeStat::GetHashDivNum(); i++) {
+			CString arg("Index ");
+			arg += i;
+			arg += " ";
+			arg += CNodeStat::GetHashDivNum();
+			arg += " ";
+			arg += m_pulse_rank_cycles;
+			arg += " ";
+			arg += is_keyword_set;
+			arg += " ";
+			arg += CNodeStat::GetBaseNodeNum();
+			arg += " ";
+			arg += MAX_GRAPH_MB;
+			arg += " ";
+			arg += thread_num;
+			arg += " ";
+			arg += is_test ? 0 : PUSH_RESIDUAL_EXP;
+			arg += " ";
+			arg += is_test ? 0 : STOP_RESIDUAL_EXP;
+
+			m_process_set.CreateRemoteProcess("../PulseRankGraph/Debug/"
+				"PulseRankGraph.exe", arg.Buffer(), i);
+		}
+
+		m_process_set.WaitForPendingProcesses();
+
+		bool is_failed = CLinkGraph::AskFailed("LocalData/pulse_graph",
+			CNodeStat::GetHashDivNum());
+
+		CLinkGraph::RemoveExchangeFiles("LocalData/pulse_graph",
+			CNodeStat::GetHashDivNum(), m_pulse_rank_cycles + 1);
+
+		if(is_failed == true) {
+			throw EException("Pulse rank graph failed");
+		}
+
+		int done_num = 0;
+		for(int i=0; i<CNodeStat::GetHashDivNum(); i++) {
+			if(CMappedFile::AskFileExists(CUtility::ExtendString
+				("LocalData/pulse_graph_done", i))) {
+				done_num++;
+			}
+		}
+
+		if(done_num > 0 && done_num < CNodeStat::GetHashDivNum()) {
+			throw EException("Pulse rank graph did not complete");
+		}
+
+		return done_num > 0;
+	}
+
 public:
 
 	CPulseRankControl() {
@@ -170,6 +260,7 @@ public:
 		CNodeStat::SetClientNum(client_num);
 		CNodeStat::SetHashDivNum(hash_div_num);
 		m_process_set.SetMaximumClientNum(max_process_num);
+		m_max_process_num = max_process_num;
 		m_process_set.SetPort(5555);
 		CMapReduce::SetMaximumProcessNum(max_process_num);
 		m_max_window_size = max_window_size;
@@ -187,11 +278,13 @@ public:
 			m_test.LoadBackBuffer();
 		}
 
-		for(int i=0; i<m_pulse_rank_cycles; i++) {
-			cout<<"Pulse Rank Cycle "<<i<<" Out Of "<<m_pulse_rank_cycles<<endl;
-			DistributePulseScores(is_keyword_set, 0, CNodeStat::GetBaseNodeNum());
-			cout<<"Update Back Buffer"<<endl;
-			UpdateBackBuffer(false, is_keyword_set);
+		if(PulseRankGraph(is_keyword_set, is_test) == false) {
+			for(int i=0; i<m_pulse_rank_cycles; i++) {
+				cout<<"Pulse Rank Cycle "<<i<<" Out Of "<<m_pulse_rank_cycles<<endl;
+				DistributePulseScores(is_keyword_set, 0, CNodeStat::GetBaseNodeNum());
+				cout<<"Update Back Buffer"<<endl;
+				UpdateBackBuffer(false, is_keyword_set);
+			}
 		}
 
 		DistributePulseScores(is_keyword_set, CNodeStat::GetBaseNodeNum(), 
@@ -214,6 +307,9 @@ public:
 		m_test.TestPulseRank(is_keyword_link_set, m_pulse_rank_cycles);
 	}
 };
+const int CPulseRankControl::MAX_GRAPH_MB;
+const int CPulseRankControl::PUSH_RESIDUAL_EXP;
+const int CPulseRankControl::STOP_RESIDUAL_EXP;
 
 int main(int argc, char *argv[]) {
 
@@ -21,7 +21,7 @@ class CTestPulseRank : public CNodeStat {
 		CArrayList<int> &cluster_size, bool is_keyword) {
 
 		SWLink w_link;
-		uLong clus_size;
+		CLinkClusterCodec link_cluster;
 		CHDFSFile link_set_file;
 		for(int i=0; i<CNodeStat::GetHashDivNum(); i++) {
 			for(int j=0; j<CNodeStat::GetHashDivNum(); j++) {
@@ -34,13 +34,13 @@ class CTestPulseRank : public CNodeStat {
 						("GlobalData/LinkSet/webgraph_hash_link_set", i, ".set", j));
 				}
 
-				while(link_set_file.GetEscapedItem(clus_size) >= 0) {
-					link_set_file.ReadCompObject(w_link.src);
+				while(link_cluster.ReadLinkCluster(link_set_file)) {
+					w_link.src = link_cluster.Src();
 
-					cluster_size.PushBack(clus_size);
-					for(uLong k=0; k<clus_size; k++) {
-						link_set_file.ReadCompObject(w_link.dst);
-						link_set_file.ReadCompObject(w_link.link_weight);
+					cluster_size.PushBack(link_cluster.LinkNum());
+					for(int k=0; k<link_cluster.LinkNum(); k++) {
+						w_link.dst = link_cluster.Dst(k);
+						w_link.link_weight = link_cluster.LinkWeight(k);
 
 						w_link_set.PushBack(w_link);
 					}
@@ -0,0 +1,334 @@
+#include "../../../MapReduce.h"
+
+// This class performs every pulse rank cycle for a single hash division
+// with the division's link set held in memory. This replaces a cycle of
+// DistributePulseScores and AccumulateHashDivision when every division
+// fits in memory. The link set and back buffer are loaded once, after
+// which each cycle distributes the pulse scores to the neighbours in
+// memory. Only the pulse scores passed to nodes in other hash divisions
+// are written out. Once all the cycles are complete the back buffer is
+// written out so the final external pass can carry on as normal.
+//
+// Rather than passing every pulse score along every link on each cycle
+// the score passed to each node is kept between cycles, and only the
+// change in a node's score since it was last passed on (its residual)
+// is distributed. Nodes whose residual is below a push tolerance are
+// left out of the cycle until their residual builds up. Most nodes settle
+// after a few cycles so later cycles only visit the links of the few
+// nodes still changing. Cycles stop once the L1 residual across every
+// division falls below a separate stop tolerance.
+class CPulseRankGraph : public CNodeStat {
+
+	// This defines the cost of scattering a residual along a link
+	// relative to pulling it, as scattering writes to random dst
+	static const int SCATTER_COST = 2;
+
+	// This stores the hash division held in memory
+	CLinkGraph m_graph;
+	// This stores all the back pulse rank scores
+	CFileSet<CHDFSFile> m_back_set;
+	// This stores the hashed link set once all link clusters
+	// have been hashed to seperate bins
+	CFileSet<CHDFSFile> m_hash_link_set;
+
+	// This stores the pulse score of each local node
+	CArrayList<float> m_pulse_score;
+	// This stores the net weight of the links from each local node
+	CArrayList<float> m_out_weight;
+	// This stores the pulse score of each local node when
+	// it was last passed to its neighbours
+	CMemoryChunk<float> m_sent_score;
+	// This stores the residual of each local node passed on this cycle
+	CMemoryChunk<float> m_residual;
+	// This stores the local id of each node passed on this cycle
+	CMemoryChunk<int> m_active_id;
+	// This stores the pulse score passed to each local node on all cycles
+	CMemoryChunk<float> m_incoming_score;
+	// This stores the pulse score passed to each local node and boundary
+	// slot on this cycle
+	CMemoryChunk<float> m_forward_score;
+	// This stores the local id of each node in the back buffer in order
+	CArrayList<int> m_back_id;
+	// This stores each node in the back buffer in order
+	CArrayList<S5Byte> m_back_node;
+	// This stores the number of nodes in each back buffer file
+	CMemoryChunk<int> m_back_node_num;
+	// This stores the hash division being processed
+	int m_hash_div;
+	// This stores the residual relative to a node's pulse score
+	// below which the node is not passed on
+	float m_tolerance;
+	// This stores the smallest pulse score the push tolerance is taken
+	// relative to, this is the mean pulse score
+	float m_min_score;
+
+	// This loads the link set and back buffer for the hash division.
+	// The back buffer holds the src node of each link cluster in order.
+	// @param max_node_num - links to nodes at or above this are ignored
+	void LoadLinkSet(_int64 max_node_num) {
+
+		SPulseMap back_pulse_map;
+		CLinkClusterCodec link_cluster;
+
+		m_back_node_num.AllocateMemory(GetHashDivNum(), 0);
+
+		for(int i=0; i<GetHashDivNum(); i++) {
+			m_back_set.OpenReadFile(m_hash_div, i);
+			m_hash_link_set.OpenReadFile(m_hash_div, i);
+
+			CHDFSFile &clus_link_file = m_hash_link_set.File(m_hash_div);
+			CHDFSFile &back_file = m_back_set.File(m_hash_div);
+			clus_link_file.SetReadAhead(true);
+			back_file.SetReadAhead(true);
+
+			while(link_cluster.ReadLinkCluster(clus_link_file)) {
+				back_pulse_map.ReadPulseMap(back_file);
+
+				int id = m_graph.AddNode(back_pulse_map.node);
+				if(id >= m_pulse_score.Size()) {
+					m_pulse_score.PushBack(back_pulse_map.pulse_score);
+					m_out_weight.PushBack(0);
+				}
+
+				m_back_id.PushBack(id);
+				m_back_node.PushBack(back_pulse_map.node);
+				m_back_node_num[i]++;
+
+				for(int j=0; j<link_cluster.LinkNum(); j++) {
+					if(link_cluster.Dst(j).Value() >= max_node_num) {
+						// dst nodes are sorted so the rest are also out of range
+						break;
+					}
+
+					float link_weight = link_cluster.LinkWeight(j);
+					m_out_weight[id] += link_weight;
+					m_graph.AddLink(id, link_cluster.Dst(j), link_weight);
+				}
+			}
+
+			clus_link_file.CloseFile();
+			back_file.CloseFile();
+		}
+	}
+
+	// This finds the local nodes whose residual is large enough to be
+	// passed on this cycle. The residual of every other node is zero.
+	// A node's residual is kept until it grows large enough to be passed
+	// on so the unsent residual across all nodes is at most twice the
+	// tolerance. This also finds the net pulse score of the division,
+	// where the score passed along every link is the score last sent.
+	// @param active_link_num - stores the number of links from the nodes
+	// @param net_pulse_score - stores the net pulse score
+	// @return the number of nodes passed on
+	int FindActiveNodes(int &active_link_num, double &net_pulse_score) {
+
+		int active_num = 0;
+		active_link_num = 0;
+		net_pulse_score = 0;
+		for(int i=0; i<m_graph.NodeNum(); i++) {
+			float residual = m_pulse_score[i] - m_sent_score[i];
+			if(fabs(residual) <= m_tolerance * (m_pulse_score[i] + m_min_score)) {
+				m_residual[i] = 0;
+			} else {
+				m_residual[i] = residual;
+				m_sent_score[i] = m_pulse_score[i];
+				m_active_id[active_num++] = i;
+				active_link_num += m_graph.SrcLinkNum(i);
+			}
+
+			net_pulse_score += m_pulse_score[i] + m_sent_score[i] * m_out_weight[i];
+		}
+
+		return active_num;
+	}
+
+	// This performs a single pulse rank cycle. The residual of every node
+	// that has changed is passed to its neighbours, the residuals passed
+	// to other hash divisions are exchanged and then every score is 
+	// normalized by the net pulse score across all divisions.
+	// @param cycle - the current cycle
+	// @param thread_num - the number of threads to use
+	// @param residual - the L1 residual of this division on the last cycle,
+	//                 - this is updated with the residual on this cycle
+	// @return the L1 residual across all divisions on the last cycle
+	double PerformCycle(int cycle, int thread_num, double &residual) {
+
+		// the residuals are scattered on a single thread, so they're
+		// pulled along every link unless few links are visited
+		int active_link_num;
+		double net_pulse_score;
+		int active_num = FindActiveNodes(active_link_num, net_pulse_score);
+		if((_int64)active_link_num * thread_num * SCATTER_COST >= m_graph.LinkNum()) {
+			m_graph.Multiply(m_residual.Buffer(), m_forward_score.Buffer(), 1, thread_num);
+		} else {
+			m_forward_score.InitializeMemoryChunk(0);
+			m_graph.Scatter(m_active_id.Buffer(), active_num,
+				m_residual.Buffer(), m_forward_score.Buffer());
+		}
+
+		double value[4] = {net_pulse_score, residual, (double)active_num, (double)active_link_num};
+		double net_value[4];
+		m_graph.SendBoundary(m_forward_score.Buffer(), 1, cycle);
+		m_graph.Synchronize(cycle + 1, value, net_value, 4);
+		m_graph.ReceiveBoundary(m_forward_score.Buffer(), 1, cycle);
+
+		cout<<"Pulse Rank Cycle "<<cycle<<" Active Nodes "<<(_int64)net_value[2]
+			<<" Active Links "<<(_int64)net_value[3];
+		if(cycle > 0) {
+			cout<<" Residual "<<net_value[1];
+		}
+		cout<<endl;
+
+		residual = 0;
+		for(int i=0; i<m_graph.NodeNum(); i++) {
+			m_incoming_score[i] += m_forward_score[i];
+			float pulse_score = (float)((m_pulse_score[i] +
+				m_incoming_score[i]) / net_value[0]);
+
+			residual += fabs(pulse_score - m_pulse_score[i]);
+			m_pulse_score[i] = pulse_score;
+		}
+
+		return net_value[1];
+	}
+
+	// This writes the back buffer in the same order it was read
+	void WriteBackBuffer() {
+
+		int offset = 0;
+		SPulseMap pulse_map;
+		for(int i=0; i<GetHashDivNum(); i++) {
+			m_back_set.OpenWriteFile(m_hash_div, i);
+			CHDFSFile &back_file = m_back_set.File(m_hash_div);
+			back_file.InitializeCompression();
+
+			for(int j=0; j<m_back_node_num[i]; j++) {
+				pulse_map.node = m_back_node[offset];
+				pulse_map.pulse_score = m_pulse_score[m_back_id[offset++]];
+				pulse_map.WritePulseMap(back_file);
+			}
+
+			back_file.CloseFile();
+		}
+	}
+
+public:
+
+	CPulseRankGraph() {
+		CHDFSFile::Initialize();
+	}
+
+	// This is the entry function that performs all of the pulse rank cycles.
+	// Nothing is done if any of the hash divisions don't fit in memory.
+	// @param hash_div - this is the hash division being processed
+	// @param hash_div_num - this is the number of hash divisions
+	// @param cycle_num - this is the number of pulse rank cycles
+	// @param is_keyword_set - true if the keyword link set is being used
+	// @param max_node_num - this stores the upper end of the node spectrum
+	// @param max_byte_num - this is the maximum number of bytes to use for links
+	// @param thread_num - this is the number of threads to use
+	// @param push_tolerance - the residual relative to a node's pulse score
+	//                       - below which the node is not passed on, 0 to
+	//                       - pass on every node that has changed
+	// @param stop_tolerance - the L1 residual across all nodes at which the
+	//                       - cycles stop, 0 to perform every cycle
+	void PulseRankGraph(int hash_div, int hash_div_num, int cycle_num, bool is_keyword_set,
+		_int64 max_node_num, _int64 max_byte_num, int thread_num, 
+		double push_tolerance, double stop_tolerance) {
+
+		m_hash_div = hash_div;
+		CNodeStat::SetClientID(hash_div);
+		CNodeStat::SetHashDivNum(hash_div_num);
+		m_back_set.SetFileName("LocalData/back_wave_pass");
+		m_back_set.AllocateFileSet(hash_div_num);
+		m_hash_link_set.AllocateFileSet(hash_div_num);
+
+		if(is_keyword_set == true) {
+			m_hash_link_set.SetFileName("GlobalData/LinkSet/keyword_hash_link_set");
+		} else {
+			m_hash_link_set.SetFileName("GlobalData/LinkSet/webgraph_hash_link_set");
+		}
+
+		m_pulse_score.Initialize(1024);
+		m_out_weight.Initialize(1024);
+		m_back_id.Initialize(1024);
+		m_back_node.Initialize(1024);
+		m_graph.Initialize("LocalData/pulse_graph", hash_div, hash_div_num, max_byte_num);
+
+		LoadLinkSet(max_node_num);
+		if(m_graph.AskOverflow() == false) {
+			m_graph.CompileGraph();
+		}
+
+		double overflow = m_graph.AskOverflow() ? 1 : 0;
+		double net_overflow;
+		m_graph.Synchronize(0, &overflow, &net_overflow, 1);
+		if(net_overflow > 0) {
+			return;
+		}
+
+		cout<<"Hash Div "<<hash_div<<" Nodes "<<m_graph.NodeNum()<<" Boundary "
+			<<m_graph.BoundaryNum()<<" Links "<<m_graph.LinkNum()<<endl;
+
+		m_tolerance = (float)push_tolerance;
+		m_min_score = (float)(1.0 / max(max_node_num, (_int64)1));
+		m_graph.CompileSrcLinks();
+
+		int node_num = max(m_graph.NodeNum(), 1);
+		m_sent_score.AllocateMemory(node_num, 0);
+		m_residual.AllocateMemory(node_num);
+		m_active_id.AllocateMemory(node_num);
+		m_incoming_score.AllocateMemory(node_num, 0);
+		m_forward_score.AllocateMemory(max(m_graph.DstNum(), 1));
+
+		int cycle = 0;
+		double residual = 0;
+		while(cycle < cycle_num) {
+			double net_residual = PerformCycle(cycle++, thread_num, residual);
+			if(cycle > 1 && net_residual < stop_tolerance) {
+				break;
+			}
+		}
+
+		WriteBackBuffer();
+
+		CHDFSFile done_file;
+		done_file.OpenWriteFile(CUtility::ExtendString
+			("LocalData/pulse_graph_done", hash_div));
+		done_file.WriteObject(cycle);
+		done_file.CloseFile();
+	}
+};
+const int CPulseRankGraph::SCATTER_COST;
+
+int main(int argc, char *argv[]) {
+
+	if(argc < 2)return 0;
+	int hash_div = atoi(argv[1]);
+	int hash_div_num = atoi(argv[2]);
+	int cycle_num = atoi(argv[3]);
+	bool is_keyword_set = atoi(argv[4]);
+	_int64 max_node_num = CANConvert::AlphaToNumericLong(argv[5], strlen(argv[5]));
+	_int64 max_byte_num = (_int64)atoi(argv[6]) << 20;
+	int thread_num = atoi(argv[7]);
+	int push_exp = atoi(argv[8]);
+	int stop_exp = atoi(argv[9]);
+	double push_tolerance = push_exp > 0 ? pow(10.0, -push_exp) : 0;
+	double stop_tolerance = stop_exp > 0 ? pow(10.0, -stop_exp) : 0;
+
+	CBeacon::InitializeBeacon(hash_div);
+	CMemoryElement<CPulseRankGraph> graph;
+	try {
+		graph->PulseRankGraph(hash_div, hash_div_num, cycle_num, is_keyword_set,
+			max_node_num, max_byte_num, thread_num, push_tolerance, stop_tolerance);
+	} catch(...) {
+		// the other divisions would otherwise wait on the next barrier
+		CLinkGraph::SignalFailure("LocalData/pulse_graph", hash_div);
+		throw;
+	}
+	graph.DeleteMemoryElement();
+
+	CBeacon::SendTerminationSignal();
+
+	return 0;
+}
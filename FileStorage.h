@@ -548,31 +548,34 @@ class CLexon {
 	// for initilizing stopwords
 	void ReadTextFile(const char str[]) {
 
-		char ch; 
+		char buff[4096];
+		int size;
 		int word_length = 0; 
 		bool new_word = false; 
 
 		CHDFSFile file;
 		file.OpenReadFile(str);
 
-		while(file.ReadObject(ch)) {
-			ch = tolower(ch); 
-
-			if(CUtility::AskEnglishCharacter(ch)) {
-				new_word = false; 
-				CUtility::TempBuffer()[word_length++] = ch; 
-			} else if(!new_word && word_length) {
-				// adds the stop word to dictionary
-				int id = m_word_dictionary.AddWord(CUtility::TempBuffer(), word_length);
-				if(CStemWord::GetStem(CUtility::TempBuffer(), word_length) < 0) {
-					m_root_dict.AddRootWord(CUtility::TempBuffer(), word_length);
-				}
-				
-				m_word_occurrence.PushBack(1);
-				m_global_word_id.PushBack(id);
-				new_word = true; 
-				word_length = 0; 
-			} 
+		while((size = file.ReadObjectBlock(buff, sizeof(buff))) > 0) {
+			for(int i=0; i<size; i++) {
+				char ch = tolower(buff[i]); 
+
+				if(CUtility::AskEnglishCharacter(ch)) {
+					new_word = false; 
+					CUtility::TempBuffer()[word_length++] = ch; 
+				} else if(!new_word && word_length) {
+					// adds the stop word to dictionary
+					int id = m_word_dictionary.AddWord(CUtility::TempBuffer(), word_length);
+					if(CStemWord::GetStem(CUtility::TempBuffer(), word_length) < 0) {
+						m_root_dict.AddRootWord(CUtility::TempBuffer(), word_length);
+					}
+					
+					m_word_occurrence.PushBack(1);
+					m_global_word_id.PushBack(id);
+					new_word = true; 
+					word_length = 0; 
+				} 
+			}
 		}
 	}
 
@@ -1240,10 +1243,13 @@ class CCompression {
 		// the comp file for which a given
 		// comp block starts
 		_int64 byte_offset; 
+		// stores the codec used to compress the comp block
+		int codec;
 
 		void Reset() {
 			uncomp_size = 0; 
 			byte_offset = 0; 
+			codec = CBlockCodec::ZLIB_CODEC;
 		}
 	}; 
 
@@ -1259,6 +1265,8 @@ class CCompression {
 	_int64 m_bytes_read;
 	// This stores the current byte offset
 	_int64 m_curr_byte_offset;
+	// This stores the codec used to compress new comp blocks
+	int m_codec;
 
 	// stores the current compression block and offset in the block
 	SHitPosition m_next_pos; 
@@ -1267,37 +1275,50 @@ class CCompression {
 	// stores the compression block
 	CMemoryChunk<char> m_word_comp; 
 
+	// This stores the blocks waiting in the compression pool
+	SCompBlockThread *m_write_pipeline;
+	// This stores the maximum number of blocks in the pipeline
+	int m_pipeline_depth;
+	// This stores the oldest block in the pipeline
+	int m_pipeline_head;
+	// This stores the number of blocks in the pipeline
+	int m_pipeline_size;
+
 	// stores an instance of the writing file used to store 
 	// compressed blocks written to external storage
 	CHDFSFile m_hit_file;
 	// This stores the lookup blocks
 	CHDFSFile m_lookup_file;
+	// This stores the mapped comp blocks when the index is mapped
+	CMappedFile m_hit_map;
+	// This stores the mapped comp block lookup when the index is mapped
+	CMappedFile m_lookup_map;
 
 	// Writes the compression block offset to file
 	void FlushCompressionSizeToFile() {
 
 		for(int i=0; i<m_comp_size.Size(); i++) {
+			uLong uncomp_size = CBlockCodec::EncodeBlockSize
+				(m_comp_size[i].uncomp_size, m_comp_size[i].codec);
+
 			m_lookup_file.WriteObject(m_comp_size[i].byte_offset); 
-			m_lookup_file.WriteObject(m_comp_size[i].uncomp_size); 
+			m_lookup_file.WriteObject(uncomp_size); 
 		}
 
 		m_comp_size.Resize(0); 
 	}
 
-	// Compress the buffer and writes to the end of the file
-	// @return the most recent file division
-	void FlushHitListToFile() {
-
-		CMemoryChunk<char> compress_buff; 
-		int compress_size = CHDFSFile::CompressBuffer(m_hit_buffer.Buffer(), 
-			compress_buff, m_hit_buffer.Size()); 
-
-		if(compress_size <= 0) {
-			return; 
-		}
+	// This writes a compressed block to the end of the file and 
+	// adds it to the comp block index
+	// @param compress_buff - the compressed block
+	// @param compress_size - the size of the compressed block in bytes
+	// @param uncomp_size - the size of the block before it was compressed
+	// @param codec - the codec used to compress the block
+	void WriteCompBlock(const char compress_buff[], int compress_size, 
+		int uncomp_size, int codec) {
 
 		// writes the compressed hit buffer
-		m_hit_file.WriteObject(compress_buff.Buffer(), compress_size); 
+		m_hit_file.WriteObject(compress_buff, compress_size); 
 
 		if((m_comp_size.Size() + 1) >= m_comp_size.OverflowSize()) {
 			FlushCompressionSizeToFile(); 
@@ -1310,7 +1331,75 @@ class CCompression {
 		// stores the comp block index info
 		m_comp_size.ExtendSize(1); 
 		m_comp_size.LastElement().byte_offset = m_curr_byte_offset; 
-		m_comp_size.LastElement().uncomp_size = m_hit_buffer.Size(); 
+		m_comp_size.LastElement().uncomp_size = uncomp_size; 
+		m_comp_size.LastElement().codec = codec; 
+	}
+
+	// This waits for the oldest block in the compression pipeline
+	// to be compressed and writes it to external storage
+	void WritePipelineBlock() {
+
+		SCompBlockThread &block = m_write_pipeline[m_pipeline_head];
+		block.compressed.Wait();
+
+		m_pipeline_head = (m_pipeline_head + 1) % m_pipeline_depth;
+		m_pipeline_size--;
+
+		if(block.compress_size <= 0) {
+			throw ECompressionException("Could Not Compress Buffer"); 
+		}
+
+		WriteCompBlock(block.comp_buffer.Buffer(), block.compress_size,
+			block.norm_buffer.Size(), block.codec);
+	}
+
+	// This writes every block left in the compression pipeline
+	void FlushPipeline() {
+
+		while(m_pipeline_size > 0) {
+			WritePipelineBlock();
+		}
+	}
+
+	// Compress the buffer and writes to the end of the file. If the 
+	// pipeline is enabled the hit buffer is swapped with a free block
+	// and handed to the compression pool instead.
+	void FlushHitListToFile() {
+
+		if(m_pipeline_depth > 0) {
+			if(m_pipeline_size >= m_pipeline_depth) {
+				WritePipelineBlock();
+			}
+
+			SCompBlockThread &block = m_write_pipeline
+				[(m_pipeline_head + m_pipeline_size) % m_pipeline_depth];
+
+			block.norm_buffer.Swap(m_hit_buffer);
+			if(m_hit_buffer.OverflowSize() != BufferSize()) {
+				m_hit_buffer.Initialize(BufferSize());
+			}
+
+			m_hit_buffer.Resize(0); 
+			m_div_size.comp_block_num++; 
+			m_div_size.bytes_stored += block.norm_buffer.Size(); 
+
+			block.codec = m_codec;
+			m_pipeline_size++;
+			CCompBlockPool::AddBlock(&block);
+			return;
+		}
+
+		int codec = m_codec;
+		CMemoryChunk<char> compress_buff; 
+		int compress_size = CBlockCodec::Compress(codec, m_hit_buffer.Buffer(), 
+			compress_buff, m_hit_buffer.Size()); 
+
+		if(compress_size <= 0) {
+			return; 
+		}
+
+		WriteCompBlock(compress_buff.Buffer(), compress_size, 
+			m_hit_buffer.Size(), codec);
 
 		// increments the number of compression blocks 
 		// stored in the current file division
@@ -1344,17 +1433,38 @@ class CCompression {
 			comp_index.LastElement().Reset(); 
 		}
 
+		_int64 lookup_offset = (_int64)comp_block_offset * (sizeof(_int64) + sizeof(uLong));
+
+		// the name is not built in a shared temp buffer since
+		// comp blocks may be retrieved by multiple threads
+		char file_name[sizeof(m_directory) + 20];
+		strcpy(file_name, m_directory);
+		strcat(file_name, ".comp.comp_lookup");
+
 		CHDFSFile file; 
-		file.OpenReadFile(CUtility::ExtendString
-			(m_directory, ".comp.comp_lookup")); 
-		file.SeekReadFileFromBeginning(comp_block_offset * (sizeof(_int64) + sizeof(uLong))); 
+		if(m_lookup_map.IsOpen() == false) {
+			file.OpenReadFile(file_name); 
+			file.SeekReadFileFromBeginning(lookup_offset); 
+		}
 
 		// reads the lookup index information first so
 		// the correct comp retr_comp_buff can be retrieved
 		for(int i=0; i<index_num; i++) {
 			comp_index.ExtendSize(1); 
-			file.ReadObject(comp_index.LastElement().byte_offset); 	
-			file.ReadObject(comp_index.LastElement().uncomp_size); 	
+			SCompIndex1 &index = comp_index.LastElement();
+
+			if(m_lookup_map.IsOpen() == true) {
+				m_lookup_map.ReadBytes(lookup_offset, (char *)&index.byte_offset, sizeof(_int64));
+				lookup_offset += sizeof(_int64);
+				m_lookup_map.ReadBytes(lookup_offset, (char *)&index.uncomp_size, sizeof(uLong));
+				lookup_offset += sizeof(uLong);
+			} else {
+				file.ReadObject(index.byte_offset); 	
+				file.ReadObject(index.uncomp_size); 	
+			}
+
+			index.codec = CBlockCodec::BlockCodec(index.uncomp_size);
+			index.uncomp_size = CBlockCodec::BlockSize(index.uncomp_size);
 		}
 	}
 
@@ -1375,9 +1485,31 @@ class CCompression {
 		// stores the current byte offset within comp file
 		_int64 curr_byte_offset = comp_index[0].byte_offset; 
 
+		if(m_hit_map.IsOpen() == true) {
+			// decompresses straight out of the mapped file
+			for(int i=1; i<comp_block_num + 1; i++) {
+				int compress_size = (int)(comp_index[i].byte_offset - curr_byte_offset);
+				if(comp_index[i].byte_offset > m_hit_map.FileSize()) {
+					throw EFileException("Mapped Comp Block Out Of Bounds");
+				}
+
+				CBlockCodec::Decompress(comp_index[i].codec, 
+					m_hit_map.Buffer() + curr_byte_offset, retr_comp_buff.Buffer() + 
+					retr_offset, compress_size, comp_index[i].uncomp_size); 
+
+				curr_byte_offset = comp_index[i].byte_offset; 
+				retr_offset += comp_index[i].uncomp_size; 	
+			}
+
+			return;
+		}
+
+		char file_name[sizeof(m_directory) + 20];
+		strcpy(file_name, m_directory);
+		strcat(file_name, ".comp.hit");
+
 		CHDFSFile file; 
-		file.OpenReadFile(CUtility::ExtendString
-			(m_directory, ".comp.hit")); 
+		file.OpenReadFile(file_name); 
 		file.SeekReadFileFromBeginning(curr_byte_offset * sizeof(char)); 
 
 		for(int i=1; i<comp_block_num + 1; i++) {
@@ -1387,8 +1519,9 @@ class CCompression {
 			file.ReadObject(decompress.Buffer(), decompress.OverflowSize()); 
 
 			// now decompress the buffer
-			file.DecompressBuffer(decompress.Buffer(), retr_comp_buff.Buffer() + retr_offset, 
-				decompress.OverflowSize(), comp_index[i].uncomp_size); 
+			CBlockCodec::Decompress(comp_index[i].codec, decompress.Buffer(),
+				retr_comp_buff.Buffer() + retr_offset, decompress.OverflowSize(), 
+				comp_index[i].uncomp_size); 
 
 			curr_byte_offset = comp_index[i].byte_offset; 
 			retr_offset += comp_index[i].uncomp_size; 	
@@ -1406,6 +1539,7 @@ class CCompression {
 			FlushHitListToFile(); 
 		}
 
+		FlushPipeline();
 		if(m_comp_size.Size() > 0) {
 			FlushCompressionSizeToFile(); 
 		}
@@ -1422,12 +1556,21 @@ class CCompression {
 public:
 
 	CCompression() {
+		m_codec = CBlockCodec::ZLIB_CODEC;
+		m_write_pipeline = NULL;
+		m_pipeline_depth = 0;
+		m_pipeline_head = 0;
+		m_pipeline_size = 0;
 	}
 
 	// Sets up the buffer and the compression index
 	// return true if the comp buffer has already been
 	// initialized before, false otherwise
 	CCompression(const char str[], int buffer_size = 1500000) {
+		m_write_pipeline = NULL;
+		m_pipeline_depth = 0;
+		m_pipeline_head = 0;
+		m_pipeline_size = 0;
 		Initialize(str, buffer_size); 
 	}
 
@@ -1441,6 +1584,7 @@ public:
 
 		strcpy(m_directory, str); 
 		m_div_size.Initialize(buffer_size); 
+		m_codec = CBlockCodec::DefaultCodec(str);
 
 		m_div_size.buffer_size = buffer_size; 
 		m_hit_buffer.Initialize(BufferSize()); 
@@ -1453,11 +1597,84 @@ public:
 			(m_directory, ".comp.comp_lookup"));
 	}
 
-	// forces flushes the hit buffer
+	// forces flushes the hit buffer and any blocks
+	// still waiting in the compression pipeline
 	inline void ForceFlush() {
 		if(m_hit_buffer.Size() > 0) {
 			FlushHitListToFile(); 
 		}
+
+		FlushPipeline();
+	}
+
+	// This hands filled comp blocks to the shared compression pool 
+	// instead of compressing them on the caller's thread. Blocks are
+	// still written and indexed in order so the format is unchanged.
+	// @param block_num - the maximum number of blocks waiting to be
+	//                  - compressed, zero compresses on the caller
+	void SetCompressionPipeline(int block_num) {
+
+		FlushPipeline();
+		if(m_write_pipeline != NULL) {
+			delete []m_write_pipeline;
+			m_write_pipeline = NULL;
+		}
+
+		m_pipeline_head = 0;
+		m_pipeline_size = 0;
+		m_pipeline_depth = max(block_num, 0);
+		if(m_pipeline_depth > 0) {
+			m_write_pipeline = new SCompBlockThread[m_pipeline_depth];
+		}
+	}
+
+	// This appends every comp block of another finished comp buffer onto
+	// the end of this comp buffer without decompressing them. Any items in
+	// the hit buffer are flushed first, so the result is identical to adding
+	// the items of the other comp buffer followed by a forced flush.
+	// @param comp - the comp buffer being appended, this must have 
+	//             - the same buffer size as this comp buffer
+	void AppendCompression(CCompression &comp) {
+
+		if(comp.BufferSize() != BufferSize()) {
+			throw EIllegalArgumentException("Append Buffer Size Mismatch");
+		}
+
+		ForceFlush();
+		if(comp.CompBlockNum() <= 0) {
+			return;
+		}
+
+		CArray<SCompIndex1> comp_index(comp.CompBlockNum() + 1);
+		comp.RetrieveCompIndexLookup(comp.CompBlockNum(), 0, comp_index);
+
+		char file_name[sizeof(m_directory) + 20];
+		strcpy(file_name, comp.DirectoryName());
+		strcat(file_name, ".comp.hit");
+
+		CHDFSFile file; 
+		file.OpenReadFile(file_name); 
+		CMemoryChunk<char> compress_buff;
+
+		for(int i=1; i<comp_index.Size(); i++) {
+			int compress_size = (int)(comp_index[i].byte_offset - comp_index[i-1].byte_offset);
+			compress_buff.AllocateMemory(compress_size);
+			file.ReadObject(compress_buff.Buffer(), compress_size); 
+			m_hit_file.WriteObject(compress_buff.Buffer(), compress_size); 
+
+			if((m_comp_size.Size() + 1) >= m_comp_size.OverflowSize()) {
+				FlushCompressionSizeToFile(); 
+			}
+
+			m_curr_byte_offset += compress_size; 
+			m_comp_size.ExtendSize(1); 
+			m_comp_size.LastElement().byte_offset = m_curr_byte_offset; 
+			m_comp_size.LastElement().uncomp_size = comp_index[i].uncomp_size; 
+			m_comp_size.LastElement().codec = comp_index[i].codec; 
+
+			m_div_size.comp_block_num++; 
+			m_div_size.bytes_stored += comp_index[i].uncomp_size; 
+		}
 	}
 
 	// This sets the buffer size, if the comp buffer is currently
@@ -1468,6 +1685,13 @@ public:
 		m_div_size.buffer_size = buffer_size; 
 	}
 
+	// This overrides the codec used to compress new comp blocks
+	// @param codec - one of the codecs defined in CBlockCodec
+	inline void SetCodec(int codec) {
+		ForceFlush();
+		m_codec = codec;
+	}
+
 	// Sets a new directory name
 	inline void SetDirectoryName(const char str[]) {
 		strcpy(m_directory, str); 
@@ -2037,15 +2261,33 @@ public:
 	}
 
 	// loads the compression index in from memory
-	void LoadIndex(const char str[] = NULL) {
+	// @param is_mapped - true if the comp blocks and lookup should be 
+	//                  - mapped read only into memory rather than read
+	//                  - from file on every retrieval
+	void LoadIndex(const char str[] = NULL, bool is_mapped = false) {
 
 		if(str != NULL) {
 			strcpy(DirectoryName(), str); 
 		}
 
-		CHDFSFile file; 
+		m_hit_map.CloseFile();
+		m_lookup_map.CloseFile();
 		strcpy(CUtility::ThirdTempBuffer(), DirectoryName());
 		strcat(CUtility::ThirdTempBuffer(), ".comp.comp_lookup");
+
+		if(is_mapped == true) {
+			m_lookup_map.OpenMappedFile(CUtility::ThirdTempBuffer());
+			m_lookup_map.ReadBytes(m_lookup_map.FileSize() - sizeof(SDivSize), 
+				(char *)&m_div_size, sizeof(SDivSize));
+
+			m_hit_map.OpenMappedFile(CUtility::ExtendString
+				(DirectoryName(), ".comp.hit"));
+
+			ResetNextHitItem(); 
+			return;
+		}
+
+		CHDFSFile file; 
 		file.OpenReadFile(CUtility::ThirdTempBuffer()); 
 		file.SeekReadFileFromBeginning(file.ReadFileSize() - sizeof(SDivSize));
 		file.ReadObject(m_div_size);
@@ -2053,6 +2295,31 @@ public:
 		ResetNextHitItem(); 
 	}
 
+	// Returns true if the comp blocks are mapped into memory
+	inline bool IsMapped() {
+		return m_hit_map.IsOpen();
+	}
+
+	// This writes every comp block out uncompressed to a single flat
+	// file so the index can be mapped and read without decompression.
+	// Byte offsets in the flat file are identical to byte offsets in the
+	// comp buffer. The index must have been loaded beforehand.
+	void CreateFlatFile() {
+
+		CHDFSFile flat_file;
+		flat_file.OpenWriteFile(CUtility::ExtendString
+			(DirectoryName(), ".comp.flat"));
+
+		CMemoryChunk<char> block;
+		for(int i=0; i<CompBlockNum(); i++) {
+			int comp_block_num = 1;
+			int block_size = GetUncompressedBlock(block, comp_block_num, i);
+			if(block_size > 0) {
+				flat_file.WriteObject(block.Buffer(), block_size);
+			}
+		}
+	}
+
 	// Called once at the end when no more information 
 	// needs to be written to the compression index
 	void FinishCompression() {
@@ -2066,6 +2333,10 @@ public:
 
 	~CCompression() {
 		FinishCompression(); 
+
+		if(m_write_pipeline != NULL) {
+			delete []m_write_pipeline;
+		}
 	}
 }; 
 
@@ -2093,6 +2364,25 @@ struct SCompBlockPtr {
 	SCompBlockPtr *prev_cache_ptr;
 };
 
+// This stores one shard of the comp block cache. Each shard has its
+// own LRU list, free list and byte budget and is guarded by its own 
+// mutex, so query threads only contend when they access the same shard.
+struct SCompBlockShard {
+	// This guards every field in the shard along with the hash 
+	// divisions of each hit item block that map to this shard
+	CMutex mutex;
+	// This stores the head of the linked cache blocks
+	SCompBlockPtr *head_cache_ptr;
+	// This stores the tail of the linked cache blocks
+	SCompBlockPtr *tail_cache_ptr;
+	// This stores all the comp blocks loaded into memory
+	CLinkedBuffer<SCompBlockPtr> loaded_comp_block;
+	// This stores a pointer to the free list of comp blocks
+	SCompBlockPtr *free_list;
+	// This stores the total number of bytes loaded into memory
+	_int64 bytes_loaded;
+};
+
 // This class stores a list of high occuring comp blocks in memory and
 // returns requested segments to the user. If a comp block is not available
 // than it has to be loaded externally from memory. If there is not enough
@@ -2102,10 +2392,18 @@ struct SCompBlockPtr {
 // a block is added to the list an entry needs to be made in the tree. Like wise
 // when a block is freed, the previous entry needs to be removed from the 
 // linked list.
+
+// The cache is shared by all instances and is split into a number of 
+// shards. Each hash division of an instance is assigned to a single shard
+// and comp blocks in that division are only ever cached, found or evicted 
+// while holding that shard's lock. This allows many query threads to 
+// retrieve bytes concurrently.
 class CHitItemBlock {
 
-	// This defines the maximum number of bytes allowed in memory
-	static const int MAX_BYTE_NUM = 500000000;
+	// This defines the default number of bytes allowed in memory
+	static const _int64 MAX_BYTE_NUM = 500000000;
+	// This defines the default number of cache shards
+	static const int SHARD_NUM = 16;
 
 	// This stores the hashed red black trees, which gives pointers
 	// to comp blocks loaded into memory
@@ -2114,28 +2412,49 @@ class CHitItemBlock {
 	int m_hash_block_num;
 	// This stores an instance of the comp buffer
 	CCompression m_comp;
-	// This stores the previois comp block accessed
-	SCompBlockPtr *m_prev_comp_ptr;
-
-	// This stores the head of the linked cache blocks
-	static SCompBlockPtr *m_head_cache_ptr;
-	// This stores the tail of the linked cache blocks
-	static SCompBlockPtr *m_tail_cache_ptr;
-	// This stores all the comp blocks loaded into memory
-	static CLinkedBuffer<SCompBlockPtr> m_loaded_comp_block;
-	// This stores a pointer to the free list of comp blocks
-	static SCompBlockPtr *m_free_list;
-	// This stores the total number of bytes loaded into memory
-	static int m_bytes_loaded;
+	// This stores the shard assigned to the first hash division
+	int m_shard_offset;
+	// This stores the uncompressed flat file if one exists, in which
+	// case bytes are read directly from the mapping and not cached
+	CMappedFile m_flat_map;
+
+	// This stores each of the cache shards
+	static CMemoryChunk<SCompBlockShard> m_shard;
+	// This stores the maximum number of bytes allowed in each shard
+	static _int64 m_shard_byte_num;
+	// This stores the number of hit item blocks that have been initialized
+	static int m_instance_num;
+	// This guards the session id
+	static CMutex m_session_mutex;
 	// This stores the current query instance
 	static uLong m_session_id;
+	// This stores the number of most recent query instances whose
+	// comp blocks are pinned, one for each concurrent query thread
+	static int m_pin_session_num;
+
+	// This returns the hash division for a given byte offset
+	inline int HashDiv(_int64 byte_offset) {
+		return (int)(byte_offset / ((_int64)m_comp.BufferSize() * m_hash_block_num));
+	}
+
+	// This returns the shard responsible for a given hash division
+	inline SCompBlockShard &Shard(int hash_div) {
+		return m_shard[(m_shard_offset + hash_div) % m_shard.OverflowSize()];
+	}
+
+	// This returns the current query instance
+	static uLong SessionID() {
+		m_session_mutex.Acquire();
+		uLong session_id = m_session_id;
+		m_session_mutex.Release();
+		return session_id;
+	}
 
 	// This removes a comp block from the hash list when it has been evicted.
 	// @param comp_block - this is a pointer to the comp block being removed
 	void RemoveCompBlock(SCompBlockPtr *comp_block) {
 
-		int hash_div = (int)(comp_block->start_bound / 
-			(m_comp.BufferSize() * m_hash_block_num));
+		int hash_div = HashDiv(comp_block->start_bound);
 
 		SCompBlockPtr *prev_ptr = NULL;
 		SCompBlockPtr *curr_ptr = m_hash_list[hash_div];
@@ -2159,94 +2478,97 @@ class CHitItemBlock {
 
 	// This moves the most recently accessed comp_block to 
 	// the head of the LRU list.
-	void PromoteCompBlock(SCompBlockPtr *comp_ptr) {
+	// @param shard - this is the shard that contains the comp block
+	static void PromoteCompBlock(SCompBlockShard &shard, SCompBlockPtr *comp_ptr) {
 
-		if(comp_ptr == m_head_cache_ptr) {
+		if(comp_ptr == shard.head_cache_ptr) {
 			// already at the head of the list
 			return;
 		}
 
-		if(comp_ptr == m_tail_cache_ptr) {
+		if(comp_ptr == shard.tail_cache_ptr) {
 			// reassigns the tail
-			m_tail_cache_ptr = comp_ptr->prev_cache_ptr;
-			m_tail_cache_ptr->next_cache_ptr = NULL;
+			shard.tail_cache_ptr = comp_ptr->prev_cache_ptr;
+			shard.tail_cache_ptr->next_cache_ptr = NULL;
 		} else {
 			// links up the nodes in the list
 			(comp_ptr->prev_cache_ptr)->next_cache_ptr = comp_ptr->next_cache_ptr;
 			(comp_ptr->next_cache_ptr)->prev_cache_ptr = comp_ptr->prev_cache_ptr;
-
-			if(comp_ptr->prev_cache_ptr == NULL) {
-				cout<<"mo";getchar();
-			}
 		}
 
-		SCompBlockPtr *prev_ptr = m_head_cache_ptr;
-		m_head_cache_ptr = comp_ptr;
-		m_head_cache_ptr->next_cache_ptr = prev_ptr;
-		m_head_cache_ptr->prev_cache_ptr = NULL;
-		prev_ptr->prev_cache_ptr = m_head_cache_ptr;
+		SCompBlockPtr *prev_ptr = shard.head_cache_ptr;
+		shard.head_cache_ptr = comp_ptr;
+		shard.head_cache_ptr->next_cache_ptr = prev_ptr;
+		shard.head_cache_ptr->prev_cache_ptr = NULL;
+		prev_ptr->prev_cache_ptr = shard.head_cache_ptr;
 	}
 
 	// This evicts a comp block from memory. This means adding a comp buffer
-	// entry to the free list for later use.
-	bool EvictCompBlock() {
+	// entry to the free list for later use. Comp blocks accessed by any of 
+	// the most recent query instances are pinned and cannot be evicted.
+	// @param shard - this is the shard to evict from
+	// @param session_id - this is the current query instance
+	static bool EvictCompBlock(SCompBlockShard &shard, uLong session_id) {
 
-		if(m_tail_cache_ptr == NULL) {
+		if(shard.tail_cache_ptr == NULL) {
 			return false;
 		}
 		
-		if(m_tail_cache_ptr->session_id == m_session_id) {
+		if(shard.tail_cache_ptr->session_id + m_pin_session_num > session_id) {
 			return false;
 		}
 		
-		m_bytes_loaded -= m_tail_cache_ptr->block.OverflowSize();
-		m_tail_cache_ptr->block.FreeMemory();
+		shard.bytes_loaded -= shard.tail_cache_ptr->block.OverflowSize();
+		shard.tail_cache_ptr->block.FreeMemory();
 
-		SCompBlockPtr *cache_ptr = m_tail_cache_ptr;
-		m_tail_cache_ptr = cache_ptr->prev_cache_ptr;
-		if(m_tail_cache_ptr != NULL) {
-			m_tail_cache_ptr->next_cache_ptr = NULL;
+		SCompBlockPtr *cache_ptr = shard.tail_cache_ptr;
+		shard.tail_cache_ptr = cache_ptr->prev_cache_ptr;
+		if(shard.tail_cache_ptr != NULL) {
+			shard.tail_cache_ptr->next_cache_ptr = NULL;
+		} else {
+			shard.head_cache_ptr = NULL;
 		}
 
 		CHitItemBlock *this_ptr = (CHitItemBlock *)cache_ptr->hit_set_ptr;
 		this_ptr->RemoveCompBlock(cache_ptr);
 
-		SCompBlockPtr *prev_ptr = m_free_list;
-		m_free_list = cache_ptr;
-		m_free_list->next_cache_ptr = prev_ptr;
+		SCompBlockPtr *prev_ptr = shard.free_list;
+		shard.free_list = cache_ptr;
+		shard.free_list->next_cache_ptr = prev_ptr;
 		return true;
 	}
 
 	// This adds a new comp_block to the set of cached comp_blocks
-	inline void AddCompBlockToCachedSet(SCompBlockPtr *ptr) {
+	// @param shard - this is the shard that contains the comp block
+	static void AddCompBlockToCachedSet(SCompBlockShard &shard, SCompBlockPtr *ptr) {
 
-		SCompBlockPtr *prev_ptr = m_head_cache_ptr;
-		m_head_cache_ptr = ptr;
-		m_head_cache_ptr->next_cache_ptr = prev_ptr;
+		SCompBlockPtr *prev_ptr = shard.head_cache_ptr;
+		shard.head_cache_ptr = ptr;
+		shard.head_cache_ptr->next_cache_ptr = prev_ptr;
 
 		if(prev_ptr != NULL) {
-			prev_ptr->prev_cache_ptr = m_head_cache_ptr;
+			prev_ptr->prev_cache_ptr = shard.head_cache_ptr;
 		} else {
-			m_tail_cache_ptr = m_head_cache_ptr;
+			shard.tail_cache_ptr = shard.head_cache_ptr;
 		}
 
-		m_head_cache_ptr->prev_cache_ptr = NULL;
+		shard.head_cache_ptr->prev_cache_ptr = NULL;
 	}
 
 	// This adds a new comp block to the hash table so it can be 
 	// later retrieved during a lookup.
 	// @param ptr - this is a ptr to the comp block being added
 	// @param comp_offset - this is the id of the comp block
-	void AddCompBlockToHashTable(SCompBlockPtr *ptr, int comp_offset) {
+	// @param session_id - this is the current query instance
+	void AddCompBlockToHashTable(SCompBlockPtr *ptr, int comp_offset, uLong session_id) {
 
 		int hash_div = (int)(comp_offset / m_hash_block_num);
 		SCompBlockPtr *prev_ptr = m_hash_list[hash_div];
-		m_prev_comp_ptr = ptr;
 
 		m_hash_list[hash_div] = ptr;
 		ptr->next_hash_ptr = prev_ptr;
 
-		ptr->session_id = m_session_id;
+		ptr->session_id = session_id;
 		ptr->start_bound = (_int64)comp_offset * m_comp.BufferSize();
 		ptr->end_bound = ptr->start_bound + ptr->block.OverflowSize();
 		ptr->hit_set_ptr = this;
@@ -2254,63 +2576,70 @@ class CHitItemBlock {
 
 	// This loads in a comp block from external storage and stores it
 	// internally. One of the existing comp blocks may need to be evicted.
+	// The shard lock must be held by the caller.
+	// @param shard - this is the shard responsible for the comp block
 	// @param byte_offset - this is the offset for which the comp buffer is 
 	//                    - being retrieved
-	void LoadCompBlock(_int64 &byte_offset) {
+	// @param session_id - this is the current query instance
+	// @return a ptr to the loaded comp block
+	SCompBlockPtr *LoadCompBlock(SCompBlockShard &shard, 
+		_int64 &byte_offset, uLong session_id) {
 
-		while(m_bytes_loaded >= MAX_BYTE_NUM) {
-			if(EvictCompBlock() == false) {
+		while(shard.bytes_loaded >= m_shard_byte_num) {
+			if(EvictCompBlock(shard, session_id) == false) {
 				break;
 			}
 		}
 		
-		SCompBlockPtr *ptr = m_free_list;
+		SCompBlockPtr *ptr = shard.free_list;
 		if(ptr == NULL) {
-			ptr = m_loaded_comp_block.ExtendSize(1);
+			ptr = shard.loaded_comp_block.ExtendSize(1);
 		} else {
-			m_free_list = m_free_list->next_hash_ptr;
+			shard.free_list = shard.free_list->next_cache_ptr;
 		}
 
 		int comp_blocks = 1;
 		int comp_offset = (int)(byte_offset / m_comp.BufferSize());
-		m_comp.GetUncompressedBlock(ptr->block, comp_blocks, comp_offset);
-		m_bytes_loaded += ptr->block.OverflowSize();
+		if(m_comp.GetUncompressedBlock(ptr->block, comp_blocks, comp_offset) < 0) {
+			ptr->block.FreeMemory();
+		}
 
-		AddCompBlockToHashTable(ptr, comp_offset);
-		AddCompBlockToCachedSet(ptr);
+		if(byte_offset < (_int64)comp_offset * m_comp.BufferSize() || 
+			byte_offset >= (_int64)comp_offset * m_comp.BufferSize() 
+			+ ptr->block.OverflowSize()) {
 
-		if(byte_offset < ptr->start_bound) {
-			cout<<"start bound error";getchar();
+			// the comp block cannot be cached so it's returned to the free list
+			ptr->next_cache_ptr = shard.free_list;
+			shard.free_list = ptr;
+			throw EException("Comp Block Bound Error");
 		}
 
-		if(byte_offset >= ptr->end_bound) {
-			cout<<"end bound error";getchar();
-		}
+		shard.bytes_loaded += ptr->block.OverflowSize();
+
+		AddCompBlockToHashTable(ptr, comp_offset, session_id);
+		AddCompBlockToCachedSet(shard, ptr);
+
+		return ptr;
 	}
 
 	// This looks for an existing comp block that bounds a given 
 	// byte offset. If the block does not exist than null is returned.
+	// The shard lock must be held by the caller.
+	// @param shard - this is the shard responsible for the comp block
 	// @param byte_offset - this is the byte offset being retrieved
+	// @param session_id - this is the current query instance
 	// @return a ptr to the comp block if it exists, NULL otherwise
-	SCompBlockPtr *FindCompBlock(_int64 &byte_offset) {
+	SCompBlockPtr *FindCompBlock(SCompBlockShard &shard, 
+		_int64 &byte_offset, uLong session_id) {
 
-		if(m_prev_comp_ptr != NULL) {
-			if(byte_offset >= m_prev_comp_ptr->start_bound && 
-				byte_offset < m_prev_comp_ptr->end_bound) {
-
-				return m_prev_comp_ptr;
-			}
-		}
-
-		int hash_div = (int)(byte_offset / (m_comp.BufferSize() * m_hash_block_num));
-		SCompBlockPtr *curr_ptr = m_hash_list[hash_div];
+		SCompBlockPtr *curr_ptr = m_hash_list[HashDiv(byte_offset)];
 
 		while(curr_ptr != NULL) {
 			if(byte_offset >= curr_ptr->start_bound && 
 				byte_offset < curr_ptr->end_bound) {
 
-				m_prev_comp_ptr = curr_ptr;
-				PromoteCompBlock(curr_ptr);
+				curr_ptr->session_id = session_id;
+				PromoteCompBlock(shard, curr_ptr);
 
 				return curr_ptr;
 			}
@@ -2324,61 +2653,103 @@ class CHitItemBlock {
 	// storage at some offset. The comp block will need to be loaded 
 	// into memory if it not already availabe. Also an existing comp 
 	// block may need to be evicted if there is not enough memory available.
+	// Bytes are copied out while the shard lock is held so the comp block
+	// cannot be evicted by another thread during the copy.
 	// @param byte_offset - this is the byte offset in the comp buffer
 	// @param byte_num - this is the number of bytes to retrieve
 	// @param buff - this is where all the retrieved bytes are stored 
 	void RecurseByteSet(_int64 &byte_offset, int byte_num, char buff[]) {
 		
-		SCompBlockPtr *curr_ptr = FindCompBlock(byte_offset);
+		uLong session_id = SessionID();
+
+		while(byte_num > 0) {
+			SCompBlockShard &shard = Shard(HashDiv(byte_offset));
+			shard.mutex.Acquire();
+
+			SCompBlockPtr *curr_ptr;
+			try {
+				curr_ptr = FindCompBlock(shard, byte_offset, session_id);
+				if(curr_ptr == NULL) {
+					curr_ptr = LoadCompBlock(shard, byte_offset, session_id);
+				}
+			} catch(...) {
+				shard.mutex.Release();
+				throw;
+			}
 
-		if(curr_ptr != NULL) {
 			// found the block copy accross the bytes
 			int offset = (int)(byte_offset - curr_ptr->start_bound);
 			int copy_byte_num = curr_ptr->block.OverflowSize() - offset;
 
 			copy_byte_num = min(byte_num, copy_byte_num);
 			memcpy(buff, curr_ptr->block.Buffer() + offset, copy_byte_num);
+			shard.mutex.Release();
 
 			byte_num -= copy_byte_num;
 			buff += copy_byte_num;
 			byte_offset += copy_byte_num;
-			
-			if(byte_num > 0) {
-				RecurseByteSet(byte_offset, byte_num, buff);
-			} 
-
-			return;
 		}
-
-		LoadCompBlock(byte_offset);
-		RecurseByteSet(byte_offset, byte_num, buff);
 	}
 
 public:
 
 	CHitItemBlock() {
-		m_prev_comp_ptr = NULL;
+		m_shard_offset = 0;
 	}
 
-	// This initializes the priority queue for LRU
-	static void InitializeLRUQueue() {
+	// This initializes the cache shared by all hit item blocks. This
+	// must be called before any hit item block is used.
+	// @param max_byte_num - the maximum number of bytes allowed in memory
+	// @param query_thread_num - the number of threads performing queries
+	//                         - concurrently, comp blocks accessed by this 
+	//                         - many of the most recent queries are pinned
+	// @param shard_num - the number of independently locked shards
+	static void InitializeLRUQueue(_int64 max_byte_num = MAX_BYTE_NUM,
+		int query_thread_num = 1, int shard_num = SHARD_NUM) {
+
+		if(max_byte_num <= 0 || query_thread_num <= 0 || shard_num <= 0) {
+			throw EIllegalArgumentException("Invalid LRU Queue Argument");
+		}
 
 		m_session_id = 0;
-		m_bytes_loaded = 0;
-		m_loaded_comp_block.Initialize(0xFF);
+		m_pin_session_num = query_thread_num;
+		m_shard_byte_num = max(max_byte_num / shard_num, (_int64)1);
+		m_shard.AllocateMemory(shard_num);
 
-		m_free_list = NULL;
-		m_head_cache_ptr = NULL;
-		m_tail_cache_ptr = NULL;
+		for(int i=0; i<m_shard.OverflowSize(); i++) {
+			SCompBlockShard &shard = m_shard[i];
+			shard.loaded_comp_block.Initialize(0xFF);
+			shard.bytes_loaded = 0;
+			shard.free_list = NULL;
+			shard.head_cache_ptr = NULL;
+			shard.tail_cache_ptr = NULL;
+		}
 	}
 
 	// This is called to setup the hit item block initially
 	// @param dir - this is the directory of the comp buffer
 	// @param max_byte_size - this is the maximum number of 
 	//                      - bytes allowed for the hash header
-	void Initialize(const char dir[], int max_byte_size) {
-
-		m_comp.LoadIndex(dir);
+	// @param is_mapped - true if the index should be mapped read only, 
+	//                  - an uncompressed flat file is used if available
+	void Initialize(const char dir[], int max_byte_size, bool is_mapped = false) {
+
+		m_comp.LoadIndex(dir, is_mapped);
+		// staggers the shards used by different blocks
+		m_shard_offset = m_instance_num++;
+
+		// the directory may be held in a shared temp buffer
+		m_flat_map.CloseFile();
+		if(is_mapped == true && CMappedFile::AskFileExists(CUtility::
+			ExtendString(m_comp.DirectoryName(), ".comp.flat"))) {
+
+			m_flat_map.OpenMappedFile(CUtility::ExtendString
+				(m_comp.DirectoryName(), ".comp.flat"));
+			if(m_flat_map.FileSize() != m_comp.BytesStored()) {
+				// a stale flat file is ignored
+				m_flat_map.CloseFile();
+			}
+		}
 
 		int hash_breadth = max_byte_size / sizeof(SCompBlockPtr *);
 		if(hash_breadth >= m_comp.CompBlockNum()) {
@@ -2399,9 +2770,34 @@ public:
 		return m_comp;
 	}
 
+	// Returns true if bytes are read directly from an uncompressed mapping
+	inline bool IsFlatMapped() {
+		return m_flat_map.IsOpen();
+	}
+
+	// This returns a pointer to a set of bytes without copying them when
+	// an uncompressed flat file is mapped. Otherwise the bytes are copied
+	// into the supplied buffer and a pointer to the buffer is returned.
+	// @param byte_offset - this is the byte offset in the comp buffer
+	// @param byte_num - this is the number of bytes to retrieve
+	// @param buff - this is where the bytes are stored if they must be copied
+	inline const char *BytePtr(_int64 byte_offset, int byte_num, char buff[]) {
+
+		if(m_flat_map.IsOpen() == true && byte_offset >= 0 && 
+			byte_offset + byte_num <= m_flat_map.FileSize()) {
+
+			return m_flat_map.Buffer() + byte_offset;
+		}
+
+		RetrieveByteSet(byte_offset, byte_num, buff);
+		return buff;
+	}
+
 	// This starts a new session instance for a query
 	static void BeginNewQuery() {
+		m_session_mutex.Acquire();
 		m_session_id++;
+		m_session_mutex.Release();
 	}
 
 	// This is the entry function used to retrieve a set of bytes from
@@ -2422,6 +2818,11 @@ public:
 				throw EException("Byte Underflow");getchar();
 			}
 		}
+
+		if(m_flat_map.IsOpen() == true) {
+			m_flat_map.ReadBytes(byte_offset, buff, byte_num);
+			return;
+		}
 		
 		RecurseByteSet(byte_offset, byte_num, buff);
 	}
@@ -2463,12 +2864,12 @@ public:
 	}
 
 };
-CLinkedBuffer<SCompBlockPtr> CHitItemBlock::m_loaded_comp_block;
-SCompBlockPtr *CHitItemBlock::m_free_list;
-int CHitItemBlock::m_bytes_loaded;
+CMemoryChunk<SCompBlockShard> CHitItemBlock::m_shard;
+_int64 CHitItemBlock::m_shard_byte_num;
+int CHitItemBlock::m_instance_num;
+CMutex CHitItemBlock::m_session_mutex;
 uLong CHitItemBlock::m_session_id;
-SCompBlockPtr *CHitItemBlock::m_head_cache_ptr;
-SCompBlockPtr *CHitItemBlock::m_tail_cache_ptr;
+int CHitItemBlock::m_pin_session_num;
 
 
 // This is simply a bit string that uses a comp buffer
@@ -3643,13 +4044,14 @@ public:
 
 	// This creates a document set
 	// @param dir - this is a ptr to the desired directory
-	void Initialize(const char dir[]) {
+	// @param is_mapped - true if the document set should be mapped read only
+	void Initialize(const char dir[], bool is_mapped = false) {
 
 		m_lookup_cache.Initialize(CUtility::ExtendString
-			(dir, ".file_system.lookup"), 1000000); 
+			(dir, ".file_system.lookup"), 1000000, is_mapped); 
 
 		m_doc_cache.Initialize(CUtility::ExtendString
-			(dir, ".file_system.document"), 10000000);
+			(dir, ".file_system.document"), 10000000, is_mapped);
 	}
 
 	// Returns the number of documents stored
@@ -3697,10 +4099,208 @@ public:
 	}
 };
 
+// This compares fixed width sort items on their low order key bytes, 
+// which are taken as a little endian unsigned number. This is the same
+// ordering used by radix sort.
+struct SKeyCompare {
+
+	// This stores the number of low order bytes in the key
+	int key_byte_size;
+
+	// @param arg1 - the first sort item
+	// @param arg2 - the second sort item
+	// @param key_byte_size - the number of low order bytes in the key
+	// @return 1 if arg1 comes before arg2, -1 if after, 0 if equal
+	static inline int CompareKeyBytes(const char *arg1, 
+		const char *arg2, int key_byte_size) {
+
+		uLong value1;
+		uLong value2;
+		int offset = key_byte_size;
+
+		while(offset >= 4) {
+			offset -= 4;
+			memcpy(&value1, arg1 + offset, 4);
+			memcpy(&value2, arg2 + offset, 4);
+
+			if(value1 < value2) {
+				return 1;
+			}
+
+			if(value1 > value2) {
+				return -1;
+			}
+		}
+
+		if(offset > 0) {
+			value1 = 0;
+			value2 = 0;
+			memcpy(&value1, arg1, offset);
+			memcpy(&value2, arg2, offset);
+
+			if(value1 < value2) {
+				return 1;
+			}
+
+			if(value1 > value2) {
+				return -1;
+			}
+		}
+
+		return 0;
+	}
+
+	// @return 1 if arg1 comes before arg2, -1 if after, 0 if equal
+	inline int Compare(const char *arg1, const char *arg2) {
+		return CompareKeyBytes(arg1, arg2, key_byte_size);
+	}
+};
+
+// This is the same as SKeyCompare except the key width N is known at
+// compile time so the compare is unrolled into a few word compares.
+template <int N> struct SFixedKeyCompare {
+
+	// @return 1 if arg1 comes before arg2, -1 if after, 0 if equal
+	static inline int Compare(const char *arg1, const char *arg2) {
+		return SKeyCompare::CompareKeyBytes(arg1, arg2, N);
+	}
+};
+
+// This is used to merge with the user supplied compare function 
+// when the sort items do not have a fixed width key
+struct SFuncCompare {
+
+	// This stores the user supplied compare function
+	int (*compare)(const SExternalSort & arg1, 
+		const SExternalSort & arg2);
+
+	// @return 1 if arg1 comes before arg2, -1 if after, 0 if equal
+	inline int Compare(const char *arg1, const char *arg2) {
+		SExternalSort item1;
+		SExternalSort item2;
+		item1.hit_item = (char *)arg1;
+		item2.hit_item = (char *)arg2;
+
+		return compare(item1, item2);
+	}
+};
+
+// This is a tournament tree used to merge a number of sorted sequences.
+// Each internal node stores the loser of the match played at that node
+// and the overall winner is stored at the root. When the winner is
+// replaced by the next item in its sequence only the matches on the path
+// from its leaf to the root need to be replayed, which takes log(k)
+// compares rather than the 2log(k) needed by a binary heap. The compare
+// class must supply Compare(const char *, const char *) that returns 1
+// if the first item comes first. Ties are broken by leaf index
+// so the merge is stable with respect to the order of the sequences.
+template <class C> class CLoserTree {
+
+	// This stores the loser at each internal node, node zero
+	// stores the overall winner
+	CMemoryChunk<int> m_node;
+	// This stores the current item for each leaf or NULL if
+	// the leaf's sequence has been exhausted
+	CMemoryChunk<char *> m_leaf;
+	// This is used to compare items
+	C m_compare;
+
+	// This returns true if leaf1 beats leaf2
+	inline bool Beats(int leaf1, int leaf2) {
+
+		if(m_leaf[leaf2] == NULL) {
+			return true;
+		}
+
+		if(m_leaf[leaf1] == NULL) {
+			return false;
+		}
+
+		int compare = m_compare.Compare(m_leaf[leaf1], m_leaf[leaf2]);
+		if(compare != 0) {
+			return compare > 0;
+		}
+
+		return leaf1 < leaf2;
+	}
+
+public:
+
+	CLoserTree() {
+	}
+
+	// This creates a tree with a given number of leaves, all leaves
+	// are initially empty
+	// @param leaf_num - the number of sequences being merged
+	// @param compare - this is used to compare items
+	void Initialize(int leaf_num, const C &compare) {
+		m_compare = compare;
+		m_node.AllocateMemory(leaf_num, 0);
+		m_leaf.AllocateMemory(leaf_num, NULL);
+	}
+
+	// This sets the current item for a leaf, the item is not copied
+	// @param leaf - the leaf being set
+	// @param item - the item or NULL if the sequence is exhausted
+	inline void SetLeaf(int leaf, char *item) {
+		m_leaf[leaf] = item;
+	}
+
+	// This plays every match once all leaves have been set
+	void Build() {
+
+		int leaf_num = m_leaf.OverflowSize();
+		CMemoryChunk<int> winner(leaf_num << 1);
+		for(int i=0; i<leaf_num; i++) {
+			winner[leaf_num + i] = i;
+		}
+
+		for(int i=leaf_num-1; i>0; i--) {
+			int leaf1 = winner[i << 1];
+			int leaf2 = winner[(i << 1) + 1];
+
+			if(Beats(leaf1, leaf2)) {
+				winner[i] = leaf1;
+				m_node[i] = leaf2;
+			} else {
+				winner[i] = leaf2;
+				m_node[i] = leaf1;
+			}
+		}
+
+		m_node[0] = (leaf_num > 1) ? winner[1] : 0;
+	}
+
+	// This replays the matches on the path from a leaf to the root once
+	// the leaf's item has been changed, the leaf must be the last winner
+	// @param leaf - the leaf that was changed
+	inline void Replay(int leaf) {
+
+		int winner = leaf;
+		for(int i=(leaf + m_leaf.OverflowSize()) >> 1; i>0; i>>=1) {
+			if(Beats(m_node[i], winner)) {
+				CSort<int>::Swap(m_node[i], winner);
+			}
+		}
+
+		m_node[0] = winner;
+	}
+
+	// This returns the leaf holding the smallest item
+	inline int Winner() {
+		return m_node[0];
+	}
+
+	// This returns the smallest item or NULL if all leaves are exhausted
+	inline char *WinnerItem() {
+		return m_leaf[m_node[0]];
+	}
+};
+
 // This class is used by multiple sub classes to perform an external
 // merge of sorted blocks. That is blocks of sorted items need to 
 // be merged together to create a single sorted block. This is done
-// using a priority queue with multiple buckets loaded into memory
+// using a loser tree with multiple buckets loaded into memory
 // at any one time. Two sequential buckets are loaded into memory 
 // for a given bucket division at any one time. This is to allow 
 // a load thread to operate in parallel in order to load the next
@@ -3721,12 +4321,6 @@ class CExternalMerge : public CSort <SExternalSort> {
 	// can be utilized for sorting
 	static const int MAX_MEM_SIZE = DISK_BLOCK * (1 << 12);
 
-	// used for the priority queue sorting
-	struct SSortedHit {
-		SExternalSort hit; 
-		int bucket; 
-	}; 
-
 	// used to store statistics related to sort progress
 	struct SSortProgress {
 		// the total number of comp blocks that
@@ -3740,14 +4334,21 @@ class CExternalMerge : public CSort <SExternalSort> {
 		_int64 sorted_byte_num;
 		// stores the number of sorted blocks
 		int sorted_block_num;
+		// stores the time taken to create the sorted blocks in seconds
+		double run_time;
+		// stores the time taken by each merge pass in seconds
+		CArrayList<double> pass_time;
 
 		void Initialize() {
 			merged_comp_block_num = 0;
 			sorted_block_num = 0;
 			sorted_byte_num = 0;
+			run_time = 0;
+			pass_time.Resize(0);
 		}
 
 		SSortProgress() {
+			pass_time.Initialize(4);
 			Initialize();
 		}
 	};
@@ -3756,17 +4357,63 @@ class CExternalMerge : public CSort <SExternalSort> {
 	// a hit item
 	int m_hit_byte_size; 
 	// this is the compare function used to sort hits
-	static int (*m_compare)(const SExternalSort & arg1, 
+	int (*m_compare)(const SExternalSort & arg1, 
 		const SExternalSort & arg2); 
 
+	// stores the number of low order bytes that make up a fixed width
+	// key, this is zero if the compare function must be used instead
+	int m_key_byte_size;
+
 	// stores the number of bytes that need to be sorted
 	 _int64 m_sort_size; 
 	// stores a pointer to the compression block that
 	// needs to be sorted
 	CCompression *m_comp; 
 
+	// This stores a single run of sort items that is loaded into
+	// memory and sorted internally before being stored
+	struct SSortRun {
+		// This stores the sort items in the run
+		CMemoryChunk<char> buffer;
+		// This stores a pointer to each sort item in the run
+		CMemoryChunk<SExternalSort> hit_sort;
+		// This stores the number of sort items in the run
+		int sort_item_num;
+		// This stores a pointer to the sorter
+		CExternalMerge *this_ptr;
+		// This stores the handle of the thread sorting the run
+		pthread_t handle;
+	};
+
+	// This stores a group of sorted blocks that are merged into their 
+	// own comp buffer so that different groups can be merged in parallel
+	struct SMergeGroup {
+		// This stores the merged sort items for the group
+		CCompression comp;
+		// This stores the number of sorted blocks in the group
+		int bucket_num;
+		// This stores the first sorted block in the group
+		int bucket_set;
+		// This stores the number of comp blocks per sorted block
+		int comp_sort_size;
+		// This is true for the last group in a merge pass
+		bool is_last_group;
+		// This stores a pointer to the sorter
+		CExternalMerge *this_ptr;
+		// This stores the handle of the thread merging the group
+		pthread_t handle;
+	};
+
+	// This stores the number of threads used to sort and merge
+	static int m_sort_thread_num;
+	// This stores the total number of bytes that can be used to
+	// hold runs of sort items in memory across all threads
+	static _int64 m_sort_mem_size;
+
 	// stores the progress statisitcs related to sorting
 	SSortProgress m_progress;
+	// This protects the progress statistics when merging in parallel
+	CMutex m_progress_mutex;
 	// stores the sorted comp buffer after all sorted blocks
 	// have been merged using a priority queue
 	CCompression m_comp1; 
@@ -3842,12 +4489,14 @@ class CExternalMerge : public CSort <SExternalSort> {
 					comp_blocks, comp_block_offset);
 
 				comp_block_offset++;
+				this_ptr->m_progress_mutex.Acquire();
 				this_ptr->m_progress.merged_comp_block_num++;
 
 				if((this_ptr->m_progress.merged_comp_block_num % 20) == 0) {
 					cout<<(float)((this_ptr->m_progress.merged_comp_block_num) * 100) 
 						/ this_ptr->m_progress.total_comp_blocks<<"% Merged"<<endl;
 				}
+				this_ptr->m_progress_mutex.Release();
 
 				buffer_offset = 0; 
 				curr_buff_size = temp_buff.OverflowSize();
@@ -3894,90 +4543,155 @@ class CExternalMerge : public CSort <SExternalSort> {
 		new_comp.ResetNextHitItem(); 
 	}
 
-	// This initializes the buckets before merging commences.
-	// Note that two sequential blocks have to be loaded to
-	// allow parallization to reduce disk access.
-	// @param queue_buff - this stores the sort items that are pointed to
-	//                   - by entries in the priority queue
+	// This merges a set of sorted blocks using a loser tree. Each bucket
+	// owns a fixed slot in the queue buffer that holds its current sort 
+	// item so no sort items are moved while merging.
+	// @param bucket_num - the number of buckets used in this sorting pass
+	// @param bucket_set - the first bucket used in this sorting pass
 	// @param comp_sort_size - the number of comp blocks used for each sorted
 	//                       - division or bucket set
-	// @param bucket - stores all of the buckets that are being merged together
-	// @param bucket_set - the current set of set of buckets used
-	// 					 - ie an offset of times max bucket number gives 
-	//                   - an id into the future sorted division
-	// @param bucket_num - the number of buckets used in this sorting pass
-	// @param queue - stores all the top priority sort items that are 
-	//              - merged together based on priority
-	void InitializeBuckets(CMemoryChunk<char> &queue_buff, 
-		int comp_sort_size, CMemoryChunk<SBucketBuff> &bucket,
-		int bucket_set, int bucket_num, 
-		CPriorityQueue<SSortedHit> &queue) {
-
-		int offset = 4;
-		SSortedHit item; 
-		// fills the priority queue up initially
+	// @param merged_comp - this stores the merged sort items
+	// @param compare - this is used to compare sort items
+	template <class C> void LoserTreeSortPass(int bucket_num, int bucket_set, 
+		int comp_sort_size, CCompression &merged_comp, const C &compare) {
+
+		CMemoryChunk<SBucketBuff> bucket(bucket_num);
+		CLoserTree<C> tree;
+		tree.Initialize(bucket_num, compare);
+		CMemoryChunk<char> queue_buffer(m_hit_byte_size * bucket_num); 
+
 		for(int i=0; i<bucket_num; i++) {
-			item.bucket = i; 
-			item.hit.hit_item = queue_buff.Buffer() + offset; 
+			char *slot = queue_buffer.Buffer() + (i * m_hit_byte_size);
 			bucket[i].Initialize(bucket_set + i, comp_sort_size, this);
 
-			if(!bucket[i].GetNextBucketHit(item.hit.hit_item, m_hit_byte_size)) {
-				continue;
+			if(bucket[i].GetNextBucketHit(slot, m_hit_byte_size)) {
+				tree.SetLeaf(i, slot);
 			}
+		}
+
+		tree.Build();
 
-			queue.AddItem(item); 
-			offset += m_hit_byte_size; 
+		// sequential retrieves hit items from 
+		// the sorted subset buffers
+		char *item;
+		while((item = tree.WinnerItem()) != NULL) {
+			int winner = tree.Winner();
+			merged_comp.AddToBuffer(item, m_hit_byte_size);
+
+			// the bucket's slot is refilled in place
+			if(!bucket[winner].GetNextBucketHit(item, m_hit_byte_size)) {
+				tree.SetLeaf(winner, NULL);
+			}
+
+			tree.Replay(winner);
 		}
+
+		merged_comp.ForceFlush();
 	}
 
 	// This is the first pass of the sorting process note bucket number is
 	// the max number of buckets that can fit into memory and bucket 
-	// set is an index giving the current lot of buckets (bucket num)
+	// set is an index giving the current lot of buckets (bucket num).
+	// Fixed width keys use a key compare, which is specialized for the
+	// common key widths, otherwise the compare function is used.
 	// @param bucket_num - the number of buckets used in this sorting pass
 	// @param bucket_set - the current set of set of buckets used
 	// 					 - ie an offset of times max bucket number gives 
 	//                   - an id into the future sorted division
 	// @param comp_sort_size - the number of comp blocks used for each sorted
 	//                       - division or bucket set
-	void SortPass(int bucket_num, int bucket_set, int comp_sort_size) {
+	// @param merged_comp - this stores the merged sort items
+	void SortPass(int bucket_num, int bucket_set, 
+		int comp_sort_size, CCompression &merged_comp) {
+
+		if(m_key_byte_size <= 0) {
+			SFuncCompare compare;
+			compare.compare = m_compare;
+			LoserTreeSortPass(bucket_num, bucket_set, 
+				comp_sort_size, merged_comp, compare);
+			return;
+		}
 
-		CMemoryChunk<SBucketBuff> bucket(bucket_num);
-		CPriorityQueue<SSortedHit> queue; 
-		queue.Initialize(bucket_num, SortCompare); 
-		CMemoryChunk<char> queue_buffer((m_hit_byte_size * bucket_num) + 4); 
-		CArrayList<char *> released_slot(10); 
+		switch(m_key_byte_size) {
+			case 4: LoserTreeSortPass(bucket_num, bucket_set, comp_sort_size, 
+				merged_comp, SFixedKeyCompare<4>()); return;
+			case 5: LoserTreeSortPass(bucket_num, bucket_set, comp_sort_size, 
+				merged_comp, SFixedKeyCompare<5>()); return;
+			case 8: LoserTreeSortPass(bucket_num, bucket_set, comp_sort_size, 
+				merged_comp, SFixedKeyCompare<8>()); return;
+			case 11: LoserTreeSortPass(bucket_num, bucket_set, comp_sort_size, 
+				merged_comp, SFixedKeyCompare<11>()); return;
+		}
 
-		InitializeBuckets(queue_buffer, comp_sort_size,
-			bucket, bucket_set, bucket_num, queue);
+		SKeyCompare compare;
+		compare.key_byte_size = m_key_byte_size;
+		LoserTreeSortPass(bucket_num, bucket_set, 
+			comp_sort_size, merged_comp, compare);
+	}
 
-		SSortedHit item; 
-		// sequential retrieves hit items from 
-		// the sorted subset buffers
-		while(queue.PopItem(item)) {
-			released_slot.PushBack(item.hit.hit_item); 
-			// adds to the final sorted buffer
-			m_merged_comp_ptr->AddToBuffer(item.hit.hit_item, m_hit_byte_size);
-
-			// retrieves a hit from a different bucket if none 
-			// left in current bucket
-			if(!bucket[item.bucket].GetNextBucketHit
-				(released_slot.LastElement(), m_hit_byte_size))
-				continue;
+	// This is the entry function for a thread merging a single group
+	static THREAD_RETURN1 THREAD_RETURN2 MergeGroupThread(void *ptr) {
 
-			// adds another hit back to the priority queue from
-			// the same bucket division if bucket division not empty
-			item.hit.hit_item = released_slot.PopBack(); 
-			queue.AddItem(item); 
-		}
+		SMergeGroup *group = (SMergeGroup *)ptr;
+		group->this_ptr->SortPass(group->bucket_num, group->bucket_set,
+			group->comp_sort_size, group->comp);
+		group->comp.FinishCompression();
 
-		m_merged_comp_ptr->ForceFlush();
+		return 0;
 	}
 
-	// the compare function used in the priority queue
-	static inline int SortCompare(const SSortedHit &arg1, 
-		const SSortedHit &arg2) {
-		
-		return m_compare(arg1.hit, arg2.hit); 
+	// This performs a merge pass where sorted blocks do not all fit into
+	// memory. Each group of sorted blocks is independent so up to one group
+	// per thread is merged at the same time into a separate comp buffer.
+	// Groups are then appended to the merged comp buffer in order, which
+	// leaves the same comp blocks as merging each group in turn.
+	// @param bucket_count - the number of sorted blocks in this pass
+	// @param bucket_subset - the first sorted block in this pass
+	// @param bucket_num - the number of merged sorted blocks created
+	// @param max_bucket_num - the maximum number of buckets allowed per merge sort
+	// @param comp_sort_size - the number of comp blocks per sorted block
+	// @param new_comp_sort_size - the number of comp blocks per merged sorted block
+	void ParallelSortPass(int bucket_count, int &bucket_subset, int &bucket_num, 
+		int max_bucket_num, int comp_sort_size, int &new_comp_sort_size) {
+
+		unsigned int threadID;
+		CMemoryChunk<SMergeGroup> group(m_sort_thread_num);
+
+		while(bucket_count > 0) {
+			int group_num = 0;
+			while(group_num < group.OverflowSize() && bucket_count > 0) {
+				SMergeGroup &curr_group = group[group_num];
+				curr_group.this_ptr = this;
+				curr_group.bucket_set = bucket_subset;
+				curr_group.bucket_num = min(bucket_count, max_bucket_num);
+				curr_group.comp_sort_size = comp_sort_size;
+				curr_group.is_last_group = bucket_count <= max_bucket_num;
+				curr_group.comp.Initialize(CUtility::ExtendString(m_merged_comp_ptr->
+					DirectoryName(), ".group", group_num), m_merged_comp_ptr->BufferSize());
+
+				curr_group.handle = _beginthreadex(NULL, 0, 
+					MergeGroupThread, &curr_group, NULL, &threadID);
+
+				bucket_count -= curr_group.bucket_num; 
+				bucket_subset += curr_group.bucket_num; 
+				bucket_num++;
+				group_num++;
+			}
+
+			for(int i=0; i<group_num; i++) {
+				WaitForThread(group[i].handle, INFINITE);
+
+				if(group[i].is_last_group == false) {
+					new_comp_sort_size = min(new_comp_sort_size, 
+						group[i].comp.CompBlockNum());
+				}
+
+				m_merged_comp_ptr->AppendCompression(group[i].comp);
+				group[i].comp.RemoveCompression();
+			}
+		}
+
+		m_merged_comp_ptr->ForceFlush();
 	}
 
 	// This updates the comps per block on the next larger merge pass. It 
@@ -4016,17 +4730,26 @@ class CExternalMerge : public CSort <SExternalSort> {
 	void MergeSort(int bucket_num, int max_bucket_num, int comp_sort_size) {
 
 		int bucket_subset = 0; 
+		CStopWatch pass_timer;
 		
 		while(bucket_subset >= 0) {
 			int bucket_count = bucket_num; 
 			int new_comp_sort_size = MAX_SIGNED;
 			bucket_num = 0;
+			pass_timer.StartTimer();
 
 			m_progress.merged_comp_block_num = 0;
 			m_progress.total_comp_blocks = m_sort_comp_ptr->CompBlockNum();
 
+			if(m_sort_thread_num > 1 && bucket_count > max_bucket_num) {
+				ParallelSortPass(bucket_count, bucket_subset, bucket_num, 
+					max_bucket_num, comp_sort_size, new_comp_sort_size);
+				bucket_count = 0;
+			}
+
 			while(bucket_count > max_bucket_num) {
-				SortPass(max_bucket_num, bucket_subset, comp_sort_size); 
+				SortPass(max_bucket_num, bucket_subset, 
+					comp_sort_size, *m_merged_comp_ptr); 
 				new_comp_sort_size = min(new_comp_sort_size, 
 					m_merged_comp_ptr->CompBlockNum());
 
@@ -4036,7 +4759,8 @@ class CExternalMerge : public CSort <SExternalSort> {
 			}
 
 			if(bucket_count > 0) {
-				SortPass(bucket_count, bucket_subset, comp_sort_size); 
+				SortPass(bucket_count, bucket_subset, 
+					comp_sort_size, *m_merged_comp_ptr); 
 				bucket_num++;
 			}
 
@@ -4048,15 +4772,137 @@ class CExternalMerge : public CSort <SExternalSort> {
 			}
 
 			UpdateMergeBlocks(bucket_subset, max_bucket_num);
+
+			pass_timer.StopTimer();
+			m_progress.pass_time.PushBack(pass_timer.NetElapsedTime());
+			cout<<"Merge Pass "<<m_progress.pass_time.Size()<<" Took "
+				<<m_progress.pass_time.LastElement()<<" Seconds"<<endl;
+		}
+	}
+
+	// This returns the maximum number of sorted blocks that are merged 
+	// at once. Each bucket holds a single uncompressed comp block so the
+	// fan in is taken from the memory budget. If all the sorted blocks fit
+	// then they are merged in a single pass using the entire budget, 
+	// otherwise the budget is shared between the merge threads.
+	// @param bucket_num - the number of sorted blocks created
+	int MaxBucketNum(int bucket_num) {
+
+		_int64 bucket_byte_num = m_sort_comp_ptr->BufferSize() + m_hit_byte_size;
+		_int64 max_bucket_num = m_sort_mem_size / bucket_byte_num;
+
+		if(bucket_num > max_bucket_num) {
+			max_bucket_num /= m_sort_thread_num;
 		}
+
+		max_bucket_num = min(max_bucket_num, (_int64)MAX_SIGNED);
+		return (int)max(max_bucket_num, (_int64)2);
+	}
+
+	// This returns the number of bytes in each run of sort items that is
+	// sorted internally. The memory budget is shared between all threads.
+	int RunByteSize() {
+
+		_int64 run_byte_num = m_sort_mem_size / m_sort_thread_num;
+		run_byte_num = max(run_byte_num, (_int64)DISK_BLOCK * m_hit_byte_size);
+		run_byte_num = min(run_byte_num, (_int64)1 << 30);
+
+		return (int)(run_byte_num - (run_byte_num % m_hit_byte_size));
+	}
+
+	// This loads the next run of sort items into memory
+	// @param run - this stores the sort items in the run
+	// @param byte_num - the number of bytes to load
+	virtual void LoadRun(SSortRun &run, int byte_num) {
+	}
+
+	// This sorts a run of sort items internally, this may be 
+	// called on multiple threads at the same time
+	// @param run - this stores the sort items in the run
+	virtual void SortRun(SSortRun &run) {
+	}
+
+	// This stores a sorted run externally to be merged later
+	// @param run - this stores the sort items in the run
+	virtual void StoreRun(SSortRun &run) {
+	}
+
+	// This is the entry function for a thread sorting a single run
+	static THREAD_RETURN1 THREAD_RETURN2 SortRunThread(void *ptr) {
+
+		SSortRun *run = (SSortRun *)ptr;
+		run->this_ptr->SortRun(*run);
+
+		return 0;
+	}
+
+	// This breaks the comp buffer up into runs that fit into memory, sorts
+	// each run and writes them to the sorted comp buffer. Runs are read 
+	// sequentially but up to one run per thread is sorted at the same time.
+	// Runs are always stored in the order they were loaded so that the 
+	// last smaller run is stored last.
+	void CreateSortedRuns() {
+
+		unsigned int threadID;
+		int run_byte_num = RunByteSize();
+		_int64 bytes_loaded = 0;
+		CMemoryChunk<SSortRun> run(m_sort_thread_num);
+		CStopWatch run_timer;
+		run_timer.StartTimer();
+
+		m_progress.sorted_byte_num = 0;
+		m_progress.sorted_block_num = 0;
+
+		while(bytes_loaded < m_sort_size) {
+			// spreads the processors between the runs sorted in this batch
+			_int64 batch_num = (m_sort_size - bytes_loaded + run_byte_num - 1) / run_byte_num;
+			batch_num = min(batch_num, (_int64)run.OverflowSize());
+			SetThreadNum(max(CCompBlockPool::ProcessorNum() / (int)batch_num, 1));
+
+			int run_num = 0;
+			while(run_num < run.OverflowSize() && bytes_loaded < m_sort_size) {
+				SSortRun &curr_run = run[run_num++];
+				int byte_num = (int)min((_int64)run_byte_num, m_sort_size - bytes_loaded);
+				bytes_loaded += byte_num;
+
+				curr_run.this_ptr = this;
+				curr_run.sort_item_num = byte_num / m_hit_byte_size;
+				LoadRun(curr_run, byte_num);
+
+				if(m_sort_thread_num > 1) {
+					curr_run.handle = _beginthreadex(NULL, 0, 
+						SortRunThread, &curr_run, NULL, &threadID);
+				} else {
+					SortRun(curr_run);
+				}
+			}
+
+			for(int i=0; i<run_num; i++) {
+				if(m_sort_thread_num > 1) {
+					WaitForThread(run[i].handle, INFINITE);
+				}
+
+				StoreRun(run[i]);
+
+				m_progress.sorted_block_num++;
+				m_progress.sorted_byte_num += run[i].sort_item_num * m_hit_byte_size;
+				cout<<"Sorted "<<m_progress.sorted_byte_num<<
+					" Bytes Out Of "<<m_sort_size<<" Bytes"<<endl;
+			}
+		}
+
+		m_sort_comp_ptr->FinishCompression();
+
+		run_timer.StopTimer();
+		m_progress.run_time = run_timer.NetElapsedTime();
+		cout<<"Sorted Blocks Took "<<m_progress.run_time<<" Seconds"<<endl;
 	}
 
 	// This sets up the necessary comp buffers and does the initial
 	// creating of sorted blocks that need to be merged together
 	void SetupMergeSort() {
 
-		int max_mem_size = MAX_MEM_SIZE;
-		max_mem_size -= max_mem_size % m_hit_byte_size;
+		int max_mem_size = RunByteSize();
 
 		int bucket_num = (int)(m_sort_size / max_mem_size);
 		if(m_sort_size % max_mem_size) {
@@ -4070,7 +4916,7 @@ class CExternalMerge : public CSort <SExternalSort> {
 		}
 
 		// the maximum number of buckets allowed per merge sort
-		int max_bucket_num = comp_sort_size >> 1; 
+		int max_bucket_num = MaxBucketNum(bucket_num); 
 
 		if(bucket_num <= max_bucket_num) {
 			// write back to the original comp buffer
@@ -4088,6 +4934,44 @@ class CExternalMerge : public CSort <SExternalSort> {
 
 public:
 
+	// This sets the number of threads used to sort runs and to merge
+	// sorted blocks. This applies to every external sort that follows.
+	// @param thread_num - the number of sorting threads
+	static void SetSortThreadNum(int thread_num) {
+		if(thread_num <= 0) {
+			throw EIllegalArgumentException("thread_num <= 0");
+		}
+
+		m_sort_thread_num = thread_num;
+	}
+
+	// This sets the total amount of memory used to hold runs of sort items
+	// across all threads. Larger runs mean fewer merge passes.
+	// @param byte_num - the memory budget in bytes
+	static void SetSortMemorySize(_int64 byte_num) {
+		if(byte_num <= 0) {
+			throw EIllegalArgumentException("byte_num <= 0");
+		}
+
+		m_sort_mem_size = byte_num;
+	}
+
+	// This returns the time taken to create the sorted blocks in seconds
+	inline double SortedBlockTime() {
+		return m_progress.run_time;
+	}
+
+	// This returns the number of merge passes in the last sort
+	inline int MergePassNum() {
+		return m_progress.pass_time.Size();
+	}
+
+	// This returns the time taken by a merge pass in seconds
+	// @param pass - the merge pass starting at zero
+	inline double MergePassTime(int pass) {
+		return m_progress.pass_time[pass];
+	}
+
 	// This is called to do the initial set up.
 	// @param hit_size - the number of bytes used for each hit item
 	// @param comp - the comp buffer that needs to be sorted
@@ -4106,6 +4990,7 @@ public:
 		m_comp = &comp; 
 		m_hit_byte_size = hit_size; 
 		m_compare = compare; 
+		m_key_byte_size = 0;
 
 		m_progress.Initialize();
 		m_comp1.Initialize(CUtility::ExtendString
@@ -4120,21 +5005,16 @@ public:
 	}
 
 };
-int (*CExternalMerge::m_compare)(const SExternalSort & arg1, 
-	const SExternalSort & arg2); 
+int CExternalMerge::m_sort_thread_num = 1;
+_int64 CExternalMerge::m_sort_mem_size = CExternalMerge::MAX_MEM_SIZE;
 
 // This is an external sorting class that uses quick sort create the
 // sorted blocks internally in memory. Only use this class when the
 // bit width for radix sort exceeds log(N), where N is the input size.
 class CExternalQuickSort : public CExternalMerge {
 
-	// this stores the total number of bytes sorted so far
-	_int64 m_bytes_sorted;
-	// this protects access to the sorting
-	CMutex m_sort_mutex;
-
 	// This loads a number of sort items into memory from a single
-	// comp buffer. This must be mutex protected.
+	// comp buffer.
 	// @param hit_sort - a buffer that stores pointers to each of
 	//                 - the sort items
 	// @param buffer - this stores the sort items
@@ -4156,78 +5036,35 @@ class CExternalQuickSort : public CExternalMerge {
 		}
 	}
 
-	// This fills a buffer with unsorted hit items, sorts it
-	// internally using quick sort and then writes the buffer
-	// to a comp buffer for later merging. Note that there 
-	// is more than a single thread operating allowing contents
-	// to be read from memory while sorting at the same time.
-	// @param hit_sort - a buffer that stores pointers to each of
-	//                 - the sort items
-	void SortAndStore(CMemoryChunk<SExternalSort> &hit_sort) {
-
-		m_sort_mutex.Acquire();
-		CExternalMerge::HybridSort(hit_sort.Buffer(), hit_sort.OverflowSize()); 
-		m_sort_mutex.Release();
-
-		for(int i=0; i<hit_sort.OverflowSize(); i++) {
-			m_sort_comp_ptr->AddToBuffer(hit_sort[i].hit_item, m_hit_byte_size);
-		}
-
-		m_sort_comp_ptr->ForceFlush();
-		m_progress.sorted_block_num++;
-		m_progress.sorted_byte_num += m_hit_byte_size *
-			hit_sort.OverflowSize();
-
-		cout<<"Sorted "<<m_progress.sorted_byte_num<<
-			" Bytes Out Of "<<m_sort_size<<" Bytes"<<endl;
+	// This fills a buffer with unsorted hit items
+	// @param run - this stores the sort items in the run
+	// @param byte_num - the number of bytes to load
+	void LoadRun(SSortRun &run, int byte_num) {
+		run.buffer.AllocateMemory(byte_num);
+		LoadSortItemBlock(run.hit_sort, run.buffer, byte_num);
 	}
 
-	// Breaks the compression buffer up into MAX_MEM_SIZE
-	// blocks and sorts them - writes them back to the compression 
-	// buffer.
-	void CreateSetOfSortedBlocks() {
-
-		int max_byte_num = MAX_MEM_SIZE;
-		max_byte_num -= max_byte_num % m_hit_byte_size;
+	// This sorts a run internally using quick sort
+	// @param run - this stores the sort items in the run
+	void SortRun(SSortRun &run) {
+		CExternalMerge::HybridSort(run.hit_sort.Buffer(), run.sort_item_num); 
+	}
 
-		CMemoryChunk<char> buffer; 
-		// stores pointers to the start of every hit item
-		// used to sort the buffer
-		CMemoryChunk<SExternalSort> hit_sort;
+	// This writes a sorted run to a comp buffer for later merging
+	// @param run - this stores the sort items in the run
+	void StoreRun(SSortRun &run) {
 
-		while(m_bytes_sorted < m_sort_size) {
-			if(m_sort_size - m_bytes_sorted < max_byte_num) {
-				// the last sorted block is stored last
-				break;
-			}
-
-			buffer.AllocateMemory(max_byte_num);
-			LoadSortItemBlock(hit_sort, buffer, max_byte_num);
-			m_bytes_sorted += max_byte_num;
-			
-			SortAndStore(hit_sort); 
+		for(int i=0; i<run.sort_item_num; i++) {
+			m_sort_comp_ptr->AddToBuffer(run.hit_sort[i].hit_item, m_hit_byte_size);
 		}
+
+		m_sort_comp_ptr->ForceFlush();
 	}
 
 	// This creates segmented sorted blocks that are later merged 
 	// together. It does this by performing quick sort multiple times.. 
 	void QuickSort() {
-
-		m_bytes_sorted = 0;
-		m_progress.sorted_byte_num = 0;
-		m_progress.sorted_block_num = 0;
-		CreateSetOfSortedBlocks();
-
-		CMemoryChunk<char> buffer; 
-		CMemoryChunk<SExternalSort> hit_sort;
-
-		// store the last block last
-		int byte_num = (int)(m_sort_size - m_bytes_sorted);
-		buffer.AllocateMemory(byte_num);
-		LoadSortItemBlock(hit_sort, buffer, byte_num);
-		SortAndStore(hit_sort); 
-
-		m_sort_comp_ptr->FinishCompression();
+		CreateSortedRuns();
 	}
 
 	// this is used for testing
@@ -4346,158 +5183,108 @@ public:
 // least significant to most significant.
 class CExternalRadixSort : public CExternalMerge {
 
-	// This defines a linked bucket item that stores
-	// a pointer to the internal buffer where a given 
-	// sort item is located.
-	struct SNode {
-		// this stores a pointer to the next linked node
-		SNode *next_ptr;
-		// this stores a pointer to the sort item
-		char *sort_item;
-	};
+	// This defines the number of bits sorted on each radix pass
+	static const int RADIX_BITS = 8;
+	// This defines the number of buckets on each radix pass
+	static const int RADIX_SIZE = 1 << RADIX_BITS;
+	// This defines the number of separate counters kept 
+	// for each bucket while building the histogram
+	static const int COUNT_SET_NUM = 4;
+	// This defines the number of sort items staged for each
+	// bucket before they are written to the destination buffer
+	static const int STAGE_ITEM_NUM = 8;
+	// This defines how many sort items ahead are prefetched
+	static const int PREFETCH_ITEM_NUM = 16;
 
-	// this stores the size in bytes of a given sort item
-	static int m_sort_byte_size;
 	// this stores the number of bytes that are used for sorting
 	// this is taken as the low order bytes of the sort item
-	static int m_compare_byte_size;
-	// this stores the initial bit offset -> used in the compare function
-	static int m_init_offset;
-
-	// this stores the maximum bit width allowed for radix
-	// sort, it's calculated based upon the amount of internal memory
-	int m_max_bit_width;
-	// this stores the total number of bytes sorted so far
-	_int64 m_bytes_sorted;
-
-	// This defines how a sort item is compare. Since a non comparison
-	// model is used for sorting, this means that this simply orders
-	// sort items in lexographic order. Note that an gauranteed
-	// extra four bytes that have been nulled need to be placed at
-	// the start of the buffer storing sort items, this is because
-	// it's possible that the offset could become negativde in the 
-	// comparison function (done for efficiency).
-	static int CompareLexographicItem(const SExternalSort &arg1, 
-		const SExternalSort &arg2) {
-
-		static uLong value1;
-		static uLong value2;
-		static int offset;
-
-		offset = m_init_offset;
-		char *buff1 = arg1.hit_item + m_sort_byte_size;
-		char *buff2 = arg2.hit_item + m_sort_byte_size;
-
-		while(true) {
-			value1 = *(uLong *)buff1;
-			value2 = *(uLong *)buff2;
-
-			if(offset < 0) {
-				value1 >>= -offset;
-				value2 >>= -offset;
-			}
+	int m_compare_byte_size;
+
+	// This builds the histogram for every key byte in a single pass over
+	// the sort items. Neighbouring sort items often share their high order
+	// bytes so every key byte keeps several interleaved counter sets. This
+	// stops consecutive increments of the same counter from waiting on 
+	// each other. The counter sets are summed once all items are counted.
+	// @param buff - the sort items
+	// @param sort_num - the number of sort items
+	// @param hit_byte_size - the number of bytes in each sort item
+	// @param key_byte_size - the number of low order bytes in the key
+	// @param count - this stores the number of sort items in each
+	//              - bucket for every key byte
+	static void CountKeyBytes(const char *buff, int sort_num, 
+		int hit_byte_size, int key_byte_size, CMemoryChunk<int> &count) {
+
+		int set_size = RADIX_SIZE * COUNT_SET_NUM;
+		CMemoryChunk<int> set_count(key_byte_size * set_size, 0);
 
+		for(int i=0; i<sort_num; i++) {
+			int *curr_count = set_count.Buffer() + 
+				((i & (COUNT_SET_NUM - 1)) * RADIX_SIZE);
 
-			if(value1 < value2) {
-				return 1;
+			for(int j=0; j<key_byte_size; j++) {
+				curr_count[(uChar)buff[j]]++;
+				curr_count += set_size;
 			}
 
-			if(value1 > value2) {
-				return -1;
-			}
+			buff += hit_byte_size;
+		}
 
-			if(offset <= 0) {
-				return 0;
+		count.AllocateMemory(key_byte_size * RADIX_SIZE, 0);
+		int *curr_count = set_count.Buffer();
+		for(int i=0; i<key_byte_size; i++) {
+			for(int j=0; j<COUNT_SET_NUM; j++) {
+				for(int k=0; k<RADIX_SIZE; k++) {
+					count[(i * RADIX_SIZE) + k] += *curr_count++;
+				}
 			}
-			offset -= 32;
-			buff1 -= 4;
-			buff2 -= 4;
 		}
-
-		return 0;
 	}
 
-	// This places each sort item loaded into memory into its repective
-	// bucket. This is done by creating a linked list of sort items that
-	// are attatched to each bucket. These can than later be retrieved
-	// by traversing the linked list of sort items.
-	// @param byte_offset - this stores a pointer to the current sort item
-	//                    - preloaded into an internal buffer
-	// @param sort_num - the number of sort items to be sorted
-	// @param curr_bit_offset - the current bit offset from the start of 
-	//                        - the sort item that have been processed
-	// @param bit_size - the number of bits that forms the mask to select
-	//                 - the bucket with repect to the bit offset
-	// @param node_buff - this stores all the pointers that are used to
-	//                  - create the linked list for each bucket
-	// @param bucket_start - this stores a pointer to the head of the linked
-	//                     - list for each bucket division
-	void AddSortItemsToBuckets(char *byte_offset, int sort_num, 
-		int curr_bit_offset, int bit_size, CArray<SNode> &node_buff,
-		CMemoryChunk<SNode *> &bucket_start) {
-
-		uLong mask = -1;
-		int byte_num = curr_bit_offset >> 3;
-		int bit_offset = curr_bit_offset % 8;
-		byte_offset += sort_num * m_hit_byte_size;
-
-		mask >>= 32 - min(m_max_bit_width, 
-			(m_compare_byte_size << 3) - curr_bit_offset);
+	// This moves every sort item into its bucket for a single key byte.
+	// Sort items are first staged in a small buffer for each bucket that 
+	// stays in cache. A full stage is written out with a single copy rather
+	// than scattering every sort item across the destination buffer.
+	// @param src - the sort items in their current order
+	// @param dst - this stores the sort items ordered by the key byte
+	// @param sort_num - the number of sort items
+	// @param hit_byte_size - the number of bytes in each sort item
+	// @param key_byte - the key byte that is being sorted on
+	// @param count - the number of sort items in each bucket
+	static void ScatterKeyByte(const char *src, char *dst, int sort_num,
+		int hit_byte_size, int key_byte, const int *count) {
 
-		for(int i=0; i<sort_num; i++) {
-			byte_offset -= m_hit_byte_size;
-			char *byte = byte_offset + byte_num;
-			uLong value = *(uLong *)byte;
-			value >>= bit_offset;
-
-			node_buff.ExtendSize(1);
-			int bucket = value & mask;
-			SNode *prev_ptr = bucket_start[bucket];
-			SNode *curr_ptr = &node_buff.LastElement();
-
-			bucket_start[bucket] = curr_ptr;
-			curr_ptr->next_ptr = (prev_ptr == NULL) ? NULL : prev_ptr;
-			curr_ptr->sort_item = byte_offset;
-		}
-	}
-
-	// This peforms a single bucket sort on a list of items
-	// stored in internal memory. This must be applied multiple
-	// times to sort the entire sequence of items.
-	// @param buffer - the buffer that stores the items that
-	//               - need to be sorted
-	// @param curr_bit_offset - the current bit offset from the start of 
-	//                        - the sort item that have been processed
-	// @param sort_num - the number of sort items to be sorted
-	void BucketSort(CMemoryChunk<char> &buffer, int sort_num, int curr_bit_offset) {
-
-		CArray<SNode> node_buff(sort_num);
-		CMemoryChunk<SNode *> bucket_start;
-
-		int bits_left = (m_compare_byte_size << 3) - curr_bit_offset;
-		if(bits_left > m_max_bit_width) {
-			bucket_start.AllocateMemory(1 << m_max_bit_width, NULL);
-		} else {
-			bucket_start.AllocateMemory(1 << bits_left, NULL);
-		}
+		int stage_byte_num = STAGE_ITEM_NUM * hit_byte_size;
+		CMemoryChunk<char> stage(RADIX_SIZE * stage_byte_num);
+		CMemoryChunk<int> stage_num(RADIX_SIZE, 0);
+		CMemoryChunk<char *> bucket_ptr(RADIX_SIZE);
 
-		int bit_size = min(m_max_bit_width, 
-			(m_compare_byte_size << 3) - curr_bit_offset);
+		for(int i=0; i<RADIX_SIZE; i++) {
+			bucket_ptr[i] = dst;
+			dst += count[i] * hit_byte_size;
+		}
 
-		CMemoryChunk<char> temp_buff(buffer);
-		AddSortItemsToBuckets(temp_buff.Buffer(), sort_num, 
-			curr_bit_offset, bit_size, node_buff, bucket_start);
+		int prefetch_byte_num = PREFETCH_ITEM_NUM * hit_byte_size;
+		for(int i=0; i<sort_num; i++) {
+			if(i + PREFETCH_ITEM_NUM < sort_num) {
+				PREFETCH_READ(src + prefetch_byte_num);
+			}
 
-		char *buff = buffer.Buffer();
-		for(int i=0; i<bucket_start.OverflowSize(); i++) {
-			SNode *curr_ptr = bucket_start[i];
+			int bucket = (uChar)src[key_byte];
+			char *stage_ptr = stage.Buffer() + (bucket * stage_byte_num);
+			memcpy(stage_ptr + (stage_num[bucket] * hit_byte_size), src, hit_byte_size);
+			src += hit_byte_size;
 
-			while(curr_ptr != NULL) {
-				memcpy(buff, curr_ptr->sort_item, m_hit_byte_size);
-				curr_ptr = curr_ptr->next_ptr;
-				buff += m_hit_byte_size;
+			if(++stage_num[bucket] == STAGE_ITEM_NUM) {
+				memcpy(bucket_ptr[bucket], stage_ptr, stage_byte_num);
+				bucket_ptr[bucket] += stage_byte_num;
+				stage_num[bucket] = 0;
 			}
 		}
+
+		for(int i=0; i<RADIX_SIZE; i++) {
+			memcpy(bucket_ptr[i], stage.Buffer() + (i * stage_byte_num), 
+				stage_num[i] * hit_byte_size);
+		}
 	}
 
 	// This loads a buffer with a number of unsorted sort items 
@@ -4522,11 +5309,6 @@ class CExternalRadixSort : public CExternalMerge {
 	// @param temp_buff - this stores all the sort items
 	void StoreSortedBuffer(int sort_item_num, CMemoryChunk<char> &temp_buff) {
 
-		m_progress.sorted_block_num++;
-		m_progress.sorted_byte_num += sort_item_num * m_hit_byte_size;
-		cout<<"Sorted "<<m_progress.sorted_byte_num<<
-			" Bytes Out Of "<<m_sort_size<<" Bytes"<<endl;
-	
 		char *buff = temp_buff.Buffer();
 		for(int i=0; i<sort_item_num; i++) {
 			m_sort_comp_ptr->AddToBuffer(buff, m_hit_byte_size);
@@ -4536,83 +5318,64 @@ class CExternalRadixSort : public CExternalMerge {
 		m_sort_comp_ptr->ForceFlush();
 	}
 
-	// This cycles through the entire bit spectrum of the sort item
-	// and uses bucket sort on each segment of the spectrum. Once
-	// completely sorted, the buffer is stored externally.
-	// @param sort_buff - this stores all the sorted hit items
-	// @param sort_item_num - this stores the number of sort items
-	void CycleThroughBitWidth(CMemoryChunk<char> &sort_buff, int sort_item_num) {
-
-		int curr_bit_offset = 0;
-		while(curr_bit_offset < (m_compare_byte_size << 3)) {
-			BucketSort(sort_buff, sort_item_num, curr_bit_offset);
-			curr_bit_offset += m_max_bit_width;
-		}
-
-		StoreSortedBuffer(sort_item_num, sort_buff);
+	// This loads a buffer with a number of unsorted sort items
+	// @param run - this stores the sort items in the run
+	// @param byte_num - the number of bytes to load
+	void LoadRun(SSortRun &run, int byte_num) {
+		run.buffer.AllocateMemory(byte_num);
+		LoadSortBuffer(byte_num, run.buffer.Buffer());
 	}
 
-	// This iteratively loades a number of sort items into memory
-	// sorts them using a single bucket sort and then writes the
-	// sorted items out to another comp buffer. It stops when
-	// the entire bit width has been scanned.
-	// @param write_buff_comp - the new comp buffer to store the
-	//                        - sorted items
-	// @param read_buff_comp - the comp buffer from which to read
-	//                       - the unsorted items
-	void LoadSortAndStore() {
-		
-		int max_byte_num = MAX_MEM_SIZE;
-		max_byte_num -= max_byte_num % m_hit_byte_size;
-		CMemoryChunk<char> temp_buff(max_byte_num + 4);
-
-		while(m_bytes_sorted < m_sort_size) {
-			if(m_sort_size - m_bytes_sorted < max_byte_num) {
-				// the last sorted block is stored last
-				break;
-			}
-			
-			m_bytes_sorted += max_byte_num;
-			LoadSortBuffer(max_byte_num, temp_buff.Buffer());
-			int sort_item_num = max_byte_num / m_hit_byte_size;
-
-			CycleThroughBitWidth(temp_buff, sort_item_num);
-		}
+	// This sorts a run internally using radix sort
+	// @param run - this stores the sort items in the run
+	void SortRun(SSortRun &run) {
+		RadixSortBuffer(run.buffer, run.sort_item_num, 
+			m_hit_byte_size, m_compare_byte_size);
 	}
 
-	// This finds the maximum bit width increment used for bucket sorting.
-	void DetermineBitIncrement() {
-		int max_byte_num = MAX_MEM_SIZE;
-		max_byte_num -= max_byte_num % m_hit_byte_size;
-
-		m_max_bit_width = CMath::LogBase2(max_byte_num);
-		if((m_max_bit_width << 1) % max_byte_num) {
-			//align at the bit boundary
-			m_max_bit_width--;
-		}
-
-		m_max_bit_width = min(m_max_bit_width, 24);
+	// This writes a sorted run to a comp buffer for later merging
+	// @param run - this stores the sort items in the run
+	void StoreRun(SSortRun &run) {
+		StoreSortedBuffer(run.sort_item_num, run.buffer);
 	}
 
-	// This creates segmented sorted blocks that are later merged 
-	// together. It does this by performing bucket sort multiple times
-	// using the radix sort idea. 
-	void RadixSort() {
+public:
 
-		m_bytes_sorted = 0;
-		DetermineBitIncrement();
+	// This sorts fixed width sort items in memory on their low order key
+	// bytes using a least significant byte radix sort. Each pass is stable
+	// so sort items with equal keys keep their order. A key byte that is
+	// the same for every sort item is skipped. No static state is used so
+	// this can be called on many threads at the same time.
+	// @param buffer - the sort items, this is replaced by the sorted items
+	// @param sort_num - the number of sort items
+	// @param hit_byte_size - the number of bytes in each sort item
+	// @param key_byte_size - the number of low order bytes in the key
+	static void RadixSortBuffer(CMemoryChunk<char> &buffer, int sort_num,
+		int hit_byte_size, int key_byte_size) {
+
+		if(sort_num <= 0) {
+			return;
+		}
 
-		LoadSortAndStore();
+		CMemoryChunk<int> count;
+		CountKeyBytes(buffer.Buffer(), sort_num, 
+			hit_byte_size, key_byte_size, count);
 
-		// stores the last sorted block
-		int byte_size = (int)(m_sort_size - m_bytes_sorted);
-		CMemoryChunk<char> temp_buff(byte_size + 4);
+		CMemoryChunk<char> temp_buff;
+		for(int i=0; i<key_byte_size; i++) {
+			int *curr_count = count.Buffer() + (i * RADIX_SIZE);
+			if(curr_count[(uChar)buffer[i]] == sort_num) {
+				continue;
+			}
 
-		LoadSortBuffer(byte_size, temp_buff.Buffer());
-		int sort_item_num = byte_size / m_hit_byte_size;
-		CycleThroughBitWidth(temp_buff, sort_item_num);
+			if(temp_buff.OverflowSize() < buffer.OverflowSize()) {
+				temp_buff.AllocateMemory(buffer.OverflowSize());
+			}
 
-		m_sort_comp_ptr->FinishCompression();
+			ScatterKeyByte(buffer.Buffer(), temp_buff.Buffer(), 
+				sort_num, hit_byte_size, i, curr_count);
+			buffer.Swap(temp_buff);
+		}
 	}
 
 public:
@@ -4647,24 +5410,16 @@ public:
 	void Initialize(int sort_byte_size, 
 		CCompression &comp, int compare_byte_size = -1) {
 
-		CExternalMerge::Setup(sort_byte_size, comp, CompareLexographicItem);
+		CExternalMerge::Setup(sort_byte_size, comp, NULL);
 
 		if(compare_byte_size < 0) {
 			compare_byte_size = sort_byte_size;
 		}
 
 		m_compare_byte_size = compare_byte_size;
-		m_sort_byte_size = m_compare_byte_size - 4;
-		m_init_offset = m_sort_byte_size;
-
-		// this is used in the lexographic compare function
-		if(m_init_offset < 0) {
-			m_init_offset = -((-m_init_offset) << 3);
-		} else {
-			m_init_offset <<= 3;
-		}
+		m_key_byte_size = compare_byte_size;
 		
-		RadixSort();
+		CreateSortedRuns();
 		
 		if(m_progress.sorted_block_num < 2) {
 			ReassignBufferSize(*m_sort_comp_ptr, *m_comp);
@@ -4740,8 +5495,5 @@ public:
 		}
 	}
 };
-int CExternalRadixSort::m_sort_byte_size;
-int CExternalRadixSort::m_init_offset;
-int CExternalRadixSort::m_compare_byte_size;
 
 
@@ -18,6 +18,7 @@
 #include <iostream> 
 #include <cstdlib> 						
 #include <fstream> 
+#include <sstream>
 #include <cassert>
 #include <cctype> 
 #include <iomanip> 
@@ -31,6 +32,25 @@
 #include <cstring>
 #include "zlib.h"
 
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+// SSE2 is always available on x86-64, AVX2 only when the build enables it
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define USE_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
+
 using namespace std; 
 
 #ifdef OS_WINDOWS 
@@ -55,6 +75,29 @@ public:
 	}
 };
 
+// This is a counting semaphore used to signal between threads.
+// Wait blocks until the count is positive and then decrements it.
+class CSemaphore {
+	HANDLE m_handle;
+
+public:
+
+	CSemaphore (int count = 0) { m_handle = CreateSemaphore(NULL, count, 0x7FFFFFFF, NULL);}
+	~CSemaphore () { CloseHandle(m_handle);}
+
+	void Wait() {
+		WaitForSingleObject(m_handle, INFINITE);
+	}
+	// This waits for at most a given number of milliseconds
+	// @return true if the semaphore was acquired, false on time out
+	bool Wait(int millisec) {
+		return WaitForSingleObject(m_handle, millisec) == WAIT_OBJECT_0;
+	}
+	void Signal() {
+		ReleaseSemaphore(m_handle, 1, NULL);
+	}
+};
+
 #else 
 
 // This a simple mutex semaphore that can be 
@@ -75,4 +118,65 @@ public:
 	}
 };
 
+// This is a counting semaphore used to signal between threads.
+// Wait blocks until the count is positive and then decrements it.
+class CSemaphore {
+	pthread_mutex_t mp;
+	pthread_cond_t cv;
+	int m_count;
+
+public:
+
+	CSemaphore (int count = 0) { 
+		pthread_mutex_init(&mp, NULL);
+		pthread_cond_init(&cv, NULL);
+		m_count = count;
+	}
+	~CSemaphore () { 
+		pthread_cond_destroy(&cv);
+		pthread_mutex_destroy(&mp);
+	}
+
+	void Wait() {
+		pthread_mutex_lock(&mp);
+		while(m_count <= 0) {
+			pthread_cond_wait(&cv, &mp);
+		}
+		m_count--;
+		pthread_mutex_unlock(&mp);
+	}
+	// This waits for at most a given number of milliseconds
+	// @return true if the semaphore was acquired, false on time out
+	bool Wait(int millisec) {
+		struct timespec due;
+		clock_gettime(CLOCK_REALTIME, &due);
+		due.tv_sec += millisec / 1000;
+		due.tv_nsec += (long)(millisec % 1000) * 1000000;
+		if(due.tv_nsec >= 1000000000) {
+			due.tv_sec++;
+			due.tv_nsec -= 1000000000;
+		}
+
+		pthread_mutex_lock(&mp);
+		while(m_count <= 0) {
+			if(pthread_cond_timedwait(&cv, &mp, &due) == ETIMEDOUT) {
+				break;
+			}
+		}
+
+		bool is_acquired = m_count > 0;
+		if(is_acquired == true) {
+			m_count--;
+		}
+		pthread_mutex_unlock(&mp);
+		return is_acquired;
+	}
+	void Signal() {
+		pthread_mutex_lock(&mp);
+		m_count++;
+		pthread_cond_signal(&cv);
+		pthread_mutex_unlock(&mp);
+	}
+};
+
 #endif
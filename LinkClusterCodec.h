@@ -0,0 +1,200 @@
+#include "./NodeStat.h"
+
+// This class stores a single link cluster, that is a src node and all
+// of its weighted links, and encodes it compactly in a link set. The
+// dst nodes are sorted and stored as escaped gaps from the previous dst.
+// The link weights are scaled by the largest weight in the cluster and
+// quantized to 16 bits. When every link in the cluster carries the same
+// weight only the largest weight is stored. Each cluster is stored as
+//   escaped (link number << 1 | uniform flag)
+//   escaped src node
+//   the largest weight as a float              -- if there are links
+//   an escaped gap for each dst node
+//   a 16 bit weight level for each link        -- if not uniform
+class CLinkClusterCodec {
+
+	// This defines the number of levels a link weight is quantized to
+	static const int WEIGHT_LEVELS = 0xFFFF;
+
+	// This stores one of the links in the cluster
+	struct SClusterLink {
+		// This stores the dst node
+		S5Byte dst;
+		// This stores the link weight
+		float link_weight;
+	};
+
+	// This stores the src node
+	S5Byte m_src;
+	// This stores the links in the cluster
+	CArrayList<SClusterLink> m_link;
+	// This stores the gap of each dst node while decoding
+	CArrayList<_int64> m_gap;
+	// This stores the quantized weight of each link
+	CArrayList<u_short> m_level;
+
+	// This is used to sort links by dst node
+	static int CompareClusterLink(const SClusterLink &arg1, const SClusterLink &arg2) {
+
+		_int64 dst1 = S5Byte::Value(arg1.dst);
+		_int64 dst2 = S5Byte::Value(arg2.dst);
+
+		if(dst1 < dst2) {
+			return 1;
+		}
+
+		if(dst1 > dst2) {
+			return -1;
+		}
+
+		return 0;
+	}
+
+public:
+
+	CLinkClusterCodec() {
+		m_link.Initialize(1024);
+		m_gap.Initialize(1024);
+		m_level.Initialize(1024);
+	}
+
+	// This starts a new link cluster
+	// @param src - the src node of the cluster
+	inline void Reset(const S5Byte &src) {
+		m_src = src;
+		m_link.Resize(0);
+	}
+
+	// This adds a link to the cluster
+	// @param dst - the dst node of the link
+	// @param link_weight - the weight of the link
+	inline void AddLink(const S5Byte &dst, float link_weight) {
+
+		if(link_weight < 0) {
+			throw EIllegalArgumentException("link_weight < 0");
+		}
+
+		m_link.ExtendSize(1);
+		m_link.LastElement().dst = dst;
+		m_link.LastElement().link_weight = link_weight;
+	}
+
+	// This writes the link cluster, the links are sorted by dst node
+	// @param file - the link set being written
+	void WriteLinkCluster(CHDFSFile &file) {
+
+		int link_num = m_link.Size();
+		if(link_num == 0) {
+			file.AddEscapedItem(0);
+			file.AddEscapedItem(S5Byte::Value(m_src));
+			return;
+		}
+
+		CSort<SClusterLink> sort(0, CompareClusterLink);
+		sort.HybridSort(m_link.Buffer(), link_num);
+
+		float max_weight = 0;
+		for(int i=0; i<link_num; i++) {
+			if(m_link[i].link_weight > max_weight) {
+				max_weight = m_link[i].link_weight;
+			}
+		}
+
+		bool is_uniform = true;
+		m_level.Resize(link_num);
+		for(int i=0; i<link_num; i++) {
+			m_level[i] = WEIGHT_LEVELS;
+			if(m_link[i].link_weight < max_weight) {
+				m_level[i] = (u_short)(m_link[i].link_weight /
+					max_weight * WEIGHT_LEVELS + 0.5f);
+				is_uniform = false;
+			}
+		}
+
+		file.AddEscapedItem(((_int64)link_num << 1) | (is_uniform ? 1 : 0));
+		file.AddEscapedItem(S5Byte::Value(m_src));
+		file.WriteCompObject(max_weight);
+
+		_int64 prev_dst = 0;
+		for(int i=0; i<link_num; i++) {
+			_int64 dst = S5Byte::Value(m_link[i].dst);
+			file.AddEscapedItem(dst - prev_dst);
+			prev_dst = dst;
+		}
+
+		if(is_uniform == false) {
+			file.WriteCompObject(m_level.Buffer(), link_num);
+		}
+	}
+
+	// This reads the next link cluster
+	// @param file - the link set being read
+	// @return true if a cluster was read, false at the end of the file
+	bool ReadLinkCluster(CHDFSFile &file) {
+
+		_int64 header;
+		if(file.GetEscapedItem(header) < 0) {
+			return false;
+		}
+
+		int link_num = (int)(header >> 1);
+		file.GetEscapedItem(m_src);
+		m_link.Resize(link_num);
+		if(link_num == 0) {
+			return true;
+		}
+
+		float max_weight;
+		file.ReadCompObject(max_weight);
+
+		m_gap.Resize(link_num);
+		file.ReadEscapedItems(m_gap.Buffer(), link_num);
+
+		_int64 dst = 0;
+		for(int i=0; i<link_num; i++) {
+			dst += m_gap[i];
+			m_link[i].dst.SetValue(dst);
+		}
+
+		if((header & 0x01) != 0) {
+			for(int i=0; i<link_num; i++) {
+				m_link[i].link_weight = max_weight;
+			}
+
+			return true;
+		}
+
+		m_level.Resize(link_num);
+		file.ReadCompObject(m_level.Buffer(), link_num);
+
+		float scale = max_weight / WEIGHT_LEVELS;
+		for(int i=0; i<link_num; i++) {
+			m_link[i].link_weight = m_level[i] * scale;
+		}
+
+		return true;
+	}
+
+	// This returns the src node of the cluster
+	inline S5Byte &Src() {
+		return m_src;
+	}
+
+	// This returns the number of links in the cluster
+	inline int LinkNum() {
+		return m_link.Size();
+	}
+
+	// This returns the dst node of one of the links
+	// @param link - the offset of the link in the cluster
+	inline S5Byte &Dst(int link) {
+		return m_link[link].dst;
+	}
+
+	// This returns the weight of one of the links
+	// @param link - the offset of the link in the cluster
+	inline float LinkWeight(int link) {
+		return m_link[link].link_weight;
+	}
+};
+const int CLinkClusterCodec::WEIGHT_LEVELS;
@@ -0,0 +1,715 @@
+#include "./ClassVector.h"
+
+// This class holds one hash division of the link set in memory so that
+// PulseRank and WavePass can iterate over it without streaming the link
+// set from disk on every cycle. Every node in the division is given a
+// dense local id in the order in which it's added. Links are stored in
+// compressed sparse row form grouped by their dst node (the transpose of
+// the link set) so every dst can pull the weighted values of its src
+// nodes. This allows the dst nodes to be split between threads without
+// any locking. Links to a node in another hash division are gathered into
+// a boundary slot, one for each distinct remote node. Only the boundary
+// slots are written out on each cycle to be picked up by the division
+// that owns the node. The divisions are kept in step with a file barrier
+// on every cycle, which also carries a handful of global sums. A division
+// that fails leaves a marker so the others give up at the next barrier
+// rather than waiting on it.
+class CLinkGraph {
+
+	// This defines the number of bytes held for every link when
+	// deciding whether a division will fit in memory, this is
+	// the link buffer plus the compiled link
+	static const int LINK_BYTE_NUM = sizeof(int) + sizeof(S5Byte) +
+		sizeof(float) + sizeof(int) + sizeof(float);
+	// This defines the time in milliseconds between checks on the barrier
+	static const int SYNC_POLL_TIME = 20;
+	// This defines the time in milliseconds to wait on a division at
+	// a barrier before giving up
+	static const int SYNC_TIME_OUT = 3600000;
+
+	// This stores a link before the graph is compiled
+	struct SGraphLink {
+		// This stores the local id of the src node
+		int src;
+		// This stores the dst node
+		S5Byte dst;
+		// This stores the link weight
+		float link_weight;
+	};
+
+	// This is passed to each multiply thread
+	struct SMultiplyThread {
+		// This stores a pointer to the graph
+		CLinkGraph *this_ptr;
+		// This stores the first dst handled by this thread
+		int start;
+		// This stores one passed the last dst handled by this thread
+		int end;
+		// This stores the values of each src node
+		const float *src_val;
+		// This stores the accumulated values of each dst
+		float *dst_val;
+		// This stores the number of values for each node
+		int width;
+	};
+
+	// This stores the links added before the graph is compiled
+	CArrayList<SGraphLink> m_link_buff;
+	// This maps each node in the division to its local id
+	CObjectHashMap<S5Byte> m_node_map;
+	// This maps each remote dst node to its boundary slot
+	CObjectHashMap<S5Byte> m_boundary_map;
+
+	// This stores the offset of the first link of each dst
+	CMemoryChunk<int> m_dst_offset;
+	// This stores the local id of the src node of each link
+	CMemoryChunk<int> m_link_src;
+	// This stores the weight of each link
+	CMemoryChunk<float> m_link_weight;
+	// This stores the offset of the first link of each src, this
+	// is only built when values are scattered from the src nodes
+	CMemoryChunk<int> m_src_offset;
+	// This stores the dst of each link grouped by src
+	CMemoryChunk<int> m_src_link_dst;
+	// This stores the weight of each link grouped by src
+	CMemoryChunk<float> m_src_link_weight;
+
+	// This stores the offset of the first boundary slot owned by
+	// each hash division, slots are placed after the local nodes
+	CMemoryChunk<int> m_boundary_offset;
+	// This stores the local id of each boundary value sent by
+	// every other hash division, -1 if the node isn't in the graph
+	CMemoryChunk<CArrayList<int> > m_recv_id;
+	// This stores the values read from a boundary file
+	CArrayList<float> m_recv_buff;
+
+	// This stores the hash division held in the graph
+	int m_hash_div;
+	// This stores the number of hash divisions
+	int m_hash_div_num;
+	// This stores the number of nodes in the graph
+	int m_node_num;
+	// This stores the maximum number of bytes the graph can use
+	_int64 m_max_byte_num;
+	// This is set if the division doesn't fit in memory
+	bool m_is_overflow;
+	// This stores the root name of the exchange files
+	CMemoryChunk<char> m_file_name;
+
+	// This defines a function that computes the hash code for a node
+	static int HashCode(const S5Byte &node) {
+		return (int)S5Byte::Value(node);
+	}
+
+	// This defines a function to compare two nodes for equality
+	static bool Equal(const S5Byte &arg1, const S5Byte &arg2) {
+		return S5Byte::Value(arg1) == S5Byte::Value(arg2);
+	}
+
+	// This returns the name of an exchange file
+	// @param type - the type of exchange file
+	// @param from_div - the hash division that wrote the file
+	// @param to_div - the hash division the file is for
+	const char *ExchangeFile(const char type[], int from_div, int to_div) {
+		strcpy(CUtility::SecondTempBuffer(), m_file_name.Buffer());
+		strcat(CUtility::SecondTempBuffer(), type);
+		return CUtility::ExtendString(CUtility::SecondTempBuffer(), from_div, ".div", to_div);
+	}
+
+	// This returns the name of the boundary file sent between two
+	// divisions. Two files are alternated between so a division can
+	// write the next cycle while a slower division is still reading.
+	// @param from_div - the hash division that sent the boundary
+	// @param to_div - the hash division receiving the boundary
+	// @param cycle - the current cycle
+	const char *BoundaryFile(int from_div, int to_div, int cycle) {
+		strcpy(CUtility::SecondTempBuffer(), m_file_name.Buffer());
+		strcat(CUtility::SecondTempBuffer(), "_boundary");
+		return CUtility::ExtendString(CUtility::SecondTempBuffer(),
+			from_div, ".div", to_div, ".", cycle & 0x01);
+	}
+
+	// This returns the name of the file that marks a division as failed
+	// @param hash_div - the hash division that failed
+	const char *FailFile(int hash_div) {
+		strcpy(CUtility::SecondTempBuffer(), m_file_name.Buffer());
+		strcat(CUtility::SecondTempBuffer(), "_failed");
+		return CUtility::ExtendString(CUtility::SecondTempBuffer(), hash_div);
+	}
+
+	// This is the entry function for each multiply thread
+	static THREAD_RETURN1 THREAD_RETURN2 MultiplyThread(void *ptr) {
+
+		SMultiplyThread *thread = (SMultiplyThread *)ptr;
+		thread->this_ptr->MultiplyRange(thread->src_val, thread->dst_val,
+			thread->width, thread->start, thread->end);
+
+		return 0;
+	}
+
+	// This accumulates the weighted src values for a range of dst
+	// @param src_val - the values of each src node
+	// @param dst_val - stores the accumulated value of each dst
+	// @param width - the number of values for each node
+	// @param start - the first dst to process
+	// @param end - one passed the last dst to process
+	void MultiplyRange(const float src_val[], float dst_val[],
+		int width, int start, int end) {
+
+		const int *link_src = m_link_src.Buffer();
+		const float *link_weight = m_link_weight.Buffer();
+
+		if(width == 1) {
+			for(int i=start; i<end; i++) {
+				float sum = 0;
+				for(int j=m_dst_offset[i]; j<m_dst_offset[i+1]; j++) {
+					sum += src_val[link_src[j]] * link_weight[j];
+				}
+				dst_val[i] = sum;
+			}
+			return;
+		}
+
+		for(int i=start; i<end; i++) {
+			float *dst = dst_val + (i * width);
+			for(int k=0; k<width; k++) {
+				dst[k] = 0;
+			}
+
+			for(int j=m_dst_offset[i]; j<m_dst_offset[i+1]; j++) {
+				CClassVector::ScaleAdd(dst, src_val + (link_src[j] * width),
+					link_weight[j], width);
+			}
+		}
+	}
+
+	// This writes the boundary nodes owned by every other hash division
+	// so the owner can map boundary values onto its own local ids
+	void WriteBoundaryNodes() {
+
+		CMemoryChunk<S5Byte> node_buff(max(BoundaryNum(), 1));
+		m_boundary_map.ResetNextObject();
+		for(int i=0; i<m_boundary_map.Size(); i++) {
+			S5Byte &node = m_boundary_map.NextSeqObject();
+			int hash = (int)(S5Byte::Value(node) % m_hash_div_num);
+			node_buff[m_boundary_offset[hash]++] = node;
+		}
+
+		// shift the offsets back to the start of each division
+		for(int i=m_hash_div_num; i>0; i--) {
+			m_boundary_offset[i] = m_boundary_offset[i-1];
+		}
+		m_boundary_offset[0] = 0;
+
+		CHDFSFile node_file;
+		for(int i=0; i<m_hash_div_num; i++) {
+			if(i == m_hash_div) {
+				continue;
+			}
+
+			node_file.OpenWriteFile(ExchangeFile("_nodes", m_hash_div, i));
+			node_file.WriteObject(node_buff.Buffer() + m_boundary_offset[i],
+				m_boundary_offset[i+1] - m_boundary_offset[i]);
+			node_file.CloseFile();
+		}
+	}
+
+	// This reads the boundary nodes sent by every other hash division
+	// and finds the local id of each
+	void ReadBoundaryNodes() {
+
+		S5Byte node;
+		CHDFSFile node_file;
+		m_recv_id.AllocateMemory(m_hash_div_num);
+
+		for(int i=0; i<m_hash_div_num; i++) {
+			m_recv_id[i].Initialize(4);
+			if(i == m_hash_div) {
+				continue;
+			}
+
+			node_file.OpenReadFile(ExchangeFile("_nodes", i, m_hash_div));
+			while(node_file.ReadObject(node)) {
+				m_recv_id[i].PushBack(m_node_map.Get(node));
+			}
+			node_file.CloseFile();
+		}
+	}
+
+public:
+
+	CLinkGraph() {
+		m_file_name.AllocateMemory(256);
+		m_is_overflow = false;
+		m_node_num = 0;
+	}
+
+	// This initializes the graph for a hash division
+	// @param file_name - the root name of the exchange files
+	// @param hash_div - the hash division being held in memory
+	// @param hash_div_num - the number of hash divisions
+	// @param max_byte_num - the maximum number of bytes the links can use
+	void Initialize(const char file_name[], int hash_div,
+		int hash_div_num, _int64 max_byte_num) {
+
+		strcpy(m_file_name.Buffer(), file_name);
+		m_hash_div = hash_div;
+		m_hash_div_num = hash_div_num;
+		m_max_byte_num = max_byte_num;
+		m_is_overflow = false;
+
+		m_link_buff.Initialize(1024);
+		m_recv_buff.Initialize(1024);
+		m_node_map.Initialize(HashCode, Equal);
+		m_boundary_map.Initialize(HashCode, Equal);
+		m_boundary_offset.AllocateMemory(hash_div_num + 1, 0);
+	}
+
+	// This adds a node to the graph
+	// @param node - the node being added
+	// @return the local id of the node
+	inline int AddNode(const S5Byte &node) {
+		return m_node_map.Put(node);
+	}
+
+	// This adds a link to the graph, links are ignored once
+	// the division is too large to fit in memory
+	// @param src - the local id of the src node
+	// @param dst - the dst node
+	// @param link_weight - the weight of the link
+	inline void AddLink(int src, const S5Byte &dst, float link_weight) {
+
+		if(m_is_overflow == true) {
+			return;
+		}
+
+		if((_int64)(m_link_buff.Size() + 1) * LINK_BYTE_NUM > m_max_byte_num
+			|| m_link_buff.Size() >= 0x7FFFFFF0) {
+			m_is_overflow = true;
+			m_link_buff.FreeMemory();
+			return;
+		}
+
+		m_link_buff.ExtendSize(1);
+		SGraphLink &link = m_link_buff.LastElement();
+		link.src = src;
+		link.dst = dst;
+		link.link_weight = link_weight;
+	}
+
+	// This returns true if the division doesn't fit in memory
+	inline bool AskOverflow() {
+		return m_is_overflow;
+	}
+
+	// This returns the number of local nodes
+	inline int NodeNum() {
+		return m_node_num;
+	}
+
+	// This returns the number of boundary slots
+	inline int BoundaryNum() {
+		return m_boundary_map.Size();
+	}
+
+	// This returns the number of dst in the graph, this is
+	// the local nodes followed by the boundary slots
+	inline int DstNum() {
+		return m_node_num + BoundaryNum();
+	}
+
+	// This returns the number of links in the graph
+	inline int LinkNum() {
+		return m_dst_offset[DstNum()];
+	}
+
+	// This returns the number of links from a local node, this
+	// is only known once CompileSrcLinks has been called
+	inline int SrcLinkNum(int id) {
+		return m_src_offset[id+1] - m_src_offset[id];
+	}
+
+	// This returns the local id of a node, -1 if it's not in the graph
+	inline int NodeID(const S5Byte &node) {
+		return m_node_map.Get(node);
+	}
+
+	// This groups the links by their dst once all the nodes and links
+	// have been added. Links to local nodes that were never added are
+	// dropped, their weight is still part of the src node's out weight.
+	void CompileGraph() {
+
+		m_node_num = m_node_map.Size();
+		CMemoryChunk<int> link_dst(max(m_link_buff.Size(), 1));
+
+		for(int i=0; i<m_link_buff.Size(); i++) {
+			SGraphLink &link = m_link_buff[i];
+			int hash = (int)(S5Byte::Value(link.dst) % m_hash_div_num);
+
+			if(hash == m_hash_div) {
+				link_dst[i] = m_node_map.Get(link.dst);
+				continue;
+			}
+
+			link_dst[i] = m_boundary_map.Put(link.dst);
+			if(m_boundary_map.AskFoundWord() == false) {
+				m_boundary_offset[hash+1]++;
+			}
+		}
+
+		for(int i=1; i<=m_hash_div_num; i++) {
+			m_boundary_offset[i] += m_boundary_offset[i-1];
+		}
+
+		// place each boundary slot after the local nodes grouped by division
+		CMemoryChunk<int> slot_dst(max(BoundaryNum(), 1));
+		CMemoryChunk<int> next_slot(m_boundary_offset);
+		m_boundary_map.ResetNextObject();
+		for(int i=0; i<BoundaryNum(); i++) {
+			S5Byte &node = m_boundary_map.NextSeqObject();
+			int hash = (int)(S5Byte::Value(node) % m_hash_div_num);
+			slot_dst[i] = m_node_num + next_slot[hash]++;
+		}
+
+		m_dst_offset.AllocateMemory(DstNum() + 1, 0);
+		for(int i=0; i<m_link_buff.Size(); i++) {
+			SGraphLink &link = m_link_buff[i];
+			if(link_dst[i] < 0) {
+				continue;
+			}
+
+			if((int)(S5Byte::Value(link.dst) % m_hash_div_num) != m_hash_div) {
+				link_dst[i] = slot_dst[link_dst[i]];
+			}
+
+			m_dst_offset[link_dst[i] + 1]++;
+		}
+
+		for(int i=1; i<=DstNum(); i++) {
+			m_dst_offset[i] += m_dst_offset[i-1];
+		}
+
+		m_link_src.AllocateMemory(max(m_dst_offset[DstNum()], 1));
+		m_link_weight.AllocateMemory(m_link_src.OverflowSize());
+		CMemoryChunk<int> next_link(m_dst_offset);
+
+		for(int i=0; i<m_link_buff.Size(); i++) {
+			if(link_dst[i] < 0) {
+				continue;
+			}
+
+			int offset = next_link[link_dst[i]]++;
+			m_link_src[offset] = m_link_buff[i].src;
+			m_link_weight[offset] = m_link_buff[i].link_weight;
+		}
+
+		m_link_buff.FreeMemory();
+		WriteBoundaryNodes();
+	}
+
+	// This groups a copy of the links by their src so the values of a
+	// small set of src nodes can be scattered to their dst. This must
+	// follow CompileGraph. The link buffer has been freed by this point
+	// so the copy fits in the memory the division was allowed.
+	void CompileSrcLinks() {
+
+		m_src_offset.AllocateMemory(m_node_num + 1, 0);
+		for(int i=0; i<LinkNum(); i++) {
+			m_src_offset[m_link_src[i] + 1]++;
+		}
+
+		for(int i=1; i<=m_node_num; i++) {
+			m_src_offset[i] += m_src_offset[i-1];
+		}
+
+		m_src_link_dst.AllocateMemory(max(LinkNum(), 1));
+		m_src_link_weight.AllocateMemory(m_src_link_dst.OverflowSize());
+		CMemoryChunk<int> next_link(m_src_offset);
+
+		for(int i=0; i<DstNum(); i++) {
+			for(int j=m_dst_offset[i]; j<m_dst_offset[i+1]; j++) {
+				int offset = next_link[m_link_src[j]]++;
+				m_src_link_dst[offset] = i;
+				m_src_link_weight[offset] = m_link_weight[j];
+			}
+		}
+	}
+
+	// This accumulates the weighted values of the src nodes for every dst.
+	// The dst are split between threads so each handles a similar number
+	// of links.
+	// @param src_val - the values of each local node
+	// @param dst_val - stores the accumulated values for every dst
+	// @param width - the number of values for each node
+	// @param thread_num - the number of threads to use
+	void Multiply(const float src_val[], float dst_val[], int width, int thread_num) {
+
+		thread_num = max(1, min(thread_num, DstNum() / 1024 + 1));
+		if(thread_num == 1) {
+			MultiplyRange(src_val, dst_val, width, 0, DstNum());
+			return;
+		}
+
+		CMemoryChunk<SMultiplyThread> thread(thread_num);
+		CMemoryChunk<pthread_t> handle(thread_num);
+
+		int start = 0;
+		for(int i=0; i<thread_num; i++) {
+			// find the first dst passed this thread's share of links
+			int end = DstNum();
+			if(i < thread_num - 1) {
+				int link_num = (int)((_int64)LinkNum() * (i + 1) / thread_num);
+				int lower = start;
+				while(lower < end) {
+					int mid = (lower + end) >> 1;
+					if(m_dst_offset[mid] < link_num) {
+						lower = mid + 1;
+					} else {
+						end = mid;
+					}
+				}
+			}
+
+			thread[i].this_ptr = this;
+			thread[i].start = start;
+			thread[i].end = end;
+			thread[i].src_val = src_val;
+			thread[i].dst_val = dst_val;
+			thread[i].width = width;
+			start = end;
+		}
+
+		unsigned int thread_id;
+		for(int i=1; i<thread_num; i++) {
+			handle[i] = _beginthreadex(NULL, 0,
+				MultiplyThread, &thread[i], NULL, &thread_id);
+		}
+
+		MultiplyThread(&thread[0]);
+
+		for(int i=1; i<thread_num; i++) {
+			WaitForThread(handle[i], INFINITE);
+		}
+	}
+
+	// This adds the weighted value of each of a set of src nodes to
+	// their dst. Unlike Multiply only the links of the given src nodes
+	// are visited, so this is cheaper when few src nodes have a value.
+	// This must follow CompileSrcLinks.
+	// @param src_id - the local id of each src node
+	// @param src_num - the number of src nodes
+	// @param src_val - the values of each local node
+	// @param dst_val - the weighted values are added to this for every dst
+	void Scatter(const int src_id[], int src_num, const float src_val[], float dst_val[]) {
+
+		const int *link_dst = m_src_link_dst.Buffer();
+		const float *link_weight = m_src_link_weight.Buffer();
+
+		for(int i=0; i<src_num; i++) {
+			int src = src_id[i];
+			float val = src_val[src];
+			for(int j=m_src_offset[src]; j<m_src_offset[src+1]; j++) {
+				dst_val[link_dst[j]] += val * link_weight[j];
+			}
+		}
+	}
+
+	// This writes the accumulated value of each boundary slot to the
+	// hash division that owns the node
+	// @param dst_val - the accumulated values for every dst
+	// @param width - the number of values for each node
+	// @param cycle - the current cycle
+	void SendBoundary(const float dst_val[], int width, int cycle) {
+
+		CHDFSFile boundary_file;
+		for(int i=0; i<m_hash_div_num; i++) {
+			if(i == m_hash_div) {
+				continue;
+			}
+
+			int start = m_node_num + m_boundary_offset[i];
+			int end = m_node_num + m_boundary_offset[i+1];
+			boundary_file.OpenWriteFile(BoundaryFile(m_hash_div, i, cycle));
+			boundary_file.WriteObject(dst_val + (start * width), (end - start) * width);
+			boundary_file.CloseFile();
+		}
+	}
+
+	// This adds the boundary values sent by every other hash division
+	// to the accumulated value of each local node. This must follow
+	// a call to Synchronize for the same cycle.
+	// @param dst_val - the accumulated values for every dst
+	// @param width - the number of values for each node
+	// @param cycle - the current cycle
+	void ReceiveBoundary(float dst_val[], int width, int cycle) {
+
+		if(m_recv_id.OverflowSize() == 0) {
+			ReadBoundaryNodes();
+		}
+
+		CHDFSFile boundary_file;
+		for(int i=0; i<m_hash_div_num; i++) {
+			if(i == m_hash_div || m_recv_id[i].Size() == 0) {
+				continue;
+			}
+
+			m_recv_buff.Resize(0);
+			m_recv_buff.ExtendSize(m_recv_id[i].Size() * width);
+			boundary_file.OpenReadFile(BoundaryFile(i, m_hash_div, cycle));
+			boundary_file.ReadObject(m_recv_buff.Buffer(), m_recv_buff.Size());
+			boundary_file.CloseFile();
+
+			const float *val = m_recv_buff.Buffer();
+			for(int j=0; j<m_recv_id[i].Size(); j++, val += width) {
+				int id = m_recv_id[i][j];
+				if(id < 0) {
+					continue;
+				}
+
+				float *dst = dst_val + (id * width);
+				for(int k=0; k<width; k++) {
+					dst[k] += val[k];
+				}
+			}
+		}
+	}
+
+	// This waits until every hash division has reached the same point.
+	// Each division publishes a set of values which are summed across
+	// all divisions. A division's values are written to a temporary
+	// file first and then renamed so they're never seen half written.
+	// An exception is thrown if a division being waited on has failed
+	// or hasn't reached the barrier in the time allowed.
+	// @param sync_id - the id of the barrier, must increase on each call
+	// @param value - the values published by this division
+	// @param net_value - stores the sum of values across all divisions
+	// @param value_num - the number of values
+	void Synchronize(int sync_id, const double value[],
+		double net_value[], int value_num) {
+
+		CHDFSFile sync_file;
+		CHDFSFile temp_file;
+		char file_name[256];
+		strcpy(file_name, ExchangeFile("_sync", sync_id, m_hash_div));
+
+		sync_file.SetFileName(file_name);
+		temp_file.OpenWriteFile(CUtility::ExtendString(file_name, ".tmp"));
+		temp_file.WriteObject(value, value_num);
+		temp_file.CloseFile();
+		strcpy(file_name, sync_file.GetFullFileName());
+		rename(temp_file.GetFullFileName(), file_name);
+
+		for(int j=0; j<value_num; j++) {
+			net_value[j] = 0;
+		}
+
+		CMemoryChunk<double> div_value(max(value_num, 1));
+		for(int i=0; i<m_hash_div_num; i++) {
+			int wait_time = 0;
+			strcpy(file_name, ExchangeFile("_sync", sync_id, i));
+			while(CMappedFile::AskFileExists(file_name) == false) {
+				if(CMappedFile::AskFileExists(FailFile(i)) == true) {
+					throw EException("Hash division failed");
+				}
+
+				if(wait_time >= SYNC_TIME_OUT) {
+					throw EException("Hash division barrier timed out");
+				}
+
+				Sleep(SYNC_POLL_TIME);
+				wait_time += SYNC_POLL_TIME;
+			}
+
+			sync_file.OpenReadFile(file_name);
+			sync_file.ReadObject(div_value.Buffer(), value_num);
+			sync_file.CloseFile();
+
+			for(int j=0; j<value_num; j++) {
+				net_value[j] += div_value[j];
+			}
+		}
+	}
+
+	// This marks a division as failed so every other division gives up 
+	// at the next barrier, this is called once the division has stopped
+	// @param file_name - the root name of the exchange files
+	// @param hash_div - the hash division that failed
+	static void SignalFailure(const char file_name[], int hash_div) {
+
+		CLinkGraph graph;
+		strcpy(graph.m_file_name.Buffer(), file_name);
+
+		CHDFSFile fail_file;
+		fail_file.OpenWriteFile(graph.FailFile(hash_div));
+		fail_file.WriteObject(hash_div);
+		fail_file.CloseFile();
+	}
+
+	// This returns true if any division has been marked as failed
+	// @param file_name - the root name of the exchange files
+	// @param hash_div_num - the number of hash divisions
+	static bool AskFailed(const char file_name[], int hash_div_num) {
+
+		CLinkGraph graph;
+		strcpy(graph.m_file_name.Buffer(), file_name);
+
+		for(int i=0; i<hash_div_num; i++) {
+			if(CMappedFile::AskFileExists(graph.FailFile(i)) == true) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// This removes all the files used to exchange values between
+	// hash divisions. This must be called before any division starts
+	// and once every division has finished, as a barrier left over from
+	// a previous run would otherwise be passed straight through.
+	// @param file_name - the root name of the exchange files
+	// @param hash_div_num - the number of hash divisions
+	// @param sync_num - the number of barriers used by each division
+	static void RemoveExchangeFiles(const char file_name[], int hash_div_num, int sync_num) {
+
+		CLinkGraph graph;
+		strcpy(graph.m_file_name.Buffer(), file_name);
+
+		CHDFSFile file;
+		for(int i=0; i<hash_div_num; i++) {
+			file.SetFileName(graph.FailFile(i));
+			file.RemoveFile();
+
+			for(int j=0; j<sync_num; j++) {
+				file.SetFileName(graph.ExchangeFile("_sync", j, i));
+				file.RemoveFile();
+			}
+
+			for(int j=0; j<hash_div_num; j++) {
+				file.SetFileName(graph.ExchangeFile("_nodes", i, j));
+				file.RemoveFile();
+				file.SetFileName(graph.BoundaryFile(i, j, 0));
+				file.RemoveFile();
+				file.SetFileName(graph.BoundaryFile(i, j, 1));
+				file.RemoveFile();
+			}
+		}
+	}
+
+	// This frees the memory held by the graph
+	void FreeMemory() {
+		m_link_buff.FreeMemory();
+		m_node_map.FreeMemory();
+		m_boundary_map.FreeMemory();
+		m_dst_offset.FreeMemory();
+		m_link_src.FreeMemory();
+		m_link_weight.FreeMemory();
+		m_src_offset.FreeMemory();
+		m_src_link_dst.FreeMemory();
+		m_src_link_weight.FreeMemory();
+		m_recv_id.FreeMemory();
+		m_recv_buff.FreeMemory();
+	}
+};
+const int CLinkGraph::LINK_BYTE_NUM;
+const int CLinkGraph::SYNC_POLL_TIME;
+const int CLinkGraph::SYNC_TIME_OUT;
@@ -1,4 +1,4 @@
-#include "./NodeStat.h"
+#include "./MessageCombiner.h"
 
 // This finds the kth order statistic for a set of elements. This uses
 // the random binary partion where the median is approximated by the 
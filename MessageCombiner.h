@@ -0,0 +1,284 @@
+#include "./LinkGraph.h"
+
+// This class combines the messages passed along each link before they're
+// written out to the hash division that owns the dst node. Many links in
+// a link set point to the same dst node, so rather than writing a record
+// for every link the values passed to the same dst are summed in memory
+// and a single record is written for each dst. Only a bounded number of
+// dst nodes are held at once, when full the combined messages are spilled
+// to their hash division as a run sorted by dst node. Within a run each
+// dst is stored as an escaped difference from the previous dst followed
+// by its values. A spill file is read back with CCombinedMessageReader.
+class CMessageCombiner {
+
+	// This defines the default maximum number of dst nodes held in memory
+	static const int DEF_MAX_DST_NUM = 1 << 20;
+
+	// This stores a combined dst node while it's being sorted
+	struct SCombinedMessage {
+		// This stores the dst node
+		S5Byte dst;
+		// This stores the slot holding the combined values
+		int slot;
+	};
+
+	// This maps each dst node to the slot holding its combined values
+	CObjectHashMap<S5Byte> m_dst_map;
+	// This stores the combined values of each slot
+	CArrayList<float> m_value;
+	// This stores the combined messages grouped by hash division
+	CMemoryChunk<SCombinedMessage> m_sort_buff;
+	// This stores the offset of each hash division in the sort buffer
+	CMemoryChunk<int> m_hash_offset;
+	// This stores the spill file for each hash division
+	CFileSet<CHDFSFile> m_spill_set;
+	// This stores the number of values passed in each message
+	int m_width;
+	// This stores the maximum number of dst nodes held in memory
+	int m_max_dst_num;
+	// This stores the number of messages added
+	_int64 m_message_num;
+	// This stores the number of combined messages written out
+	_int64 m_spill_num;
+
+	// This returns a hash code for a dst node, the nodes in a single hash
+	// division are all congruent so the bits are mixed
+	static int HashCode(const S5Byte &node) {
+		return (int)((S5Byte::Value(node) * 2654435761LL) >> 16) & 0x7FFFFFFF;
+	}
+
+	// This is an equality handle used to compare two dst nodes
+	static bool Equal(const S5Byte &arg1, const S5Byte &arg2) {
+		return S5Byte::Value(arg1) == S5Byte::Value(arg2);
+	}
+
+	// This is used to sort combined messages by dst node
+	static int CompareCombinedMessage(const SCombinedMessage &arg1,
+		const SCombinedMessage &arg2) {
+
+		_int64 dst1 = S5Byte::Value(arg1.dst);
+		_int64 dst2 = S5Byte::Value(arg2.dst);
+
+		if(dst1 < dst2) {
+			return 1;
+		}
+
+		if(dst1 > dst2) {
+			return -1;
+		}
+
+		return 0;
+	}
+
+	// This returns the slot for a dst node, the slot is added if the
+	// dst node has not been seen since the last spill
+	// @param dst - the dst node of the message
+	// @return the offset of the slot's values
+	inline int Slot(const S5Byte &dst) {
+
+		if(m_dst_map.Size() >= m_max_dst_num) {
+			Spill();
+		}
+
+		int offset = m_dst_map.Put(dst) * m_width;
+		if(m_dst_map.AskFoundWord() == false) {
+			m_value.ExtendSize(m_width);
+			for(int i=0; i<m_width; i++) {
+				m_value[offset + i] = 0;
+			}
+		}
+
+		return offset;
+	}
+
+public:
+
+	CMessageCombiner() {
+		m_width = 0;
+	}
+
+	// This opens a spill file for every hash division
+	// @param dir - this is the directory for the spill set
+	// @param set_num - this is the number of hash divisions
+	// @param client - the client id of this client
+	// @param width - the number of values passed in each message
+	// @param max_dst_num - the maximum number of dst nodes held in memory
+	void Initialize(const char dir[], int set_num, int client,
+		int width, int max_dst_num = DEF_MAX_DST_NUM) {
+
+		if(width <= 0) {
+			throw EIllegalArgumentException("width <= 0");
+		}
+
+		if(max_dst_num <= 0) {
+			throw EIllegalArgumentException("max_dst_num <= 0");
+		}
+
+		m_width = width;
+		m_max_dst_num = max_dst_num;
+		m_message_num = 0;
+		m_spill_num = 0;
+
+		m_spill_set.OpenWriteFileSet(dir, set_num, client);
+		m_dst_map.Initialize(HashCode, Equal, max_dst_num);
+		m_value.Initialize(max_dst_num * width);
+		m_sort_buff.AllocateMemory(max_dst_num);
+		m_hash_offset.AllocateMemory(set_num + 1);
+	}
+
+	// This adds a message with a single value
+	// @param dst - the dst node of the message
+	// @param value - the value passed to the dst node
+	inline void AddMessage(const S5Byte &dst, float value) {
+		m_value[Slot(dst)] += value;
+		m_message_num++;
+	}
+
+	// This adds a message with a value for each class
+	// @param dst - the dst node of the message
+	// @param value - the values passed to the dst node
+	// @param weight - this is multiplied by each value
+	inline void AddMessage(const S5Byte &dst, const float value[], float weight) {
+
+		CClassVector::ScaleAdd(m_value.Buffer() + Slot(dst), value, weight, m_width);
+		m_message_num++;
+	}
+
+	// This writes out all of the combined messages held in memory. Each
+	// hash division is given a run of combined messages sorted by dst.
+	void Spill() {
+
+		int set_num = m_spill_set.SetNum();
+		if(m_dst_map.Size() == 0) {
+			return;
+		}
+
+		m_hash_offset.InitializeMemoryChunk(0);
+		m_dst_map.ResetNextObject();
+		for(int i=0; i<m_dst_map.Size(); i++) {
+			S5Byte &dst = m_dst_map.NextSeqObject();
+			m_hash_offset[(int)(S5Byte::Value(dst) % set_num) + 1]++;
+		}
+
+		for(int i=1; i<=set_num; i++) {
+			m_hash_offset[i] += m_hash_offset[i-1];
+		}
+
+		m_dst_map.ResetNextObject();
+		for(int i=0; i<m_dst_map.Size(); i++) {
+			S5Byte &dst = m_dst_map.NextSeqObject();
+			int hash = (int)(S5Byte::Value(dst) % set_num);
+			SCombinedMessage &message = m_sort_buff[m_hash_offset[hash]++];
+			message.dst = dst;
+			message.slot = i * m_width;
+		}
+
+		CSort<SCombinedMessage> sort(0, CompareCombinedMessage);
+
+		int start = 0;
+		for(int i=0; i<set_num; i++) {
+			// the offsets have been moved on to the start of the next division
+			int end = m_hash_offset[i];
+			if(start == end) {
+				continue;
+			}
+
+			sort.HybridSort(m_sort_buff.Buffer() + start, end - start);
+
+			_int64 prev_dst = 0;
+			CHDFSFile &spill_file = m_spill_set.File(i);
+			spill_file.AddEscapedItem(end - start);
+			for(int j=start; j<end; j++) {
+				SCombinedMessage &message = m_sort_buff[j];
+				_int64 dst = S5Byte::Value(message.dst);
+
+				spill_file.AddEscapedItem(dst - prev_dst);
+				spill_file.WriteCompObject(m_value.Buffer() + message.slot, m_width);
+				prev_dst = dst;
+			}
+
+			start = end;
+		}
+
+		m_spill_num += m_dst_map.Size();
+		m_dst_map.Reset();
+		m_value.Resize(0);
+	}
+
+	// This spills any remaining messages and closes the spill set
+	void CloseCombiner() {
+		Spill();
+		m_spill_set.CloseFileSet();
+
+		if(m_message_num > 0) {
+			cout<<"Combined "<<m_message_num<<" Messages Into "<<m_spill_num<<endl;
+		}
+	}
+
+	// This returns the number of messages added
+	inline _int64 MessageNum() {
+		return m_message_num;
+	}
+
+	// This returns the number of combined messages written out
+	inline _int64 SpillNum() {
+		return m_spill_num;
+	}
+};
+const int CMessageCombiner::DEF_MAX_DST_NUM;
+
+// This class reads back the combined messages written to a spill file
+// by CMessageCombiner. Runs are read one after another, so a dst node
+// may appear once in each run.
+class CCombinedMessageReader {
+
+	// This stores the spill file being read
+	CHDFSFile *m_spill_file;
+	// This stores the number of messages left in the current run
+	uLong m_run_left;
+	// This stores the previous dst node in the current run
+	_int64 m_prev_dst;
+	// This stores the number of values passed in each message
+	int m_width;
+
+public:
+
+	CCombinedMessageReader() {
+		m_spill_file = NULL;
+	}
+
+	// This starts reading a spill file
+	// @param spill_file - the spill file which must be open for reading
+	// @param width - the number of values passed in each message
+	void Initialize(CHDFSFile &spill_file, int width) {
+		m_spill_file = &spill_file;
+		m_width = width;
+		m_run_left = 0;
+		m_prev_dst = 0;
+	}
+
+	// This reads the next combined message
+	// @param dst - used to store the dst node
+	// @param value - used to store the values passed to the dst node
+	// @return true if a message was read, false at the end of the file
+	bool NextMessage(S5Byte &dst, float value[]) {
+
+		if(m_run_left == 0) {
+			if(m_spill_file->GetEscapedItem(m_run_left) < 0) {
+				return false;
+			}
+
+			m_prev_dst = 0;
+		}
+
+		_int64 delta;
+		m_spill_file->GetEscapedItem(delta);
+		m_prev_dst += delta;
+		dst = m_prev_dst;
+
+		m_spill_file->ReadCompObject(value, m_width);
+		m_run_left--;
+
+		return true;
+	}
+};
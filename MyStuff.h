@@ -1407,10 +1407,10 @@ public:
 // string into individual words. Several functions are 
 // supplied to handle this job.
 class CTokeniser : public CUtility {
-	// stores if a new word has started in a buffer
-	static bool m_new_word; 
+	// stores if a new word has started in a buffer, one for each thread
+	static THREAD_LOCAL bool m_new_word; 
 	// stores the index for the start of the new word
-	static int m_word_start; 
+	static THREAD_LOCAL int m_word_start; 
 
 	// stores a list of word tokens
 	CArrayList<char> m_token; 
@@ -1570,8 +1570,8 @@ public:
 		return (matched_terms == term_num) ? word_end : -1; 
 	}
 }; 
-bool CTokeniser::m_new_word; 
-int CTokeniser::m_word_start; 
+THREAD_LOCAL bool CTokeniser::m_new_word; 
+THREAD_LOCAL int CTokeniser::m_word_start; 
 
 // This is a standard linked list LocalData structure
 // that allocates elements individually. The linked
@@ -1927,35 +1927,37 @@ public:
 // function must be provided.
 template <class X> class CSort {
 
+	// This defines the size below which insertion sort is used
+	static const int INSERTION_SORT_SIZE = 16;
+	// This defines the size above which the pivot is taken as
+	// the median of three medians instead of a single median
+	static const int NINTHER_SIZE = 128;
+	// This defines the size above which both sides of a
+	// partition can be sorted on different threads
+	static const int PARALLEL_SORT_SIZE = 1 << 16;
+
+	// This stores a range of items sorted on its own thread
+	struct SSortTask {
+		// This stores a pointer to the sorter
+		CSort<X> *this_ptr;
+		// This stores the items being sorted
+		X *items;
+		// This stores the first item in the range
+		int left;
+		// This stores the last item in the range
+		int right;
+		// This stores the number of bad partitions allowed
+		int depth_limit;
+		// This stores the number of threads available to the range
+		int thread_num;
+	};
+
 	// stores a Buffer to a compare function
-	int (*m_compare)(const X &arg1, const X &arg2); 
+	int (*m_compare)(const X &arg1, const X &arg2);
 	// stores the number of sorted elements
-	static int m_size; 
-	// stores a Buffer to the elements that need sorting
-	static X *m_items; 
-
-	// recursive quick sort
-	void q_sort(X items[], X left, X right) {
-		X pivot = items[left]; 
-		while(left < right) {
-			while((m_compare(items[right], pivot) >= 0) && (m_compare(left, right) < 0))
-			right--; 
-			if(left != right) {
-				items[left] = items[right]; 
-				left++; 
-			}
-			while((m_compare(items[right], pivot) <= 0) && (m_compare(left, right) < 0))
-			left++; 
-			if(m_compare(left, right)) {
-				items[right] = items[left]; 
-				right--; 
-			}
-		}
-		items[left] = pivot; 
-		pivot = left; 
-		if(left < pivot)q_sort(items, left, pivot - 1); 
-		if(right > pivot)q_sort(items, pivot + 1, right); 
-	}
+	int m_size;
+	// This stores the number of threads used by hybrid sort
+	int m_thread_num;
 
 	// generic compare function
 	static int GreaterCompare(const X &arg1, const X &arg2) {
@@ -1971,42 +1973,186 @@ template <class X> class CSort {
 		return 0; 
 	}
 
-	// recursive quick sort used for hybrid sort
-	void ReqQuickSort(int left, int right) {
-		int size = right - left + 1; 
-		if(size < 10)
-			InsertionSort(left, right); 	// insertion sort if small
-		else {	// quicksort if large
-			X median = MedianOf3(left, right); 
-			int partition = PartionIt(left, right, median); 
-			ReqQuickSort(left, partition - 1); 
-			ReqQuickSort(partition + 1, right); 
+	// This is the entry function for a thread sorting a range of items
+	static THREAD_RETURN1 THREAD_RETURN2 SortTaskThread(void *ptr) {
+
+		SSortTask *task = (SSortTask *)ptr;
+		task->this_ptr->IntroSort(task->items, task->left,
+			task->right, task->depth_limit, task->thread_num);
+
+		return 0;
+	}
+
+	// This is an introspective quick sort used for hybrid sort. Ranges are
+	// partitioned until they are small enough for insertion sort. A badly
+	// unbalanced partition has a few items swapped to break up patterns in
+	// the input, after too many of these the range is heap sorted instead
+	// which bounds the sort at O(NlogN). The smaller side is recursed on so
+	// the stack depth is O(logN). When threads are available the left side
+	// of a large range is sorted on another thread. The items are passed
+	// down so multiple threads can sort at the same time.
+	// @param items - the items being sorted
+	// @param left - the first item in the range
+	// @param right - the last item in the range
+	// @param depth_limit - the number of bad partitions allowed before
+	//                    - falling back to heap sort
+	// @param thread_num - the number of threads available to the range
+	void IntroSort(X items[], int left, int right,
+		int depth_limit, int thread_num) {
+
+		while(right - left + 1 > INSERTION_SORT_SIZE) {
+			int size = right - left + 1;
+			X median = MedianOf3(items, left, right);
+			int partition = PartionIt(items, left, right, median);
+			int left_size = partition - left;
+			int right_size = right - partition;
+
+			if(min(left_size, right_size) < (size >> 3)) {
+				if(--depth_limit < 0) {
+					HeapSort(items, left, right);
+					return;
+				}
+
+				BreakPatterns(items, left, partition - 1);
+				BreakPatterns(items, partition + 1, right);
+			}
+
+			if(thread_num > 1 && size > PARALLEL_SORT_SIZE) {
+				unsigned int threadID;
+				SSortTask task;
+				task.this_ptr = this;
+				task.items = items;
+				task.left = left;
+				task.right = partition - 1;
+				task.depth_limit = depth_limit;
+				task.thread_num = thread_num >> 1;
+
+				pthread_t handle = _beginthreadex(NULL, 0,
+					SortTaskThread, &task, NULL, &threadID);
+				IntroSort(items, partition + 1, right,
+					depth_limit, thread_num - task.thread_num);
+				WaitForThread(handle, INFINITE);
+				return;
+			}
+
+			if(left_size < right_size) {
+				IntroSort(items, left, partition - 1, depth_limit, 1);
+				left = partition + 1;
+			} else {
+				IntroSort(items, partition + 1, right, depth_limit, 1);
+				right = partition - 1;
+			}
 		}
+
+		InsertionSort(items, left, right);
 	}
 
-	// finds the median of three elements
-	X MedianOf3(int left, int right) {
-		int center = (left + right) >> 1; 
+	// This swaps a few items at either end of a range with items a
+	// quarter of the way in. This stops ordered input from creating
+	// the same unbalanced partition over and over.
+	// @param items - the items being sorted
+	// @param left - the first item in the range
+	// @param right - the last item in the range
+	void BreakPatterns(X items[], int left, int right) {
 
-		// order left and center
-		if(m_compare(m_items[left], m_items[center]) < 0)
-			Swap(m_items[left], m_items[center]); 
+		int size = right - left + 1;
+		if(size < INSERTION_SORT_SIZE) {
+			return;
+		}
 
-		// order left and right
-		if(m_compare(m_items[left], m_items[right]) < 0)
-			Swap(m_items[left], m_items[right]); 
+		int offset = size >> 2;
+		Swap(items[left], items[left + offset]);
+		Swap(items[right], items[right - offset]);
 
-		// order center and right
-		if(m_compare(m_items[center], m_items[right]) < 0)
-			Swap(m_items[center], m_items[right]); 
+		if(size > NINTHER_SIZE) {
+			Swap(items[left + 1], items[left + offset + 1]);
+			Swap(items[left + 2], items[left + offset + 2]);
+			Swap(items[right - 1], items[right - offset - 1]);
+			Swap(items[right - 2], items[right - offset - 2]);
+		}
+	}
+
+	// This orders three items in place
+	inline void Sort3(X items[], int index1, int index2, int index3) {
+
+		if(m_compare(items[index1], items[index2]) < 0)
+			Swap(items[index1], items[index2]);
+
+		if(m_compare(items[index1], items[index3]) < 0)
+			Swap(items[index1], items[index3]);
+
+		if(m_compare(items[index2], items[index3]) < 0)
+			Swap(items[index2], items[index3]);
+	}
+
+	// finds the median of three elements, for larger ranges the center
+	// is first replaced by the median of three medians taken from across
+	// the range which gives a much better pivot on skewed input
+	X MedianOf3(X items[], int left, int right) {
+		int center = (left + right) >> 1;
+
+		if(right - left + 1 > NINTHER_SIZE) {
+			int step = (right - left + 1) >> 3;
+			Sort3(items, left + 1, left + step, left + (step << 1));
+			Sort3(items, center - step, center, center + step);
+			Sort3(items, right - (step << 1), right - step, right - 1);
+			Sort3(items, left + step, center, right - step);
+		}
+
+		// order left, center and right
+		Sort3(items, left, center, right);
 
 		// put pivot on the right
-		Swap(m_items[center], m_items[right - 1]); 
-		return m_items[right - 1]; 	// return median value
+		Swap(items[center], items[right - 1]);
+		return items[right - 1]; 	// return median value
+	}
+
+	// This moves an item down the heap until it comes after both
+	// of its children, the heap keeps the last item at the root
+	// @param items - the heap
+	// @param root - the item being moved down
+	// @param size - the number of items in the heap
+	void SiftDown(X items[], int root, int size) {
+
+		while(true) {
+			int child = (root << 1) + 1;
+			if(child >= size) {
+				return;
+			}
+
+			if(child + 1 < size && m_compare(items[child], items[child + 1]) > 0) {
+				child++;
+			}
+
+			if(m_compare(items[root], items[child]) <= 0) {
+				return;
+			}
+
+			Swap(items[root], items[child]);
+			root = child;
+		}
+	}
+
+	// This heap sorts a range of items in place
+	// @param items - the items being sorted
+	// @param left - the first item in the range
+	// @param right - the last item in the range
+	void HeapSort(X items[], int left, int right) {
+
+		items += left;
+		int size = right - left + 1;
+		for(int i=(size >> 1) - 1; i>=0; i--) {
+			SiftDown(items, i, size);
+		}
+
+		for(int i=size-1; i>0; i--) {
+			Swap(items[0], items[i]);
+			SiftDown(items, 0, i);
+		}
 	}
 
 	// used for hybrid sort
-	int PartionIt(int left, int right, X &pivot) {
+	int PartionIt(X items[], int left, int right, X &pivot) {
 		// right of the first element
 		int left_ptr = left; 
 		// left of the pivot
@@ -2014,49 +2160,66 @@ template <class X> class CSort {
 
 		while(true) {
 			// find the bigger
-			while(m_compare(m_items[++left_ptr], pivot) > 0); 
+			while(m_compare(items[++left_ptr], pivot) > 0); 
 
 			// find the smaller
-			while(m_compare(m_items[--right_ptr], pivot) < 0); 
+			while(m_compare(items[--right_ptr], pivot) < 0); 
 
 			// if Buffer cross partion done
 			if(left_ptr >= right_ptr)
 				break; 
 
-			Swap(m_items[left_ptr], m_items[right_ptr]); 
+			Swap(items[left_ptr], items[right_ptr]); 
 		}
 
 		// restore pivot
-		Swap(m_items[left_ptr], m_items[right - 1]); 
+		Swap(items[left_ptr], items[right - 1]); 
 		return left_ptr; 	// return pivot location
 	}
 
-	void InsertionSort(int left, int right) {
+	void InsertionSort(X items[], int left, int right) {
 
 		int in, out; 
 		for(out = left + 1; out <= right; out++) {	// out is dividing line
-			X temp = m_items[out]; 	// removed marked item
+			X temp = items[out]; 	// removed marked item
 			in = out; 	// start shift at out	
-			while((in > left) && (m_compare(m_items[in - 1], temp) <= 0)) {	// until one is smaller
-				m_items[in] = m_items[in - 1]; 
+			while((in > left) && (m_compare(items[in - 1], temp) <= 0)) {	// until one is smaller
+				items[in] = items[in - 1]; 
 				--in; 	// go left one position
 			}
-			m_items[in] = temp; 
+			items[in] = temp; 
 		}
 	}
 
 public:
 
 	CSort() {
+		m_compare = NULL;
+		m_size = 0;
+		m_thread_num = 1;
 	}
 
 	CSort(int size, int (*compare)(const X &arg1, const X &arg2)) {
 		m_compare = compare; 
 		m_size = size; 
+		m_thread_num = 1;
 	}
 
 	CSort(int size) {
+		m_compare = NULL;
 		m_size = size; 
+		m_thread_num = 1;
+	}
+
+	// This sets the number of threads used by hybrid sort, 
+	// only large ranges are split between threads
+	// @param thread_num - the number of sorting threads
+	void SetThreadNum(int thread_num) {
+		if(thread_num <= 0) {
+			throw EIllegalArgumentException("thread_num <= 0");
+		}
+
+		m_thread_num = thread_num;
 	}
 
 	// sets a comparison function given by the user
@@ -2097,7 +2260,12 @@ public:
 	}
 
 	// This is a very poor but simple sorting algorithm
-	void BubbleSort(X *buffer, int size = m_size) {
+	void BubbleSort(X *buffer) {
+		BubbleSort(buffer, m_size);
+	}
+
+	// This is a very poor but simple sorting algorithm
+	void BubbleSort(X *buffer, int size) {
 		
 		for(int a = 0; a < size; a++) {
 			for(int b = a + 1; b < size; b++) {
@@ -2109,13 +2277,24 @@ public:
 	}
 
 	// This performs a recursive quick sort
-	static void QuickSort(X items[], int size = m_size) {
-		q_sort(items, 0, size - 1); 
+	void QuickSort(X items[]) {
+		HybridSort(items, m_size);
+	}
+
+	// This performs a recursive quick sort
+	void QuickSort(X items[], int size) {
+		HybridSort(items, size);
+	}
+
+	// This search performs in Nlog(N) time - quick sort
+	// is still slightly faster
+	void MergeSort(X items[]) {
+		MergeSort(items, m_size);
 	}
 
 	// This search performs in Nlog(N) time - quick sort
 	// is still slightly faster
-	void MergeSort(X items[], int size = m_size) {
+	void MergeSort(X items[], int size) {
 		int level_size = 1; 
 		while(true) {
 			for(int i=0; i<size; i += (level_size << 1)) {
@@ -2202,7 +2381,12 @@ public:
 	}
 
 	// most commonly used for O(N2)
-	void InsertionSort(X items[], int size = m_size) {
+	void InsertionSort(X items[]) {
+		InsertionSort(items, m_size);
+	}
+
+	// most commonly used for O(N2)
+	void InsertionSort(X items[], int size) {
 		int in, out; 
 		for(out = 1; out < size; out++) {	// out is dividing line
 			X temp = items[out]; 	// removed marked item
@@ -2215,9 +2399,14 @@ public:
 		}
 	}
 
+	// most commonly used for O(N2)
+	template <class Z, class Y> void InsertionSort(Z items[], Y *order) {
+		InsertionSort(items, order, m_size);
+	}
+
 	// most commonly used for O(N2)
 	template <class Z, class Y> void InsertionSort
-		(Z items[], Y *order, int size = m_size) {
+		(Z items[], Y *order, int size) {
 
 		int in, out; 
 		for(out = 1; out < size; out++) {	// out is dividing line
@@ -2236,7 +2425,13 @@ public:
 
 	// This is the sorting algorithm that uses a heap
 	// to sort the buffer
-	void HeapSort(X items[], int size = m_size) {
+	void HeapSort(X items[]) {
+		HeapSort(items, m_size);
+	}
+
+	// This is the sorting algorithm that uses a heap
+	// to sort the buffer
+	void HeapSort(X items[], int size) {
 		
 		CPriorityQueue<X> priority_queue(size, m_compare); 
 		
@@ -2250,7 +2445,12 @@ public:
 	}
 
 	// fast for smaller number of elements
-	void ShellSort(X items[], int size = m_size) {
+	void ShellSort(X items[]) {
+		ShellSort(items, m_size);
+	}
+
+	// fast for smaller number of elements
+	void ShellSort(X items[], int size) {
 		
 		if(size <= 0)return; 
 		int inner, outer; 
@@ -2277,10 +2477,22 @@ public:
 	}
 
 	// this is the all in one super sort
-	void HybridSort(X items[], int size = m_size) {
+	void HybridSort(X items[]) {
+		HybridSort(items, m_size);
+	}
+
+	// this is the all in one super sort, it's an introspective quick
+	// sort that keeps no static state so different instances can sort
+	// on different threads at the same time
+	void HybridSort(X items[], int size) {
 		if(size <= 1)return; 
-		m_items = items; 
-		ReqQuickSort(0, size - 1); 
+
+		int depth_limit = 0;
+		for(int i=size; i>1; i>>=1) {
+			depth_limit++;
+		}
+
+		IntroSort(items, 0, size - 1, depth_limit, m_thread_num); 
 	}
 
 	// swaps two elements
@@ -2295,7 +2507,7 @@ public:
 
 	// delets an element from a list
 	template <class Z, class Y> static void DeleteElement
-		(Z list[], Y element, int size = m_size) {
+		(Z list[], Y element, int size) {
 
 		for(Y i=element; i<size; i++) {
 			list[i] = list[i+1]; 
@@ -2312,8 +2524,7 @@ public:
 		list[index] = element; 
 	}
 }; 
-template <class X> int CSort<X>::m_size; 
-template <class X> X *CSort<X>::m_items; 
+ 
 
 class CArrayListBitString {
 	// used to hold the bitstring
@@ -6913,21 +7124,24 @@ class CStemWord {
 		CHDFSFile file;
 		file.OpenReadFile(dir);
 
-		char ch; 
+		char buff[4096];
+		int size;
 		int length = 0; 
 		bool new_word = false; 
 		char *str = CUtility::SecondTempBuffer();
 
-		while(file.ReadObject(ch)) {	
-			ch = tolower(ch); 
-			if(CUtility::AskOkCharacter(ch)) {
-				new_word = false; 
-				str[length++] = ch; 
-			} else if(!new_word && length) {
-				new_word = true; 
-				// adds the suffix word to dictionary
-				AddSuffix(str, length); 	
-				length = 0; 
+		while((size = file.ReadObjectBlock(buff, sizeof(buff))) > 0) {	
+			for(int i=0; i<size; i++) {
+				char ch = tolower(buff[i]); 
+				if(CUtility::AskOkCharacter(ch)) {
+					new_word = false; 
+					str[length++] = ch; 
+				} else if(!new_word && length) {
+					new_word = true; 
+					// adds the suffix word to dictionary
+					AddSuffix(str, length); 	
+					length = 0; 
+				}
 			}
 		}
 	}
@@ -20,8 +20,14 @@ class COpenConnection {
 	// This stores the server info
 	struct sockaddr_in m_server;
 
+	// A closed socket is marked invalid so the descriptor is never closed
+	// twice, once the descriptor is reused by another connection closing
+	// it again would drop that connection.
 	void CleanUp() {
-		closesocket(m_socket);
+		if(m_socket != INVALID_SOCKET) {
+			closesocket(m_socket);
+			m_socket = INVALID_SOCKET;
+		}
 	}
 
 	// This is used to zero out a buffer
@@ -74,7 +80,7 @@ public:
 	// Sets up several DLL libraries
 	COpenConnection() {
 		Initialize();
-		
+		m_socket = INVALID_SOCKET;
 	}
 
 	COpenConnection(SOCKET socket) {
@@ -106,12 +112,16 @@ public:
 			return false;
 		}
 		
-		int nHostAddress;
-		struct hostent* pHostInfo;
-		/* get IP address from name */
-	        pHostInfo = gethostbyname(ip_addr);
-	        /* copy address into int */
-	        memcpy(&nHostAddress, pHostInfo->h_addr, pHostInfo->h_length);
+		// a numeric address is converted directly since gethostbyname
+		// shares a static result between every thread
+		int nHostAddress = inet_addr(ip_addr);
+		if(nHostAddress == INADDR_NONE) {
+			struct hostent* pHostInfo;
+			/* get IP address from name */
+			pHostInfo = gethostbyname(ip_addr);
+			/* copy address into int */
+			memcpy(&nHostAddress, pHostInfo->h_addr, pHostInfo->h_length);
+		}
 		
 		// Connect to a server.
 		sockaddr_in clientService;
@@ -540,12 +550,13 @@ public:
 
 	// Closes the current connection
 	inline void CloseConnection() {
-		closesocket(m_socket);
+		CleanUp();
 	}
 
 	// Closes the current connection
 	inline static void CloseConnection(SOCKET &socket) {
 		closesocket(socket);
+		socket = INVALID_SOCKET;
 	}
 
 	~COpenConnection() {
@@ -553,6 +564,433 @@ public:
 	}
 };
 
+// This is used to batch the many small fields exchanged between the query
+// front end and the query servers into length prefixed frames. Send only
+// appends to the outgoing frame. The frame is written with a single vectored
+// write once the connection waits on a Receive, is flushed or is closed, so
+// each turn of a request/reply exchange costs one system call instead of one
+// per field while the byte stream seen by each side stays the same. Each frame
+// starts with a header storing the number of payload bytes that follow and
+// the uncompressed payload size packed with the codec. A payload larger than 
+// COMP_THRESHOLD is compressed if that makes it any smaller. The frames and 
+// bytes sent and received are counted across every connection in the process
+// so the network cost of a query can be reported.
+class CFrameConnection {
+
+	// This defines the number of bytes in the frame header
+	static const int HEADER_SIZE = 8;
+	// This defines the payload size above which a frame is compressed
+	static const int COMP_THRESHOLD = 4096;
+	// This defines the initial size of the outgoing frame buffer
+	static const int INIT_FRAME_SIZE = 1024;
+
+	// This stores the socket
+	SOCKET m_socket;
+	// This stores the outgoing frame
+	CMemoryChunk<char> m_send_buff;
+	// This stores the number of bytes in the outgoing frame
+	int m_send_size;
+	// This stores the incoming frame
+	CMemoryChunk<char> m_receive_buff;
+	// This stores the number of bytes in the incoming frame
+	int m_receive_size;
+	// This stores the offset of the next unread byte in the incoming frame
+	int m_receive_offset;
+	// This stores a compressed outgoing payload
+	CMemoryChunk<char> m_comp_buff;
+	// This stores a compressed incoming payload
+	CMemoryChunk<char> m_wire_buff;
+	// This indicates whether the outgoing frame is sent before waiting
+	// on the next incoming frame
+	bool m_is_auto_flush;
+
+	// This protects the frame statistics
+	static CMutex m_stat_mutex;
+	// This stores the number of frames sent
+	static int m_send_frame_num;
+	// This stores the number of frames received
+	static int m_receive_frame_num;
+	// This stores the number of bytes sent and received including headers
+	static _int64 m_wire_byte_num;
+	// This stores the number of payload bytes sent and received before compression
+	static _int64 m_raw_byte_num;
+
+	// This records a frame that has been sent or received
+	// @param is_send - true if the frame was sent, false if it was received
+	// @param wire_size - the number of bytes on the wire including the header
+	// @param raw_size - the number of payload bytes before compression
+	static void UpdateStat(bool is_send, int wire_size, int raw_size) {
+
+		m_stat_mutex.Acquire();
+		if(is_send == true) {
+			m_send_frame_num++;
+		} else {
+			m_receive_frame_num++;
+		}
+
+		m_wire_byte_num += wire_size;
+		m_raw_byte_num += raw_size;
+		m_stat_mutex.Release();
+	}
+
+	// This writes the frame header followed by the payload with
+	// a single vectored write
+	// @param header - the frame header
+	// @param payload - the frame payload
+	// @param payload_size - the number of bytes in the payload
+	void WriteFrame(int header[], const char payload[], int payload_size) {
+
+		#ifdef OS_WINDOWS
+		COpenConnection::Send(m_socket, (char *)header, HEADER_SIZE);
+		COpenConnection::Send(m_socket, payload, payload_size);
+		#else
+		struct iovec vec[2];
+		vec[0].iov_base = (char *)header;
+		vec[0].iov_len = HEADER_SIZE;
+		vec[1].iov_base = (char *)payload;
+		vec[1].iov_len = payload_size;
+
+		int vec_offset = 0;
+		int bytes_left = HEADER_SIZE + payload_size;
+		while(bytes_left > 0) {
+			// a closed connection raises an error rather than SIGPIPE
+			struct msghdr msg;
+			memset(&msg, 0, sizeof(msg));
+			msg.msg_iov = vec + vec_offset;
+			msg.msg_iovlen = 2 - vec_offset;
+
+			int status = sendmsg(m_socket, &msg, MSG_NOSIGNAL);
+			if(status < 0 && errno == EINTR) {
+				continue;
+			}
+
+			if(status <= 0) {
+				throw ENetworkException("Send Error");
+			}
+
+			bytes_left -= status;
+			while(vec_offset < 2 && status >= (int)vec[vec_offset].iov_len) {
+				status -= vec[vec_offset].iov_len;
+				vec_offset++;
+			}
+
+			if(vec_offset < 2) {
+				vec[vec_offset].iov_base = (char *)vec[vec_offset].iov_base + status;
+				vec[vec_offset].iov_len -= status;
+			}
+		}
+		#endif
+	}
+
+	// This reads the next frame into the incoming frame buffer
+	void ReadFrame() {
+
+		int header[2];
+		COpenConnection::Receive(m_socket, (char *)header, HEADER_SIZE);
+
+		int wire_size = header[0];
+		int raw_size = CBlockCodec::BlockSize(header[1]);
+		if(wire_size < 0 || wire_size > raw_size) {
+			throw ENetworkException("Invalid Frame Header");
+		}
+
+		if(raw_size > m_receive_buff.OverflowSize()) {
+			m_receive_buff.AllocateMemory(raw_size);
+		}
+
+		if(wire_size == raw_size) {
+			COpenConnection::Receive(m_socket, m_receive_buff.Buffer(), raw_size);
+		} else {
+			if(wire_size > m_wire_buff.OverflowSize()) {
+				m_wire_buff.AllocateMemory(wire_size);
+			}
+
+			COpenConnection::Receive(m_socket, m_wire_buff.Buffer(), wire_size);
+			CBlockCodec::Decompress(CBlockCodec::BlockCodec(header[1]), 
+				m_wire_buff.Buffer(), m_receive_buff.Buffer(), wire_size, raw_size);
+		}
+
+		m_receive_size = raw_size;
+		m_receive_offset = 0;
+		UpdateStat(false, HEADER_SIZE + wire_size, raw_size);
+	}
+
+public:
+
+	CFrameConnection() {
+		m_socket = INVALID_SOCKET;
+		m_send_size = 0;
+		m_receive_size = 0;
+		m_receive_offset = 0;
+		m_is_auto_flush = true;
+	}
+
+	// This takes ownership of a socket that is already connected
+	CFrameConnection(SOCKET socket) {
+		m_socket = socket;
+		m_send_size = 0;
+		m_receive_size = 0;
+		m_receive_offset = 0;
+		m_is_auto_flush = true;
+	}
+
+	// Opens a client connection to some server on a given port and ip address
+	// @param port - the connecting port for the given process
+	// @param ip_address - a buffer containing the server ip address
+	// @return true if successful, false otherwise
+	bool OpenClientConnection(u_short port, const char *ip_addr) {
+
+		CloseConnection();
+		m_send_size = 0;
+		m_receive_size = 0;
+		m_receive_offset = 0;
+		return COpenConnection::OpenClientConnection(m_socket, port, ip_addr);
+	}
+
+	// Returns a reference to the socket
+	inline SOCKET &Socket() {
+		return m_socket;
+	}
+
+	// This takes ownership of a socket that is already connected, 
+	// any existing connection is closed first
+	// @param socket - the connected socket
+	void Attach(SOCKET socket) {
+
+		CloseConnection();
+		m_socket = socket;
+		m_send_size = 0;
+		m_receive_size = 0;
+		m_receive_offset = 0;
+	}
+
+	// This gives up ownership of the socket without closing it so
+	// it can be handed to another connection. Any outgoing frame
+	// is sent first.
+	// @return the socket
+	SOCKET Detach() {
+
+		Flush();
+		SOCKET socket = m_socket;
+		m_socket = INVALID_SOCKET;
+		m_receive_size = 0;
+		m_receive_offset = 0;
+
+		return socket;
+	}
+
+	// This sets whether the outgoing frame is sent before waiting on
+	// an incoming frame. This is turned off when one thread sends on 
+	// the connection while another receives, the sender must then 
+	// call Flush itself.
+	inline void SetAutoFlush(bool is_auto_flush) {
+		m_is_auto_flush = is_auto_flush;
+	}
+
+	// This returns true if part of the incoming frame is still unread
+	inline bool IsReceivePending() {
+		return m_receive_offset < m_receive_size;
+	}
+
+	// This checks that an idle connection can still be used, that is
+	// the other side has not closed it and has sent nothing unexpected.
+	// @return true if the connection is usable, false otherwise
+	bool IsAlive() {
+
+		if(m_socket == INVALID_SOCKET || IsReceivePending() == true) {
+			return false;
+		}
+
+		#ifndef OS_WINDOWS
+		char buff;
+		int status = recv(m_socket, &buff, 1, MSG_PEEK | MSG_DONTWAIT);
+		if(status >= 0) {
+			return false;
+		}
+
+		return errno == EAGAIN || errno == EWOULDBLOCK;
+		#else
+		return true;
+		#endif
+	}
+
+	// This appends data to the outgoing frame
+	// @param buffer - the buffer containg the data to send
+	// @param length - the number of bytes to send accross the connection
+	// @return the number of bytes added to the frame
+	int Send(const char buffer[], int length) {
+
+		if(m_send_size + length > m_send_buff.OverflowSize()) {
+			int size = max(INIT_FRAME_SIZE, m_send_buff.OverflowSize() << 1);
+			m_send_buff.Resize(max(size, m_send_size + length));
+		}
+
+		memcpy(m_send_buff.Buffer() + m_send_size, buffer, length);
+		m_send_size += length;
+
+		return length;
+	}
+
+	// This retrieves data from the incoming frames. Any outgoing frame is 
+	// sent first since the other side may be waiting on it to reply, 
+	// unless auto flush has been turned off.
+	// @param buffer - buffer to place the recieved data
+	// @param buffer_size - the number of bytes to recieve
+	// @return the number of bytes recieved
+	int Receive(char buffer[], int buffer_size) {
+
+		int offset = 0;
+		while(offset < buffer_size) {
+			if(m_receive_offset >= m_receive_size) {
+				if(m_is_auto_flush == true) {
+					Flush();
+				}
+
+				ReadFrame();
+				continue;
+			}
+
+			int bytes = buffer_size - offset;
+			int bytes_left = m_receive_size - m_receive_offset;
+			if(bytes > bytes_left) {
+				bytes = bytes_left;
+			}
+
+			memcpy(buffer + offset, m_receive_buff.Buffer() + m_receive_offset, bytes);
+			m_receive_offset += bytes;
+			offset += bytes;
+		}
+
+		return buffer_size;
+	}
+
+	// This sends the outgoing frame if it holds any data
+	void Flush() {
+
+		if(m_send_size == 0) {
+			return;
+		}
+
+		int header[2];
+		int codec = CBlockCodec::ZLIB_CODEC;
+		const char *payload = m_send_buff.Buffer();
+		header[0] = m_send_size;
+
+		if(m_send_size > COMP_THRESHOLD) {
+			codec = CBlockCodec::DefaultCodec("LocalData/");
+			int comp_size = CBlockCodec::Compress(codec, 
+				m_send_buff.Buffer(), m_comp_buff, m_send_size);
+
+			if(comp_size < m_send_size) {
+				payload = m_comp_buff.Buffer();
+				header[0] = comp_size;
+			}
+		}
+
+		header[1] = CBlockCodec::EncodeBlockSize(m_send_size, codec);
+		WriteFrame(header, payload, header[0]);
+		UpdateStat(true, HEADER_SIZE + header[0], m_send_size);
+		m_send_size = 0;
+	}
+
+	// This makes a Send or Receive that is blocked on the connection in 
+	// another thread fail straight away, for instance once a deadline has
+	// passed. The connection must still be closed by the thread using it.
+	void Abort() {
+
+		if(m_socket == INVALID_SOCKET) {
+			return;
+		}
+
+		#ifdef OS_WINDOWS
+			shutdown(m_socket, SD_BOTH);
+		#else
+			shutdown(m_socket, SHUT_RDWR);
+		#endif
+	}
+
+	// This sends any outgoing frame and closes the connection
+	void CloseConnection() {
+
+		if(m_socket == INVALID_SOCKET) {
+			return;
+		}
+
+		try {
+			Flush();
+		} catch(...) {
+		}
+
+		m_send_size = 0;
+		COpenConnection::CloseConnection(m_socket);
+	}
+
+	// This resets the frame statistics, called at the start of a query
+	static void ResetStat() {
+
+		m_stat_mutex.Acquire();
+		m_send_frame_num = 0;
+		m_receive_frame_num = 0;
+		m_wire_byte_num = 0;
+		m_raw_byte_num = 0;
+		m_stat_mutex.Release();
+	}
+
+	// This returns the number of round trips, one is completed
+	// each time a reply frame is received
+	static int RoundTripNum() {
+
+		m_stat_mutex.Acquire();
+		int num = m_receive_frame_num;
+		m_stat_mutex.Release();
+
+		return num;
+	}
+
+	// This returns the number of frames sent
+	static int SendFrameNum() {
+
+		m_stat_mutex.Acquire();
+		int num = m_send_frame_num;
+		m_stat_mutex.Release();
+
+		return num;
+	}
+
+	// This returns the number of bytes sent and received on the wire
+	static _int64 WireByteNum() {
+
+		m_stat_mutex.Acquire();
+		_int64 num = m_wire_byte_num;
+		m_stat_mutex.Release();
+
+		return num;
+	}
+
+	// This returns the number of payload bytes sent and 
+	// received before compression
+	static _int64 RawByteNum() {
+
+		m_stat_mutex.Acquire();
+		_int64 num = m_raw_byte_num;
+		m_stat_mutex.Release();
+
+		return num;
+	}
+
+	~CFrameConnection() {
+		CloseConnection();
+	}
+};
+CMutex CFrameConnection::m_stat_mutex;
+int CFrameConnection::m_send_frame_num;
+int CFrameConnection::m_receive_frame_num;
+_int64 CFrameConnection::m_wire_byte_num;
+_int64 CFrameConnection::m_raw_byte_num;
+const int CFrameConnection::HEADER_SIZE;
+const int CFrameConnection::COMP_THRESHOLD;
+const int CFrameConnection::INIT_FRAME_SIZE;
+
 // This is used to establish a pipe connection between two processes. This 
 // allows to processes to communicate with one another without the use of sockets.
 class CPipe {
@@ -627,3 +1065,329 @@ public:
 	}
 
 };
+
+
+#ifndef OS_WINDOWS
+
+// This is an event driven server core that is shared by the name server
+// and each of the query servers. The listening socket is made non blocking
+// and registered edge triggered with epoll so every notification drains the
+// accept queue. Accepted connections are registered one shot, which means a
+// connection is only handed to a worker once the client has sent a request
+// and only one worker ever owns it at a time. The worker runs the server's
+// handler on the connection using the normal blocking Send and Receive calls.
+// A connection that the handler keeps open is rearmed and goes back to waiting
+// in epoll, so idle and slow clients never hold up the accept loop or a worker.
+// Servers whose protocol has the server speak first can't wait for the client,
+// for these new connections are handed to a worker as soon as they're accepted.
+class CReactor {
+
+	// This defines the maximum number of events returned by each wait
+	static const int MAX_EVENT_NUM = 64;
+
+	// This stores the handler called for each ready connection
+	bool (*m_handler)(SOCKET &socket, void *handler_ptr);
+	// This is passed to the handler
+	void *m_handler_ptr;
+	// This stores the epoll instance
+	int m_epoll;
+	// This stores the listening socket
+	SOCKET m_listen_socket;
+	// This is written to in order to wake up the event loop
+	int m_wake_pipe[2];
+	// This stores the handle of each worker thread
+	CMemoryChunk<pthread_t> m_worker;
+	// This stores the connections waiting for a worker
+	CArrayList<SOCKET> m_ready;
+	// This stores the index of the oldest waiting connection
+	int m_ready_head;
+	// This protects the waiting connections
+	CMutex m_mutex;
+	// This is signalled once for every waiting connection and
+	// once for every worker when the reactor is stopped
+	CSemaphore m_ready_sem;
+	// This is true once the reactor has been told to stop
+	bool m_is_stop;
+	// This is true if new connections are handed to a worker as
+	// soon as they are accepted instead of once they are readable
+	bool m_is_server_first;
+
+	// This registers a connection with epoll so it's handed to a worker 
+	// the next time it becomes readable. A connection that can't be
+	// registered is closed.
+	// @param socket - the connection being registered
+	// @param op - EPOLL_CTL_ADD for a new connection, EPOLL_CTL_MOD
+	//           - to rearm a connection that has been kept open
+	void ArmConnection(SOCKET socket, int op) {
+
+		struct epoll_event event;
+		event.events = EPOLLIN | EPOLLET | EPOLLONESHOT;
+		event.data.fd = socket;
+
+		if(epoll_ctl(m_epoll, op, socket, &event) == 0) {
+			return;
+		}
+
+		// a server first connection is only registered once it's kept open
+		if(op == EPOLL_CTL_MOD && errno == ENOENT) {
+			ArmConnection(socket, EPOLL_CTL_ADD);
+			return;
+		}
+
+		closesocket(socket);
+	}
+
+	// This accepts every pending connection on the listening socket. Since
+	// the listening socket is edge triggered the queue must be drained 
+	// completely before waiting again.
+	void AcceptConnections() {
+
+		int flag = 1;
+		while(true) {
+			SOCKET socket = accept(m_listen_socket, NULL, NULL);
+			if(socket == INVALID_SOCKET) {
+				if(errno == EINTR) {
+					continue;
+				}
+
+				return;
+			}
+
+			// replies are small so don't hold them back waiting for an ack
+			setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (char *)&flag, sizeof(int));
+
+			if(m_is_server_first == true) {
+				QueueConnection(socket);
+			} else {
+				ArmConnection(socket, EPOLL_CTL_ADD);
+			}
+		}
+	}
+
+	// This queues a readable connection to be handled by a worker
+	// @param socket - the connection that is ready
+	void QueueConnection(SOCKET socket) {
+
+		m_mutex.Acquire();
+		m_ready.PushBack(socket);
+		m_mutex.Release();
+
+		m_ready_sem.Signal();
+	}
+
+	// This takes the oldest waiting connection. A worker only looks for a 
+	// connection once it has been signalled so there is always one to be
+	// found unless the reactor has been stopped.
+	// @param socket - this stores the connection taken
+	// @return true if a connection was taken, false if the worker should exit
+	bool TakeConnection(SOCKET &socket) {
+
+		m_ready_sem.Wait();
+
+		bool is_found = false;
+		m_mutex.Acquire();
+		if(m_ready.Size() > m_ready_head) {
+			socket = m_ready[m_ready_head++];
+			is_found = true;
+		}
+
+		if(m_ready.Size() <= m_ready_head) {
+			m_ready.Resize(0);
+			m_ready_head = 0;
+		}
+		m_mutex.Release();
+
+		return is_found;
+	}
+
+	// This is the entry function for each worker thread
+	static THREAD_RETURN1 THREAD_RETURN2 WorkerThread(void *ptr) {
+
+		CReactor *this_ptr = (CReactor *)ptr;
+		SOCKET socket;
+
+		while(this_ptr->TakeConnection(socket)) {
+
+			bool is_open = false;
+			try {
+				is_open = this_ptr->m_handler(socket, this_ptr->m_handler_ptr);
+			} catch(...) {
+				// the handler is responsible for closing the connection
+				cout<<"Connection Handler Failed"<<endl;
+			}
+
+			if(is_open == true) {
+				this_ptr->ArmConnection(socket, EPOLL_CTL_MOD);
+			}
+		}
+
+		return 0;
+	}
+
+	// This waits for the workers to finish the connections already 
+	// queued and releases the epoll instance
+	void Shutdown() {
+
+		for(int i=0; i<m_worker.OverflowSize(); i++) {
+			m_ready_sem.Signal();
+		}
+
+		for(int i=0; i<m_worker.OverflowSize(); i++) {
+			WaitForThread(m_worker[i], INFINITE);
+		}
+
+		m_mutex.Acquire();
+		m_worker.FreeMemory();
+		close(m_wake_pipe[0]);
+		close(m_wake_pipe[1]);
+		close(m_epoll);
+		m_epoll = -1;
+		m_mutex.Release();
+	}
+
+	// This returns true once the reactor has been told to stop
+	bool IsStopped() {
+
+		m_mutex.Acquire();
+		bool is_stop = m_is_stop;
+		m_mutex.Release();
+
+		return is_stop;
+	}
+
+public:
+
+	CReactor() {
+		m_epoll = -1;
+		m_ready_head = 0;
+		m_is_stop = false;
+		m_is_server_first = false;
+	}
+
+	// This registers the listening socket and starts the worker threads
+	// @param listen_socket - a socket that is already bound and listening
+	// @param worker_num - the number of worker threads used to handle connections
+	// @param handler - this is called by a worker each time a connection is 
+	//                - readable, it returns true to keep the connection open
+	//                - for the next request or false once it has closed it
+	// @param handler_ptr - this is passed to the handler
+	// @param is_server_first - true if the server sends first on a new connection,
+	//                        - the handler is then called as soon as it's accepted
+	void Initialize(SOCKET listen_socket, int worker_num,
+		bool (*handler)(SOCKET &socket, void *handler_ptr), void *handler_ptr,
+		bool is_server_first = false) {
+
+		if(worker_num <= 0) {
+			throw EIllegalArgumentException("Invalid Worker Number");
+		}
+
+		if(m_epoll >= 0) {
+			throw EException("Reactor Already Started");
+		}
+
+		m_handler = handler;
+		m_handler_ptr = handler_ptr;
+		m_listen_socket = listen_socket;
+		m_ready.Initialize();
+		m_ready_head = 0;
+		m_is_stop = false;
+		m_is_server_first = is_server_first;
+
+		int flags = fcntl(m_listen_socket, F_GETFL, 0);
+		if(flags < 0 || fcntl(m_listen_socket, F_SETFL, flags | O_NONBLOCK) < 0) {
+			throw ENetworkException("Could Not Make Socket Non Blocking");
+		}
+
+		m_epoll = epoll_create(MAX_EVENT_NUM);
+		if(m_epoll < 0) {
+			throw ENetworkException("Could Not Create Epoll");
+		}
+
+		if(pipe(m_wake_pipe) < 0) {
+			throw ENetworkException("Could Not Create Pipe");
+		}
+
+		struct epoll_event event;
+		event.events = EPOLLIN | EPOLLET;
+		event.data.fd = m_listen_socket;
+		if(epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_listen_socket, &event) < 0) {
+			throw ENetworkException("Could Not Register Socket");
+		}
+
+		event.events = EPOLLIN;
+		event.data.fd = m_wake_pipe[0];
+		if(epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake_pipe[0], &event) < 0) {
+			throw ENetworkException("Could Not Register Pipe");
+		}
+
+		unsigned int threadID;
+		m_worker.AllocateMemory(worker_num);
+		for(int i=0; i<worker_num; i++) {
+			m_worker[i] = _beginthreadex(NULL, 0, WorkerThread, this, NULL, &threadID);
+		}
+	}
+
+	// This returns the number of worker threads
+	inline int WorkerNum() {
+		return m_worker.OverflowSize();
+	}
+
+	// This runs the event loop on the calling thread until the reactor
+	// is stopped. Connections that are already queued are still handled
+	// before this returns.
+	void Run() {
+
+		CMemoryChunk<struct epoll_event> event(MAX_EVENT_NUM);
+
+		while(IsStopped() == false) {
+			int event_num = epoll_wait(m_epoll, event.Buffer(), MAX_EVENT_NUM, -1);
+			if(event_num < 0) {
+				if(errno == EINTR) {
+					continue;
+				}
+
+				Shutdown();
+				throw ENetworkException("Epoll Wait Error");
+			}
+
+			for(int i=0; i<event_num; i++) {
+				SOCKET socket = event[i].data.fd;
+				if(socket == m_listen_socket) {
+					AcceptConnections();
+					continue;
+				}
+
+				if(socket == m_wake_pipe[0]) {
+					continue;
+				}
+
+				if((event[i].events & EPOLLIN) == 0) {
+					// the client hung up without sending a request
+					closesocket(socket);
+					continue;
+				}
+
+				QueueConnection(socket);
+			}
+		}
+
+		Shutdown();
+	}
+
+	// This tells the event loop to stop, it can be called from
+	// any thread including one of the handlers
+	void Stop() {
+
+		char wake = 0;
+		m_mutex.Acquire();
+		if(m_is_stop == false && m_epoll >= 0) {
+			m_is_stop = true;
+			if(write(m_wake_pipe[1], &wake, sizeof(char)) < 0) {
+				cout<<"Could Not Wake Reactor"<<endl;
+			}
+		}
+		m_mutex.Release();
+	}
+};
+
+#endif
@@ -602,6 +602,303 @@ int CProcessSet::m_timeout;
 bool CProcessSet::m_is_restart_process;
 #endif
 
+// This is a pool of resident worker threads used to run tasks inside
+// the current process rather than spawning a process for every task.
+// Each worker owns a queue of tasks. A worker runs the newest task on
+// its own queue and once that's empty steals the oldest task from the
+// queue of another worker, so no worker is left idle while there is
+// work queued anywhere in the pool.
+class CTaskPool {
+
+public:
+
+	// This defines a task run by one of the workers
+	struct STask {
+		// This is the function that runs the task
+		void (*func)(void *task_ptr);
+		// This is passed to the function
+		void *task_ptr;
+	};
+
+private:
+
+	// This stores a single worker along with its queue of tasks
+	struct SWorker {
+		// This stores a ptr to the pool
+		CTaskPool *this_ptr;
+		// This stores the id of the worker
+		int id;
+		// This stores the handle of the worker thread
+		pthread_t handle;
+		// This stores the queued tasks
+		CArrayList<STask> task;
+		// This stores the index of the oldest queued task
+		int head;
+		// This protects the queue
+		CMutex mutex;
+	};
+
+	// This stores the set of workers
+	CMemoryChunk<SWorker> m_worker;
+	// This is signalled once for every task added and once 
+	// for every worker when the pool is stopped
+	CSemaphore m_task_sem;
+	// This is signalled when the last pending task finishes
+	CSemaphore m_finish_sem;
+	// This protects the pending task count
+	CMutex m_mutex;
+	// This stores the number of tasks added but not yet finished
+	int m_pending_num;
+	// This stores the number of tasks that threw an exception
+	int m_fail_num;
+	// This stores the worker that the next task is queued on
+	int m_next_worker;
+	// This is true when a thread is waiting for the tasks to finish
+	bool m_is_waiting;
+	// This is true once the workers have been told to exit
+	bool m_is_stopped;
+
+	// This takes the newest task from a worker's own queue
+	// @param worker - the worker taking the task
+	// @param task - this stores the task taken
+	// @return true if a task was taken, false otherwise
+	bool PopTask(SWorker &worker, STask &task) {
+
+		bool is_found = false;
+		worker.mutex.Acquire();
+		if(worker.task.Size() > worker.head) {
+			task = worker.task.PopBack();
+			is_found = true;
+		}
+
+		if(worker.task.Size() <= worker.head) {
+			worker.task.Resize(0);
+			worker.head = 0;
+		}
+		worker.mutex.Release();
+
+		return is_found;
+	}
+
+	// This steals the oldest task from another worker's queue
+	// @param worker - the worker being stolen from
+	// @param task - this stores the task taken
+	// @return true if a task was taken, false otherwise
+	bool StealTask(SWorker &worker, STask &task) {
+
+		bool is_found = false;
+		worker.mutex.Acquire();
+		if(worker.task.Size() > worker.head) {
+			task = worker.task[worker.head++];
+			is_found = true;
+		}
+
+		if(worker.task.Size() <= worker.head) {
+			worker.task.Resize(0);
+			worker.head = 0;
+		}
+		worker.mutex.Release();
+
+		return is_found;
+	}
+
+	// This finds the next task for a worker. A worker only looks for a
+	// task once it has been signalled so there is always a task to be 
+	// found unless the pool has been stopped.
+	// @param id - the id of the worker looking for a task
+	// @param task - this stores the task taken
+	// @return true if a task was taken, false if the worker should exit
+	bool TakeTask(int id, STask &task) {
+
+		while(true) {
+			if(PopTask(m_worker[id], task)) {
+				return true;
+			}
+
+			for(int i=1; i<m_worker.OverflowSize(); i++) {
+				if(StealTask(m_worker[(id + i) % m_worker.OverflowSize()], task)) {
+					return true;
+				}
+			}
+
+			m_mutex.Acquire();
+			bool is_stopped = m_is_stopped;
+			m_mutex.Release();
+
+			if(is_stopped == true) {
+				return false;
+			}
+		}
+
+		return false;
+	}
+
+	// This is called once a task has finished
+	// @param is_failed - true if the task threw an exception
+	void FinishTask(bool is_failed) {
+
+		m_mutex.Acquire();
+		if(is_failed == true) {
+			m_fail_num++;
+		}
+
+		if(--m_pending_num == 0 && m_is_waiting == true) {
+			m_is_waiting = false;
+			m_finish_sem.Signal();
+		}
+		m_mutex.Release();
+	}
+
+	// This is the entry function for each worker thread
+	static THREAD_RETURN1 THREAD_RETURN2 WorkerThread(void *ptr) {
+
+		SWorker *worker = (SWorker *)ptr;
+		CTaskPool *pool = worker->this_ptr;
+		STask task;
+
+		while(true) {
+			pool->m_task_sem.Wait();
+			if(pool->TakeTask(worker->id, task) == false) {
+				break;
+			}
+
+			bool is_failed = true;
+			try {
+				task.func(task.task_ptr);
+				is_failed = false;
+			} catch(EException &e) {
+				e.PrintException("Task Failed:");
+			} catch(bad_alloc &e) {
+				cout<<"Task Failed: Out Of Memory"<<endl;
+			} catch(...) {
+				cout<<"Task Failed: Unknown Exception"<<endl;
+			}
+
+			pool->FinishTask(is_failed);
+		}
+
+		return 0;
+	}
+
+public:
+
+	CTaskPool() {
+		m_pending_num = 0;
+		m_fail_num = 0;
+		m_next_worker = 0;
+		m_is_waiting = false;
+		m_is_stopped = false;
+	}
+
+	// This starts the worker threads
+	// @param worker_num - the number of worker threads
+	void Initialize(int worker_num) {
+
+		if(worker_num <= 0) {
+			throw EIllegalArgumentException("Invalid Worker Number");
+		}
+
+		if(m_worker.OverflowSize() > 0) {
+			throw EException("Task Pool Already Started");
+		}
+
+		m_worker.AllocateMemory(worker_num);
+		for(int i=0; i<worker_num; i++) {
+			m_worker[i].this_ptr = this;
+			m_worker[i].id = i;
+			m_worker[i].head = 0;
+			m_worker[i].task.Initialize();
+		}
+
+		unsigned int threadID;
+		for(int i=0; i<worker_num; i++) {
+			m_worker[i].handle = _beginthreadex(NULL, 0, 
+				WorkerThread, &m_worker[i], NULL, &threadID);
+		}
+	}
+
+	// This returns the number of worker threads
+	inline int WorkerNum() {
+		return m_worker.OverflowSize();
+	}
+
+	// This queues a task to be run by one of the workers, tasks 
+	// are spread across the worker queues in turn
+	// @param func - the function that runs the task
+	// @param task_ptr - this is passed to the function
+	void AddTask(void (*func)(void *task_ptr), void *task_ptr) {
+
+		STask task;
+		task.func = func;
+		task.task_ptr = task_ptr;
+
+		m_mutex.Acquire();
+		m_pending_num++;
+		SWorker &worker = m_worker[m_next_worker];
+		m_next_worker = (m_next_worker + 1) % m_worker.OverflowSize();
+		m_mutex.Release();
+
+		worker.mutex.Acquire();
+		worker.task.PushBack(task);
+		worker.mutex.Release();
+
+		m_task_sem.Signal();
+	}
+
+	// This waits for every task that has been added to finish
+	// @return the number of tasks that threw an exception
+	int WaitForTasks() {
+
+		m_mutex.Acquire();
+		if(m_pending_num == 0) {
+			int fail_num = m_fail_num;
+			m_fail_num = 0;
+			m_mutex.Release();
+			return fail_num;
+		}
+
+		m_is_waiting = true;
+		m_mutex.Release();
+		m_finish_sem.Wait();
+
+		m_mutex.Acquire();
+		int fail_num = m_fail_num;
+		m_fail_num = 0;
+		m_mutex.Release();
+
+		return fail_num;
+	}
+
+	// This finishes any queued tasks and then stops the workers
+	void Stop() {
+
+		if(m_worker.OverflowSize() == 0) {
+			return;
+		}
+
+		WaitForTasks();
+
+		m_mutex.Acquire();
+		m_is_stopped = true;
+		m_mutex.Release();
+
+		for(int i=0; i<m_worker.OverflowSize(); i++) {
+			m_task_sem.Signal();
+		}
+
+		for(int i=0; i<m_worker.OverflowSize(); i++) {
+			WaitForThread(m_worker[i].handle, INFINITE);
+		}
+
+		m_worker.FreeMemory();
+		m_is_stopped = false;
+	}
+
+	~CTaskPool() {
+		Stop();
+	}
+};
+
 // The maximum number of map reduce tasks
 int m_max_process_num = 8;
 
@@ -737,9 +1034,13 @@ class CMapReduce : public CNodeStat {
 		m_conn.SendUDP(work_dir, work_dir_length);
 		m_conn.SendUDP(data_type, data_type_length);
 
-		char success = 'f';
+		char success = 'e';
 		m_conn.ReceiveUDP(&success, 1);
 		m_conn.CloseConnection();
+
+		if(success != 'f') {
+			throw EException("MapReduce Request Failed");
+		}
 	}
 
 	// This issues the request to the MapReduce server
@@ -249,6 +249,11 @@ make clean
 make
 cd ..
 
+cd PulseRankGraph
+make clean
+make
+cd ..
+
 cd ..
 
 cd DyableClusterGraph
@@ -268,6 +273,11 @@ make clean
 make
 cd ..
 
+cd WavePassGraph
+make clean
+make
+cd ..
+
 cd ..
 
 cd MergeLinkClusters